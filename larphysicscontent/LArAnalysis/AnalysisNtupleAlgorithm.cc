@@ -46,12 +46,45 @@ AnalysisNtupleAlgorithm::AnalysisNtupleAlgorithm() :
     m_spTmpRegistry(nullptr),
     m_spPlotsRegistry(nullptr),
     m_ntupleVariableTools(),
+    m_spGeometryContext(nullptr),
     m_batchMode(false)
 {
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+AnalysisNtupleAlgorithm::~AnalysisNtupleAlgorithm()
+{
+    if (!m_spNtuple)
+        return;
+
+    // The ntuple is still written without its event index, so report the failure rather than throw from the destructor
+    try
+    {
+        m_spNtuple->Finalise();
+    }
+
+    catch (const StatusCodeException &statusCodeException)
+    {
+        std::cerr << "AnalysisNtupleAlgorithm: Failed to finalise the ntuple: " << statusCodeException.ToString() << std::endl;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+StatusCode AnalysisNtupleAlgorithm::Initialize()
+{
+    // The geometry is fixed for the run, so read it once here and share the snapshot with every tool
+    m_spGeometryContext = std::make_shared<const LArGeometryContext>(this->GetPandora());
+
+    for (NtupleVariableBaseTool *const pNtupleTool : m_ntupleVariableTools)
+        pNtupleTool->SetGeometryContext(m_spGeometryContext);
+
+    return STATUS_CODE_SUCCESS;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 StatusCode AnalysisNtupleAlgorithm::Run()
 {
     ++m_eventNumber;
@@ -499,9 +532,15 @@ void AnalysisNtupleAlgorithm::RegisterNtupleRecords(const int hypothesisId, cons
 {
     std::cout << "AnalysisNtupleAlgorithm: Preparing ntuple tools for new event" << std::endl;
 
+    // Index the 3D-2D hit relationships once, for all the tools to share
+    m_spNtuple->PrepareEvent(pfoList);
+
     // Prepare the tools
     for (NtupleVariableBaseTool *const pNtupleTool : m_ntupleVariableTools)
-        pNtupleTool->PrepareEventWrapper(this, pfoList, eventValidationInfo);
+    {
+        if (pNtupleTool->IsEnabledForAny())
+            pNtupleTool->PrepareEventWrapper(this, pfoList, eventValidationInfo);
+    }
 
     std::cout << "AnalysisNtupleAlgorithm: Registering cosmic records" << std::endl;
 
@@ -536,6 +575,9 @@ void AnalysisNtupleAlgorithm::RegisterNtupleRecords(const int hypothesisId, cons
     // Register the per-event records
     for (NtupleVariableBaseTool *const pNtupleTool : m_ntupleVariableTools)
     {
+        if (!pNtupleTool->IsEnabledForEvents())
+            continue;
+
         for (const LArNtupleRecord &record : pNtupleTool->ProcessEventWrapper(this, pfoList, eventValidationInfo))
             m_spNtuple->AddScalarRecord(record);
     }
@@ -592,6 +634,29 @@ StatusCode AnalysisNtupleAlgorithm::ReadSettings(const TiXmlHandle xmlHandle)
 
     m_spNtuple = std::shared_ptr<LArNtuple>(new LArNtuple(m_ntupleOutputFile, m_ntupleTreeName, m_ntupleTreeTitle, m_appendNtuple));
 
+    // Optionally write only a selection of branches, always keeping the reserved per-event branches
+    StringVector branchSelection;
+    PANDORA_RETURN_RESULT_IF_AND_IF(
+        STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=, XmlHelper::ReadVectorOfValues(xmlHandle, "BranchSelection", branchSelection));
+
+    if (!branchSelection.empty())
+    {
+        branchSelection.insert(branchSelection.end(),
+            {"fileId", "eventNum", "hypothesisId", "numNeutrinoEntries", "numCosmicRayEntries", "numPrimaryEntries", "hasMcInfo"});
+    }
+
+    m_spNtuple->SetBranchSelection(std::move(branchSelection));
+
+    // Optionally record the range of some per-event branches in each cluster of entries, for readers to skip clusters that fail their cuts
+    StringVector zoneMapBranches;
+    unsigned int zoneMapClusterSize(1000U);
+    PANDORA_RETURN_RESULT_IF_AND_IF(
+        STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=, XmlHelper::ReadVectorOfValues(xmlHandle, "ZoneMapBranches", zoneMapBranches));
+    PANDORA_RETURN_RESULT_IF_AND_IF(
+        STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=, XmlHelper::ReadValue(xmlHandle, "ZoneMapClusterSize", zoneMapClusterSize));
+
+    m_spNtuple->SetZoneMapBranches(std::move(zoneMapBranches), zoneMapClusterSize);
+
     // Downcast and store the algorithm tools
     AlgorithmToolVector validationToolVector;
     PANDORA_RETURN_RESULT_IF(STATUS_CODE_SUCCESS, !=, XmlHelper::ProcessAlgorithmToolList(*this, xmlHandle, "EventValidationTools", validationToolVector));
@@ -10,6 +10,7 @@
 
 #include "larphysicscontent/LArAnalysis/EventValidationTool.h"
 #include "larphysicscontent/LArNtuple/LArNtuple.h"
+#include "larphysicscontent/LArObjects/LArGeometryContext.h"
 #include "larphysicscontent/LArObjects/LArRootRegistry.h"
 
 #include "Pandora/Algorithm.h"
@@ -29,9 +30,9 @@ public:
     AnalysisNtupleAlgorithm();
 
     /**
-     *  @brief  Default copy constructor
+     *  @brief  Deleted copy constructor
      */
-    AnalysisNtupleAlgorithm(const AnalysisNtupleAlgorithm &) = default;
+    AnalysisNtupleAlgorithm(const AnalysisNtupleAlgorithm &) = delete;
 
     /**
      *  @brief  Default move constructor
@@ -39,9 +40,9 @@ public:
     AnalysisNtupleAlgorithm(AnalysisNtupleAlgorithm &&) = default;
 
     /**
-     *  @brief  Default copy assignment operator
+     *  @brief  Deleted copy assignment operator
      */
-    AnalysisNtupleAlgorithm &operator=(const AnalysisNtupleAlgorithm &) = default;
+    AnalysisNtupleAlgorithm &operator=(const AnalysisNtupleAlgorithm &) = delete;
 
     /**
      *  @brief  Default move assignment operator
@@ -49,11 +50,12 @@ public:
     AnalysisNtupleAlgorithm &operator=(AnalysisNtupleAlgorithm &&) = default;
 
     /**
-     *  @brief  Default destructor
+     *  @brief  Destructor, finalising the ntuple at the end of the job
      */
-    ~AnalysisNtupleAlgorithm() = default;
+    ~AnalysisNtupleAlgorithm();
 
 protected:
+    pandora::StatusCode Initialize();
     pandora::StatusCode ReadSettings(const pandora::TiXmlHandle xmlHandle);
     pandora::StatusCode Run();
 
@@ -66,29 +68,30 @@ private:
     using VectorRecordProcessor = std::function<std::vector<LArNtupleRecord>(NtupleVariableBaseTool *const,
         const pandora::ParticleFlowObject *const, const std::shared_ptr<std::decay_t<T>> &)>; ///< Alias for a vector record processor
 
-    unsigned int                          m_eventNumber;              ///< The current event number
-    EventValidationTool *                 m_pEventValidationTool;     ///< Address of the event validation tool
-    std::string                           m_caloHitListName;          ///< The CaloHit list name
-    std::string                           m_mcParticleListName;       ///< The MCParticle list name
-    bool                                  m_printValidation;          ///< Whether to print the validation
-    bool                                  m_produceAllOutcomes;       ///< Whether to produce all outcomes
-    std::string                           m_pfoListName;              ///< If not all outcomes, the PFO list to use
-    std::string                           m_ntupleOutputFile;         ///< The ntuple ROOT tree output file
-    std::string                           m_ntupleTreeName;           ///< The ntuple ROOT tree name
-    std::string                           m_ntupleTreeTitle;          ///< The ntuple ROOT tree title
-    std::string                           m_plotsOutputFile;          ///< The plots ROOT output file
-    std::string                           m_tmpOutputFile;            ///< The tmp ROOT output file
-    std::shared_ptr<LArNtuple>            m_spNtuple;                 ///< Shared pointer to the ntuple
-    int                                   m_fileIdentifier;           ///< The input file identifier
-    bool                                  m_appendNtuple;             ///< Whether to append to an existing ntuple
-    pandora::CartesianVector              m_fiducialRegion1MinCoords; ///< The minimum fiducial coordinates of region 1
-    pandora::CartesianVector              m_fiducialRegion1MaxCoords; ///< The maximum fiducial coordinates of region 2
-    pandora::CartesianVector              m_fiducialRegion2MinCoords; ///< The minimum fiducial coordinates of region 2
-    pandora::CartesianVector              m_fiducialRegion2MaxCoords; ///< The maximum fiducial coordinates of region 2
-    std::shared_ptr<LArRootRegistry>      m_spTmpRegistry;            ///< Shared pointer to the tmp ROOT registry
-    std::shared_ptr<LArRootRegistry>      m_spPlotsRegistry;          ///< Shared pointer to the plots ROOT registry
-    std::vector<NtupleVariableBaseTool *> m_ntupleVariableTools;      ///< The ntuple variable tools
-    bool                                  m_batchMode;                ///< Whether to run in batch mode
+    unsigned int                              m_eventNumber;              ///< The current event number
+    EventValidationTool *                     m_pEventValidationTool;     ///< Address of the event validation tool
+    std::string                               m_caloHitListName;          ///< The CaloHit list name
+    std::string                               m_mcParticleListName;       ///< The MCParticle list name
+    bool                                      m_printValidation;          ///< Whether to print the validation
+    bool                                      m_produceAllOutcomes;       ///< Whether to produce all outcomes
+    std::string                               m_pfoListName;              ///< If not all outcomes, the PFO list to use
+    std::string                               m_ntupleOutputFile;         ///< The ntuple ROOT tree output file
+    std::string                               m_ntupleTreeName;           ///< The ntuple ROOT tree name
+    std::string                               m_ntupleTreeTitle;          ///< The ntuple ROOT tree title
+    std::string                               m_plotsOutputFile;          ///< The plots ROOT output file
+    std::string                               m_tmpOutputFile;            ///< The tmp ROOT output file
+    std::shared_ptr<LArNtuple>                m_spNtuple;                 ///< Shared pointer to the ntuple
+    int                                       m_fileIdentifier;           ///< The input file identifier
+    bool                                      m_appendNtuple;             ///< Whether to append to an existing ntuple
+    pandora::CartesianVector                  m_fiducialRegion1MinCoords; ///< The minimum fiducial coordinates of region 1
+    pandora::CartesianVector                  m_fiducialRegion1MaxCoords; ///< The maximum fiducial coordinates of region 2
+    pandora::CartesianVector                  m_fiducialRegion2MinCoords; ///< The minimum fiducial coordinates of region 2
+    pandora::CartesianVector                  m_fiducialRegion2MaxCoords; ///< The maximum fiducial coordinates of region 2
+    std::shared_ptr<LArRootRegistry>          m_spTmpRegistry;            ///< Shared pointer to the tmp ROOT registry
+    std::shared_ptr<LArRootRegistry>          m_spPlotsRegistry;          ///< Shared pointer to the plots ROOT registry
+    std::vector<NtupleVariableBaseTool *>     m_ntupleVariableTools;      ///< The ntuple variable tools
+    std::shared_ptr<const LArGeometryContext> m_spGeometryContext;        ///< Shared pointer to the per-run geometry context
+    bool                                      m_batchMode;                ///< Whether to run in batch mode
 
     /**
      *  @brief  Collect all possible PFO outcomes
@@ -229,13 +232,17 @@ std::size_t AnalysisNtupleAlgorithm::RegisterVectorRecords(const pandora::PfoLis
         const auto        findIter   = pfoToMcObjectMap.find(pPfo);
         const TSharedPtr &spMcObject = (findIter == pfoToMcObjectMap.end()) ? nullptr : findIter->second;
 
+        if (spMcObject)
+            encounteredMcObjects.insert(spMcObject);
+
         for (NtupleVariableBaseTool *const pNtupleTool : m_ntupleVariableTools)
         {
+            // Tools disabled for this category are not called, so their branches are absent rather than computed and discarded
+            if (!pNtupleTool->IsEnabledFor(type))
+                continue;
+
             for (const LArNtupleRecord &record : processor(pNtupleTool, pPfo, spMcObject))
                 m_spNtuple->AddVectorRecordElement(record, type);
-
-            if (spMcObject)
-                encounteredMcObjects.insert(spMcObject);
         }
 
         m_spNtuple->FillVectors(type);
@@ -251,6 +258,9 @@ std::size_t AnalysisNtupleAlgorithm::RegisterVectorRecords(const pandora::PfoLis
 
         for (NtupleVariableBaseTool *const pNtupleTool : m_ntupleVariableTools)
         {
+            if (!pNtupleTool->IsEnabledFor(type))
+                continue;
+
             for (const LArNtupleRecord &record : processor(pNtupleTool, nullptr, spMcObject))
                 m_spNtuple->AddVectorRecordElement(record, type);
         }
@@ -8,6 +8,7 @@
 
 #include "larphysicscontent/LArAnalysis/CommonMCNtupleTool.h"
 #include "larphysicscontent/LArHelpers/LArAnalysisHelper.h"
+#include "larphysicscontent/LArHelpers/LArNtupleHelper.h"
 
 #include "larpandoracontent/LArHelpers/LArMCParticleHelper.h"
 
@@ -47,7 +48,8 @@ std::vector<LArNtupleRecord> CommonMCNtupleTool::ProcessEvent(const PfoList &, c
 std::vector<LArNtupleRecord> CommonMCNtupleTool::ProcessNeutrino(
     const ParticleFlowObject *const pPfo, const PfoList &pfoList, const std::shared_ptr<LArInteractionValidationInfo> &spInteractionInfo)
 {
-    std::vector<LArNtupleRecord> records;
+    std::vector<LArNtupleRecord>     records;
+    const LArNtupleRecord::Precision cosinePrecision(LArNtupleHelper::GetDirectionCosinePrecision());
 
     const MCParticle *const      pMCParticle         = spInteractionInfo ? spInteractionInfo->GetMcNeutrino() : nullptr;
     std::vector<LArNtupleRecord> genericPfoMCRecords = this->ProduceGenericPfoMCRecords(pPfo, pfoList, pMCParticle);
@@ -76,9 +78,12 @@ std::vector<LArNtupleRecord> CommonMCNtupleTool::ProcessNeutrino(
         records.emplace_back("mc_VisibleEnergy", static_cast<LArNtupleRecord::RFloat>(visibleEnergy));
         records.emplace_back("mc_VisibleLongitudinalEnergy", static_cast<LArNtupleRecord::RFloat>(visibleLongitudinalEnergy));
         records.emplace_back("mc_VisibleTranverseEnergy", static_cast<LArNtupleRecord::RFloat>(visibleTranverseEnergy));
-        records.emplace_back("mc_VisibleInitialDirectionX", static_cast<LArNtupleRecord::RFloat>(visibleInitialDirection.GetX()));
-        records.emplace_back("mc_VisibleInitialDirectionY", static_cast<LArNtupleRecord::RFloat>(visibleInitialDirection.GetY()));
-        records.emplace_back("mc_VisibleInitialDirectionZ", static_cast<LArNtupleRecord::RFloat>(visibleInitialDirection.GetZ()));
+        records.emplace_back(
+            "mc_VisibleInitialDirectionX", static_cast<LArNtupleRecord::RFloat>(visibleInitialDirection.GetX()), cosinePrecision);
+        records.emplace_back(
+            "mc_VisibleInitialDirectionY", static_cast<LArNtupleRecord::RFloat>(visibleInitialDirection.GetY()), cosinePrecision);
+        records.emplace_back(
+            "mc_VisibleInitialDirectionZ", static_cast<LArNtupleRecord::RFloat>(visibleInitialDirection.GetZ()), cosinePrecision);
     }
 
     else // null values for size consistency
@@ -88,9 +93,9 @@ std::vector<LArNtupleRecord> CommonMCNtupleTool::ProcessNeutrino(
         records.emplace_back("mc_VisibleEnergy", static_cast<LArNtupleRecord::RFloat>(0.f));
         records.emplace_back("mc_VisibleLongitudinalEnergy", static_cast<LArNtupleRecord::RFloat>(0.f));
         records.emplace_back("mc_VisibleTranverseEnergy", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_VisibleInitialDirectionX", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_VisibleInitialDirectionY", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_VisibleInitialDirectionZ", static_cast<LArNtupleRecord::RFloat>(0.f));
+        records.emplace_back("mc_VisibleInitialDirectionX", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
+        records.emplace_back("mc_VisibleInitialDirectionY", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
+        records.emplace_back("mc_VisibleInitialDirectionZ", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
     }
 
     return records;
@@ -135,7 +140,9 @@ std::vector<LArNtupleRecord> CommonMCNtupleTool::ProcessCosmicRay(
 std::vector<LArNtupleRecord> CommonMCNtupleTool::ProduceGenericPfoMCRecords(
     const ParticleFlowObject *const, const PfoList &, const MCParticle *const pMCParticle) const
 {
-    std::vector<LArNtupleRecord> records;
+    std::vector<LArNtupleRecord>     records;
+    const LArNtupleRecord::Precision cosinePrecision(LArNtupleHelper::GetDirectionCosinePrecision());
+    const LArNtupleRecord::Precision fractionPrecision(LArNtupleHelper::GetFractionPrecision());
     records.emplace_back("HasMCInfo", static_cast<LArNtupleRecord::RBool>(pMCParticle));
 
     if (pMCParticle)
@@ -156,11 +163,11 @@ std::vector<LArNtupleRecord> CommonMCNtupleTool::ProduceGenericPfoMCRecords(
         records.emplace_back("mc_MomentumX", static_cast<LArNtupleRecord::RFloat>(momentum.GetX()));
         records.emplace_back("mc_MomentumY", static_cast<LArNtupleRecord::RFloat>(momentum.GetY()));
         records.emplace_back("mc_MomentumZ", static_cast<LArNtupleRecord::RFloat>(momentum.GetZ()));
-        records.emplace_back("mc_DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(initialDirection.GetX()));
-        records.emplace_back("mc_DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(initialDirection.GetY()));
-        records.emplace_back("mc_DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(initialDirection.GetZ()));
-        records.emplace_back(
-            "mc_EnergyWeightedContainedPfoFraction", static_cast<LArNtupleRecord::RFloat>(this->CalculateContainmentFraction(pMCParticle)));
+        records.emplace_back("mc_DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(initialDirection.GetX()), cosinePrecision);
+        records.emplace_back("mc_DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(initialDirection.GetY()), cosinePrecision);
+        records.emplace_back("mc_DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(initialDirection.GetZ()), cosinePrecision);
+        records.emplace_back("mc_EnergyWeightedContainedPfoFraction",
+            static_cast<LArNtupleRecord::RFloat>(this->CalculateContainmentFraction(pMCParticle)), fractionPrecision);
     }
 
     else // null values for size consistency
@@ -175,10 +182,10 @@ std::vector<LArNtupleRecord> CommonMCNtupleTool::ProduceGenericPfoMCRecords(
         records.emplace_back("mc_MomentumX", static_cast<LArNtupleRecord::RFloat>(0.f));
         records.emplace_back("mc_MomentumY", static_cast<LArNtupleRecord::RFloat>(0.f));
         records.emplace_back("mc_MomentumZ", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_EnergyWeightedContainedPfoFraction", static_cast<LArNtupleRecord::RFloat>(0.f));
+        records.emplace_back("mc_DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
+        records.emplace_back("mc_DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
+        records.emplace_back("mc_DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
+        records.emplace_back("mc_EnergyWeightedContainedPfoFraction", static_cast<LArNtupleRecord::RFloat>(0.f), fractionPrecision);
     }
 
     return records;
@@ -105,8 +105,9 @@ std::vector<LArNtupleRecord> CommonNtupleTool::ProcessCosmicRay(
 
 std::vector<LArNtupleRecord> CommonNtupleTool::ProduceGenericPfoRecords(const ParticleFlowObject *const pPfo, const PfoList &) const
 {
-    std::vector<LArNtupleRecord> records;
-    const Vertex *const          pVertex = pPfo ? this->GetSingleVertex(pPfo) : nullptr;
+    std::vector<LArNtupleRecord>     records;
+    const LArNtupleRecord::Precision fractionPrecision(LArNtupleHelper::GetFractionPrecision());
+    const Vertex *const              pVertex = pPfo ? this->GetSingleVertex(pPfo) : nullptr;
     records.emplace_back("WasReconstructedWithVertex", static_cast<LArNtupleRecord::RBool>(pVertex));
 
     if (pVertex)
@@ -117,7 +118,8 @@ std::vector<LArNtupleRecord> CommonNtupleTool::ProduceGenericPfoRecords(const Pa
         records.emplace_back("VertexX", static_cast<LArNtupleRecord::RFloat>(vertexPosition.GetX()));
         records.emplace_back("VertexY", static_cast<LArNtupleRecord::RFloat>(vertexPosition.GetY()));
         records.emplace_back("VertexZ", static_cast<LArNtupleRecord::RFloat>(vertexPosition.GetZ()));
-        records.emplace_back("FiducialThreeDHitFraction", static_cast<LArNtupleRecord::RFloat>(this->GetFractionOfFiducialThreeDHits(pPfo)));
+        records.emplace_back("FiducialThreeDHitFraction",
+            static_cast<LArNtupleRecord::RFloat>(this->GetFractionOfFiducialThreeDHits(pPfo)), fractionPrecision);
         records.emplace_back("NumberOfThreeDHits", static_cast<LArNtupleRecord::RUInt>(this->GetAllDownstreamThreeDHits(pPfo).size()));
         records.emplace_back("NumberOfTwoDHits", static_cast<LArNtupleRecord::RUInt>(this->GetAllDownstreamTwoDHits(pPfo).size()));
         records.emplace_back("NumberOfCollectionPlaneHits", static_cast<LArNtupleRecord::RUInt>(this->GetAllDownstreamWHits(pPfo).size()));
@@ -130,7 +132,7 @@ std::vector<LArNtupleRecord> CommonNtupleTool::ProduceGenericPfoRecords(const Pa
         records.emplace_back("VertexX", static_cast<LArNtupleRecord::RFloat>(0.f));
         records.emplace_back("VertexY", static_cast<LArNtupleRecord::RFloat>(0.f));
         records.emplace_back("VertexZ", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("FiducialThreeDHitFraction", static_cast<LArNtupleRecord::RFloat>(0.f));
+        records.emplace_back("FiducialThreeDHitFraction", static_cast<LArNtupleRecord::RFloat>(0.f), fractionPrecision);
         records.emplace_back("NumberOfThreeDHits", static_cast<LArNtupleRecord::RUInt>(0U));
         records.emplace_back("NumberOfTwoDHits", static_cast<LArNtupleRecord::RUInt>(0U));
         records.emplace_back("NumberOfCollectionPlaneHits", static_cast<LArNtupleRecord::RUInt>(0U));
@@ -144,8 +146,9 @@ std::vector<LArNtupleRecord> CommonNtupleTool::ProduceGenericPfoRecords(const Pa
 
 std::vector<LArNtupleRecord> CommonNtupleTool::ProduceNonNeutrinoPfoRecords(const ParticleFlowObject *const pPfo, const PfoList &) const
 {
-    std::vector<LArNtupleRecord> records;
-    const Vertex *const          pVertex = pPfo ? this->GetSingleVertex(pPfo) : nullptr;
+    std::vector<LArNtupleRecord>     records;
+    const LArNtupleRecord::Precision cosinePrecision(LArNtupleHelper::GetDirectionCosinePrecision());
+    const Vertex *const              pVertex = pPfo ? this->GetSingleVertex(pPfo) : nullptr;
 
     if (pVertex)
     {
@@ -155,18 +158,18 @@ std::vector<LArNtupleRecord> CommonNtupleTool::ProduceNonNeutrinoPfoRecords(cons
 
         records.emplace_back("IsShower", static_cast<LArNtupleRecord::RBool>(isShower));
         records.emplace_back("IsTrack", static_cast<LArNtupleRecord::RBool>(!isShower));
-        records.emplace_back("DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(directionCosines.GetX()));
-        records.emplace_back("DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(directionCosines.GetY()));
-        records.emplace_back("DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(directionCosines.GetZ()));
+        records.emplace_back("DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(directionCosines.GetX()), cosinePrecision);
+        records.emplace_back("DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(directionCosines.GetY()), cosinePrecision);
+        records.emplace_back("DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(directionCosines.GetZ()), cosinePrecision);
     }
 
     else // null values for size consistency
     {
         records.emplace_back("IsShower", static_cast<LArNtupleRecord::RBool>(false));
         records.emplace_back("IsTrack", static_cast<LArNtupleRecord::RBool>(false));
-        records.emplace_back("DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(0.f));
+        records.emplace_back("DirectionCosineX", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
+        records.emplace_back("DirectionCosineY", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
+        records.emplace_back("DirectionCosineZ", static_cast<LArNtupleRecord::RFloat>(0.f), cosinePrecision);
     }
 
     return records;
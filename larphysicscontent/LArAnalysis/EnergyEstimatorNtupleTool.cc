@@ -9,7 +9,7 @@
 #include "larphysicscontent/LArAnalysis/EnergyEstimatorNtupleTool.h"
 #include "larphysicscontent/LArObjects/LArRootRegistry.h"
 
-#include "larpandoracontent/LArHelpers/LArGeometryHelper.h"
+#include "larpandoracontent/LArHelpers/LArPcaHelper.h"
 #include "larpandoracontent/LArHelpers/LArPfoHelper.h"
 
 #include "Pandora/AlgorithmHeaders.h"
@@ -20,22 +20,339 @@
 #include "TLatex.h"
 #include "TTreeReader.h"
 
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
 using namespace pandora;
 using namespace lar_content;
 
+namespace
+{
+/**
+ *  @brief  Get the plot colour scheme index for a particle
+ *
+ *  @param  particleId the PDG code
+ *
+ *  @return the colour scheme index
+ */
+unsigned int GetPlotColour(const int particleId)
+{
+    switch (std::abs(particleId))
+    {
+        case 13:
+            return 0U;
+        case 211:
+            return 1U;
+        case 321:
+            return 2U;
+        case 2212:
+            return 3U;
+        default:
+            return 7U;
+    }
+}
+
+/**
+ *  @brief  Get the plot label for a particle
+ *
+ *  @param  particleId the PDG code
+ *
+ *  @return the LaTeX particle symbol
+ */
+std::string GetPlotParticleSymbol(const int particleId)
+{
+    switch (particleId)
+    {
+        case 13:
+            return "\\mu";
+        case 211:
+            return "\\pi^+";
+        case -211:
+            return "\\pi^-";
+        case 321:
+            return "K^+\\";
+        case -321:
+            return "K^-\\";
+        case 2212:
+            return "p\\";
+        default:
+            return "\\text{PDG " + std::to_string(particleId) + "}";
+    }
+}
+} // namespace
+
 namespace lar_physics_content
 {
 
-EnergyEstimatorNtupleTool::HitCalorimetryInfo::HitCalorimetryInfo() :
-    m_projectionSuccessful(false),
-    m_threeDPosition(0.f, 0.f, 0.f),
-    m_projectionError(0.f),
-    m_coordinate(0.f),
-    m_dQ(0.f),
-    m_dX(0.f),
-    m_isNoise(false),
-    m_isFake(false)
+void EnergyEstimatorNtupleTool::HitCalorimetryBuffer::Clear()
+{
+    m_isValid.clear();
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_projectionError.clear();
+    m_coordinate.clear();
+    m_dQ.clear();
+    m_dX.clear();
+    m_residualRange.clear();
+    m_dQdx.clear();
+    m_dEdx.clear();
+    m_order.clear();
+    m_hitBatch.Clear();
+    m_batchIndices.clear();
+    m_batchDQdx.clear();
+    m_batchDEdx.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::HitCalorimetryBuffer::Add(
+    const CartesianVector &threeDPosition, const float projectionError, const double coordinate, const double dQ, const double dX)
+{
+    m_isValid.push_back(true);
+    m_x.push_back(threeDPosition.GetX());
+    m_y.push_back(threeDPosition.GetY());
+    m_z.push_back(threeDPosition.GetZ());
+    m_projectionError.push_back(projectionError);
+    m_coordinate.push_back(coordinate);
+    m_dQ.push_back(dQ);
+    m_dX.push_back(dX);
+    m_residualRange.push_back(0.);
+    m_dQdx.push_back(0.f);
+    m_dEdx.push_back(0.f);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::HitCalorimetryBuffer::AddFailure()
+{
+    m_isValid.push_back(false);
+    m_x.push_back(0.f);
+    m_y.push_back(0.f);
+    m_z.push_back(0.f);
+    m_projectionError.push_back(0.f);
+    m_coordinate.push_back(0.);
+    m_dQ.push_back(0.);
+    m_dX.push_back(0.);
+    m_residualRange.push_back(0.);
+    m_dQdx.push_back(0.f);
+    m_dEdx.push_back(0.f);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::HitCalorimetryBuffer::SortByCoordinate(const bool isBackwards)
+{
+    m_order.resize(this->Size());
+    std::iota(m_order.begin(), m_order.end(), 0UL);
+
+    std::stable_sort(m_order.begin(), m_order.end(), [&](const std::size_t lhs, const std::size_t rhs) {
+        return isBackwards ? m_coordinate[lhs] > m_coordinate[rhs] : m_coordinate[lhs] < m_coordinate[rhs];
+    });
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+EnergyEstimatorNtupleTool::PlotSpecification::PlotSpecification(
+    const std::string &name, const std::string &xAxisTitle, const std::string &yAxisTitle, const int particleId) :
+    m_name{name},
+    m_xAxisTitle{xAxisTitle},
+    m_yAxisTitle{yAxisTitle},
+    m_particleId{particleId},
+    m_xValues{},
+    m_yValues{},
+    m_useLightColour{false},
+    m_hasZeroMinimum{false},
+    m_hasLine{false},
+    m_lineIntercept{0.},
+    m_lineGradient{0.},
+    m_lineLabel{}
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::PlotSpecification::SetPoints(const TGraph &graph)
+{
+    const std::size_t nPoints = static_cast<std::size_t>(std::max(graph.GetN(), 0));
+    m_xValues.assign(graph.GetX(), graph.GetX() + nPoints);
+    m_yValues.assign(graph.GetY(), graph.GetY() + nPoints);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::PlotSpecification::SetLine(const double intercept, const double gradient, const bool isScientific)
+{
+    m_hasLine       = true;
+    m_lineIntercept = intercept;
+    m_lineGradient  = gradient;
+
+    std::stringstream labelStream;
+
+    if (isScientific)
+        labelStream << std::scientific;
+
+    else
+        labelStream << std::fixed;
+
+    labelStream << std::setprecision(2) << "#splitline{gradient = " << gradient << "}{intercept = " << intercept << "}";
+    m_lineLabel = labelStream.str();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+EnergyEstimatorNtupleTool::CalorimetryComparison::CalorimetryComparison() :
+    m_nParticles{0UL},
+    m_sumFullTrackEnergy{0.},
+    m_sumTrackEnergyDifference{0.},
+    m_sumSquaredEnergyDifference{0.},
+    m_sumHitCountDifference{0.}
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::CalorimetryComparison::Add(
+    const std::vector<bf::HitCharge> &fullHitCharges, const std::vector<bf::HitCharge> &approximateHitCharges)
+{
+    const auto getTrackEnergy = [](const std::vector<bf::HitCharge> &hitCharges) {
+        double trackEnergy(0.);
+
+        for (const bf::HitCharge &hitCharge : hitCharges)
+            trackEnergy += hitCharge.EnergyLossRate() * hitCharge.Extent();
+
+        return trackEnergy;
+    };
+
+    const double fullTrackEnergy(getTrackEnergy(fullHitCharges));
+    const double energyDifference(getTrackEnergy(approximateHitCharges) - fullTrackEnergy);
+
+    ++m_nParticles;
+    m_sumFullTrackEnergy += fullTrackEnergy;
+    m_sumTrackEnergyDifference += energyDifference;
+    m_sumSquaredEnergyDifference += energyDifference * energyDifference;
+    m_sumHitCountDifference += static_cast<double>(approximateHitCharges.size()) - static_cast<double>(fullHitCharges.size());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::CalorimetryComparison::Print() const
+{
+    if (m_nParticles == 0UL)
+    {
+        std::cout << "EnergyEstimatorNtupleTool: No particles had both approximate and full calorimetry" << std::endl;
+        return;
+    }
+
+    const double nParticles(static_cast<double>(m_nParticles));
+    const double meanDifference(m_sumTrackEnergyDifference / nParticles);
+    const double rmsDifference(std::sqrt(m_sumSquaredEnergyDifference / nParticles));
+    const double relativeBias(
+        m_sumFullTrackEnergy > std::numeric_limits<double>::epsilon() ? m_sumTrackEnergyDifference / m_sumFullTrackEnergy : 0.);
+
+    std::cout << "EnergyEstimatorNtupleTool: Approximate minus full calorimetry over " << m_nParticles << " particles" << std::endl
+              << "    Mean track energy difference: " << meanDifference << " MeV (RMS " << rmsDifference << " MeV)" << std::endl
+              << "    Relative track energy bias:   " << 100. * relativeBias << "%" << std::endl
+              << "    Mean hit count difference:    " << m_sumHitCountDifference / nParticles << std::endl;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+EnergyEstimatorNtupleTool::HitCalorimetryTree::HitCalorimetryTree(const std::string &filePath, const std::string &treeName) :
+    m_spRegistry{std::make_shared<LArRootRegistry>(filePath, LArRootRegistry::FILE_MODE::APPEND)},
+    m_pTree{nullptr},
+    m_ntupleEntry{0LL},
+    m_particleType{0U},
+    m_particleIndex{0U},
+    m_trackIndex{0U},
+    m_dQ{0.f},
+    m_dX{0.f},
+    m_x{0.f},
+    m_y{0.f},
+    m_z{0.f},
+    m_residualRange{0.f}
+{
+    bool isAppending(false);
+
+    m_spRegistry->DoAsRegistry([&]() {
+        if (m_spRegistry->GetTFile()->GetListOfKeys()->Contains(treeName.c_str()))
+        {
+            m_pTree     = dynamic_cast<TTree *>(m_spRegistry->GetTFile()->Get(treeName.c_str()));
+            isAppending = true;
+        }
+
+        else
+            m_pTree = new TTree(treeName.c_str(), "Per-hit calorimetry inputs");
+    });
+
+    if (!m_pTree)
+    {
+        std::cerr << "EnergyEstimatorNtupleTool: Object '" << treeName << "' at " << filePath << " is not a TTree" << std::endl;
+        throw StatusCodeException(STATUS_CODE_FAILURE);
+    }
+
+    const std::vector<std::tuple<std::string, void *, std::string>> branches{{"ntupleEntry", &m_ntupleEntry, "/L"},
+        {"particleType", &m_particleType, "/i"}, {"particleIndex", &m_particleIndex, "/i"}, {"trackIndex", &m_trackIndex, "/i"},
+        {"dQ", &m_dQ, "/F"}, {"dX", &m_dX, "/F"}, {"x", &m_x, "/F"}, {"y", &m_y, "/F"}, {"z", &m_z, "/F"},
+        {"residualRange", &m_residualRange, "/F"}};
+
+    for (const auto &[branchName, pAddress, leafType] : branches)
+    {
+        if (!isAppending)
+            m_pTree->Branch(branchName.c_str(), pAddress, (branchName + leafType).c_str());
+
+        else if (m_pTree->SetBranchAddress(branchName.c_str(), pAddress) < 0)
+        {
+            std::cerr << "EnergyEstimatorNtupleTool: Could not append to TTree '" << treeName << "' without branch '" << branchName << "'"
+                      << std::endl;
+            throw StatusCodeException(STATUS_CODE_FAILURE);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::HitCalorimetryTree::SetOwner(
+    const LArNtupleHelper::VECTOR_BRANCH_TYPE particleType, const LArNtupleRecord::RUInt particleIndex)
+{
+    m_particleType  = static_cast<LArNtupleRecord::RUInt>(particleType);
+    m_particleIndex = particleIndex;
+    m_trackIndex    = 0U;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::HitCalorimetryTree::Fill(const Long64_t ntupleEntry, const HitCalorimetryBuffer &hitBuffer)
 {
+    // The buffer holds the range from the first hit, so the residual range is measured back from the furthest hit
+    double maxRange(0.);
+
+    for (const std::size_t index : hitBuffer.m_batchIndices)
+        maxRange = std::max(maxRange, hitBuffer.m_residualRange[index]);
+
+    m_ntupleEntry = ntupleEntry;
+
+    for (const std::size_t index : hitBuffer.m_batchIndices)
+    {
+        m_dQ            = static_cast<LArNtupleRecord::RFloat>(hitBuffer.m_dQ[index]);
+        m_dX            = static_cast<LArNtupleRecord::RFloat>(hitBuffer.m_dX[index]);
+        m_x             = hitBuffer.m_x[index];
+        m_y             = hitBuffer.m_y[index];
+        m_z             = hitBuffer.m_z[index];
+        m_residualRange = static_cast<LArNtupleRecord::RFloat>(maxRange - hitBuffer.m_residualRange[index]);
+
+        if (m_pTree->Fill() < 0)
+        {
+            std::cerr << "EnergyEstimatorNtupleTool: Error filling the hit calorimetry TTree" << std::endl;
+            throw StatusCodeException(STATUS_CODE_FAILURE);
+        }
+    }
+
+    ++m_trackIndex;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -46,18 +363,45 @@ EnergyEstimatorNtupleTool::EnergyEstimatorNtupleTool() :
     m_trainingMode{false},
     m_braggGradientTrainingMode{false},
     m_makePlots{false},
+    m_useBatchCalorimetry{true},
+    m_checkBatchCalorimetry{false},
+    m_useApproximateCalorimetry{false},
+    m_approximateSegmentHalfWindow{3U},
+    m_compareApproximateCalorimetry{false},
     m_modboxRho{0.f},
     m_modboxA{0.f},
     m_modboxB{0.f},
     m_modboxEpsilon{0.f},
     m_modboxWion{0.f},
     m_modboxC{0.f},
-    m_modboxFactor{0.f}
+    m_modboxFactor{0.f},
+    m_chargeCorrectionMaps{},
+    m_hitCalorimetryBuffer{},
+    m_plotQueue{},
+    m_calorimetryComparison{},
+    m_spHitCalorimetryTree{nullptr}
 {
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+EnergyEstimatorNtupleTool::~EnergyEstimatorNtupleTool()
+{
+    if (m_compareApproximateCalorimetry)
+        m_calorimetryComparison.Print();
+
+    try
+    {
+        this->RenderPlots();
+    }
+    catch (...)
+    {
+        std::cerr << "EnergyEstimatorNtupleTool: Failed to render the queued plots" << std::endl;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 StatusCode EnergyEstimatorNtupleTool::ReadSettings(const TiXmlHandle xmlHandle)
 {
     PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
@@ -65,6 +409,40 @@ StatusCode EnergyEstimatorNtupleTool::ReadSettings(const TiXmlHandle xmlHandle)
     PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
         XmlHelper::ReadValue(xmlHandle, "BraggGradientTrainingMode", m_braggGradientTrainingMode));
     PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=, XmlHelper::ReadValue(xmlHandle, "MakePlots", m_makePlots));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "UseBatchCalorimetry", m_useBatchCalorimetry));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "CheckBatchCalorimetry", m_checkBatchCalorimetry));
+
+    std::string calorimetryMode("Full");
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "CalorimetryMode", calorimetryMode));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "ApproximateSegmentHalfWindow", m_approximateSegmentHalfWindow));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "CompareApproximateCalorimetry", m_compareApproximateCalorimetry));
+
+    if (calorimetryMode != "Full" && calorimetryMode != "Approximate")
+    {
+        std::cerr << "EnergyEstimatorNtupleTool: Unknown calorimetry mode " << calorimetryMode << ", expected Full or Approximate"
+                  << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    m_useApproximateCalorimetry = (calorimetryMode == "Approximate");
+
+    if (m_approximateSegmentHalfWindow < 1U)
+    {
+        std::cerr << "EnergyEstimatorNtupleTool: ApproximateSegmentHalfWindow must be at least 1" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    if (m_compareApproximateCalorimetry && !m_useApproximateCalorimetry)
+    {
+        std::cerr << "EnergyEstimatorNtupleTool: CompareApproximateCalorimetry requires the Approximate calorimetry mode" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
     PANDORA_RETURN_RESULT_IF(STATUS_CODE_SUCCESS, !=, XmlHelper::ReadValue(xmlHandle, "ModBoxRho", m_modboxRho));
     PANDORA_RETURN_RESULT_IF(STATUS_CODE_SUCCESS, !=, XmlHelper::ReadValue(xmlHandle, "ModBoxA", m_modboxA));
     PANDORA_RETURN_RESULT_IF(STATUS_CODE_SUCCESS, !=, XmlHelper::ReadValue(xmlHandle, "ModBoxB", m_modboxB));
@@ -92,7 +470,66 @@ StatusCode EnergyEstimatorNtupleTool::ReadSettings(const TiXmlHandle xmlHandle)
         throw StatusCodeException(STATUS_CODE_FAILURE);
     }
 
-    return NtupleVariableBaseTool::ReadSettings(xmlHandle);
+    // Charge corrections default to the analytic MicroBooNE parameterisations, unless lookup tables are supplied
+    std::string chargeCorrectionFile, driftCorrectionMapName, positionCorrectionMapName, outOfRangePolicyName("Clamp");
+    float       correctionMapDefaultValue(1.f);
+
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "ChargeCorrectionFile", chargeCorrectionFile));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "DriftCorrectionMapName", driftCorrectionMapName));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "PositionCorrectionMapName", positionCorrectionMapName));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "CorrectionMapOutOfRangePolicy", outOfRangePolicyName));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "CorrectionMapDefaultValue", correctionMapDefaultValue));
+
+    if (chargeCorrectionFile.empty() && (!driftCorrectionMapName.empty() || !positionCorrectionMapName.empty()))
+    {
+        std::cerr << "EnergyEstimatorNtupleTool: Charge correction map names were given without a ChargeCorrectionFile" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    if (!chargeCorrectionFile.empty())
+    {
+        const LArCorrectionMap::OUT_OF_RANGE_POLICY outOfRangePolicy(LArCorrectionMap::GetOutOfRangePolicy(outOfRangePolicyName));
+
+        std::shared_ptr<const LArCorrectionMap> spDriftMap, spPositionMap;
+
+        if (!driftCorrectionMapName.empty())
+            spDriftMap = LArCorrectionMap::Load(chargeCorrectionFile, driftCorrectionMapName, outOfRangePolicy, correctionMapDefaultValue);
+
+        if (!positionCorrectionMapName.empty())
+        {
+            spPositionMap =
+                LArCorrectionMap::Load(chargeCorrectionFile, positionCorrectionMapName, outOfRangePolicy, correctionMapDefaultValue);
+        }
+
+        m_chargeCorrectionMaps = LArCalorimetryHelper::ChargeCorrectionMaps(spDriftMap, spPositionMap);
+    }
+
+    std::string hitCalorimetryTreeFile, hitCalorimetryTreeName("HitCalorimetry");
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "HitCalorimetryTreeFile", hitCalorimetryTreeFile));
+    PANDORA_RETURN_RESULT_IF_AND_IF(STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=,
+        XmlHelper::ReadValue(xmlHandle, "HitCalorimetryTreeName", hitCalorimetryTreeName));
+
+    if (!hitCalorimetryTreeFile.empty())
+        m_spHitCalorimetryTree = std::make_shared<HitCalorimetryTree>(hitCalorimetryTreeFile, hitCalorimetryTreeName);
+
+    PANDORA_RETURN_RESULT_IF(STATUS_CODE_SUCCESS, !=, NtupleVariableBaseTool::ReadSettings(xmlHandle));
+
+    // The neutrino records are sums over the primary records, so they cannot be produced without them
+    if (!m_trainingMode && !m_braggGradientTrainingMode && this->IsEnabledFor(LArNtupleHelper::VECTOR_BRANCH_TYPE::NEUTRINO) &&
+        !this->IsEnabledFor(LArNtupleHelper::VECTOR_BRANCH_TYPE::PRIMARY))
+    {
+        std::cerr << "EnergyEstimatorNtupleTool: The neutrino category needs the primary category, as its records sum the primary records"
+                  << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    return STATUS_CODE_SUCCESS;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -110,33 +547,31 @@ std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProcessNeutrino(
     if (m_trainingMode || m_braggGradientTrainingMode)
         return {};
 
-    std::vector<LArNtupleRecord> records;
-
-    if (pNeutrinoPfo)
-    {
-        LArNtupleRecord::RFloat energyEstimator(0.f);
-        LArNtupleRecord::RUInt  numTrackHits(0U), numTrackHitsLost(0U);
+    // Summing over the primaries requests their lazy records, so their calorimetry only runs if these records are needed
+    this->AddLazyRecords({"RecoKineticEnergy", "NumTrackHits", "NumTrackHitsLost", "IsApproximateCalorimetry"}, [this, pNeutrinoPfo]() {
+        std::vector<LArNtupleRecord> records;
+        LArNtupleRecord::RFloat      energyEstimator(0.f);
+        LArNtupleRecord::RUInt       numTrackHits(0U), numTrackHitsLost(0U);
 
-        for (const ParticleFlowObject *const pPrimary : pNeutrinoPfo->GetDaughterPfoList())
+        if (pNeutrinoPfo)
         {
-            energyEstimator += this->GetPrimaryRecord<LArNtupleRecord::RFloat>("RecoKineticEnergy", pPrimary);
-            numTrackHits += this->GetPrimaryRecord<LArNtupleRecord::RUInt>("NumTrackHits", pPrimary);
-            numTrackHitsLost += this->GetPrimaryRecord<LArNtupleRecord::RUInt>("NumTrackHitsLost", pPrimary);
+            for (const ParticleFlowObject *const pPrimary : pNeutrinoPfo->GetDaughterPfoList())
+            {
+                energyEstimator += this->GetPrimaryRecord<LArNtupleRecord::RFloat>("RecoKineticEnergy", pPrimary);
+                numTrackHits += this->GetPrimaryRecord<LArNtupleRecord::RUInt>("NumTrackHits", pPrimary);
+                numTrackHitsLost += this->GetPrimaryRecord<LArNtupleRecord::RUInt>("NumTrackHitsLost", pPrimary);
+            }
         }
 
         records.emplace_back("RecoKineticEnergy", energyEstimator);
         records.emplace_back("NumTrackHits", numTrackHits);
         records.emplace_back("NumTrackHitsLost", numTrackHitsLost);
-    }
+        records.emplace_back("IsApproximateCalorimetry", static_cast<LArNtupleRecord::RBool>(m_useApproximateCalorimetry));
 
-    else
-    {
-        records.emplace_back("RecoKineticEnergy", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("NumTrackHits", static_cast<LArNtupleRecord::RUInt>(0U));
-        records.emplace_back("NumTrackHitsLost", static_cast<LArNtupleRecord::RUInt>(0U));
-    }
+        return records;
+    });
 
-    return records;
+    return {};
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -149,14 +584,17 @@ std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProcessCosmicRay(
 
     (void)pfoList;
 
+    this->FillHitCalorimetryTree(pPfo, LArNtupleHelper::VECTOR_BRANCH_TYPE::COSMIC_RAY);
+
     if (m_trainingMode)
-        return this->ProduceTrainingRecords(pPfo);
+        return this->ProduceTrainingRecords(pPfo, pMcParticle);
 
     if (m_braggGradientTrainingMode)
         return records; // return this->ProduceBraggGradientTrainingRecords(pPfo, pfoList, pMcParticle);
 
-    std::vector<LArNtupleRecord> energyEstimatorRecords = this->GetEnergyEstimatorRecords(pPfo, pMcParticle);
-    records.insert(records.end(), std::make_move_iterator(energyEstimatorRecords.begin()), std::make_move_iterator(energyEstimatorRecords.end()));
+    // The calorimetry is only run if these records are written or requested by another tool
+    this->AddLazyRecords({"RecoKineticEnergy", "NumTrackHits", "NumTrackHitsLost", "IsApproximateCalorimetry"},
+        [this, pPfo, pMcParticle]() { return this->GetEnergyEstimatorRecords(pPfo, pMcParticle); });
 
     return records;
 }
@@ -169,14 +607,17 @@ std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProcessPrimary(
     std::vector<LArNtupleRecord> records;
     const MCParticle *const      pMcParticle = spMcTarget ? spMcTarget->GetMCParticle() : nullptr;
 
+    this->FillHitCalorimetryTree(pPfo, LArNtupleHelper::VECTOR_BRANCH_TYPE::PRIMARY);
+
     if (m_trainingMode)
-        return this->ProduceTrainingRecords(pPfo);
+        return this->ProduceTrainingRecords(pPfo, pMcParticle);
 
     if (m_braggGradientTrainingMode)
         return this->ProduceBraggGradientTrainingRecords(pPfo, pfoList, pMcParticle);
 
-    std::vector<LArNtupleRecord> energyEstimatorRecords = this->GetEnergyEstimatorRecords(pPfo, pMcParticle);
-    records.insert(records.end(), std::make_move_iterator(energyEstimatorRecords.begin()), std::make_move_iterator(energyEstimatorRecords.end()));
+    // The calorimetry is only run if these records are written or requested by another tool
+    this->AddLazyRecords({"RecoKineticEnergy", "NumTrackHits", "NumTrackHitsLost", "IsApproximateCalorimetry"},
+        [this, pPfo, pMcParticle]() { return this->GetEnergyEstimatorRecords(pPfo, pMcParticle); });
 
     return records;
 }
@@ -184,7 +625,8 @@ std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProcessPrimary(
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProduceTrainingRecords(const ParticleFlowObject *const pPfo) const
+std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProduceTrainingRecords(
+    const ParticleFlowObject *const pPfo, const MCParticle *const pMcParticle) const
 {
     std::vector<LArNtupleRecord> records;
 
@@ -200,9 +642,10 @@ std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProduceTrainingRecords(c
 
         CaloHitList collectionPlaneHits;
         LArPfoHelper::GetCaloHits(pDownstreamPfo, TPC_VIEW_W, collectionPlaneHits);
-        const auto spTrackFit = this->GetTrackFit(pDownstreamPfo);
+        std::vector<bf::HitCharge> hitChargeVector;
 
-        if (LArPfoHelper::IsShower(pDownstreamPfo) || !spTrackFit)
+        if (LArPfoHelper::IsShower(pDownstreamPfo) ||
+            !this->GetParticledEdxDistribution(pDownstreamPfo, collectionPlaneHits, false, pMcParticle, hitChargeVector))
         {
             for (const CaloHit *const pCaloHit : collectionPlaneHits)
                 showerCharge += pCaloHit->GetInputEnergy();
@@ -210,37 +653,21 @@ std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProduceTrainingRecords(c
             continue;
         }
 
-        // It's tracklike and we have a good track fit.
-        CaloHitList threeDCaloHits;
-        LArPfoHelper::GetCaloHits(pDownstreamPfo, TPC_3D, threeDCaloHits);
-        CaloHitMap caloHitMap;
-
-        for (const CaloHit *const pThreeDHit : threeDCaloHits)
-        {
-            if (const CaloHit *const pTwoDHit = reinterpret_cast<const CaloHit *const>(pThreeDHit->GetParentAddress()))
-            {
-                if (pTwoDHit->GetHitType() != TPC_VIEW_W)
-                    continue;
-
-                caloHitMap.emplace(pTwoDHit, pThreeDHit);
-            }
-        }
-
-        const auto hitChargeVector = this->GetdEdxDistribution(*spTrackFit, collectionPlaneHits, caloHitMap, false, pMcParticle);
-
+        // It's tracklike and the calorimetry placed its hits
         for (const auto &hitCharge : hitChargeVector)
         {
-            dQdXVector.push_back(hitCharge.EnergyLossRate())
-            dXVector.push_back(hitCharge.Extent())
+            dQdXVector.push_back(static_cast<float>(hitCharge.EnergyLossRate()));
+            dXVector.push_back(static_cast<float>(hitCharge.Extent()));
         }
-        
-        dQdXMatrix.push_back(dQdXVector)
-        dXMatrix.push_back(dXVector)
+
+        dQdXMatrix.push_back(dQdXVector);
+        dXMatrix.push_back(dXVector);
     }
 
     records.emplace_back("dQdXMatrix", dQdXMatrix);
     records.emplace_back("dXMatrix", dXMatrix);
     records.emplace_back("showerCharge", showerCharge);
+    records.emplace_back("IsApproximateCalorimetry", static_cast<LArNtupleRecord::RBool>(m_useApproximateCalorimetry));
 
     return records;
 }
@@ -272,6 +699,8 @@ std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::GetEnergyEstimatorRecord
         records.emplace_back("NumTrackHitsLost", static_cast<LArNtupleRecord::RUInt>(0U));
     }
 
+    records.emplace_back("IsApproximateCalorimetry", static_cast<LArNtupleRecord::RBool>(m_useApproximateCalorimetry));
+
     return records;
 }
 
@@ -289,7 +718,7 @@ EnergyEstimatorNtupleTool::GetHitCalorimetryInfo(const ParticleFlowObject *const
         CaloHitList collectionPlaneHits;
         LArPfoHelper::GetCaloHits(pDownstreamPfo, TPC_VIEW_W, collectionPlaneHits);
 
-        if (LArPfoHelper::IsShower(pDownstreamPfo) || !this->GetTrackFit(pDownstreamPfo))
+        if (LArPfoHelper::IsShower(pDownstreamPfo) || !this->HasTrackCalorimetry(pDownstreamPfo))
         {
             for (const CaloHit *const pCaloHit : collectionPlaneHits)
                 showerCharge += pCaloHit->GetInputEnergy();
@@ -298,26 +727,11 @@ EnergyEstimatorNtupleTool::GetHitCalorimetryInfo(const ParticleFlowObject *const
         }
 
         // It's tracklike and we have a good track fit
-        CaloHitList threeDCaloHits;
-        LArPfoHelper::GetCaloHits(pDownstreamPfo, TPC_3D, threeDCaloHits);
-        CaloHitMap caloHitMap;
-
-        for (const CaloHit *const pThreeDHit : threeDCaloHits)
-        {
-            if (const CaloHit *const pTwoDHit = reinterpret_cast<const CaloHit *const>(pThreeDHit->GetParentAddress()))
-            {
-                if (pTwoDHit->GetHitType() != TPC_VIEW_W)
-                    continue;
-
-                caloHitMap.emplace(pTwoDHit, pThreeDHit);
-            }
-        }
-
         (void)pMCParticle;
 
         // const bool                                isBackwards = pPfo->GetMomentum().GetDotProduct(pMCParticle->GetMomentum()) < 0.f;
         // const LArNtupleHelper::TrackFitSharedPtr &spTrackFit  = this->GetTrackFit(pDownstreamPfo);
-        // const auto hitChargeVector = this->GetdEdxDistribution(*spTrackFit, collectionPlaneHits, caloHitMap, isBackwards, pMCParticle);
+        // const auto hitChargeVector = this->GetdEdxDistribution(*spTrackFit, collectionPlaneHits, isBackwards, pMCParticle);
 
         // const auto detector                        = bf::DetectorHelper::GetMicroBooNEDetector();
         // const auto quickPidAlgorithm               = bf::QuickPidAlgorithm{detector};
@@ -338,72 +752,6 @@ EnergyEstimatorNtupleTool::GetHitCalorimetryInfo(const ParticleFlowObject *const
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-StatusCode EnergyEstimatorNtupleTool::CaloHitToThreeDDistance(
-    const float hitWidth, const ThreeDSlidingFitResult &trackFit, const CartesianVector &threeDPosition, float &threeDDistance) const
-{
-    CartesianVector fitDirection(0.f, 0.f, 0.f);
-    PANDORA_RETURN_RESULT_IF(STATUS_CODE_SUCCESS, !=, LArAnalysisHelper::GetFittedDirectionAtThreeDPosition(trackFit, threeDPosition, true, fitDirection));
-    const float wirePitch = LArGeometryHelper::GetWirePitch(this->GetPandora(), TPC_VIEW_W);
-
-    try
-    {
-        threeDDistance = this->CellToThreeDDistance(hitWidth, wirePitch, fitDirection);
-    }
-
-    catch (...)
-    {
-        return STATUS_CODE_FAILURE;
-    }
-
-    return STATUS_CODE_SUCCESS;
-}
-
-//------------------------------------------------------------------------------------------------------------------------------------------
-
-float EnergyEstimatorNtupleTool::CellToThreeDDistance(const float hitWidth, const float wirePitch, const CartesianVector &fitDirection) const
-{
-    float polarAngle = 0.f, azimuthalAngle = 0.f;
-    std::tie(polarAngle, azimuthalAngle) = this->GetPolarAnglesFromDirection(fitDirection);
-
-    if (polarAngle <= std::numeric_limits<float>::epsilon()) // negligible polar angle, so the wire pitch is the hit separation
-        return wirePitch;
-
-    const float cosPhi_sinTheta = std::fabs(std::cos(azimuthalAngle) * std::sin(polarAngle));
-    const float sinPhi_sinTheta = std::fabs(std::sin(azimuthalAngle) * std::sin(polarAngle));
-
-    float dx_p = std::numeric_limits<float>::max();
-    float dx_w = std::numeric_limits<float>::max();
-
-    if (cosPhi_sinTheta > std::numeric_limits<float>::epsilon())
-        dx_p = wirePitch / cosPhi_sinTheta;
-
-    if (sinPhi_sinTheta > std::numeric_limits<float>::epsilon())
-        dx_w = hitWidth / sinPhi_sinTheta;
-
-    if ((dx_p < std::numeric_limits<float>::max()) || (dx_w < std::numeric_limits<float>::max()))
-        return std::min(dx_p, dx_w);
-
-    // For non-negligible polar angle, this shouldn't happen
-    std::cerr << "EnergyEstimatorNtupleTool: Failed to calculate hit's 3D distance" << std::endl;
-    throw StatusCodeException(STATUS_CODE_FAILURE);
-}
-
-//------------------------------------------------------------------------------------------------------------------------------------------
-
-std::tuple<float, float> EnergyEstimatorNtupleTool::GetPolarAnglesFromDirection(const CartesianVector &direction) const
-{
-    const float polarAngle    = std::acos(std::fabs(direction.GetY()));
-    const float sinPolarAngle = std::sin(polarAngle);
-
-    if (sinPolarAngle <= std::numeric_limits<float>::epsilon())
-        return {0.f, 0.f}; // negligible polar angle means azimuthal angle is undefined
-
-    const float azimuthalAngle = std::asin(std::fabs(direction.GetX() / sinPolarAngle));
-    return {polarAngle, azimuthalAngle};
-}
-
-//------------------------------------------------------------------------------------------------------------------------------------------
-
 std::vector<LArNtupleRecord> EnergyEstimatorNtupleTool::ProduceBraggGradientTrainingRecords(
     const ParticleFlowObject *const pPfo, const PfoList &, const MCParticle *const pMcParticle)
 {
@@ -471,36 +819,18 @@ bool EnergyEstimatorNtupleTool::GetBraggGradientParameters(const ParticleFlowObj
     if (LArPfoHelper::IsShower(pPfo))
         return false;
 
-    const auto spTrackFit = this->GetTrackFit(pPfo);
-
-    if (!spTrackFit)
-        return false;
-
-    // It's tracklike and we have a good track fit.
     CaloHitList collectionPlaneHits;
     LArPfoHelper::GetCaloHits(pPfo, TPC_VIEW_W, collectionPlaneHits);
 
-    CaloHitList threeDCaloHits;
-    LArPfoHelper::GetCaloHits(pPfo, TPC_3D, threeDCaloHits);
-    CaloHitMap caloHitMap;
-
-    for (const CaloHit *const pThreeDHit : threeDCaloHits)
-    {
-        if (const CaloHit *const pTwoDHit = reinterpret_cast<const CaloHit *const>(pThreeDHit->GetParentAddress()))
-        {
-            if (pTwoDHit->GetHitType() != TPC_VIEW_W)
-                continue;
-
-            caloHitMap.emplace(pTwoDHit, pThreeDHit);
-        }
-    }
-
     // Filter the hit charges to get Bragg peak.
     const bool isReconstructedBackwards = pPfo->GetMomentum().GetDotProduct(pMcParticle->GetMomentum()) < 0.f;
     const bool isRecoBackwardsGoing     = pPfo->GetMomentum().GetZ() < 0.f;
     const bool isBackwards              = isReconstructedBackwards != isRecoBackwardsGoing;
 
-    const auto hitChargeVector = this->GetdEdxDistribution(*spTrackFit, collectionPlaneHits, caloHitMap, isBackwards, pMcParticle);
+    std::vector<bf::HitCharge> hitChargeVector;
+
+    if (!this->GetParticledEdxDistribution(pPfo, collectionPlaneHits, isBackwards, pMcParticle, hitChargeVector))
+        return false;
 
     double                     maxCoordinate = 0.;
     std::vector<bf::HitCharge> filteredHitCharges;
@@ -534,92 +864,14 @@ bool EnergyEstimatorNtupleTool::GetBraggGradientParameters(const ParticleFlowObj
     {
         const float trueKineticEnergy = this->GetPrimaryRecord<LArNtupleRecord::RFloat>("mc_KineticEnergy", pPfo);
         std::cerr << "Plotted particle has incident energy " << trueKineticEnergy << std::endl;
-        bf::PlotHelper::SetGlobalPlotStyle();
-
-        TCanvas *pCanvas = this->GetTmpRegistry()->CreateWithUniqueName<TCanvas>("BraggGradientPlot", "BraggGradientPlot", 10, 10, 900, 600);
-        auto     braggGraph = bf::PlotHelper::GetBraggGradientGraph(filteredHitCharges);
-
-        unsigned int colour = 7UL;
-        switch (std::abs(pMcParticle->GetParticleId()))
-        {
-            case 13:
-                colour = 0UL;
-                break;
-            case 211:
-                colour = 1UL;
-                break;
-            case 321:
-                colour = 2UL;
-                break;
-            case 2212:
-                colour = 3UL;
-                break;
-            default:
-                break;
-        }
-
-        braggGraph.GetYaxis()->SetTitle("\\mathrm{d}E/\\mathrm{d}x \\text{ (MeV/cm)}");
-        braggGraph.GetXaxis()->SetTitle("1 / \\sqrt{R - x}  \\text{ (cm}^{-0.5}\\text{)}");
-        braggGraph.SetMarkerColor(bf::PlotHelper::GetSchemeColourLight(colour));
-        braggGraph.SetMarkerStyle(7UL);
-        braggGraph.SetMinimum(0.);
-        braggGraph.Draw("AP");
-
-        const double xMax = braggGraph.GetXaxis()->GetXmax();
-        braggGraph.GetXaxis()->SetRangeUser(0., xMax);
-
-        TF1 *pFunction = this->GetTmpRegistry()->CreateWithUniqueName<TF1>("BraggLine", "[0] + [1] * x", 0., xMax);
-        pFunction->SetLineColor(bf::PlotHelper::GetSchemeColour(colour));
-        pFunction->SetParameter(0, firstOrderIntercept);
-        pFunction->SetParameter(1, firstOrderGradient);
-        pFunction->Draw("same");
-
-        auto particleSymbol = std::string{};
-
-        switch (pMcParticle->GetParticleId())
-        {
-            case 13:
-                particleSymbol = "\\mu";
-                break;
-            case 211:
-                particleSymbol = "\\pi^+";
-                break;
-            case -211:
-                particleSymbol = "\\pi^-";
-                break;
-            case 321:
-                particleSymbol = "K^+\\";
-                break;
-            case -321:
-                particleSymbol = "K^-\\";
-                break;
-            case 2212:
-                particleSymbol = "p\\";
-                break;
-            default:
-                particleSymbol = "\\text{PDG " + std::to_string(pMcParticle->GetParticleId()) + "}";
-                break;
-        }
-
-        std::stringstream labelStream;
-        labelStream << std::fixed << std::setprecision(2);
-        labelStream << "#splitline{gradient = " << firstOrderGradient << "}{intercept = " << firstOrderIntercept << "}";
-        TLatex latex;
-        latex.SetTextSize(0.04);
-        latex.DrawLatexNDC(0.7, 0.7, labelStream.str().c_str());
-
-        TLatex latexLabel;
-        latexLabel.SetTextSize(0.06);
-        latexLabel.DrawLatexNDC(0.77, 0.8, particleSymbol.c_str());
-
-        if (gROOT->IsBatch())
-            pCanvas->SaveAs((std::string{pCanvas->GetName()} + ".eps").c_str());
 
-        else
-        {
-            bf::PlotHelper::Pause();
-            pCanvas->Close();
-        }
+        PlotSpecification plot("BraggGradientPlot", "1 / \\sqrt{R - x}  \\text{ (cm}^{-0.5}\\text{)}",
+            "\\mathrm{d}E/\\mathrm{d}x \\text{ (MeV/cm)}", pMcParticle->GetParticleId());
+        plot.SetPoints(bf::PlotHelper::GetBraggGradientGraph(filteredHitCharges));
+        plot.SetLine(firstOrderIntercept, firstOrderGradient, false);
+        plot.m_useLightColour = true;
+        plot.m_hasZeroMinimum = true;
+        this->QueuePlot(std::move(plot));
     }
 
     // Calculate the average detector thickness.
@@ -664,7 +916,7 @@ bool EnergyEstimatorNtupleTool::GetBraggGradientParameters(const ParticleFlowObj
     double secondOrderGradientDouble  = 0.;
     double secondOrderInterceptDouble = 0.;
 
-    const auto detector    = bf::DetectorHelper::GetMicroBooNEDetector();
+    const auto &detector   = this->GetGeometryContext().GetDetector();
     const auto quickPidAlg = bf::QuickPidAlgorithm{detector};
     if (!quickPidAlg.CalculateSecondOrderBraggGradient(filteredHitCharges, secondOrderGradientDouble, secondOrderInterceptDouble))
         return false;
@@ -674,93 +926,79 @@ bool EnergyEstimatorNtupleTool::GetBraggGradientParameters(const ParticleFlowObj
 
     if (m_makePlots)
     {
-        // const float trueKineticEnergy = this->GetPrimaryRecord<LArNtupleRecord::RFloat>("mc_KineticEnergy", pPfo);
-        // std::cerr << "Plotted particle has incident energy " << trueKineticEnergy << std::endl;
-        bf::PlotHelper::SetGlobalPlotStyle();
+        PlotSpecification plot("BraggGradientPlot", "R - x  \\text{ (cm)}", "Q\\", pMcParticle->GetParticleId());
+        plot.SetPoints(quickPidAlg.GetSecondOrderBraggGradientGraph(filteredHitCharges));
+        plot.SetLine(secondOrderIntercept, secondOrderGradient, true);
+        plot.m_useLightColour = true;
+        this->QueuePlot(std::move(plot));
+    }
 
-        TCanvas *pCanvas = this->GetTmpRegistry()->CreateWithUniqueName<TCanvas>("BraggGradientPlot", "BraggGradientPlot", 10, 10, 900, 600);
-        auto     braggGraph = quickPidAlg.GetSecondOrderBraggGradientGraph(filteredHitCharges);
+    return true;
+}
 
-        unsigned int colour = 7UL;
-        switch (std::abs(pMcParticle->GetParticleId()))
-        {
-            case 13:
-                colour = 0UL;
-                break;
-            case 211:
-                colour = 1UL;
-                break;
-            case 321:
-                colour = 2UL;
-                break;
-            case 2212:
-                colour = 3UL;
-                break;
-            default:
-                break;
-        }
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-        braggGraph.GetYaxis()->SetTitle("Q\\");
-        braggGraph.GetXaxis()->SetTitle("R - x  \\text{ (cm)}");
-        braggGraph.SetMarkerColor(bf::PlotHelper::GetSchemeColourLight(colour));
-        braggGraph.SetMarkerStyle(7UL);
-        braggGraph.Draw("AP");
+std::vector<bf::HitCharge> EnergyEstimatorNtupleTool::GetdEdxDistribution(const ThreeDSlidingFitResult &trackFit, CaloHitList caloHitList,
+    const bool isBackwards, const MCParticle *const pMcParticle) const
+{
+    HitCalorimetryBuffer &hitBuffer = m_hitCalorimetryBuffer;
 
-        const double xMax = braggGraph.GetXaxis()->GetXmax();
-        braggGraph.GetXaxis()->SetRangeUser(0., xMax);
+    // The buffer must not keep the previous particle's hits, which would otherwise be filled into the side tree for this one
+    if (caloHitList.empty())
+    {
+        hitBuffer.Clear();
+        return {};
+    }
 
-        TF1 *pFunction = this->GetTmpRegistry()->CreateWithUniqueName<TF1>("BraggLine", "[0] + [1] * x", 0., xMax);
-        pFunction->SetLineColor(bf::PlotHelper::GetSchemeColour(colour));
-        pFunction->SetParameter(0, secondOrderIntercept);
-        pFunction->SetParameter(1, secondOrderGradient);
-        pFunction->Draw("same");
+    this->CalculateHitCalorimetryInfo(trackFit, caloHitList, isBackwards, hitBuffer);
 
-        auto particleSymbol = std::string{};
+    return this->GetHitCharges(hitBuffer, pMcParticle);
+}
 
-        switch (pMcParticle->GetParticleId())
-        {
-            case 13:
-                particleSymbol = "\\mu";
-                break;
-            case 211:
-                particleSymbol = "\\pi^+";
-                break;
-            case -211:
-                particleSymbol = "\\pi^-";
-                break;
-            case 321:
-                particleSymbol = "K^+\\";
-                break;
-            case -321:
-                particleSymbol = "K^-\\";
-                break;
-            case 2212:
-                particleSymbol = "p\\";
-                break;
-            default:
-                particleSymbol = "\\text{PDG " + std::to_string(pMcParticle->GetParticleId()) + "}";
-                break;
-        }
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-        std::stringstream labelStream;
-        labelStream << std::scientific << std::setprecision(2);
-        labelStream << "#splitline{gradient = " << secondOrderGradient << "}{intercept = " << secondOrderIntercept << "}";
-        TLatex latex;
-        latex.SetTextSize(0.04);
-        latex.DrawLatexNDC(0.7, 0.7, labelStream.str().c_str());
+bool EnergyEstimatorNtupleTool::HasTrackCalorimetry(const ParticleFlowObject *const pPfo) const
+{
+    if (!m_useApproximateCalorimetry)
+        return static_cast<bool>(this->GetTrackFit(pPfo));
 
-        TLatex latexLabel;
-        latexLabel.SetTextSize(0.06);
-        latexLabel.DrawLatexNDC(0.77, 0.8, particleSymbol.c_str());
+    CaloHitList threeDHits;
+    LArPfoHelper::GetCaloHits(pPfo, TPC_3D, threeDHits);
 
-        if (gROOT->IsBatch())
-            pCanvas->SaveAs((std::string{pCanvas->GetName()} + ".eps").c_str());
+    return threeDHits.size() > static_cast<std::size_t>(m_approximateSegmentHalfWindow);
+}
 
-        else
-        {
-            bf::PlotHelper::Pause();
-            pCanvas->Close();
-        }
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool EnergyEstimatorNtupleTool::GetParticledEdxDistribution(const ParticleFlowObject *const pPfo, const CaloHitList &caloHitList,
+    const bool isBackwards, const MCParticle *const pMcParticle, std::vector<bf::HitCharge> &hitChargeVector) const
+{
+    hitChargeVector.clear();
+
+    if (!m_useApproximateCalorimetry)
+    {
+        const LArNtupleHelper::TrackFitSharedPtr &spTrackFit = this->GetTrackFit(pPfo);
+
+        if (!spTrackFit)
+            return false;
+
+        hitChargeVector = this->GetdEdxDistribution(*spTrackFit, caloHitList, isBackwards, pMcParticle);
+        return true;
+    }
+
+    if (caloHitList.empty())
+        return this->HasTrackCalorimetry(pPfo);
+
+    if (!this->CalculateApproximateHitCalorimetryInfo(pPfo, caloHitList, isBackwards, m_hitCalorimetryBuffer))
+        return false;
+
+    hitChargeVector = this->GetHitCharges(m_hitCalorimetryBuffer, pMcParticle);
+
+    // The comparison pays for the sliding fit the approximate mode exists to avoid, so it is only for measuring the bias
+    if (m_compareApproximateCalorimetry)
+    {
+        if (const LArNtupleHelper::TrackFitSharedPtr &spTrackFit = this->GetTrackFit(pPfo))
+            m_calorimetryComparison.Add(this->GetdEdxDistribution(*spTrackFit, caloHitList, isBackwards, nullptr), hitChargeVector);
     }
 
     return true;
@@ -768,38 +1006,47 @@ bool EnergyEstimatorNtupleTool::GetBraggGradientParameters(const ParticleFlowObj
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-std::vector<bf::HitCharge> EnergyEstimatorNtupleTool::GetdEdxDistribution(const ThreeDSlidingFitResult &trackFit, CaloHitList caloHitList,
-    const CaloHitMap &caloHitMap, const bool isBackwards, const MCParticle *const pMcParticle) const
+std::vector<bf::HitCharge> EnergyEstimatorNtupleTool::GetHitCharges(
+    HitCalorimetryBuffer &hitBuffer, const MCParticle *const pMcParticle) const
 {
-    if (caloHitList.empty())
-        return {};
-
-    std::vector<HitCalorimetryInfoPtr> hitInfoVector = this->CalculateHitCalorimetryInfo(trackFit, caloHitList, caloHitMap, isBackwards);
-    std::vector<bf::HitCharge>         hitChargeVector;
-    std::vector<double>                coordinateVector, dQdxVector;
+    LArCalorimetryHelper::HitBatch &hitBatch = hitBuffer.m_hitBatch;
 
-    for (const auto spHitInfo : hitInfoVector)
+    for (const std::size_t index : hitBuffer.m_order)
     {
-        if (!spHitInfo->m_projectionSuccessful)
+        if (!hitBuffer.m_isValid[index])
             continue;
 
-        if (spHitInfo->m_dX < std::numeric_limits<float>::epsilon())
+        if (hitBuffer.m_dX[index] < std::numeric_limits<float>::epsilon())
             continue;
 
-        const float dQdxUncorrected = spHitInfo->m_dQ / spHitInfo->m_dX;
-        const float dQdxCorrected   = this->CorrectChargeDeposition(dQdxUncorrected, spHitInfo->m_threeDPosition);
+        hitBatch.Add(static_cast<float>(hitBuffer.m_dQ[index]), static_cast<float>(hitBuffer.m_dX[index]), hitBuffer.m_x[index],
+            hitBuffer.m_y[index], hitBuffer.m_z[index]);
+        hitBuffer.m_batchIndices.push_back(index);
+    }
+
+    this->CalculateEnergyLossRates(hitBatch, hitBuffer.m_batchDQdx, hitBuffer.m_batchDEdx);
+
+    std::vector<bf::HitCharge> hitChargeVector;
+    std::vector<double>        coordinateVector, dQdxVector;
+    hitChargeVector.reserve(hitBuffer.m_batchIndices.size());
+
+    for (std::size_t i = 0UL; i < hitBuffer.m_batchIndices.size(); ++i)
+    {
+        const std::size_t index = hitBuffer.m_batchIndices[i];
+        hitBuffer.m_dQdx[index] = hitBuffer.m_batchDQdx.at(i);
+        hitBuffer.m_dEdx[index] = hitBuffer.m_batchDEdx.at(i);
 
-        const float dEdx = this->ApplyModBoxCorrection(dQdxCorrected);
-        hitChargeVector.emplace_back(spHitInfo->m_coordinate, dEdx, spHitInfo->m_dX);
+        hitChargeVector.emplace_back(hitBuffer.m_residualRange[index], hitBuffer.m_dEdx[index], hitBuffer.m_dX[index]);
 
-        coordinateVector.emplace_back(spHitInfo->m_coordinate);
-        dQdxVector.emplace_back(dQdxCorrected);
+        if (m_makePlots && pMcParticle)
+        {
+            coordinateVector.emplace_back(hitBuffer.m_residualRange[index]);
+            dQdxVector.emplace_back(hitBuffer.m_dQdx[index]);
+        }
     }
 
     if (m_makePlots && pMcParticle)
     {
-        bf::PlotHelper::SetGlobalPlotStyle();
-
         double maxCoordinate = 0.;
 
         for (const double coordinate : coordinateVector)
@@ -811,114 +1058,171 @@ std::vector<bf::HitCharge> EnergyEstimatorNtupleTool::GetdEdxDistribution(const
         for (double &coordinate : coordinateVector)
             coordinate = maxCoordinate - coordinate;
 
-        TGraph   chargeDistributionGraph{static_cast<Int_t>(coordinateVector.size()), coordinateVector.data(), dQdxVector.data()};
-        TCanvas *pCanvas =
-            this->GetTmpRegistry()->CreateWithUniqueName<TCanvas>("ChargeDistributionPlot", "ChargeDistributionPlot", 10, 10, 900, 600);
+        PlotSpecification plot("ChargeDistributionPlot", "\\text{Residual range (cm})", "\\mathrm{d}Q/\\mathrm{d}x \\text{ (ADC/cm)}",
+            pMcParticle->GetParticleId());
+        plot.m_xValues        = std::move(coordinateVector);
+        plot.m_yValues        = std::move(dQdxVector);
+        plot.m_hasZeroMinimum = true;
+        this->QueuePlot(std::move(plot));
+    }
 
-        unsigned int colour = 7UL;
-        switch (std::abs(pMcParticle->GetParticleId()))
-        {
-            case 13:
-                colour = 0UL;
-                break;
-            case 211:
-                colour = 1UL;
-                break;
-            case 321:
-                colour = 2UL;
-                break;
-            case 2212:
-                colour = 3UL;
-                break;
-            default:
-                break;
-        }
+    return hitChargeVector;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-        chargeDistributionGraph.GetYaxis()->SetTitle("\\mathrm{d}Q/\\mathrm{d}x \\text{ (ADC/cm)}");
-        chargeDistributionGraph.GetXaxis()->SetTitle("\\text{Residual range (cm})");
-        chargeDistributionGraph.SetMarkerColor(bf::PlotHelper::GetSchemeColour(colour));
-        chargeDistributionGraph.SetMarkerStyle(7UL);
-        chargeDistributionGraph.SetMinimum(0.);
-        chargeDistributionGraph.Draw("AP");
+void EnergyEstimatorNtupleTool::FillHitCalorimetryTree(
+    const ParticleFlowObject *const pPfo, const LArNtupleHelper::VECTOR_BRANCH_TYPE particleType) const
+{
+    if (!m_spHitCalorimetryTree || !pPfo)
+        return;
 
-        const double xMax = chargeDistributionGraph.GetXaxis()->GetXmax();
-        chargeDistributionGraph.GetXaxis()->SetRangeUser(0., xMax);
+    // The hits are linked to the particle by its index in the ntuple vectors, which is independent of the mode and of other tools
+    m_spHitCalorimetryTree->SetOwner(particleType, static_cast<LArNtupleRecord::RUInt>(this->GetVectorElementIndex(particleType)));
 
-        auto particleSymbol = std::string{};
+    for (const ParticleFlowObject *const pDownstreamPfo : this->GetAllDownstreamPfos(pPfo))
+    {
+        if (!pDownstreamPfo || LArPfoHelper::IsShower(pDownstreamPfo))
+            continue;
 
-        switch (pMcParticle->GetParticleId())
+        CaloHitList collectionPlaneHits;
+        LArPfoHelper::GetCaloHits(pDownstreamPfo, TPC_VIEW_W, collectionPlaneHits);
+
+        if (collectionPlaneHits.empty())
+            continue;
+
+        // Without an MC particle no plots are queued, and the approximate calorimetry is not compared with the full calorimetry
+        if (!m_useApproximateCalorimetry)
         {
-            case 13:
-                particleSymbol = "\\mu";
-                break;
-            case 211:
-                particleSymbol = "\\pi^+";
-                break;
-            case -211:
-                particleSymbol = "\\pi^-";
-                break;
-            case 321:
-                particleSymbol = "K^+\\";
-                break;
-            case -321:
-                particleSymbol = "K^-\\";
-                break;
-            case 2212:
-                particleSymbol = "p\\";
-                break;
-            default:
-                particleSymbol = "\\text{PDG " + std::to_string(pMcParticle->GetParticleId()) + "}";
-                break;
-        }
+            const LArNtupleHelper::TrackFitSharedPtr &spTrackFit = this->GetTrackFit(pDownstreamPfo);
 
-        TLatex latexLabel;
-        latexLabel.SetTextSize(0.06);
-        latexLabel.DrawLatexNDC(0.77, 0.8, particleSymbol.c_str());
+            if (!spTrackFit)
+                continue;
 
-        if (gROOT->IsBatch())
-            pCanvas->SaveAs((std::string{pCanvas->GetName()} + ".eps").c_str());
+            this->GetdEdxDistribution(*spTrackFit, collectionPlaneHits, false, nullptr);
+        }
 
         else
         {
-            bf::PlotHelper::Pause();
-            pCanvas->Close();
+            if (!this->CalculateApproximateHitCalorimetryInfo(pDownstreamPfo, collectionPlaneHits, false, m_hitCalorimetryBuffer))
+                continue;
+
+            this->GetHitCharges(m_hitCalorimetryBuffer, nullptr);
         }
-    }
 
-    return hitChargeVector;
+        m_spHitCalorimetryTree->Fill(this->GetNtupleEntry(), m_hitCalorimetryBuffer);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-std::vector<EnergyEstimatorNtupleTool::HitCalorimetryInfoPtr> EnergyEstimatorNtupleTool::CalculateHitCalorimetryInfo(
-    const ThreeDSlidingFitResult &trackFit, const CaloHitList &caloHitList, const CaloHitMap &caloHitMap, const bool isBackwards) const
+void EnergyEstimatorNtupleTool::CalculateHitCalorimetryInfo(const ThreeDSlidingFitResult &trackFit, const CaloHitList &caloHitList,
+    const bool isBackwards, HitCalorimetryBuffer &hitBuffer) const
 {
-    std::vector<HitCalorimetryInfoPtr> hitInfoVector;
+    hitBuffer.Clear();
 
     if (caloHitList.empty())
-        return hitInfoVector;
+        return;
+
+    const LArGeometryContext &                 geometryContext(this->GetGeometryContext());
+    const LArAnalysisHelper::WireViewGeometry &wireViewGeometry(geometryContext.GetWireViewGeometry(TPC_VIEW_W));
+
+    // Project every hit onto the fit in a single pass
+    CartesianPointVector twoDPositions;
+    twoDPositions.reserve(caloHitList.size());
+
+    for (const CaloHit *const pCaloHit : caloHitList)
+        twoDPositions.push_back(pCaloHit->GetPositionVector());
+
+    LArAnalysisHelper::TrackFitProjectionVector projections;
+    LArAnalysisHelper::ProjectTwoDPositionsOntoTrackFit(geometryContext, trackFit, twoDPositions, TPC_VIEW_W, true, projections);
+
+    // Use the 3D hit instead wherever it projects back closer to the 2D hit, and get the fit directions there in a second pass
+    std::vector<int>     threeDHitIndices(twoDPositions.size(), -1);
+    FloatVector          threeDHitProjectionErrors;
+    CartesianPointVector threeDHitPositions;
+
+    std::size_t hitIndex = 0UL;
 
     for (const CaloHit *const pCaloHit : caloHitList)
     {
-        hitInfoVector.push_back(this->CalculateHitCalorimetryInfo(
-            trackFit, pCaloHit->GetPositionVector(), pCaloHit->GetInputEnergy(), pCaloHit->GetCellSize1(), caloHitMap, pCaloHit));
+        if (const CaloHit *const pThreeDHit = this->GetDaughterThreeDHit(pCaloHit))
+        {
+            const CartesianVector &threeDHitPosition = pThreeDHit->GetPositionVector();
+            const float            threeDHitProjectionError =
+                (geometryContext.ProjectPosition(threeDHitPosition, TPC_VIEW_W) - twoDPositions.at(hitIndex)).GetMagnitude();
+
+            if (threeDHitProjectionError < projections.at(hitIndex).m_projectionError)
+            {
+                threeDHitIndices.at(hitIndex) = static_cast<int>(threeDHitPositions.size());
+                threeDHitProjectionErrors.push_back(threeDHitProjectionError);
+                threeDHitPositions.push_back(threeDHitPosition);
+            }
+        }
+
+        ++hitIndex;
     }
 
-    std::sort(hitInfoVector.begin(), hitInfoVector.end(), [&](const auto &spLhs, const auto &spRhs) {
-        return isBackwards ? spLhs->m_coordinate > spRhs->m_coordinate : spLhs->m_coordinate < spRhs->m_coordinate;
-    });
+    CartesianPointVector threeDHitDirections;
+    std::vector<bool>    isThreeDHitDirectionValid;
+    LArAnalysisHelper::GetFittedDirectionsAtThreeDPositions(
+        trackFit, threeDHitPositions, true, threeDHitDirections, isThreeDHitDirectionValid);
+
+    hitIndex = 0UL;
+
+    for (const CaloHit *const pCaloHit : caloHitList)
+    {
+        const int                                    threeDHitIndex = threeDHitIndices.at(hitIndex);
+        const LArAnalysisHelper::TrackFitProjection &projection     = projections.at(hitIndex);
+        ++hitIndex;
+
+        if (threeDHitIndex < 0)
+        {
+            if (!projection.m_isValid || (projection.m_projectionError > 5.f))
+            {
+                hitBuffer.AddFailure();
+                continue;
+            }
+
+            this->AddHitCalorimetryInfo(trackFit, pCaloHit->GetInputEnergy(), pCaloHit->GetCellSize1(), projection.m_threeDPosition,
+                projection.m_direction, projection.m_projectionError, wireViewGeometry, hitBuffer);
+            continue;
+        }
+
+        const std::size_t threeDIndex = static_cast<std::size_t>(threeDHitIndex);
 
-    float           coord    = isBackwards ? -hitInfoVector.front()->m_coordinate : hitInfoVector.front()->m_coordinate;
-    CartesianVector position = hitInfoVector.front()->m_threeDPosition;
-    float           range    = 0.f;
+        if (!isThreeDHitDirectionValid.at(threeDIndex) || (threeDHitProjectionErrors.at(threeDIndex) > 5.f))
+        {
+            hitBuffer.AddFailure();
+            continue;
+        }
+
+        this->AddHitCalorimetryInfo(trackFit, pCaloHit->GetInputEnergy(), pCaloHit->GetCellSize1(), threeDHitPositions.at(threeDIndex),
+            threeDHitDirections.at(threeDIndex), threeDHitProjectionErrors.at(threeDIndex), wireViewGeometry, hitBuffer);
+    }
+
+    hitBuffer.SortByCoordinate(isBackwards);
+
+    // The range starts from the first placed hit, as the failed hits hold no position or coordinate
+    const auto firstValidIter = std::find_if(hitBuffer.m_order.begin(), hitBuffer.m_order.end(),
+        [&hitBuffer](const std::size_t index) { return static_cast<bool>(hitBuffer.m_isValid[index]); });
+
+    if (firstValidIter == hitBuffer.m_order.end())
+        return;
 
-    for (const auto &spHitInfo : hitInfoVector)
+    const std::size_t firstIndex      = *firstValidIter;
+    const double      firstCoordinate = hitBuffer.m_coordinate[firstIndex];
+    float             coord           = static_cast<float>(isBackwards ? -firstCoordinate : firstCoordinate);
+    CartesianVector   position(hitBuffer.m_x[firstIndex], hitBuffer.m_y[firstIndex], hitBuffer.m_z[firstIndex]);
+    float             range = 0.f;
+
+    for (const std::size_t index : hitBuffer.m_order)
     {
-        if (!spHitInfo->m_projectionSuccessful)
+        if (!hitBuffer.m_isValid[index])
             continue;
 
         bool        failed   = false;
-        const float newCoord = isBackwards ? -spHitInfo->m_coordinate : spHitInfo->m_coordinate;
+        const float newCoord = static_cast<float>(isBackwards ? -hitBuffer.m_coordinate[index] : hitBuffer.m_coordinate[index]);
 
         while (coord < newCoord)
         {
@@ -936,103 +1240,264 @@ std::vector<EnergyEstimatorNtupleTool::HitCalorimetryInfoPtr> EnergyEstimatorNtu
 
         if (failed)
         {
-            spHitInfo->m_projectionSuccessful = false;
+            hitBuffer.m_isValid[index] = false;
             continue;
         }
 
-        spHitInfo->m_coordinate = range;
+        hitBuffer.m_residualRange[index] = range;
     }
-
-    return hitInfoVector;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-EnergyEstimatorNtupleTool::HitCalorimetryInfoPtr EnergyEstimatorNtupleTool::CalculateHitCalorimetryInfo(const ThreeDSlidingFitResult &trackFit,
-    const CartesianVector &twoDPositionVector, const float dQ, const float hitWidth, const CaloHitMap &caloHitMap, const CaloHit *const pCaloHit) const
+bool EnergyEstimatorNtupleTool::CalculateApproximateHitCalorimetryInfo(
+    const ParticleFlowObject *const pPfo, const CaloHitList &caloHitList, const bool isBackwards, HitCalorimetryBuffer &hitBuffer) const
 {
-    const HitCalorimetryInfoPtr spHitInfo = HitCalorimetryInfoPtr(new HitCalorimetryInfo());
+    hitBuffer.Clear();
+
+    CaloHitList threeDHits;
+    LArPfoHelper::GetCaloHits(pPfo, TPC_3D, threeDHits);
+
+    const std::size_t halfWindow = static_cast<std::size_t>(m_approximateSegmentHalfWindow);
 
-    CartesianVector threeDHitPosition(0.f, 0.f, 0.f);
-    float           threeDHitProjectionError(std::numeric_limits<float>::max());
+    if (threeDHits.size() <= halfWindow)
+        return false;
+
+    LArPcaHelper::EigenVectors eigenVectors;
+    LArPcaHelper::EigenValues  eigenValues(0.f, 0.f, 0.f);
+    CartesianVector            centroid(0.f, 0.f, 0.f);
 
-    const auto findIter = caloHitMap.find(pCaloHit);
+    try
+    {
+        LArPcaHelper::RunPca(threeDHits, centroid, eigenValues, eigenVectors);
+    }
 
-    if (findIter != caloHitMap.end())
+    catch (...)
     {
-        threeDHitPosition = findIter->second->GetPositionVector();
-        threeDHitProjectionError =
-            (LArGeometryHelper::ProjectPosition(this->GetPandora(), threeDHitPosition, TPC_VIEW_W) - twoDPositionVector).GetMagnitude();
+        return false;
     }
 
-    CartesianVector inferredThreeDPosition(0.f, 0.f, 0.f);
-    float           inferredThreeDProjectionError(std::numeric_limits<float>::max()), dX(0.f);
+    if (eigenVectors.empty())
+        return false;
+
+    // Orient the axis along increasing z, matching the longitudinal coordinate of the sliding fits
+    CartesianVector axis(eigenVectors.at(0UL));
+
+    if (axis.GetZ() < 0.f)
+        axis *= -1.f;
+
+    // Order every 3D hit along the principal axis, so that the segments are as long as the hit density allows
+    std::vector<std::pair<float, const CaloHit *>> orderedHits;
+    orderedHits.reserve(threeDHits.size());
+
+    for (const CaloHit *const pThreeDHit : threeDHits)
+        orderedHits.emplace_back((pThreeDHit->GetPositionVector() - centroid).GetDotProduct(axis), pThreeDHit);
 
-    if (STATUS_CODE_SUCCESS != LArAnalysisHelper::ProjectTwoDPositionOntoTrackFit(this->GetPandora(), trackFit, twoDPositionVector,
-                                   TPC_VIEW_W, true, inferredThreeDPosition, inferredThreeDProjectionError))
+    std::stable_sort(orderedHits.begin(), orderedHits.end(),
+        [](const std::pair<float, const CaloHit *> &lhs, const std::pair<float, const CaloHit *> &rhs) { return lhs.first < rhs.first; });
+
+    std::unordered_map<const CaloHit *, std::size_t> hitRanks;
+    hitRanks.reserve(orderedHits.size());
+
+    for (std::size_t rank = 0UL; rank < orderedHits.size(); ++rank)
+        hitRanks.emplace(orderedHits.at(rank).second, rank);
+
+    const LArAnalysisHelper::WireViewGeometry &wireViewGeometry(this->GetGeometryContext().GetWireViewGeometry(TPC_VIEW_W));
+    CartesianPointVector                       hitDirections;
+    hitDirections.reserve(caloHitList.size());
+
+    for (const CaloHit *const pCaloHit : caloHitList)
     {
-        inferredThreeDProjectionError = std::numeric_limits<float>::max();
+        const CaloHit *const pThreeDHit = this->GetDaughterThreeDHit(pCaloHit);
+        const auto           rankIter   = pThreeDHit ? hitRanks.find(pThreeDHit) : hitRanks.end();
+
+        if (rankIter == hitRanks.end())
+        {
+            hitBuffer.AddFailure();
+            hitDirections.push_back(axis);
+            continue;
+        }
+
+        const std::size_t      rank         = rankIter->second;
+        const std::size_t      lowRank      = rank > halfWindow ? rank - halfWindow : 0UL;
+        const std::size_t      highRank     = std::min(rank + halfWindow, orderedHits.size() - 1UL);
+        CartesianVector        direction    = orderedHits.at(highRank).second->GetPositionVector();
+        direction -= orderedHits.at(lowRank).second->GetPositionVector();
+
+        direction = direction.GetMagnitudeSquared() > std::numeric_limits<float>::epsilon() ? direction.GetUnitVector() : axis;
+
+        const float dX = LArAnalysisHelper::GetCellPathLength(
+            wireViewGeometry, pCaloHit->GetCellSize1(), direction.GetX(), direction.GetY(), direction.GetZ());
+
+        if (dX <= std::numeric_limits<float>::epsilon())
+        {
+            hitBuffer.AddFailure();
+            hitDirections.push_back(axis);
+            continue;
+        }
+
+        hitBuffer.Add(pThreeDHit->GetPositionVector(), 0.f, orderedHits.at(rank).first, pCaloHit->GetInputEnergy(), dX);
+        hitDirections.push_back(direction);
     }
 
-    if (inferredThreeDProjectionError > 5.f && threeDHitProjectionError > 5.f)
-        return spHitInfo;
+    hitBuffer.SortByCoordinate(isBackwards);
 
-    const CartesianVector threeDPosition = (threeDHitProjectionError < inferredThreeDProjectionError) ? threeDHitPosition : inferredThreeDPosition;
-    const float           projectionError = std::min(threeDHitProjectionError, inferredThreeDProjectionError);
+    // Accumulate the range from the separations of successive hits along their local directions, which unlike the straight-line
+    // separations does not pick up the transverse scatter of the 3D hits
+    bool            isFirstHit(true);
+    CartesianVector previousPosition(0.f, 0.f, 0.f);
+    double          range(0.);
 
-    if (STATUS_CODE_SUCCESS != this->CaloHitToThreeDDistance(hitWidth, trackFit, threeDPosition, dX))
-        return spHitInfo;
+    for (const std::size_t index : hitBuffer.m_order)
+    {
+        if (!hitBuffer.m_isValid[index])
+            continue;
 
-    if (dX <= std::numeric_limits<float>::epsilon())
-        return spHitInfo;
+        const CartesianVector position(hitBuffer.m_x[index], hitBuffer.m_y[index], hitBuffer.m_z[index]);
 
-    spHitInfo->m_projectionSuccessful = true;
-    spHitInfo->m_threeDPosition       = threeDPosition;
-    spHitInfo->m_projectionError      = projectionError;
-    spHitInfo->m_coordinate           = trackFit.GetLongitudinalDisplacement(threeDPosition); // temporary coordinate
-    spHitInfo->m_dQ                   = dQ;
-    spHitInfo->m_dX                   = dX;
+        if (!isFirstHit)
+            range += std::fabs((position - previousPosition).GetDotProduct(hitDirections.at(index)));
 
-    return spHitInfo;
+        hitBuffer.m_residualRange[index] = range;
+        previousPosition                 = position;
+        isFirstHit                       = false;
+    }
+
+    return true;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-float EnergyEstimatorNtupleTool::CorrectChargeDeposition(const float dQdxUncorrected, const CartesianVector &threeDPosition) const
+void EnergyEstimatorNtupleTool::AddHitCalorimetryInfo(const ThreeDSlidingFitResult &trackFit, const float dQ, const float hitWidth,
+    const CartesianVector &threeDPosition, const CartesianVector &fitDirection, const float projectionError,
+    const LArAnalysisHelper::WireViewGeometry &wireViewGeometry, HitCalorimetryBuffer &hitBuffer) const
 {
-    const float positionX = threeDPosition.GetX();
-    const float positionY = threeDPosition.GetY();
-    const float positionZ = threeDPosition.GetZ();
+    const float dX =
+        LArAnalysisHelper::GetCellPathLength(wireViewGeometry, hitWidth, fitDirection.GetX(), fitDirection.GetY(), fitDirection.GetZ());
+
+    if (dX <= std::numeric_limits<float>::epsilon())
+    {
+        hitBuffer.AddFailure();
+        return;
+    }
 
-    return dQdxUncorrected * this->GetDriftCoordinateCorrection(positionX) * this->GetYZCoordinateCorrection(positionY, positionZ);
+    hitBuffer.Add(threeDPosition, projectionError, trackFit.GetLongitudinalDisplacement(threeDPosition), dQ, dX);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-float EnergyEstimatorNtupleTool::GetDriftCoordinateCorrection(const float xPosition) const
+void EnergyEstimatorNtupleTool::CalculateEnergyLossRates(const LArCalorimetryHelper::HitBatch &hitBatch,
+    LArCalorimetryHelper::FloatVector &dQdxVector, LArCalorimetryHelper::FloatVector &dEdxVector) const
 {
-    const float parameter0 = 1.35970e-1f;
-    const float parameter1 = 5.18310e-3f;
-    const float parameter2 = -3.45421f;
-    const float parameter3 = 1.37225f;
-    const float parameter4 = -4.23881e-3f;
-    const float parameter5 = -6.83842e-1f;
-
-    return (parameter0 + parameter1 * (xPosition - parameter2) + parameter3 * std::sin(parameter4 * xPosition - parameter5));
+    const LArCalorimetryHelper::ModBoxParameters parameters(this->GetModBoxParameters());
+
+    if (m_useBatchCalorimetry)
+    {
+        LArCalorimetryHelper::CalculateEnergyLossRates(hitBatch, parameters, m_chargeCorrectionMaps, dQdxVector, dEdxVector);
+    }
+    else
+    {
+        dQdxVector.clear();
+        dEdxVector.clear();
+
+        for (std::size_t i = 0UL; i < hitBatch.Size(); ++i)
+        {
+            const float correction = LArCalorimetryHelper::GetChargeCorrection(
+                hitBatch.m_x.at(i), hitBatch.m_y.at(i), hitBatch.m_z.at(i), m_chargeCorrectionMaps);
+            const float dQdxCorrected = (hitBatch.m_dQ.at(i) / hitBatch.m_dX.at(i)) * correction;
+
+            dQdxVector.push_back(dQdxCorrected);
+            dEdxVector.push_back(LArCalorimetryHelper::ApplyModBoxCorrection(dQdxCorrected, parameters));
+        }
+    }
+
+    if (!m_useBatchCalorimetry || !m_checkBatchCalorimetry)
+        return;
+
+    const float tolerance = LArCalorimetryHelper::GetBatchRelativeTolerance();
+
+    for (std::size_t i = 0UL; i < hitBatch.Size(); ++i)
+    {
+        const float scalarEnergyLossRate = LArCalorimetryHelper::CalculateEnergyLossRate(hitBatch.m_dQ.at(i), hitBatch.m_dX.at(i),
+            hitBatch.m_x.at(i), hitBatch.m_y.at(i), hitBatch.m_z.at(i), parameters, m_chargeCorrectionMaps);
+
+        if (std::fabs(dEdxVector.at(i) - scalarEnergyLossRate) > tolerance * std::max(1.f, std::fabs(scalarEnergyLossRate)))
+        {
+            std::cerr << "EnergyEstimatorNtupleTool: batch dE/dx " << dEdxVector.at(i) << " disagreed with scalar dE/dx "
+                      << scalarEnergyLossRate << std::endl;
+            throw StatusCodeException(STATUS_CODE_FAILURE);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void EnergyEstimatorNtupleTool::QueuePlot(PlotSpecification &&plot) const
+{
+    plot.m_name = std::to_string(m_plotQueue.size()) + "_" + plot.m_name;
+    m_plotQueue.push_back(std::move(plot));
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-float EnergyEstimatorNtupleTool::GetYZCoordinateCorrection(const float yPosition, const float zPosition) const
+void EnergyEstimatorNtupleTool::RenderPlots() const
 {
-    const bool zCut = (zPosition > 0.f) && (zPosition < 400.f);
-    const bool yzCut1 = yPosition > -120.f + zPosition * 220.f / 400.f;
-    const bool yzCut2 = yPosition < zPosition * 120.f / 250.f;
+    if (m_plotQueue.empty())
+        return;
+
+    bf::PlotHelper::SetGlobalPlotStyle();
+
+    for (const PlotSpecification &plot : m_plotQueue)
+        EnergyEstimatorNtupleTool::RenderPlot(plot);
 
-    if (zCut && yzCut1 && yzCut2)
-        return 1.3f;
+    m_plotQueue.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-    return 1.f;
+void EnergyEstimatorNtupleTool::RenderPlot(const PlotSpecification &plot)
+{
+    const unsigned int colour = GetPlotColour(plot.m_particleId);
+
+    TCanvas canvas(plot.m_name.c_str(), plot.m_name.c_str(), 10, 10, 900, 600);
+    TGraph  graph{static_cast<Int_t>(plot.m_xValues.size()), plot.m_xValues.data(), plot.m_yValues.data()};
+
+    graph.GetYaxis()->SetTitle(plot.m_yAxisTitle.c_str());
+    graph.GetXaxis()->SetTitle(plot.m_xAxisTitle.c_str());
+    graph.SetMarkerColor(plot.m_useLightColour ? bf::PlotHelper::GetSchemeColourLight(colour) : bf::PlotHelper::GetSchemeColour(colour));
+    graph.SetMarkerStyle(7UL);
+
+    if (plot.m_hasZeroMinimum)
+        graph.SetMinimum(0.);
+
+    graph.Draw("AP");
+
+    const double xMax = graph.GetXaxis()->GetXmax();
+    graph.GetXaxis()->SetRangeUser(0., xMax);
+
+    TF1 line((plot.m_name + "_BraggLine").c_str(), "[0] + [1] * x", 0., xMax);
+    TLatex latex;
+
+    if (plot.m_hasLine)
+    {
+        line.SetLineColor(bf::PlotHelper::GetSchemeColour(colour));
+        line.SetParameter(0, plot.m_lineIntercept);
+        line.SetParameter(1, plot.m_lineGradient);
+        line.Draw("same");
+
+        latex.SetTextSize(0.04);
+        latex.DrawLatexNDC(0.7, 0.7, plot.m_lineLabel.c_str());
+    }
+
+    TLatex latexLabel;
+    latexLabel.SetTextSize(0.06);
+    latexLabel.DrawLatexNDC(0.77, 0.8, GetPlotParticleSymbol(plot.m_particleId).c_str());
+
+    if (gROOT->IsBatch())
+        canvas.SaveAs((plot.m_name + ".eps").c_str());
+
+    else
+        bf::PlotHelper::Pause();
 }
 
 } // namespace lar_physics_content
@@ -8,6 +8,7 @@
 #ifndef LAR_ENERGY_ESTIMATOR_NTUPLE_TOOL_H
 #define LAR_ENERGY_ESTIMATOR_NTUPLE_TOOL_H 1
 
+#include "larphysicscontent/LArHelpers/LArCalorimetryHelper.h"
 #include "larphysicscontent/LArHelpers/LArRootHelper.h"
 #include "larphysicscontent/LArNtuple/NtupleVariableBaseTool.h"
 
@@ -15,6 +16,9 @@
 
 #include "bethe-faster/BetheFaster.h"
 
+#include "TGraph.h"
+#include "TTree.h"
+
 namespace lar_physics_content
 {
 /**
@@ -29,29 +33,29 @@ public:
     EnergyEstimatorNtupleTool();
 
     /**
-     *  @brief  Default copy constructor
+     *  @brief  Deleted copy constructor, as each tool renders its queued plots once on destruction
      */
-    EnergyEstimatorNtupleTool(const EnergyEstimatorNtupleTool &) = default;
+    EnergyEstimatorNtupleTool(const EnergyEstimatorNtupleTool &) = delete;
 
     /**
-     *  @brief  Default move constructor
+     *  @brief  Deleted move constructor
      */
-    EnergyEstimatorNtupleTool(EnergyEstimatorNtupleTool &&) = default;
+    EnergyEstimatorNtupleTool(EnergyEstimatorNtupleTool &&) = delete;
 
     /**
-     *  @brief  Default copy assignment operator
+     *  @brief  Deleted copy assignment operator
      */
-    EnergyEstimatorNtupleTool &operator=(const EnergyEstimatorNtupleTool &) = default;
+    EnergyEstimatorNtupleTool &operator=(const EnergyEstimatorNtupleTool &) = delete;
 
     /**
-     *  @brief  Default move assignment operator
+     *  @brief  Deleted move assignment operator
      */
-    EnergyEstimatorNtupleTool &operator=(EnergyEstimatorNtupleTool &&) = default;
+    EnergyEstimatorNtupleTool &operator=(EnergyEstimatorNtupleTool &&) = delete;
 
     /**
-     *  @brief  Default destructor
+     *  @brief  Destructor, rendering any queued plots
      */
-    ~EnergyEstimatorNtupleTool() = default;
+    ~EnergyEstimatorNtupleTool();
 
 protected:
     std::vector<LArNtupleRecord> ProcessEvent(
@@ -67,49 +71,216 @@ protected:
         const std::shared_ptr<LArMCTargetValidationInfo> &spMcTarget) override;
 
 private:
+    using DoubleVector = std::vector<double>; ///< Alias for a vector of doubles
+
     /**
-     *  @brief  Struct containing hit calorimetry info
+     *  @brief  Per-particle hit calorimetry results, stored as parallel arrays that keep their capacity between particles and events
      */
-    struct HitCalorimetryInfo
+    struct HitCalorimetryBuffer
+    {
+        /**
+         *  @brief  Clear the buffer, keeping the allocated capacity
+         */
+        void Clear();
+
+        /**
+         *  @brief  Append a hit that was successfully placed on the track fit
+         *
+         *  @param  threeDPosition the 3D position
+         *  @param  projectionError the projection error
+         *  @param  coordinate the longitudinal coordinate along the track fit
+         *  @param  dQ the hit charge
+         *  @param  dX the 3D dx
+         */
+        void Add(const pandora::CartesianVector &threeDPosition, const float projectionError, const double coordinate, const double dQ,
+            const double dX);
+
+        /**
+         *  @brief  Append a hit that could not be placed on the track fit
+         */
+        void AddFailure();
+
+        /**
+         *  @brief  Get the number of hits in the buffer
+         *
+         *  @return the number of hits
+         */
+        std::size_t Size() const;
+
+        /**
+         *  @brief  Order the hits by their longitudinal coordinate, without moving any of the arrays
+         *
+         *  @param  isBackwards whether to order by descending coordinate
+         */
+        void SortByCoordinate(const bool isBackwards);
+
+        std::vector<bool>              m_isValid;         ///< Whether each hit was successfully placed on the track fit
+        pandora::FloatVector           m_x;               ///< If valid, the 3D x positions
+        pandora::FloatVector           m_y;               ///< If valid, the 3D y positions
+        pandora::FloatVector           m_z;               ///< If valid, the 3D z positions
+        pandora::FloatVector           m_projectionError; ///< If valid, the projection errors
+        DoubleVector                   m_coordinate;      ///< If valid, the longitudinal coordinates along the track fit
+        DoubleVector                   m_dQ;              ///< The hit charges
+        DoubleVector                   m_dX;              ///< The 3D dx values
+        DoubleVector                   m_residualRange;   ///< If valid, the range along the track fit from the first hit
+        pandora::FloatVector           m_dQdx;            ///< If usable for calorimetry, the corrected dQ/dx values
+        pandora::FloatVector           m_dEdx;            ///< If usable for calorimetry, the dE/dx values
+        std::vector<std::size_t>       m_order;           ///< The hit indices in coordinate order
+        LArCalorimetryHelper::HitBatch m_hitBatch;        ///< Scratch space for the hits passed to the calorimetry kernel
+        std::vector<std::size_t>       m_batchIndices;    ///< The buffer index of each hit in the calorimetry batch
+        pandora::FloatVector           m_batchDQdx;       ///< Scratch space for the calorimetry kernel dQ/dx output
+        pandora::FloatVector           m_batchDEdx;       ///< Scratch space for the calorimetry kernel dE/dx output
+    };
+
+    /**
+     *  @brief  Everything needed to draw one of the tool's plots, recorded in the event loop and rendered at the end of the job
+     */
+    struct PlotSpecification
     {
         /**
          *  @brief  Constructor
+         *
+         *  @param  name the plot name, used for the canvas and the output file
+         *  @param  xAxisTitle the x axis title
+         *  @param  yAxisTitle the y axis title
+         *  @param  particleId the PDG code of the true particle, which sets the colour and the particle label
+         */
+        PlotSpecification(const std::string &name, const std::string &xAxisTitle, const std::string &yAxisTitle, const int particleId);
+
+        /**
+         *  @brief  Copy the points from a graph
+         *
+         *  @param  graph the graph
+         */
+        void SetPoints(const TGraph &graph);
+
+        /**
+         *  @brief  Add a fitted straight line, with its parameters shown in a label
+         *
+         *  @param  intercept the intercept
+         *  @param  gradient the gradient
+         *  @param  isScientific whether to show the parameters in scientific notation
          */
-        HitCalorimetryInfo();
-
-        bool                     m_projectionSuccessful; ///< Whether the projection was successful
-        pandora::CartesianVector m_threeDPosition;       ///< If projection successful, the 3D position
-        float                    m_projectionError;      ///< If projection successful, the projection error
-        double                   m_coordinate;           ///< If projection successful, the 3D track coordinate
-        double                   m_dQ;                   ///< The hit charge
-        double                   m_dX;                   ///< The 3D dx
-        bool                     m_isNoise;              ///< Whether this hit is tagged as noisy
-        bool                     m_isFake;               ///< Whether this is a fake hit
+        void SetLine(const double intercept, const double gradient, const bool isScientific);
+
+        std::string  m_name;           ///< The plot name, used for the canvas and the output file
+        std::string  m_xAxisTitle;     ///< The x axis title
+        std::string  m_yAxisTitle;     ///< The y axis title
+        int          m_particleId;     ///< The PDG code of the true particle
+        DoubleVector m_xValues;        ///< The x values of the points
+        DoubleVector m_yValues;        ///< The y values of the points
+        bool         m_useLightColour; ///< Whether to draw the points in the light version of the particle colour
+        bool         m_hasZeroMinimum; ///< Whether the y axis starts at zero
+        bool         m_hasLine;        ///< Whether to draw a fitted line
+        double       m_lineIntercept;  ///< The fitted line intercept
+        double       m_lineGradient;   ///< The fitted line gradient
+        std::string  m_lineLabel;      ///< The label with the fitted line parameters
     };
 
-    using DoubleVector          = std::vector<double>;                 ///< Alias for a vector of doubles
-    using HitCalorimetryInfoPtr = std::shared_ptr<HitCalorimetryInfo>; ///< Alias for a shared to a HitCalorimetryInfo object
-    using HitCalorimetryInfoMap =
-        std::unordered_map<const pandora::CaloHit *, HitCalorimetryInfoPtr>; ///< Alias for a map from CaloHits to HitCalorimetryInfo shared pointers
-    using CaloHitMap = std::unordered_map<const pandora::CaloHit *, const pandora::CaloHit *>; ///< Alias for a map between CaloHits
-
-    template <typename T>
-    using HitDataGetter = std::function<std::optional<std::decay_t<T>>(const pandora::CaloHit *const, const HitCalorimetryInfo &hitInfo)>; ///< Alias for a CaloHit info getter function
-
-    bool  m_trainingMode;
-    bool  m_braggGradientTrainingMode; ///< Whether to run in Bragg gradient training mode
-    bool  m_makePlots;                 ///< Make plots
-    float m_modboxRho;                 ///< The ModBox rho parameter
-    float m_modboxA;                   ///< The ModBox A parameter
-    float m_modboxB;                   ///< The ModBox B parameter
-    float m_modboxEpsilon;             ///< The ModBox epsilon parameter
-    float m_modboxWion;                ///< The ModBox W_ion parameter
-    float m_modboxC;                   ///< The ModBox C parameter
-    float m_modboxFactor;              ///< The ModBox (rho * epsilon / B) value
+    using PlotSpecificationVector = std::vector<PlotSpecification>; ///< Alias for a vector of plot specifications
+
+    /**
+     *  @brief  Running totals comparing the approximate calorimetry with the full calorimetry, particle by particle
+     */
+    struct CalorimetryComparison
+    {
+        /**
+         *  @brief  Default constructor
+         */
+        CalorimetryComparison();
+
+        /**
+         *  @brief  Add a particle
+         *
+         *  @param  fullHitCharges the hit charges from the full calorimetry
+         *  @param  approximateHitCharges the hit charges from the approximate calorimetry
+         */
+        void Add(const std::vector<bf::HitCharge> &fullHitCharges, const std::vector<bf::HitCharge> &approximateHitCharges);
+
+        /**
+         *  @brief  Print a summary of the bias of the approximate calorimetry
+         */
+        void Print() const;
+
+        std::size_t m_nParticles;                 ///< The number of particles compared
+        double      m_sumFullTrackEnergy;         ///< The sum of the full track energies
+        double      m_sumTrackEnergyDifference;   ///< The sum of the approximate minus full track energies
+        double      m_sumSquaredEnergyDifference; ///< The sum of the squared approximate minus full track energies
+        double      m_sumHitCountDifference;      ///< The sum of the approximate minus full numbers of hits
+    };
+
+    /**
+     *  @brief  Optional side tree with one entry per collection plane hit passed to the track calorimetry, holding the uncorrected
+     *          inputs so that offline macros can re-apply charge corrections and recombination models without reprocessing
+     */
+    struct HitCalorimetryTree
+    {
+        /**
+         *  @brief  Constructor, appending to the tree if the file already has one
+         *
+         *  @param  filePath the ROOT file path
+         *  @param  treeName the tree name
+         */
+        HitCalorimetryTree(const std::string &filePath, const std::string &treeName);
+
+        /**
+         *  @brief  Set the particle that owns the hits filled from now on
+         *
+         *  @param  particleType the vector branch type of the owning particle
+         *  @param  particleIndex the index of the owning particle in its vector branches
+         */
+        void SetOwner(const LArNtupleHelper::VECTOR_BRANCH_TYPE particleType, const LArNtupleRecord::RUInt particleIndex);
+
+        /**
+         *  @brief  Fill an entry for each hit in a buffer that was passed to the calorimetry kernel, in coordinate order
+         *
+         *  @param  ntupleEntry the main ntuple entry of the event
+         *  @param  hitBuffer the hit calorimetry buffer
+         */
+        void Fill(const Long64_t ntupleEntry, const HitCalorimetryBuffer &hitBuffer);
+
+        std::shared_ptr<LArRootRegistry> m_spRegistry;    ///< The ROOT registry for the side tree file
+        TTree *                          m_pTree;         ///< The side tree
+        Long64_t                         m_ntupleEntry;   ///< The main ntuple entry of the event
+        LArNtupleRecord::RUInt           m_particleType;  ///< The vector branch type of the owning particle
+        LArNtupleRecord::RUInt           m_particleIndex; ///< The index of the owning particle in its vector branches
+        LArNtupleRecord::RUInt           m_trackIndex;    ///< The index of the track among the owning particle's calorimetry tracks
+        LArNtupleRecord::RFloat          m_dQ;            ///< The uncorrected hit charge
+        LArNtupleRecord::RFloat          m_dX;            ///< The 3D dx
+        LArNtupleRecord::RFloat          m_x;             ///< The 3D x position
+        LArNtupleRecord::RFloat          m_y;             ///< The 3D y position
+        LArNtupleRecord::RFloat          m_z;             ///< The 3D z position
+        LArNtupleRecord::RFloat          m_residualRange; ///< The residual range
+    };
+
+    bool         m_trainingMode;
+    bool         m_braggGradientTrainingMode;     ///< Whether to run in Bragg gradient training mode
+    bool         m_makePlots;                     ///< Make plots
+    bool         m_useBatchCalorimetry;           ///< Whether to calculate dE/dx with the batch calorimetry kernel rather than hit by hit
+    bool         m_checkBatchCalorimetry;         ///< Whether to check the batch calorimetry kernel against the scalar path
+    bool         m_useApproximateCalorimetry;     ///< Whether to take track directions from local PCA segments instead of sliding fits
+    unsigned int m_approximateSegmentHalfWindow;  ///< The number of ordered 3D hits either side of a hit in its approximate segment
+    bool         m_compareApproximateCalorimetry; ///< Whether to also run the full calorimetry and report the approximate bias
+    float        m_modboxRho;                     ///< The ModBox rho parameter
+    float        m_modboxA;                       ///< The ModBox A parameter
+    float        m_modboxB;                       ///< The ModBox B parameter
+    float        m_modboxEpsilon;                 ///< The ModBox epsilon parameter
+    float        m_modboxWion;                    ///< The ModBox W_ion parameter
+    float        m_modboxC;                       ///< The ModBox C parameter
+    float        m_modboxFactor;                  ///< The ModBox (rho * epsilon / B) value
+
+    LArCalorimetryHelper::ChargeCorrectionMaps m_chargeCorrectionMaps; ///< The charge correction lookup tables, loaded at initialisation
+
+    mutable HitCalorimetryBuffer    m_hitCalorimetryBuffer;  ///< The reusable per-particle hit calorimetry buffer
+    mutable PlotSpecificationVector m_plotQueue;             ///< The plots to render at the end of the job
+    mutable CalorimetryComparison   m_calorimetryComparison; ///< The comparison of the approximate and full calorimetry
+
+    std::shared_ptr<HitCalorimetryTree> m_spHitCalorimetryTree; ///< The optional per-hit calorimetry side tree
 
     pandora::StatusCode ReadSettings(const pandora::TiXmlHandle xmlHandle);
 
-    std::vector<LArNtupleRecord> ProduceTrainingRecords(const pandora::ParticleFlowObject *const pPfo) const;
+    std::vector<LArNtupleRecord> ProduceTrainingRecords(
+        const pandora::ParticleFlowObject *const pPfo, const pandora::MCParticle *const pMcParticle) const;
 
     /**
      *  @brief  Get energy estimator records for a PFO
@@ -133,39 +304,6 @@ private:
     std::tuple<LArNtupleRecord::RFloatVector, LArNtupleRecord::RFloatVector, LArNtupleRecord::RFloat, LArNtupleRecord::RUInt> GetHitCalorimetryInfo(
         const pandora::ParticleFlowObject *const pPfo, const pandora::MCParticle *const pMcParticle) const;
 
-    /**
-     *  @brief  Get a 3D distance from a cell
-     *
-     *  @param  hitWidth the hit width
-     *  @param  wirePitch the wire pitch
-     *  @param  fitDirection the fit direction at the hit
-     *
-     *  @return the 3D distance
-     */
-    float CellToThreeDDistance(const float hitWidth, const float wirePitch, const pandora::CartesianVector &fitDirection) const;
-
-    /**
-     *  @brief  Get the 3D distance from CaloHit info
-     *
-     *  @param  hitWidth the instance of Pandora
-     *  @param  trackFit the 3D track fit to which the hit belongs
-     *  @param  threeDPosition the 3D position
-     *  @param  threeDDistance the 3D distance (to populate)
-     *
-     *  @return the status code
-     */
-    pandora::StatusCode CaloHitToThreeDDistance(const float hitWidth, const lar_content::ThreeDSlidingFitResult &trackFit,
-        const pandora::CartesianVector &threeDPosition, float &threeDDistance) const;
-
-    /**
-     *  @brief  Turn a direction in polar and azimuthal angles
-     *
-     *  @param  direction the Cartesian direction
-     *
-     *  @return the polar and azimuthal angles
-     */
-    std::tuple<float, float> GetPolarAnglesFromDirection(const pandora::CartesianVector &direction) const;
-
     /**
      *  @brief  Produce Bragg gradient training records for a PFO
      *
@@ -195,47 +333,103 @@ private:
     bool GetBraggGradientParameters(const pandora::ParticleFlowObject *const pPfo, const pandora::MCParticle *const pMcParticle,
         float &firstOrderGradient, float &firstOrderIntercept, float &secondOrderGradient, float &secondOrderIntercept, float &averageDetectorThickness, float &pida, float &medianFilteredEnergyLossRate, float &medianUnfilteredEnergyLossRate, const float maxResidualRange) const;
 
+    /**
+     *  @brief  Whether a particle can be treated as a track by the selected calorimetry mode
+     *
+     *  @param  pPfo address of the PFO
+     *
+     *  @return whether the full mode has a track fit, or the approximate mode has enough 3D hits
+     */
+    bool HasTrackCalorimetry(const pandora::ParticleFlowObject *const pPfo) const;
+
+    /**
+     *  @brief  Get the dE/dx distribution of a particle with the selected calorimetry mode
+     *
+     *  @param  pPfo address of the PFO
+     *  @param  caloHitList the collection plane CaloHit list
+     *  @param  isBackwards whether the particle is going backwards
+     *  @param  pMcParticle address of the MC particle
+     *  @param  hitChargeVector the vector of hit charge objects (to populate)
+     *
+     *  @return whether the particle could be treated as a track
+     */
+    bool GetParticledEdxDistribution(const pandora::ParticleFlowObject *const pPfo, const pandora::CaloHitList &caloHitList,
+        const bool isBackwards, const pandora::MCParticle *const pMcParticle, std::vector<bf::HitCharge> &hitChargeVector) const;
+
     /**
      *  @brief  Get the dE/dx distribution
      *
      *  @param  trackFit the 3D track fit
      *  @param  caloHitList the CaloHit list
-     *  @param  caloHitMap the map from 2D to 3D CaloHits
      *  @param  isBackwards whether the particle is going backwards
      *  @param  pMcParticle address of the MC particle
      *
      *  @return the vector of hit charge objects
      */
     std::vector<bf::HitCharge> GetdEdxDistribution(const lar_content::ThreeDSlidingFitResult &trackFit, pandora::CaloHitList caloHitList,
-        const CaloHitMap &caloHitMap, const bool isBackwards, const pandora::MCParticle * const pMcParticle) const;
+        const bool isBackwards, const pandora::MCParticle * const pMcParticle) const;
 
     /**
-     *  @brief  Generate the hit calorimetry info map
+     *  @brief  Calculate the hit calorimetry info for a particle, ordered by coordinate and with the residual range of each hit
      *
      *  @param  trackFit the track fit object
      *  @param  caloHitList the CaloHit list
-     *  @param  caloHitMap the map from 2D to 3D CaloHits
      *  @param  isBackwards whether the particle is going backwards
+     *  @param  hitBuffer the hit calorimetry buffer (to populate)
+     */
+    void CalculateHitCalorimetryInfo(const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::CaloHitList &caloHitList,
+        const bool isBackwards, HitCalorimetryBuffer &hitBuffer) const;
+
+    /**
+     *  @brief  Calculate approximate hit calorimetry info for a particle without a sliding fit. Each collection plane hit takes the
+     *          position of its 3D hit, and the direction of a straight segment through the neighbouring 3D hits ordered along the
+     *          particle's principal axis. Residual ranges accumulate the separations of successive hits along those directions
+     *
+     *  @param  pPfo address of the PFO
+     *  @param  caloHitList the collection plane CaloHit list
+     *  @param  isBackwards whether the particle is going backwards
+     *  @param  hitBuffer the hit calorimetry buffer (to populate)
+     *
+     *  @return whether there were enough 3D hits to define the principal axis
+     */
+    bool CalculateApproximateHitCalorimetryInfo(const pandora::ParticleFlowObject *const pPfo, const pandora::CaloHitList &caloHitList,
+        const bool isBackwards, HitCalorimetryBuffer &hitBuffer) const;
+
+    /**
+     *  @brief  Run the calorimetry kernel over the valid hits in a buffer and convert them to hit charges
+     *
+     *  @param  hitBuffer the hit calorimetry buffer
+     *  @param  pMcParticle address of the MC particle, used only for plots
      *
-     *  @return the hit calorimetry info vector
+     *  @return the vector of hit charge objects
+     */
+    std::vector<bf::HitCharge> GetHitCharges(HitCalorimetryBuffer &hitBuffer, const pandora::MCParticle *const pMcParticle) const;
+
+    /**
+     *  @brief  Write the hits that the calorimetry kernel uses for each track of a particle to the side tree, if there is one. This is
+     *          called once for each particle, whatever the mode, so that each particle's hits are written exactly once
+     *
+     *  @param  pPfo address of the particle's PFO
+     *  @param  particleType the vector branch type of the particle
      */
-    std::vector<HitCalorimetryInfoPtr> CalculateHitCalorimetryInfo(const lar_content::ThreeDSlidingFitResult &trackFit,
-        const pandora::CaloHitList &caloHitList, const CaloHitMap &caloHitMap, const bool isBackwards) const;
+    void FillHitCalorimetryTree(
+        const pandora::ParticleFlowObject *const pPfo, const LArNtupleHelper::VECTOR_BRANCH_TYPE particleType) const;
 
     /**
-     *  @brief  Calculate the hit calorimetry info
+     *  @brief  Add the calorimetry info for a hit already placed on the track fit to a buffer
      *
      *  @param  trackFit the track fit object
-     *  @param  twoDPositionVector the 2D position
      *  @param  dQ the hit charge
      *  @param  hitWidth the hit width
-     *  @param  caloHitMap the map from 2D to 3D CaloHits
-     *  @param  pCaloHit address of the CaloHit
-     *
-     *  @return shared pointer to the hit calorimetry info object
+     *  @param  threeDPosition the 3D position of the hit
+     *  @param  fitDirection the fitted track direction at the 3D position
+     *  @param  projectionError the distance between the 2D hit and the projection of the 3D position
+     *  @param  wireViewGeometry the wire geometry constants for the view of the hit
+     *  @param  hitBuffer the hit calorimetry buffer (to append to)
      */
-    HitCalorimetryInfoPtr CalculateHitCalorimetryInfo(const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::CartesianVector &twoDPositionVector,
-        const float dQ, const float hitWidth, const CaloHitMap &caloHitMap, const pandora::CaloHit *const pCaloHit) const;
+    void AddHitCalorimetryInfo(const lar_content::ThreeDSlidingFitResult &trackFit, const float dQ, const float hitWidth,
+        const pandora::CartesianVector &threeDPosition, const pandora::CartesianVector &fitDirection, const float projectionError,
+        const LArAnalysisHelper::WireViewGeometry &wireViewGeometry, HitCalorimetryBuffer &hitBuffer) const;
 
     /**
      *  @brief  Esimate the energy of a track hit
@@ -274,26 +468,64 @@ private:
      */
     float ApplyChargeScaling(const float dQdx) const;
 
-    float CorrectChargeDeposition(const float dQdxUncorrected, const pandora::CartesianVector &threeDPosition) const;
+    /**
+     *  @brief  Get the ModBox parameters
+     *
+     *  @return the ModBox parameters
+     */
+    LArCalorimetryHelper::ModBoxParameters GetModBoxParameters() const;
+
+    /**
+     *  @brief  Calculate the corrected dQ/dx and dE/dx for a batch of hits, with either the batch kernel or the scalar path, taking the
+     *          charge corrections from the configured lookup tables where set
+     *
+     *  @param  hitBatch the hit batch
+     *  @param  dQdxVector the corrected dQ/dx values (to populate)
+     *  @param  dEdxVector the dE/dx values (to populate)
+     */
+    void CalculateEnergyLossRates(const LArCalorimetryHelper::HitBatch &hitBatch, LArCalorimetryHelper::FloatVector &dQdxVector,
+        LArCalorimetryHelper::FloatVector &dEdxVector) const;
+
+    /**
+     *  @brief  Queue a plot to be rendered at the end of the job, so that the event loop does no drawing or file output
+     *
+     *  @param  plot the plot specification
+     */
+    void QueuePlot(PlotSpecification &&plot) const;
 
-    float GetDriftCoordinateCorrection(const float xPosition) const;
+    /**
+     *  @brief  Render all the queued plots, saving them to file in batch mode and pausing on each one otherwise
+     */
+    void RenderPlots() const;
 
-    float GetYZCoordinateCorrection(const float yPosition, const float zPosition) const;
+    /**
+     *  @brief  Render a plot
+     *
+     *  @param  plot the plot specification
+     */
+    static void RenderPlot(const PlotSpecification &plot);
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+inline std::size_t EnergyEstimatorNtupleTool::HitCalorimetryBuffer::Size() const
+{
+    return m_isValid.size();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 inline float EnergyEstimatorNtupleTool::ApplyModBoxCorrection(const float dQdx) const
 {
-    return m_modboxFactor * (std::exp(this->ApplyChargeScaling(dQdx) / m_modboxFactor) - m_modboxA);
+    return LArCalorimetryHelper::ApplyModBoxCorrection(dQdx, this->GetModBoxParameters());
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 inline float EnergyEstimatorNtupleTool::ApplyChargeScaling(const float chargeValue) const
 {
-    return chargeValue * m_modboxWion / m_modboxC;
+    return LArCalorimetryHelper::ApplyChargeScaling(chargeValue, this->GetModBoxParameters());
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -310,6 +542,13 @@ inline float EnergyEstimatorNtupleTool::EstimateShowerEnergy(const float showerC
     return this->ApplyChargeScaling(showerCharge);
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArCalorimetryHelper::ModBoxParameters EnergyEstimatorNtupleTool::GetModBoxParameters() const
+{
+    return LArCalorimetryHelper::ModBoxParameters(m_modboxFactor, m_modboxA, m_modboxWion, m_modboxC);
+}
+
 } // namespace lar_physics_content
 
 #endif // #ifndef LAR_ENERGY_ESTIMATOR_NTUPLE_TOOL_H
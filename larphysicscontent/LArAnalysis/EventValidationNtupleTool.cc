@@ -7,6 +7,7 @@
  */
 
 #include "larphysicscontent/LArAnalysis/EventValidationNtupleTool.h"
+#include "larphysicscontent/LArHelpers/LArNtupleHelper.h"
 
 #include "Pandora/AlgorithmHeaders.h"
 #include "larpandoracontent/LArHelpers/LArMonitoringHelper.h"
@@ -17,8 +18,15 @@ using namespace lar_content;
 
 namespace lar_physics_content
 {
-EventValidationNtupleTool::EventValidationNtupleTool() : NtupleVariableBaseTool()
+EventValidationNtupleTool::EventValidationNtupleTool() : NtupleVariableBaseTool(), m_spInteractionTypes(nullptr)
 {
+    // Declare every interaction type up front, with an empty category for a missing MC interaction, so that every job writes the same codes
+    LArNtupleRecord::RCategory::Vocabulary interactionTypes{""};
+
+    for (int type = 0; type <= static_cast<int>(LArInteractionTypeHelper::InteractionType::ALL_INTERACTIONS); ++type)
+        interactionTypes.push_back(LArInteractionTypeHelper::ToString(static_cast<LArInteractionTypeHelper::InteractionType>(type)));
+
+    m_spInteractionTypes = std::make_shared<const LArNtupleRecord::RCategory::Vocabulary>(std::move(interactionTypes));
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -111,8 +119,8 @@ std::vector<LArNtupleRecord> EventValidationNtupleTool::WriteInteractionRecords(
         records.emplace_back("mc_IsFake", static_cast<LArNtupleRecord::RBool>(spMcInteraction->IsFake()));
         records.emplace_back("mc_IsSplit", static_cast<LArNtupleRecord::RBool>(spMcInteraction->IsSplit()));
         records.emplace_back("mc_IsLost", static_cast<LArNtupleRecord::RBool>(spMcInteraction->IsLost()));
-        records.emplace_back(
-            "mc_InteractionType", LArNtupleRecord::RTString(LArInteractionTypeHelper::ToString(spMcInteraction->GetInteractionType())));
+        records.emplace_back("mc_InteractionType",
+            LArNtupleRecord::RCategory(LArInteractionTypeHelper::ToString(spMcInteraction->GetInteractionType()), m_spInteractionTypes));
     }
 
     else
@@ -122,7 +130,7 @@ std::vector<LArNtupleRecord> EventValidationNtupleTool::WriteInteractionRecords(
         records.emplace_back("mc_IsFake", static_cast<LArNtupleRecord::RBool>(false));
         records.emplace_back("mc_IsSplit", static_cast<LArNtupleRecord::RBool>(false));
         records.emplace_back("mc_IsLost", static_cast<LArNtupleRecord::RBool>(false));
-        records.emplace_back("mc_InteractionType", LArNtupleRecord::RTString(""));
+        records.emplace_back("mc_InteractionType", LArNtupleRecord::RCategory("", m_spInteractionTypes));
     }
 
     return records;
@@ -133,7 +141,8 @@ std::vector<LArNtupleRecord> EventValidationNtupleTool::WriteInteractionRecords(
 std::vector<LArNtupleRecord> EventValidationNtupleTool::WriteMatchRecords(
     const ParticleFlowObject *const pPfo, const std::shared_ptr<LArMCTargetValidationInfo> &spMcTarget) const
 {
-    std::vector<LArNtupleRecord> records;
+    std::vector<LArNtupleRecord>     records;
+    const LArNtupleRecord::Precision fractionPrecision(LArNtupleHelper::GetFractionPrecision());
 
     if (pPfo && spMcTarget)
     {
@@ -145,15 +154,15 @@ std::vector<LArNtupleRecord> EventValidationNtupleTool::WriteMatchRecords(
             throw StatusCodeException(STATUS_CODE_FAILURE);
         }
 
-        records.emplace_back("mc_MatchPurity", static_cast<LArNtupleRecord::RFloat>(spMcMatch->GetPurity()));
-        records.emplace_back("mc_MatchCompleteness", static_cast<LArNtupleRecord::RFloat>(spMcMatch->GetCompleteness()));
+        records.emplace_back("mc_MatchPurity", static_cast<LArNtupleRecord::RFloat>(spMcMatch->GetPurity()), fractionPrecision);
+        records.emplace_back("mc_MatchCompleteness", static_cast<LArNtupleRecord::RFloat>(spMcMatch->GetCompleteness()), fractionPrecision);
         records.emplace_back("mc_IsGoodMatch", static_cast<LArNtupleRecord::RBool>(spMcMatch->IsGoodMatch()));
     }
 
     else
     {
-        records.emplace_back("mc_MatchPurity", static_cast<LArNtupleRecord::RFloat>(0.f));
-        records.emplace_back("mc_MatchCompleteness", static_cast<LArNtupleRecord::RFloat>(0.f));
+        records.emplace_back("mc_MatchPurity", static_cast<LArNtupleRecord::RFloat>(0.f), fractionPrecision);
+        records.emplace_back("mc_MatchCompleteness", static_cast<LArNtupleRecord::RFloat>(0.f), fractionPrecision);
         records.emplace_back("mc_IsGoodMatch", static_cast<LArNtupleRecord::RBool>(false));
     }
 
@@ -85,6 +85,8 @@ private:
      *  @return the records
      */
     std::vector<LArNtupleRecord> WriteMatchRecords(const pandora::ParticleFlowObject *const pPfo, const std::shared_ptr<LArMCTargetValidationInfo> &spMcTarget) const;
+
+    LArNtupleRecord::RCategory::VocabularySPtr m_spInteractionTypes; ///< The vocabulary of interaction types
 };
 
 } // namespace lar_physics_content
@@ -7,10 +7,8 @@
  */
 
 #include "larphysicscontent/LArHelpers/LArAnalysisHelper.h"
-#include "larpandoracontent/LArHelpers/LArGeometryHelper.h"
 
-#include "Geometry/LArTPC.h"
-#include "Managers/GeometryManager.h"
+#include <numeric>
 
 using namespace pandora;
 using namespace lar_content;
@@ -19,28 +17,32 @@ namespace lar_physics_content
 {
 
 std::tuple<CartesianVector, CartesianVector> LArAnalysisHelper::GetFiducialCutCoordinates(
-    const Pandora &pandoraInstance, const CartesianVector &fiducialCutLowMargins, const CartesianVector &fiducialCutHighMargins)
+    const LArGeometryContext &geometryContext, const CartesianVector &fiducialCutLowMargins, const CartesianVector &fiducialCutHighMargins)
 {
-    const LArTPCMap &larTPCMap(pandoraInstance.GetGeometry()->GetLArTPCMap());
+    return {
+        geometryContext.GetTPCMinCoordinates() + fiducialCutLowMargins, geometryContext.GetTPCMaxCoordinates() - fiducialCutHighMargins};
+}
 
-    if (larTPCMap.size() != 1UL)
-    {
-        std::cout << "LArAnalysisHelper: the number of LArTPCs was not equal to 1" << std::endl;
-        throw StatusCodeException(STATUS_CODE_NOT_FOUND);
-    }
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-    const LArTPC *const pLArTPC(larTPCMap.begin()->second);
+void LArAnalysisHelper::GetCellPathLengths(const WireViewGeometry &wireViewGeometry, const FloatVector &hitWidths,
+    const FloatVector &directionsX, const FloatVector &directionsY, const FloatVector &directionsZ, FloatVector &pathLengths)
+{
+    const std::size_t nHits = hitWidths.size();
 
-    // The extremal coordinates are at the centre +- half of the widths
-    const float xMin(pLArTPC->GetCenterX() - (0.5f * pLArTPC->GetWidthX()) + fiducialCutLowMargins.GetX());
-    const float yMin(pLArTPC->GetCenterY() - (0.5f * pLArTPC->GetWidthY()) + fiducialCutLowMargins.GetY());
-    const float zMin(pLArTPC->GetCenterZ() - (0.5f * pLArTPC->GetWidthZ()) + fiducialCutLowMargins.GetZ());
+    if ((directionsX.size() != nHits) || (directionsY.size() != nHits) || (directionsZ.size() != nHits))
+    {
+        std::cout << "LArAnalysisHelper: the hit width and direction vectors had different sizes" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
 
-    const float xMax(pLArTPC->GetCenterX() + (0.5f * pLArTPC->GetWidthX()) - fiducialCutHighMargins.GetX());
-    const float yMax(pLArTPC->GetCenterY() + (0.5f * pLArTPC->GetWidthY()) - fiducialCutHighMargins.GetY());
-    const float zMax(pLArTPC->GetCenterZ() + (0.5f * pLArTPC->GetWidthZ()) - fiducialCutHighMargins.GetZ());
+    pathLengths.resize(nHits);
 
-    return {CartesianVector(xMin, yMin, zMin), CartesianVector(xMax, yMax, zMax)};
+    for (std::size_t i = 0UL; i < nHits; ++i)
+    {
+        pathLengths[i] =
+            LArAnalysisHelper::GetCellPathLength(wireViewGeometry, hitWidths[i], directionsX[i], directionsY[i], directionsZ[i]);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -83,18 +85,19 @@ bool LArAnalysisHelper::IsTrueShower(const MCParticle *const pMCParticle)
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-StatusCode LArAnalysisHelper::ProjectTwoDPositionOntoTrackFit(const Pandora &pandoraInstance, const ThreeDSlidingFitResult &trackFit,
-    const CartesianVector &twoDPosition, const HitType hitType, const bool linearlyProjectEnds, CartesianVector &threeDPosition, float &projectionError)
+StatusCode LArAnalysisHelper::ProjectTwoDPositionOntoTrackFit(const LArGeometryContext &geometryContext,
+    const ThreeDSlidingFitResult &trackFit, const CartesianVector &twoDPosition, const HitType hitType, const bool linearlyProjectEnds,
+    CartesianVector &threeDPosition, float &projectionError)
 {
     // Calculate the effective longitudinal coordinate along the 3D fit
     const float longCoordScalingFactor =
-        LArGeometryHelper::ProjectDirection(pandoraInstance, trackFit.GetAxisDirection(), hitType).GetDotProduct(trackFit.GetAxisDirection());
+        geometryContext.ProjectDirection(trackFit.GetAxisDirection(), hitType).GetDotProduct(trackFit.GetAxisDirection());
 
     if (longCoordScalingFactor <= std::numeric_limits<float>::epsilon())
         return STATUS_CODE_FAILURE;
 
-    const CartesianVector &projectedIntercept = LArGeometryHelper::ProjectPosition(pandoraInstance, trackFit.GetAxisIntercept(), hitType);
-    const CartesianVector &projectedDirection = LArGeometryHelper::ProjectDirection(pandoraInstance, trackFit.GetAxisDirection(), hitType);
+    const CartesianVector &projectedIntercept = geometryContext.ProjectPosition(trackFit.GetAxisIntercept(), hitType);
+    const CartesianVector &projectedDirection = geometryContext.ProjectDirection(trackFit.GetAxisDirection(), hitType);
 
     const float projectedLongCoord = (twoDPosition - projectedIntercept).GetDotProduct(projectedDirection);
     const float longCoord          = projectedLongCoord / longCoordScalingFactor;
@@ -102,7 +105,7 @@ StatusCode LArAnalysisHelper::ProjectTwoDPositionOntoTrackFit(const Pandora &pan
     // If this is within bounds, then get the fit position
     if (STATUS_CODE_SUCCESS == trackFit.GetGlobalFitPosition(longCoord, threeDPosition))
     {
-        projectionError = (LArGeometryHelper::ProjectPosition(pandoraInstance, threeDPosition, hitType) - twoDPosition).GetMagnitude();
+        projectionError = (geometryContext.ProjectPosition(threeDPosition, hitType) - twoDPosition).GetMagnitude();
         return STATUS_CODE_SUCCESS;
     }
 
@@ -113,15 +116,15 @@ StatusCode LArAnalysisHelper::ProjectTwoDPositionOntoTrackFit(const Pandora &pan
     const CartesianVector &minPosition = trackFit.GetGlobalMinLayerPosition();
     const CartesianVector &maxPosition = trackFit.GetGlobalMaxLayerPosition();
 
-    const CartesianVector projectedMinPosition = LArGeometryHelper::ProjectPosition(pandoraInstance, minPosition, hitType);
-    const CartesianVector projectedMaxPosition = LArGeometryHelper::ProjectPosition(pandoraInstance, maxPosition, hitType);
+    const CartesianVector projectedMinPosition = geometryContext.ProjectPosition(minPosition, hitType);
+    const CartesianVector projectedMaxPosition = geometryContext.ProjectPosition(maxPosition, hitType);
 
     const bool closerToMax = ((twoDPosition - projectedMinPosition).GetMagnitude() > (twoDPosition - projectedMaxPosition).GetMagnitude());
 
     // Check the quality
     if (STATUS_CODE_SUCCESS == LArAnalysisHelper::LinearlyExtrapolateVectorFromFitEnd(trackFit, longCoord, closerToMax, threeDPosition))
     {
-        projectionError = (LArGeometryHelper::ProjectPosition(pandoraInstance, threeDPosition, hitType) - twoDPosition).GetMagnitude();
+        projectionError = (geometryContext.ProjectPosition(threeDPosition, hitType) - twoDPosition).GetMagnitude();
         return STATUS_CODE_SUCCESS;
     }
 
@@ -130,6 +133,78 @@ StatusCode LArAnalysisHelper::ProjectTwoDPositionOntoTrackFit(const Pandora &pan
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+void LArAnalysisHelper::ProjectTwoDPositionsOntoTrackFit(const LArGeometryContext &geometryContext, const ThreeDSlidingFitResult &trackFit,
+    const CartesianPointVector &twoDPositions, const HitType hitType, const bool linearlyProjectEnds, TrackFitProjectionVector &projections)
+{
+    projections.assign(twoDPositions.size(), TrackFitProjection());
+
+    // Calculate the effective longitudinal coordinates along the 3D fit, exactly as for a single position
+    const float longCoordScalingFactor =
+        geometryContext.ProjectDirection(trackFit.GetAxisDirection(), hitType).GetDotProduct(trackFit.GetAxisDirection());
+
+    if (longCoordScalingFactor <= std::numeric_limits<float>::epsilon())
+        return;
+
+    const CartesianVector projectedIntercept = geometryContext.ProjectPosition(trackFit.GetAxisIntercept(), hitType);
+    const CartesianVector projectedDirection = geometryContext.ProjectDirection(trackFit.GetAxisDirection(), hitType);
+
+    FloatVector longCoords;
+    longCoords.reserve(twoDPositions.size());
+
+    for (const CartesianVector &twoDPosition : twoDPositions)
+        longCoords.push_back((twoDPosition - projectedIntercept).GetDotProduct(projectedDirection) / longCoordScalingFactor);
+
+    CartesianPointVector fitPositions, fitDirections;
+    std::vector<bool>    isWithinFit;
+    LArAnalysisHelper::InterpolateTrackFit(trackFit, longCoords, fitPositions, fitDirections, isWithinFit);
+
+    const CartesianVector &minPosition          = trackFit.GetGlobalMinLayerPosition();
+    const CartesianVector &maxPosition          = trackFit.GetGlobalMaxLayerPosition();
+    const CartesianVector  projectedMinPosition = geometryContext.ProjectPosition(minPosition, hitType);
+    const CartesianVector  projectedMaxPosition = geometryContext.ProjectPosition(maxPosition, hitType);
+
+    for (std::size_t i = 0UL; i < twoDPositions.size(); ++i)
+    {
+        const CartesianVector &twoDPosition = twoDPositions.at(i);
+        TrackFitProjection &   projection   = projections.at(i);
+
+        if (isWithinFit.at(i))
+        {
+            const CartesianVector &threeDPosition = fitPositions.at(i);
+            const bool closerToMin = ((threeDPosition - minPosition).GetMagnitude() < (threeDPosition - maxPosition).GetMagnitude());
+
+            projection.m_isValid         = true;
+            projection.m_threeDPosition  = threeDPosition;
+            projection.m_direction       = LArAnalysisHelper::AlignVectorWithFit(trackFit, fitDirections.at(i), closerToMin);
+            projection.m_projectionError = (geometryContext.ProjectPosition(threeDPosition, hitType) - twoDPosition).GetMagnitude();
+            continue;
+        }
+
+        if (!linearlyProjectEnds)
+            continue;
+
+        // Positions beyond the fit ends are rare, so these fall back to the single-position path
+        const bool closerToMax =
+            ((twoDPosition - projectedMinPosition).GetMagnitude() > (twoDPosition - projectedMaxPosition).GetMagnitude());
+
+        CartesianVector threeDPosition(0.f, 0.f, 0.f), direction(0.f, 0.f, 0.f);
+
+        if (STATUS_CODE_SUCCESS !=
+            LArAnalysisHelper::LinearlyExtrapolateVectorFromFitEnd(trackFit, longCoords.at(i), closerToMax, threeDPosition))
+            continue;
+
+        if (STATUS_CODE_SUCCESS != LArAnalysisHelper::GetFittedDirectionAtThreeDPosition(trackFit, threeDPosition, true, direction))
+            continue;
+
+        projection.m_isValid         = true;
+        projection.m_threeDPosition  = threeDPosition;
+        projection.m_direction       = direction;
+        projection.m_projectionError = (geometryContext.ProjectPosition(threeDPosition, hitType) - twoDPosition).GetMagnitude();
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 StatusCode LArAnalysisHelper::GetFittedDirectionAtThreeDPosition(
     const ThreeDSlidingFitResult &trackFit, const CartesianVector &threeDPosition, const bool snapToEnds, CartesianVector &direction)
 {
@@ -160,6 +235,123 @@ StatusCode LArAnalysisHelper::GetFittedDirectionAtThreeDPosition(
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+void LArAnalysisHelper::GetFittedDirectionsAtThreeDPositions(const ThreeDSlidingFitResult &trackFit,
+    const CartesianPointVector &threeDPositions, const bool snapToEnds, CartesianPointVector &directions, std::vector<bool> &isValid)
+{
+    FloatVector longCoords;
+    longCoords.reserve(threeDPositions.size());
+
+    for (const CartesianVector &threeDPosition : threeDPositions)
+        longCoords.push_back(trackFit.GetLongitudinalDisplacement(threeDPosition));
+
+    CartesianPointVector fitPositions;
+    LArAnalysisHelper::InterpolateTrackFit(trackFit, longCoords, fitPositions, directions, isValid);
+
+    const CartesianVector &minPosition = trackFit.GetGlobalMinLayerPosition();
+    const CartesianVector &maxPosition = trackFit.GetGlobalMaxLayerPosition();
+
+    for (std::size_t i = 0UL; i < threeDPositions.size(); ++i)
+    {
+        const CartesianVector &threeDPosition = threeDPositions.at(i);
+        const bool closerToMin = ((threeDPosition - minPosition).GetMagnitude() < (threeDPosition - maxPosition).GetMagnitude());
+
+        if (!isValid.at(i))
+        {
+            if (!snapToEnds)
+                continue;
+
+            directions.at(i) = closerToMin ? trackFit.GetGlobalMinLayerDirection() : trackFit.GetGlobalMaxLayerDirection();
+            isValid.at(i)    = true;
+        }
+
+        directions.at(i) = LArAnalysisHelper::AlignVectorWithFit(trackFit, directions.at(i), closerToMin);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArAnalysisHelper::InterpolateTrackFit(const ThreeDSlidingFitResult &trackFit, const FloatVector &longCoords,
+    CartesianPointVector &positions, CartesianPointVector &directions, std::vector<bool> &isWithinFit)
+{
+    const std::size_t nCoords = longCoords.size();
+
+    positions.assign(nCoords, CartesianVector(0.f, 0.f, 0.f));
+    directions.assign(nCoords, CartesianVector(0.f, 0.f, 0.f));
+    isWithinFit.assign(nCoords, false);
+
+    if (nCoords == 0UL)
+        return;
+
+    // Sample the fit once at the centre of every layer
+    const TwoDSlidingFitResult &firstFitResult = trackFit.GetFirstFitResult();
+    const int                   minLayer       = trackFit.GetMinLayer();
+    const int                   nLayers        = std::max(0, trackFit.GetMaxLayer() - minLayer + 1);
+
+    FloatVector          layerCoords;
+    CartesianPointVector layerPositions, layerDirections;
+    std::vector<bool>    isLayerSampled;
+    layerCoords.reserve(static_cast<std::size_t>(nLayers));
+    layerPositions.reserve(static_cast<std::size_t>(nLayers));
+    layerDirections.reserve(static_cast<std::size_t>(nLayers));
+    isLayerSampled.reserve(static_cast<std::size_t>(nLayers));
+
+    for (int iLayer = 0; iLayer < nLayers; ++iLayer)
+    {
+        const float     layerCoord = firstFitResult.GetL(minLayer + iLayer);
+        CartesianVector position(0.f, 0.f, 0.f), direction(0.f, 0.f, 0.f);
+
+        const bool isSampled = (STATUS_CODE_SUCCESS == trackFit.GetGlobalFitPosition(layerCoord, position)) &&
+                               (STATUS_CODE_SUCCESS == trackFit.GetGlobalFitDirection(layerCoord, direction));
+
+        layerCoords.push_back(layerCoord);
+        layerPositions.push_back(position);
+        layerDirections.push_back(direction);
+        isLayerSampled.push_back(isSampled);
+    }
+
+    // Visit the coordinates in ascending order so that the bracketing layer only ever moves forwards
+    std::vector<std::size_t> order(nCoords);
+    std::iota(order.begin(), order.end(), 0UL);
+    std::stable_sort(
+        order.begin(), order.end(), [&](const std::size_t lhs, const std::size_t rhs) { return longCoords[lhs] < longCoords[rhs]; });
+
+    int lowerLayer = 0;
+
+    for (const std::size_t index : order)
+    {
+        const float longCoord = longCoords[index];
+
+        while ((lowerLayer + 2 < nLayers) && (layerCoords[lowerLayer + 1] < longCoord))
+            ++lowerLayer;
+
+        const int  upperLayer = lowerLayer + 1;
+        const bool isBracketed =
+            (upperLayer < nLayers) && isLayerSampled[lowerLayer] && isLayerSampled[upperLayer] &&
+            (longCoord >= layerCoords[lowerLayer]) && (longCoord <= layerCoords[upperLayer]);
+
+        if (isBracketed)
+        {
+            const float weight = (longCoord - layerCoords[lowerLayer]) / (layerCoords[upperLayer] - layerCoords[lowerLayer]);
+            const CartesianVector direction =
+                layerDirections[lowerLayer] + (layerDirections[upperLayer] - layerDirections[lowerLayer]) * weight;
+
+            if (direction.GetMagnitudeSquared() > std::numeric_limits<float>::epsilon())
+            {
+                positions[index]   = layerPositions[lowerLayer] + (layerPositions[upperLayer] - layerPositions[lowerLayer]) * weight;
+                directions[index]  = direction.GetUnitVector();
+                isWithinFit[index] = true;
+                continue;
+            }
+        }
+
+        // Query the fit directly wherever the layer samples cannot be used
+        isWithinFit[index] = (STATUS_CODE_SUCCESS == trackFit.GetGlobalFitPosition(longCoord, positions[index])) &&
+                             (STATUS_CODE_SUCCESS == trackFit.GetGlobalFitDirection(longCoord, directions[index]));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 CartesianVector LArAnalysisHelper::AlignVectorWithFit(const ThreeDSlidingFitResult &trackFit, const CartesianVector &threeDPosition, const bool antiAlign)
 {
     // Get the extremal fit parameters
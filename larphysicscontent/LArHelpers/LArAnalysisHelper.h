@@ -9,6 +9,7 @@
 #define LAR_ANALYSIS_HELPER_H 1
 
 #include "larpandoracontent/LArObjects/LArThreeDSlidingFitResult.h"
+#include "larphysicscontent/LArObjects/LArGeometryContext.h"
 #include "larphysicscontent/LArObjects/LArInteractionValidationInfo.h"
 #include "larphysicscontent/LArObjects/LArMCTargetValidationInfo.h"
 
@@ -17,7 +18,11 @@
 #include "Pandora/Pandora.h"
 #include "Pandora/PdgTable.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <tuple>
+#include <vector>
 
 namespace lar_physics_content
 {
@@ -30,6 +35,25 @@ public:
     using PfoToTargetMap =
         std::unordered_map<const pandora::ParticleFlowObject *, std::shared_ptr<LArMCTargetValidationInfo>>; ///< Alias for a map from PFOs to MC targets
     using PfoToInteractionMap = std::unordered_map<const pandora::ParticleFlowObject *, std::shared_ptr<LArInteractionValidationInfo>>; ///< Alias for a map from PFOs to MC interactions
+    using WireViewGeometry = LArGeometryContext::WireViewGeometry; ///< Alias for the per-view wire geometry constants
+
+    /**
+     *  @brief  The result of projecting a 2D position onto a 3D track fit
+     */
+    struct TrackFitProjection
+    {
+        /**
+         *  @brief  Constructor
+         */
+        TrackFitProjection();
+
+        bool                     m_isValid;         ///< Whether the projection succeeded
+        pandora::CartesianVector m_threeDPosition;  ///< The projected 3D position
+        pandora::CartesianVector m_direction;       ///< The fitted direction at the projected 3D position
+        float                    m_projectionError; ///< The distance between the 2D position and the re-projected 3D position
+    };
+
+    using TrackFitProjectionVector = std::vector<TrackFitProjection>; ///< Alias for a vector of track fit projections
 
     /**
      *  @brief  Deleted copy constructor
@@ -59,14 +83,15 @@ public:
     /**
      *  @brief  Get the minimum and maximum fiducial cut coordinates
      *
-     *  @param  pandoraInstance the instance of Pandora
+     *  @param  geometryContext the geometry context
      *  @param  fiducialCutLowMargins the fiducial cut low margins
      *  @param  fiducialCutHighMargins the fiducial cut high margins
      *
      *  @return the minimum and maximum fiducial cut coordinates
      */
-    static std::tuple<pandora::CartesianVector, pandora::CartesianVector> GetFiducialCutCoordinates(const pandora::Pandora &pandoraInstance,
-        const pandora::CartesianVector &fiducialCutLowMargins, const pandora::CartesianVector &fiducialCutHighMargins);
+    static std::tuple<pandora::CartesianVector, pandora::CartesianVector> GetFiducialCutCoordinates(
+        const LArGeometryContext &geometryContext, const pandora::CartesianVector &fiducialCutLowMargins,
+        const pandora::CartesianVector &fiducialCutHighMargins);
 
     /**
      *  @brief  Find out whether a given point lies in the fiducial region of the detector
@@ -110,7 +135,7 @@ public:
     /**
      *  @brief  Project a 2D position to a 3D position using a track fit
      *
-     *  @param  pandoraInstance the instance of Pandora
+     *  @param  geometryContext the geometry context
      *  @param  trackFit the track fit object
      *  @param  twoDPosition the 2D position
      *  @param  hitType the hit type
@@ -120,14 +145,14 @@ public:
      *
      *  @return the status code
      */
-    static pandora::StatusCode ProjectTwoDPositionOntoTrackFit(const pandora::Pandora &pandoraInstance,
+    static pandora::StatusCode ProjectTwoDPositionOntoTrackFit(const LArGeometryContext &geometryContext,
         const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::CartesianVector &twoDPosition, const pandora::HitType hitType,
         const bool linearlyProjectEnds, pandora::CartesianVector &threeDPosition, float &projectionError);
 
     /**
      *  @brief  Get the fitted track direction at a given 2D position
      *
-     *  @param  pandoraInstance the instance of Pandora
+     *  @param  geometryContext the geometry context
      *  @param  trackFit the track fit object
      *  @param  twoDPosition the 2D position
      *  @param  hitType the hit type
@@ -137,10 +162,27 @@ public:
      *
      *  @return the status code
      */
-    static pandora::StatusCode GetFittedDirectionAtTwoDPosition(const pandora::Pandora &pandoraInstance,
+    static pandora::StatusCode GetFittedDirectionAtTwoDPosition(const LArGeometryContext &geometryContext,
         const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::CartesianVector &twoDPosition, const pandora::HitType hitType,
         const bool linearlyProjectEnds, pandora::CartesianVector &direction, float &projectionError);
 
+    /**
+     *  @brief  Project a batch of 2D positions in the same view onto a track fit, also getting the fitted direction at each one
+     *
+     *  Equivalent to calling GetFittedDirectionAtTwoDPosition for each position, but the positions are ordered by their longitudinal
+     *  coordinate and the fit is walked once from its first layer to its last, so the cost is linear in the number of hits plus layers
+     *
+     *  @param  geometryContext the geometry context
+     *  @param  trackFit the track fit object
+     *  @param  twoDPositions the 2D positions, in any order
+     *  @param  hitType the hit type
+     *  @param  linearlyProjectEnds whether to linearly project the ends of the fit
+     *  @param  projections the projections, in the order of the input positions (to populate)
+     */
+    static void ProjectTwoDPositionsOntoTrackFit(const LArGeometryContext &geometryContext,
+        const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::CartesianPointVector &twoDPositions,
+        const pandora::HitType hitType, const bool linearlyProjectEnds, TrackFitProjectionVector &projections);
+
     /**
      *  @brief  Get the fitted track direction at a given 3D position
      *
@@ -154,7 +196,67 @@ public:
     static pandora::StatusCode GetFittedDirectionAtThreeDPosition(const lar_content::ThreeDSlidingFitResult &trackFit,
         const pandora::CartesianVector &threeDPosition, const bool snapToEnds, pandora::CartesianVector &direction);
 
+    /**
+     *  @brief  Get the fitted track directions at a batch of 3D positions, walking the fit once in the same way as the 2D projection
+     *
+     *  @param  trackFit the track fit object
+     *  @param  threeDPositions the 3D positions, in any order
+     *  @param  snapToEnds whether to snap to the ends of the fit if a point is out of bounds
+     *  @param  directions the directions, in the order of the input positions (to populate)
+     *  @param  isValid whether each direction was found (to populate)
+     */
+    static void GetFittedDirectionsAtThreeDPositions(const lar_content::ThreeDSlidingFitResult &trackFit,
+        const pandora::CartesianPointVector &threeDPositions, const bool snapToEnds, pandora::CartesianPointVector &directions,
+        std::vector<bool> &isValid);
+
+    /**
+     *  @brief  Get the 3D path length of a track through the wire cell of a hit
+     *
+     *  The path length is the smaller of the wire pitch over the direction component normal to the wires and the hit width over the
+     *  drift component, computed directly from the (unit) direction components without any trigonometry
+     *
+     *  @param  wireViewGeometry the wire geometry constants for the view of the hit
+     *  @param  hitWidth the hit width
+     *  @param  directionX the x component of the unit track direction
+     *  @param  directionY the y component of the unit track direction
+     *  @param  directionZ the z component of the unit track direction
+     *
+     *  @return the path length
+     */
+    static float GetCellPathLength(const WireViewGeometry &wireViewGeometry, const float hitWidth, const float directionX,
+        const float directionY, const float directionZ);
+
+    /**
+     *  @brief  Get the 3D path lengths of a track through the wire cells of a batch of hits in the same view
+     *
+     *  @param  wireViewGeometry the wire geometry constants for the view of the hits
+     *  @param  hitWidths the hit widths
+     *  @param  directionsX the x components of the unit track directions at the hits
+     *  @param  directionsY the y components of the unit track directions at the hits
+     *  @param  directionsZ the z components of the unit track directions at the hits
+     *  @param  pathLengths the path lengths (to populate)
+     */
+    static void GetCellPathLengths(const WireViewGeometry &wireViewGeometry, const pandora::FloatVector &hitWidths,
+        const pandora::FloatVector &directionsX, const pandora::FloatVector &directionsY, const pandora::FloatVector &directionsZ,
+        pandora::FloatVector &pathLengths);
+
 private:
+    /**
+     *  @brief  Get the fit positions and directions at a set of longitudinal coordinates in a single pass over the fit layers
+     *
+     *  The fit positions are piecewise linear between layers, so interpolating between the two bracketing layer samples reproduces
+     *  them exactly. Directions are interpolated in the same way and renormalised, which agrees with the fit to second order in the
+     *  layer pitch. Coordinates outside the sampled layers, or next to a layer that could not be sampled, are queried directly
+     *
+     *  @param  trackFit the track fit object
+     *  @param  longCoords the longitudinal coordinates, in any order
+     *  @param  positions the fit positions (to populate)
+     *  @param  directions the raw (unaligned) fit directions (to populate)
+     *  @param  isWithinFit whether each coordinate was within the fit (to populate)
+     */
+    static void InterpolateTrackFit(const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::FloatVector &longCoords,
+        pandora::CartesianPointVector &positions, pandora::CartesianPointVector &directions, std::vector<bool> &isWithinFit);
+
     static pandora::CartesianVector AlignVectorWithFit(
         const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::CartesianVector &threeDPosition, const bool antiAlign);
 
@@ -165,6 +267,16 @@ private:
 //------------------------------------------------------------------------------------------------------------------------------------------
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+inline LArAnalysisHelper::TrackFitProjection::TrackFitProjection() :
+    m_isValid{false},
+    m_threeDPosition{0.f, 0.f, 0.f},
+    m_direction{0.f, 0.f, 0.f},
+    m_projectionError{std::numeric_limits<float>::max()}
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 inline float LArAnalysisHelper::GetTrueKineticEnergy(const pandora::MCParticle *const pMCParticle)
 {
     return pMCParticle->GetEnergy() - LArAnalysisHelper::GetTrueMass(pMCParticle);
@@ -179,14 +291,14 @@ inline float LArAnalysisHelper::GetTrueMass(const pandora::MCParticle *const pMC
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-inline pandora::StatusCode LArAnalysisHelper::GetFittedDirectionAtTwoDPosition(const pandora::Pandora &pandoraInstance,
+inline pandora::StatusCode LArAnalysisHelper::GetFittedDirectionAtTwoDPosition(const LArGeometryContext &geometryContext,
     const lar_content::ThreeDSlidingFitResult &trackFit, const pandora::CartesianVector &twoDPosition, const pandora::HitType hitType,
     const bool linearlyProjectEnds, pandora::CartesianVector &fittedDirection, float &projectionError)
 {
     pandora::CartesianVector threeDPosition(0.f, 0.f, 0.f);
 
     const pandora::StatusCode status = LArAnalysisHelper::ProjectTwoDPositionOntoTrackFit(
-        pandoraInstance, trackFit, twoDPosition, hitType, linearlyProjectEnds, threeDPosition, projectionError);
+        geometryContext, trackFit, twoDPosition, hitType, linearlyProjectEnds, threeDPosition, projectionError);
 
     if (status == pandora::STATUS_CODE_SUCCESS)
         return LArAnalysisHelper::GetFittedDirectionAtThreeDPosition(trackFit, threeDPosition, linearlyProjectEnds, fittedDirection);
@@ -194,6 +306,27 @@ inline pandora::StatusCode LArAnalysisHelper::GetFittedDirectionAtTwoDPosition(c
     return status;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline float LArAnalysisHelper::GetCellPathLength(
+    const WireViewGeometry &wireViewGeometry, const float hitWidth, const float directionX, const float directionY, const float directionZ)
+{
+    const float epsilon = std::numeric_limits<float>::epsilon();
+    const float maxLength = std::numeric_limits<float>::max();
+    const float wireNormalComponent =
+        std::fabs(directionZ * wireViewGeometry.m_cosWireAngle - directionY * wireViewGeometry.m_sinWireAngle);
+    const float driftComponent = std::fabs(directionX);
+
+    // A track running along the wire crosses no wire cell boundaries, so the wire pitch is the hit separation
+    if ((wireNormalComponent <= epsilon) && (driftComponent <= epsilon))
+        return wireViewGeometry.m_wirePitch;
+
+    const float pitchPathLength = (wireNormalComponent > epsilon) ? wireViewGeometry.m_wirePitch / wireNormalComponent : maxLength;
+    const float widthPathLength = (driftComponent > epsilon) ? hitWidth / driftComponent : maxLength;
+
+    return std::min(pitchPathLength, widthPathLength);
+}
+
 } // namespace lar_physics_content
 
 #endif // #ifndef LAR_ANALYSIS_HELPER_H
@@ -0,0 +1,304 @@
+/**
+ *  @file   larphysicscontent/LArHelpers/LArCalorimetryHelper.cc
+ *
+ *  @brief  Implementation of the lar calorimetry helper class.
+ *
+ *  $Log: $
+ */
+
+#include "larphysicscontent/LArHelpers/LArCalorimetryHelper.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace
+{
+const float DRIFT_PARAMETER_0 = 1.35970e-1f;  ///< The drift coordinate correction constant term
+const float DRIFT_PARAMETER_1 = 5.18310e-3f;  ///< The drift coordinate correction linear gradient
+const float DRIFT_PARAMETER_2 = -3.45421f;    ///< The drift coordinate correction linear offset
+const float DRIFT_PARAMETER_3 = 1.37225f;     ///< The drift coordinate correction sinusoidal amplitude
+const float DRIFT_PARAMETER_4 = -4.23881e-3f; ///< The drift coordinate correction sinusoidal frequency
+const float DRIFT_PARAMETER_5 = -6.83842e-1f; ///< The drift coordinate correction sinusoidal phase
+
+/**
+ *  @brief  Get the y-z coordinate correction factor, written without branches so that it vectorises
+ *
+ *  @param  yPosition the 3D y position
+ *  @param  zPosition the 3D z position
+ *
+ *  @return the correction factor
+ */
+inline float YZCorrection(const float yPosition, const float zPosition)
+{
+    // Combine the cuts with bitwise operators and apply them arithmetically, so there is nothing left to branch on
+    const bool zCut = (zPosition > 0.f) & (zPosition < 400.f);
+    const bool yzCut1 = yPosition > -120.f + zPosition * 220.f / 400.f;
+    const bool yzCut2 = yPosition < zPosition * 120.f / 250.f;
+
+    return 1.f + (1.3f - 1.f) * static_cast<float>(zCut & yzCut1 & yzCut2);
+}
+
+/**
+ *  @brief  Round to the nearest integer by truncation, which unlike std::floor compiles to a vector instruction without -ffast-math
+ *
+ *  @param  value the value, which must lie within the range of a 32-bit integer
+ *
+ *  @return the rounded value
+ */
+inline float RoundToNearest(const float value)
+{
+    return static_cast<float>(static_cast<std::int32_t>(value + std::copysign(0.5f, value)));
+}
+
+/**
+ *  @brief  Vectorisable exponential, accurate to a few ulps over the float range
+ *
+ *  @param  value the exponent
+ *
+ *  @return the exponential (saturating at exp(88) rather than infinity)
+ */
+inline float FastExp(const float value)
+{
+    // Clamp so that 2^n stays a normal float; exp(88) is already well beyond any physical dE/dx. The clamp is applied arithmetically
+    // because, without -ffast-math, compilers turn a floating-point select feeding further arithmetic back into a branch
+    const float isLow = static_cast<float>(value < -87.f);
+    const float isHigh = static_cast<float>(value > 88.f);
+    const float x = value * (1.f - isLow - isHigh) - 87.f * isLow + 88.f * isHigh;
+
+    // Cody-Waite reduction x = n ln2 + r with |r| <= ln2 / 2, ln2 split into an exactly representable part and a remainder
+    const float n = RoundToNearest(1.44269504088896341f * x);
+    const float r = (x - n * 0.693359375f) - n * -2.12194440e-4f;
+
+    // Minimax polynomial for exp(r) on the reduced range
+    float p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.f;
+
+    // Build 2^n directly from the exponent bits
+    const std::uint32_t bits = static_cast<std::uint32_t>(static_cast<std::int32_t>(n) + 127) << 23;
+    float scale(0.f);
+    std::memcpy(&scale, &bits, sizeof(float));
+
+    return p * scale;
+}
+
+/**
+ *  @brief  Vectorisable sine, accurate to a few ulps for arguments of moderate magnitude
+ *
+ *  @param  value the angle in radians
+ *
+ *  @return the sine
+ */
+inline float FastSin(const float value)
+{
+    // Reduce to r = x - k pi with |r| <= pi / 2, pi split into an exactly representable part and a remainder
+    const float k = RoundToNearest(0.318309886183790672f * value);
+    const float r = (value - k * 3.140625f) - k * 9.67653589793e-4f;
+    const float r2 = r * r;
+
+    // Odd Taylor polynomial for sin(r), truncation error below 6e-8 on the reduced range
+    float p = -2.50521083854e-8f;
+    p = p * r2 + 2.75573192240e-6f;
+    p = p * r2 - 1.98412698413e-4f;
+    p = p * r2 + 8.33333333333e-3f;
+    p = p * r2 - 1.66666666667e-1f;
+    p = r + r * r2 * p;
+
+    // sin(r + k pi) = (-1)^k sin(r)
+    const float sign = 1.f - 2.f * static_cast<float>(static_cast<std::int32_t>(k) & 1);
+
+    return sign * p;
+}
+
+/**
+ *  @brief  Apply the ModBox correction to a batch of corrected dQ/dx values
+ *
+ *  @param  parameters the ModBox parameters
+ *  @param  nHits the number of hits
+ *  @param  pDQdx the corrected dQ/dx values
+ *  @param  pDEdx the dE/dx values (to populate)
+ */
+inline void ApplyModBoxCorrections(const lar_physics_content::LArCalorimetryHelper::ModBoxParameters &parameters, const std::size_t nHits,
+    const float *const pDQdx, float *const pDEdx)
+{
+    const float factor = parameters.m_factor;
+    const float modboxA = parameters.m_a;
+    const float wion = parameters.m_wion;
+    const float modboxC = parameters.m_c;
+
+    // Same operation order as the scalar path, since dE/dx amplifies any rounding difference in the exponent
+    for (std::size_t i = 0UL; i < nHits; ++i)
+        pDEdx[i] = factor * (FastExp(pDQdx[i] * wion / modboxC / factor) - modboxA);
+}
+} // namespace
+
+namespace lar_physics_content
+{
+
+void LArCalorimetryHelper::HitBatch::Reserve(const std::size_t nHits)
+{
+    m_dQ.reserve(nHits);
+    m_dX.reserve(nHits);
+    m_x.reserve(nHits);
+    m_y.reserve(nHits);
+    m_z.reserve(nHits);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArCalorimetryHelper::HitBatch::Add(const float dQ, const float dX, const float x, const float y, const float z)
+{
+    m_dQ.push_back(dQ);
+    m_dX.push_back(dX);
+    m_x.push_back(x);
+    m_y.push_back(y);
+    m_z.push_back(z);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArCalorimetryHelper::HitBatch::Clear()
+{
+    m_dQ.clear();
+    m_dX.clear();
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArCalorimetryHelper::ChargeCorrectionMaps::ChargeCorrectionMaps(
+    std::shared_ptr<const LArCorrectionMap> spDriftMap, std::shared_ptr<const LArCorrectionMap> spPositionMap) :
+    m_spDriftMap{std::move(spDriftMap)},
+    m_spPositionMap{std::move(spPositionMap)}
+{
+    if (m_spDriftMap && m_spDriftMap->GetDimension() != 1UL)
+    {
+        std::cerr << "LArCalorimetryHelper: the drift coordinate correction map must be 1D over x" << std::endl;
+        throw pandora::StatusCodeException(pandora::STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    if (m_spPositionMap && m_spPositionMap->GetDimension() < 2UL)
+    {
+        std::cerr << "LArCalorimetryHelper: the position correction map must be 2D over y-z or 3D over x-y-z" << std::endl;
+        throw pandora::StatusCodeException(pandora::STATUS_CODE_INVALID_PARAMETER);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+float LArCalorimetryHelper::ApplyModBoxCorrection(const float dQdx, const ModBoxParameters &parameters)
+{
+    const float exponent = LArCalorimetryHelper::ApplyChargeScaling(dQdx, parameters) / parameters.m_factor;
+    return parameters.m_factor * (std::exp(exponent) - parameters.m_a);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+float LArCalorimetryHelper::GetDriftCoordinateCorrection(const float xPosition)
+{
+    return (DRIFT_PARAMETER_0 + DRIFT_PARAMETER_1 * (xPosition - DRIFT_PARAMETER_2) +
+            DRIFT_PARAMETER_3 * std::sin(DRIFT_PARAMETER_4 * xPosition - DRIFT_PARAMETER_5));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+float LArCalorimetryHelper::GetYZCoordinateCorrection(const float yPosition, const float zPosition)
+{
+    return YZCorrection(yPosition, zPosition);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+float LArCalorimetryHelper::GetChargeCorrection(const float x, const float y, const float z, const ChargeCorrectionMaps &correctionMaps)
+{
+    const LArCorrectionMap *const pDriftMap = correctionMaps.m_spDriftMap.get();
+    const LArCorrectionMap *const pPositionMap = correctionMaps.m_spPositionMap.get();
+
+    const float driftCorrection = pDriftMap ? pDriftMap->Evaluate(x, 0.f, 0.f) : LArCalorimetryHelper::GetDriftCoordinateCorrection(x);
+
+    if (!pPositionMap)
+        return driftCorrection * LArCalorimetryHelper::GetYZCoordinateCorrection(y, z);
+
+    return driftCorrection * (pPositionMap->GetDimension() == 3UL ? pPositionMap->Evaluate(x, y, z) : pPositionMap->Evaluate(y, z, 0.f));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+float LArCalorimetryHelper::CalculateEnergyLossRate(
+    const float dQ, const float dX, const float x, const float y, const float z, const ModBoxParameters &parameters)
+{
+    const float dQdxCorrected = LArCalorimetryHelper::CorrectChargeDeposition(dQ / dX, x, y, z);
+    return LArCalorimetryHelper::ApplyModBoxCorrection(dQdxCorrected, parameters);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+float LArCalorimetryHelper::CalculateEnergyLossRate(const float dQ, const float dX, const float x, const float y, const float z,
+    const ModBoxParameters &parameters, const ChargeCorrectionMaps &correctionMaps)
+{
+    const float dQdxCorrected = (dQ / dX) * LArCalorimetryHelper::GetChargeCorrection(x, y, z, correctionMaps);
+    return LArCalorimetryHelper::ApplyModBoxCorrection(dQdxCorrected, parameters);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArCalorimetryHelper::CalculateEnergyLossRates(
+    const HitBatch &batch, const ModBoxParameters &parameters, FloatVector &dQdxVector, FloatVector &dEdxVector)
+{
+    const std::size_t nHits = batch.Size();
+
+    dQdxVector.resize(nHits);
+    dEdxVector.resize(nHits);
+
+    const float *const pDQ = batch.m_dQ.data();
+    const float *const pDX = batch.m_dX.data();
+    const float *const pX = batch.m_x.data();
+    const float *const pY = batch.m_y.data();
+    const float *const pZ = batch.m_z.data();
+    float *const pDQdx = dQdxVector.data();
+    float *const pDEdx = dEdxVector.data();
+
+    // Keep the two passes separate and free of branches so that each reduces to straight-line arithmetic over contiguous arrays
+    for (std::size_t i = 0UL; i < nHits; ++i)
+    {
+        const float driftCorrection = DRIFT_PARAMETER_0 + DRIFT_PARAMETER_1 * (pX[i] - DRIFT_PARAMETER_2) +
+                                      DRIFT_PARAMETER_3 * FastSin(DRIFT_PARAMETER_4 * pX[i] - DRIFT_PARAMETER_5);
+        pDQdx[i] = (pDQ[i] / pDX[i]) * driftCorrection * YZCorrection(pY[i], pZ[i]);
+    }
+
+    ApplyModBoxCorrections(parameters, nHits, pDQdx, pDEdx);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArCalorimetryHelper::CalculateEnergyLossRates(const HitBatch &batch, const ModBoxParameters &parameters,
+    const ChargeCorrectionMaps &correctionMaps, FloatVector &dQdxVector, FloatVector &dEdxVector)
+{
+    if (!correctionMaps.m_spDriftMap && !correctionMaps.m_spPositionMap)
+        return LArCalorimetryHelper::CalculateEnergyLossRates(batch, parameters, dQdxVector, dEdxVector);
+
+    const std::size_t nHits = batch.Size();
+
+    dQdxVector.resize(nHits);
+    dEdxVector.resize(nHits);
+
+    for (std::size_t i = 0UL; i < nHits; ++i)
+    {
+        dQdxVector[i] = (batch.m_dQ[i] / batch.m_dX[i]) *
+                        LArCalorimetryHelper::GetChargeCorrection(batch.m_x[i], batch.m_y[i], batch.m_z[i], correctionMaps);
+    }
+
+    ApplyModBoxCorrections(parameters, nHits, dQdxVector.data(), dEdxVector.data());
+}
+
+} // namespace lar_physics_content
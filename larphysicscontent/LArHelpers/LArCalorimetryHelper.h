@@ -0,0 +1,312 @@
+/**
+ *  @file   larphysicscontent/LArHelpers/LArCalorimetryHelper.h
+ *
+ *  @brief  Header file for the lar calorimetry helper class.
+ *
+ *  $Log: $
+ */
+#ifndef LAR_CALORIMETRY_HELPER_H
+#define LAR_CALORIMETRY_HELPER_H 1
+
+#include "larphysicscontent/LArObjects/LArCorrectionMap.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace lar_physics_content
+{
+/**
+ *  @brief  LArCalorimetryHelper class
+ */
+class LArCalorimetryHelper
+{
+public:
+    using FloatVector = std::vector<float>; ///< Alias for a vector of floats
+
+    /**
+     *  @brief  ModBox recombination parameters
+     */
+    struct ModBoxParameters
+    {
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  factor the ModBox (rho * epsilon / B) value
+         *  @param  a the ModBox A parameter
+         *  @param  wion the ModBox W_ion parameter
+         *  @param  c the ModBox C parameter
+         */
+        ModBoxParameters(const float factor, const float a, const float wion, const float c);
+
+        float m_factor; ///< The ModBox (rho * epsilon / B) value
+        float m_a;      ///< The ModBox A parameter
+        float m_wion;   ///< The ModBox W_ion parameter
+        float m_c;      ///< The ModBox C parameter
+    };
+
+    /**
+     *  @brief  Charge correction lookup tables, each replacing the corresponding analytic correction when set
+     */
+    struct ChargeCorrectionMaps
+    {
+        /**
+         *  @brief  Default constructor, using the analytic corrections
+         */
+        ChargeCorrectionMaps() = default;
+
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  spDriftMap the 1D drift coordinate correction map over x, or nullptr for the analytic correction
+         *  @param  spPositionMap the 2D correction map over y-z or 3D map over x-y-z, or nullptr for the analytic y-z correction
+         */
+        ChargeCorrectionMaps(
+            std::shared_ptr<const LArCorrectionMap> spDriftMap, std::shared_ptr<const LArCorrectionMap> spPositionMap);
+
+        std::shared_ptr<const LArCorrectionMap> m_spDriftMap;    ///< The drift coordinate correction map
+        std::shared_ptr<const LArCorrectionMap> m_spPositionMap; ///< The position correction map
+    };
+
+    /**
+     *  @brief  Structure-of-arrays hit inputs for the batch calorimetry kernel
+     */
+    struct HitBatch
+    {
+        /**
+         *  @brief  Reserve space for a number of hits
+         *
+         *  @param  nHits the number of hits
+         */
+        void Reserve(const std::size_t nHits);
+
+        /**
+         *  @brief  Append a hit
+         *
+         *  @param  dQ the hit charge
+         *  @param  dX the 3D dx
+         *  @param  x the 3D x position
+         *  @param  y the 3D y position
+         *  @param  z the 3D z position
+         */
+        void Add(const float dQ, const float dX, const float x, const float y, const float z);
+
+        /**
+         *  @brief  Clear the batch
+         */
+        void Clear();
+
+        /**
+         *  @brief  Get the number of hits in the batch
+         *
+         *  @return the number of hits
+         */
+        std::size_t Size() const;
+
+        FloatVector m_dQ; ///< The hit charges
+        FloatVector m_dX; ///< The 3D dx values
+        FloatVector m_x;  ///< The 3D x positions
+        FloatVector m_y;  ///< The 3D y positions
+        FloatVector m_z;  ///< The 3D z positions
+    };
+
+    /**
+     *  @brief  Deleted copy constructor
+     */
+    LArCalorimetryHelper(const LArCalorimetryHelper &) = delete;
+
+    /**
+     *  @brief  Deleted move constructor
+     */
+    LArCalorimetryHelper(LArCalorimetryHelper &&) = delete;
+
+    /**
+     *  @brief  Deleted copy assignment operator
+     */
+    LArCalorimetryHelper &operator=(const LArCalorimetryHelper &) = delete;
+
+    /**
+     *  @brief  Deleted move assignment operator
+     */
+    LArCalorimetryHelper &operator=(LArCalorimetryHelper &&) = delete;
+
+    /**
+     *  @brief  Deleted destructor
+     */
+    ~LArCalorimetryHelper() = delete;
+
+    /**
+     *  @brief  Get the maximum relative difference between the batch kernel and the scalar path
+     *
+     *  The batch kernel replaces std::exp and std::sin with polynomial approximations accurate to a few float ulps. Each dE/dx agrees
+     *  with CalculateEnergyLossRate to within this fraction of max(1, |dE/dx|) for ModBox exponents below 88, beyond which the batch
+     *  kernel saturates. The error grows with the exponent; physical hits (exponents of a few) typically agree to around 1e-6
+     *
+     *  @return the relative tolerance
+     */
+    static float GetBatchRelativeTolerance();
+
+    /**
+     *  @brief  Apply a scaling from charge to energy in the absence of recombination
+     *
+     *  @param  charge the charge (or dQ/dx) value
+     *  @param  parameters the ModBox parameters
+     *
+     *  @return the energy (or dE/dx) value
+     */
+    static float ApplyChargeScaling(const float charge, const ModBoxParameters &parameters);
+
+    /**
+     *  @brief  Apply the ModBox correction to map dQ/dx to dE/dx
+     *
+     *  @param  dQdx the dQ/dx value
+     *  @param  parameters the ModBox parameters
+     *
+     *  @return the dE/dx value
+     */
+    static float ApplyModBoxCorrection(const float dQdx, const ModBoxParameters &parameters);
+
+    /**
+     *  @brief  Get the charge correction factor for the drift coordinate
+     *
+     *  @param  xPosition the 3D x position
+     *
+     *  @return the correction factor
+     */
+    static float GetDriftCoordinateCorrection(const float xPosition);
+
+    /**
+     *  @brief  Get the charge correction factor for the y-z coordinates
+     *
+     *  @param  yPosition the 3D y position
+     *  @param  zPosition the 3D z position
+     *
+     *  @return the correction factor
+     */
+    static float GetYZCoordinateCorrection(const float yPosition, const float zPosition);
+
+    /**
+     *  @brief  Apply the position-dependent corrections to an uncorrected dQ/dx value
+     *
+     *  @param  dQdxUncorrected the uncorrected dQ/dx value
+     *  @param  x the 3D x position
+     *  @param  y the 3D y position
+     *  @param  z the 3D z position
+     *
+     *  @return the corrected dQ/dx value
+     */
+    static float CorrectChargeDeposition(const float dQdxUncorrected, const float x, const float y, const float z);
+
+    /**
+     *  @brief  Get the combined charge correction factor, taking each correction from its map if one is set
+     *
+     *  @param  x the 3D x position
+     *  @param  y the 3D y position
+     *  @param  z the 3D z position
+     *  @param  correctionMaps the charge correction maps
+     *
+     *  @return the correction factor
+     */
+    static float GetChargeCorrection(const float x, const float y, const float z, const ChargeCorrectionMaps &correctionMaps);
+
+    /**
+     *  @brief  Calculate the corrected dE/dx for a single hit (the scalar reference path)
+     *
+     *  @param  dQ the hit charge
+     *  @param  dX the 3D dx
+     *  @param  x the 3D x position
+     *  @param  y the 3D y position
+     *  @param  z the 3D z position
+     *  @param  parameters the ModBox parameters
+     *
+     *  @return the dE/dx value
+     */
+    static float CalculateEnergyLossRate(
+        const float dQ, const float dX, const float x, const float y, const float z, const ModBoxParameters &parameters);
+
+    /**
+     *  @brief  Calculate the corrected dE/dx for a single hit, with the charge corrections taken from lookup tables where set
+     *
+     *  @param  dQ the hit charge
+     *  @param  dX the 3D dx
+     *  @param  x the 3D x position
+     *  @param  y the 3D y position
+     *  @param  z the 3D z position
+     *  @param  parameters the ModBox parameters
+     *  @param  correctionMaps the charge correction maps
+     *
+     *  @return the dE/dx value
+     */
+    static float CalculateEnergyLossRate(const float dQ, const float dX, const float x, const float y, const float z,
+        const ModBoxParameters &parameters, const ChargeCorrectionMaps &correctionMaps);
+
+    /**
+     *  @brief  Calculate the corrected dQ/dx and dE/dx for every hit in a batch
+     *
+     *  The loops are branch-free and operate on contiguous arrays, so they vectorise wherever the target provides SIMD and run as plain
+     *  scalar code otherwise. Hits must have dX > 0; the caller is responsible for filtering them beforehand
+     *
+     *  @param  batch the hit batch
+     *  @param  parameters the ModBox parameters
+     *  @param  dQdxVector the corrected dQ/dx values (to populate)
+     *  @param  dEdxVector the dE/dx values (to populate)
+     */
+    static void CalculateEnergyLossRates(
+        const HitBatch &batch, const ModBoxParameters &parameters, FloatVector &dQdxVector, FloatVector &dEdxVector);
+
+    /**
+     *  @brief  Calculate the corrected dQ/dx and dE/dx for every hit in a batch, with the charge corrections taken from lookup tables
+     *          where set. Each table lookup is a fixed amount of work, after which the ModBox pass is the same as for the analytic case
+     *
+     *  @param  batch the hit batch
+     *  @param  parameters the ModBox parameters
+     *  @param  correctionMaps the charge correction maps
+     *  @param  dQdxVector the corrected dQ/dx values (to populate)
+     *  @param  dEdxVector the dE/dx values (to populate)
+     */
+    static void CalculateEnergyLossRates(const HitBatch &batch, const ModBoxParameters &parameters,
+        const ChargeCorrectionMaps &correctionMaps, FloatVector &dQdxVector, FloatVector &dEdxVector);
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArCalorimetryHelper::ModBoxParameters::ModBoxParameters(const float factor, const float a, const float wion, const float c) :
+    m_factor{factor},
+    m_a{a},
+    m_wion{wion},
+    m_c{c}
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::size_t LArCalorimetryHelper::HitBatch::Size() const
+{
+    return m_dQ.size();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline float LArCalorimetryHelper::GetBatchRelativeTolerance()
+{
+    return 5.e-5f;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline float LArCalorimetryHelper::ApplyChargeScaling(const float charge, const ModBoxParameters &parameters)
+{
+    return charge * parameters.m_wion / parameters.m_c;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline float LArCalorimetryHelper::CorrectChargeDeposition(const float dQdxUncorrected, const float x, const float y, const float z)
+{
+    return dQdxUncorrected * LArCalorimetryHelper::GetDriftCoordinateCorrection(x) * LArCalorimetryHelper::GetYZCoordinateCorrection(y, z);
+}
+
+} // namespace lar_physics_content
+
+#endif // #ifndef LAR_CALORIMETRY_HELPER_H
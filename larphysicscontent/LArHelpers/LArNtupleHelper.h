@@ -10,8 +10,11 @@
 
 #include "Objects/ParticleFlowObject.h"
 #include "larpandoracontent/LArObjects/LArThreeDSlidingFitResult.h"
+#include "larphysicscontent/LArNtuple/LArNtupleRecord.h"
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace lar_physics_content
 {
@@ -22,6 +25,7 @@ class LArNtupleHelper
 {
 public:
     using TrackFitSharedPtr = std::shared_ptr<lar_content::ThreeDSlidingFitResult>; ///< Alias for a shared pointer to a track fit object
+    using RecordProducer    = std::function<std::vector<LArNtupleRecord>()>;          ///< Alias for a function producing a group of records
 
     /**
      *  @brief  The particle class
@@ -87,8 +91,37 @@ public:
      *  @return the class as a string
      */
     static std::string ToString(const PARTICLE_CLASS particleClass);
+
+    /**
+     *  @brief  Get the storage precision for fractions in the range [0, 1], e.g. purities and completenesses
+     *
+     *  @return the precision
+     */
+    static LArNtupleRecord::Precision GetFractionPrecision();
+
+    /**
+     *  @brief  Get the storage precision for direction cosines in the range [-1, 1]
+     *
+     *  @return the precision
+     */
+    static LArNtupleRecord::Precision GetDirectionCosinePrecision();
 };
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArNtupleRecord::Precision LArNtupleHelper::GetFractionPrecision()
+{
+    return LArNtupleRecord::Precision(0.f, 1.f, 16U);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArNtupleRecord::Precision LArNtupleHelper::GetDirectionCosinePrecision()
+{
+    return LArNtupleRecord::Precision(-1.f, 1.f, 16U);
+}
+
 } // namespace lar_physics_content
 
 #endif // #ifndef LAR_NTUPLE_HELPER_H
@@ -25,6 +25,13 @@ void LArBranchPlaceholder::SetNtupleScalarRecord(const LArNtupleRecord &record)
         throw pandora::STATUS_CODE_NOT_ALLOWED;
     }
 
+    if (m_precision != record.GetPrecision())
+    {
+        std::cerr << "LArBranchPlaceholder: Could not replace value of branch '" << record.BranchName()
+                  << "' because the declared precisions did not match" << std::endl;
+        throw pandora::STATUS_CODE_NOT_ALLOWED;
+    }
+
     m_spNtupleScalarRecord = NtupleRecordSPtr(new LArNtupleRecord(record));
     this->PopulateMaps();
 }
@@ -49,7 +56,9 @@ LArBranchPlaceholder::LArBranchPlaceholder(const LArNtupleRecord &record) noexce
     m_spNtupleScalarRecord(new LArNtupleRecord(record)),
     m_ntupleVectorRecord(),
     m_valueType(record.ValueType()),
+    m_precision(record.GetPrecision()),
     m_pCacheElement(nullptr),
+    m_pStatistics(nullptr),
     m_pfoRecordMap(),
     m_mcParticleRecordMap()
 {
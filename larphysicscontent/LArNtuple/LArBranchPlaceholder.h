@@ -10,8 +10,11 @@
 
 #include "larphysicscontent/LArNtuple/LArNtupleRecord.h"
 
+#include "TParameter.h"
+
 #include <any>
 #include <memory>
+#include <vector>
 
 namespace lar_physics_content
 {
@@ -27,7 +30,8 @@ class LArNtuple;
 class LArBranchPlaceholder
 {
 public:
-    using NtupleRecordSPtr = std::shared_ptr<LArNtupleRecord>; ///< Alias for a shared pointer to an ntuple record
+    using NtupleRecordSPtr = std::shared_ptr<LArNtupleRecord>;      ///< Alias for a shared pointer to an ntuple record
+    using StatisticVector  = std::vector<TParameter<Double_t> *>; ///< Alias for the running statistics of a branch
 
     /**
      * @brief  Default copy constructor
@@ -103,6 +107,13 @@ protected:
      */
     LArNtupleRecord::VALUE_TYPE ValueType() const noexcept;
 
+    /**
+     *  @brief  Get the branch's declared storage precision
+     *
+     *  @return the precision, if one has been declared
+     */
+    const std::optional<LArNtupleRecord::Precision> &GetPrecision() const noexcept;
+
     /**
      *  @return the cache element pointer
      */
@@ -115,6 +126,20 @@ protected:
      */
     void CacheElement(std::any *const pCacheElement) noexcept;
 
+    /**
+     *  @brief  Get the running statistics of the branch
+     *
+     *  @return address of the statistics, or nullptr if they have not been resolved yet
+     */
+    const StatisticVector *Statistics() const noexcept;
+
+    /**
+     *  @brief  Set the running statistics of the branch
+     *
+     *  @param  pStatistics address of the statistics
+     */
+    void Statistics(const StatisticVector *const pStatistics) noexcept;
+
     /**
      *  @brief  Get the PFO record map
      *
@@ -135,7 +160,9 @@ private:
     NtupleRecordSPtr                                     m_spNtupleScalarRecord; ///< Shared pointer to the ntuple scalar record
     std::vector<NtupleRecordSPtr>                        m_ntupleVectorRecord;   ///< The vector record shared pointers
     LArNtupleRecord::VALUE_TYPE                          m_valueType;            ///< The branch's value type
+    std::optional<LArNtupleRecord::Precision>            m_precision;            ///< The branch's declared storage precision, if any
     std::any *                                           m_pCacheElement;        ///< The cache element pointer
+    const StatisticVector *                              m_pStatistics;          ///< The running statistics of the branch, once resolved
     NtupleRecordMap<const pandora::ParticleFlowObject *> m_pfoRecordMap;         ///< The map from PFOs to record shared pointers
     NtupleRecordMap<const pandora::MCParticle *>         m_mcParticleRecordMap;  ///< The map from MCParticles to record shared pointers
 
@@ -179,6 +206,13 @@ inline LArNtupleRecord::VALUE_TYPE LArBranchPlaceholder::ValueType() const noexc
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+inline const std::optional<LArNtupleRecord::Precision> &LArBranchPlaceholder::GetPrecision() const noexcept
+{
+    return m_precision;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 inline void LArBranchPlaceholder::CacheElement(std::any *const pCacheElement) noexcept
 {
     m_pCacheElement = pCacheElement;
@@ -193,6 +227,20 @@ inline std::any *LArBranchPlaceholder::CacheElement() const noexcept
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+inline const LArBranchPlaceholder::StatisticVector *LArBranchPlaceholder::Statistics() const noexcept
+{
+    return m_pStatistics;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void LArBranchPlaceholder::Statistics(const StatisticVector *const pStatistics) noexcept
+{
+    m_pStatistics = pStatistics;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 inline const LArBranchPlaceholder::NtupleRecordMap<const pandora::ParticleFlowObject *> &LArBranchPlaceholder::GetPfoRecordMap() const noexcept
 {
     return m_pfoRecordMap;
@@ -10,12 +10,131 @@
 #include "larphysicscontent/LArHelpers/LArNtupleHelper.h"
 
 #include "larpandoracontent/LArHelpers/LArClusterHelper.h"
-#include "larpandoracontent/LArHelpers/LArGeometryHelper.h"
 #include "larpandoracontent/LArHelpers/LArPfoHelper.h"
 
+#include "TObjString.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace pandora;
 using namespace lar_content;
 
+namespace
+{
+/**
+ *  @brief  The running statistics stored for each numeric branch, in order
+ */
+enum BRANCH_STATISTIC : std::size_t
+{
+    STATISTIC_COUNT,       ///< The number of values
+    STATISTIC_MIN,         ///< The minimum value
+    STATISTIC_MAX,         ///< The maximum value
+    STATISTIC_SUM,         ///< The sum of the values
+    STATISTIC_SUM_SQUARES, ///< The sum of the squares of the values
+    NUM_BRANCH_STATISTICS  ///< The number of statistics
+};
+
+const char *const STATISTIC_NAMES[NUM_BRANCH_STATISTICS] = {"count", "min", "max", "sum", "sumSquares"}; ///< The names of the statistics
+
+/**
+ *  @brief  The fields of each zone of a zone map, in order
+ */
+enum ZONE_FIELD : Int_t
+{
+    ZONE_FIRST_ENTRY, ///< The first entry in the zone
+    ZONE_END_ENTRY,   ///< One past the last entry in the zone
+    ZONE_MIN,         ///< The minimum finite value in the zone
+    ZONE_MAX,         ///< The maximum finite value in the zone
+    NUM_ZONE_FIELDS   ///< The number of fields
+};
+
+const char *const           EVENT_INDEX_MAJOR         = "fileId";                          ///< The major key of the event index
+const char *const           EVENT_INDEX_MINOR         = "eventNum * 65536 + hypothesisId"; ///< The minor key of the event index
+const LArNtupleRecord::RInt MAX_INDEXED_HYPOTHESIS_ID = 65535; ///< The largest hypothesis ID that the minor key keeps distinct
+
+/**
+ *  @brief  Get the value of a numeric scalar record
+ *
+ *  @param  record the record
+ *  @param  value to receive the value
+ *
+ *  @return whether the record is a numeric scalar
+ */
+bool GetNumericValue(const LArNtupleRecord &record, double &value)
+{
+    switch (record.ValueType())
+    {
+        case LArNtupleRecord::VALUE_TYPE::R_FLOAT:
+            value = record.Value<LArNtupleRecord::RFloat>();
+            return true;
+        case LArNtupleRecord::VALUE_TYPE::R_INT:
+            value = record.Value<LArNtupleRecord::RInt>();
+            return true;
+        case LArNtupleRecord::VALUE_TYPE::R_BOOL:
+            value = record.Value<LArNtupleRecord::RBool>() ? 1. : 0.;
+            return true;
+        case LArNtupleRecord::VALUE_TYPE::R_UINT:
+            value = record.Value<LArNtupleRecord::RUInt>();
+            return true;
+        case LArNtupleRecord::VALUE_TYPE::R_ULONG64:
+            value = static_cast<double>(record.Value<LArNtupleRecord::RULong64>());
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ *  @brief  Accumulate a value into running branch statistics, skipping non-finite values so that they cannot swamp the range or mean
+ *
+ *  @param  value the value
+ *  @param  statistics the statistics to update
+ */
+void AccumulateStatistic(const double value, const std::vector<TParameter<Double_t> *> &statistics)
+{
+    if (!std::isfinite(value))
+        return;
+
+    TParameter<Double_t> &count = *statistics[STATISTIC_COUNT];
+    TParameter<Double_t> &min   = *statistics[STATISTIC_MIN];
+    TParameter<Double_t> &max   = *statistics[STATISTIC_MAX];
+
+    min.SetVal(count.GetVal() < 0.5 ? value : std::min(min.GetVal(), value));
+    max.SetVal(count.GetVal() < 0.5 ? value : std::max(max.GetVal(), value));
+    count.SetVal(count.GetVal() + 1.);
+    statistics[STATISTIC_SUM]->SetVal(statistics[STATISTIC_SUM]->GetVal() + value);
+    statistics[STATISTIC_SUM_SQUARES]->SetVal(statistics[STATISTIC_SUM_SQUARES]->GetVal() + value * value);
+}
+
+/**
+ *  @brief  Accumulate each element of a vector into running branch statistics
+ *
+ *  @param  values the values
+ *  @param  statistics the statistics to update
+ */
+template <typename T>
+void AccumulateStatistics(const std::vector<T> &values, const std::vector<TParameter<Double_t> *> &statistics)
+{
+    for (const T value : values)
+        AccumulateStatistic(static_cast<double>(value), statistics);
+}
+
+/**
+ *  @brief  Accumulate each element of a matrix into running branch statistics
+ *
+ *  @param  rows the matrix rows
+ *  @param  statistics the statistics to update
+ */
+template <typename T>
+void AccumulateStatistics(const std::vector<std::vector<T>> &rows, const std::vector<TParameter<Double_t> *> &statistics)
+{
+    for (const std::vector<T> &row : rows)
+        AccumulateStatistics(row, statistics);
+}
+} // namespace
+
 namespace lar_physics_content
 {
 void LArNtuple::AddScalarRecord(const LArNtupleRecord &record)
@@ -23,6 +142,13 @@ void LArNtuple::AddScalarRecord(const LArNtupleRecord &record)
     if (!record.WriteToNtuple())
         return;
 
+    // Records outside the branch selection are not written, but stay available to other tools
+    if (!this->IsBranchSelected(record.BranchName()))
+    {
+        this->AddLazyRecords({record.BranchName()}, nullptr, nullptr, [record]() { return std::vector<LArNtupleRecord>{record}; });
+        return;
+    }
+
     if (m_addressesSet)
         this->ValidateAndAddRecord(m_scalarBranchMap, record);
 
@@ -44,6 +170,13 @@ void LArNtuple::AddVectorRecordElement(const LArNtupleRecord &record, const LArN
     if (!record.WriteToNtuple())
         return;
 
+    if (!this->IsBranchSelected(record.BranchName()))
+    {
+        this->AddLazyRecords({record.BranchName()}, record.GetPfo(), record.GetMCParticle(),
+            [record]() { return std::vector<LArNtupleRecord>{record}; });
+        return;
+    }
+
     BranchMap &branchMap = this->GetVectorBranchMap(type);
 
     // If the vector elements are locked in, reuse the scalar record validation mechanics
@@ -63,6 +196,100 @@ void LArNtuple::AddVectorRecordElement(const LArNtupleRecord &record, const LArN
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+std::vector<LArNtupleRecord> LArNtuple::AddLazyRecords(
+    const StringVector &branchNames, const ParticleFlowObject *const pPfo, const MCParticle *const pMCParticle, LArNtupleHelper::RecordProducer producer)
+{
+    const LazyRecordGroupSPtr spLazyRecordGroup(new LazyRecordGroup{std::move(producer), {}, false});
+
+    // Per-event records have neither particle, so they are keyed by a null PFO
+    const bool isPfoKeyed(pPfo || !pMCParticle);
+
+    for (const std::string &branchName : branchNames)
+    {
+        if ((isPfoKeyed && !m_lazyPfoRecords.emplace(std::make_pair(branchName, pPfo), spLazyRecordGroup).second) ||
+            (pMCParticle && !m_lazyMCParticleRecords.emplace(std::make_pair(branchName, pMCParticle), spLazyRecordGroup).second))
+        {
+            std::cerr << "LArNtuple: cannot add multiple lazy records with the same branch name '" << branchName << "' for one particle" << std::endl;
+            throw StatusCodeException(STATUS_CODE_NOT_ALLOWED);
+        }
+    }
+
+    // Produce the records that will be written now; those that are not selected are only produced if another tool requests them
+    std::vector<LArNtupleRecord> selectedRecords;
+
+    for (const std::string &branchName : branchNames)
+    {
+        if (!this->IsBranchSelected(branchName))
+            continue;
+
+        const LArBranchPlaceholder::NtupleRecordSPtr spRecord = isPfoKeyed
+            ? this->GetLazyRecord<ParticleFlowObject>(m_lazyPfoRecords, branchName, pPfo)
+            : this->GetLazyRecord<MCParticle>(m_lazyMCParticleRecords, branchName, pMCParticle);
+
+        selectedRecords.push_back(*spRecord);
+    }
+
+    return selectedRecords;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::SetBranchSelection(StringVector branchSelection)
+{
+    m_branchSelection = std::move(branchSelection);
+    m_branchSelectionCache.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool LArNtuple::IsBranchSelected(const std::string &branchName) const
+{
+    if (m_branchSelection.empty())
+        return true;
+
+    const auto findIter = m_branchSelectionCache.find(branchName);
+
+    if (findIter != m_branchSelectionCache.end())
+        return findIter->second;
+
+    bool isSelected(false);
+
+    for (const std::string &selection : m_branchSelection)
+    {
+        if (!selection.empty() && selection.back() == '*')
+            isSelected = (branchName.compare(0UL, selection.size() - 1UL, selection, 0UL, selection.size() - 1UL) == 0);
+
+        else
+            isSelected = (branchName == selection);
+
+        if (isSelected)
+            break;
+    }
+
+    m_branchSelectionCache.emplace(branchName, isSelected);
+    return isSelected;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::SetZoneMapBranches(StringVector zoneMapBranches, const unsigned int clusterSize)
+{
+    if (!zoneMapBranches.empty() && clusterSize == 0U)
+    {
+        std::cerr << "LArNtuple: Zone maps need a non-zero cluster size" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    m_zoneMapBranches    = std::move(zoneMapBranches);
+    m_zoneMapClusterSize = clusterSize;
+
+    // Flushing the baskets every fixed number of entries makes each zone exactly one cluster
+    if (!m_zoneMapBranches.empty())
+        m_pOutputTree->SetAutoFlush(static_cast<Long64_t>(m_zoneMapClusterSize));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 void LArNtuple::FillVectors(const LArNtupleHelper::VECTOR_BRANCH_TYPE type)
 {
     BranchMap &branchMap = this->GetVectorBranchMap(type);
@@ -80,6 +307,8 @@ void LArNtuple::FillVectors(const LArNtupleHelper::VECTOR_BRANCH_TYPE type)
         branchPlaceholder.PushNtupleScalarRecord();
     }
 
+    ++m_numVectorElements[type];
+
     if (!branchMap.empty()) // if ther has been at least one particle, then we can lock the vector
         m_areVectorElementsLocked = true;
 }
@@ -116,6 +345,9 @@ void LArNtuple::Fill()
         throw StatusCodeException(STATUS_CODE_FAILURE);
     }
 
+    this->UpdateBranchStatistics();
+    this->UpdateZoneMaps();
+
     // Prepare the ntuple for the next event
     m_addressesSet = true;
     m_ntupleEmpty  = false;
@@ -132,6 +364,7 @@ LArNtuple::LArNtuple(const std::string &filePath, const std::string &treeName, c
     m_addressesSet(false),
     m_ntupleEmpty(true),
     m_areVectorElementsLocked(false),
+    m_numVectorElements(),
     m_trackSlidingFitWindow(25U),
     m_cache(),
     m_cacheMCParticles(),
@@ -144,6 +377,17 @@ LArNtuple::LArNtuple(const std::string &filePath, const std::string &treeName, c
     m_cacheDownstreamWHits(),
     m_cacheDownstreamPfos(),
     m_cacheTrackFits(),
+    m_categoryCodes(),
+    m_categoryVocabularies(),
+    m_branchStatistics(),
+    m_branchSelection(),
+    m_branchSelectionCache(),
+    m_zoneMapBranches(),
+    m_zoneMapClusterSize(0U),
+    m_zoneMaps(),
+    m_numZoneEntries(0U),
+    m_lazyPfoRecords(),
+    m_lazyMCParticleRecords(),
     m_spRegistry(new LArRootRegistry(filePath, appendMode ? LArRootRegistry::FILE_MODE::APPEND : LArRootRegistry::FILE_MODE::NEW))
 {
     this->InstantiateTTree(appendMode, treeName, treeTitle, filePath);
@@ -151,11 +395,19 @@ LArNtuple::LArNtuple(const std::string &filePath, const std::string &treeName, c
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+void LArNtuple::Finalise() const
+{
+    this->BuildEventIndex();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 void LArNtuple::Reset()
 {
     // Reset the ntuple state to allow recovery from internal errors
     m_vectorElementBranchMap.clear();
     m_areVectorElementsLocked = false;
+    m_numVectorElements.clear();
 
     if (m_addressesSet)
     {
@@ -189,6 +441,172 @@ void LArNtuple::Reset()
     m_cacheDownstreamWHits.clear();
     m_cacheDownstreamPfos.clear();
     m_cacheTrackFits.clear();
+    m_lazyPfoRecords.clear();
+    m_lazyMCParticleRecords.clear();
+    m_hitPairIndices.clear();
+    m_indexedThreeDHits.clear();
+    m_indexedTwoDHits.clear();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::UpdateBranchStatistics()
+{
+    for (auto &entry : m_scalarBranchMap)
+        this->AccumulateBranchStatistics(entry.first, entry.second, *entry.second.GetNtupleScalarRecord());
+
+    for (auto &mapPair : m_vectorBranchMaps)
+    {
+        for (auto &entry : mapPair.second)
+        {
+            for (const LArBranchPlaceholder::NtupleRecordSPtr &spRecord : entry.second.GetNtupleVectorRecord())
+                this->AccumulateBranchStatistics(entry.first, entry.second, *spRecord);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::AccumulateBranchStatistics(
+    const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, const LArNtupleRecord &record)
+{
+    // The statistics are looked up once per branch and then kept by its placeholder. Matrices are written as flattened columns, so their
+    // statistics go with the values column that readers see
+    const auto statistics = [&]() -> const StatisticVector & {
+        if (!branchPlaceholder.Statistics())
+        {
+            const bool isMatrix(record.ValueType() == LArNtupleRecord::VALUE_TYPE::R_FLOAT_MATRIX ||
+                                record.ValueType() == LArNtupleRecord::VALUE_TYPE::R_INT_MATRIX);
+            branchPlaceholder.Statistics(&this->GetBranchStatistics(isMatrix ? branchName + "_values" : branchName));
+        }
+
+        return *branchPlaceholder.Statistics();
+    };
+
+    // Strings and categories have no meaningful range, and declared precisions are ignored as the truncation is well below any binning
+    switch (record.ValueType())
+    {
+        case LArNtupleRecord::VALUE_TYPE::R_FLOAT:
+            AccumulateStatistic(record.Value<LArNtupleRecord::RFloat>(), statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_INT:
+            AccumulateStatistic(record.Value<LArNtupleRecord::RInt>(), statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_BOOL:
+            AccumulateStatistic(record.Value<LArNtupleRecord::RBool>() ? 1. : 0., statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_UINT:
+            AccumulateStatistic(record.Value<LArNtupleRecord::RUInt>(), statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_ULONG64:
+            AccumulateStatistic(static_cast<double>(record.Value<LArNtupleRecord::RULong64>()), statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_FLOAT_VECTOR:
+            AccumulateStatistics(record.Value<LArNtupleRecord::RFloatVector>(), statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_INT_VECTOR:
+            AccumulateStatistics(record.Value<LArNtupleRecord::RIntVector>(), statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_FLOAT_MATRIX:
+            AccumulateStatistics(record.Value<LArNtupleRecord::RFloatMatrix>(), statistics());
+            break;
+
+        case LArNtupleRecord::VALUE_TYPE::R_INT_MATRIX:
+            AccumulateStatistics(record.Value<LArNtupleRecord::RIntMatrix>(), statistics());
+            break;
+
+        default:
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::UpdateZoneMaps()
+{
+    if (m_zoneMapBranches.empty())
+        return;
+
+    // Setting the cluster size starts a new cluster range at the next entry, so the clusters are counted from the first entry filled here.
+    // Should they not line up, for instance after appending with an unchanged cluster size, readers skip fewer clusters but none wrongly
+    const Long64_t entry(m_pOutputTree->GetEntries() - 1LL);
+    const bool     isNewZone(m_numZoneEntries == 0U || m_numZoneEntries == m_zoneMapClusterSize);
+    m_numZoneEntries = isNewZone ? 1U : m_numZoneEntries + 1U;
+
+    for (const std::string &branchName : m_zoneMapBranches)
+    {
+        const auto findIter = m_scalarBranchMap.find(branchName);
+        double     value(0.);
+
+        if (findIter == m_scalarBranchMap.end() || !GetNumericValue(*findIter->second.GetNtupleScalarRecord(), value))
+        {
+            std::cerr << "LArNtuple: Could not record a zone map for branch '" << branchName << "' as it is not a numeric per-event branch"
+                      << std::endl;
+            throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+        }
+
+        TList *const pZoneMap = this->GetZoneMap(branchName);
+        TVectorD    *pZone    = isNewZone ? nullptr : dynamic_cast<TVectorD *>(pZoneMap->Last());
+
+        if (!pZone)
+        {
+            // A zone with no finite values has an empty range, which no cut can overlap
+            pZone                      = new TVectorD(NUM_ZONE_FIELDS);
+            (*pZone)[ZONE_FIRST_ENTRY] = static_cast<double>(entry);
+            (*pZone)[ZONE_MIN]         = std::numeric_limits<double>::infinity();
+            (*pZone)[ZONE_MAX]         = -std::numeric_limits<double>::infinity();
+            pZoneMap->Add(pZone);
+        }
+
+        (*pZone)[ZONE_END_ENTRY] = static_cast<double>(entry + 1LL);
+
+        if (std::isfinite(value))
+        {
+            (*pZone)[ZONE_MIN] = std::min((*pZone)[ZONE_MIN], value);
+            (*pZone)[ZONE_MAX] = std::max((*pZone)[ZONE_MAX], value);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::PrepareEvent(const PfoList &pfoList)
+{
+    m_hitPairIndices.clear();
+    m_indexedThreeDHits.clear();
+    m_indexedTwoDHits.clear();
+
+    CaloHitList threeDHits;
+    LArPfoHelper::GetCaloHits(pfoList, TPC_3D, threeDHits);
+
+    m_hitPairIndices.reserve(2UL * threeDHits.size());
+    m_indexedThreeDHits.reserve(threeDHits.size());
+    m_indexedTwoDHits.reserve(threeDHits.size());
+
+    // 3D and 2D hits are distinct objects, so one map serves both directions; a 2D hit keeps the first 3D hit made from it
+    for (const CaloHit *const pThreeDHit : threeDHits)
+    {
+        const CaloHit *const pTwoDHit = reinterpret_cast<const CaloHit *>(pThreeDHit->GetParentAddress());
+
+        if (!pTwoDHit)
+            continue;
+
+        const std::size_t index(m_indexedThreeDHits.size());
+
+        if (!m_hitPairIndices.emplace(pThreeDHit, index).second)
+            continue;
+
+        m_hitPairIndices.emplace(pTwoDHit, index);
+        m_indexedThreeDHits.push_back(pThreeDHit);
+        m_indexedTwoDHits.push_back(pTwoDHit);
+    }
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -210,7 +628,11 @@ std::size_t LArNtuple::SetScalarBranchAddresses()
         switch (spRecord->ValueType())
         {
             case LArNtupleRecord::VALUE_TYPE::R_FLOAT:
-                this->PushScalarToBranch<LArNtupleRecord::RFloat>(entry.first, entry.second, false);
+                if (entry.second.GetPrecision())
+                    this->PushPrecisionScalarToBranch(entry.first, entry.second);
+
+                else
+                    this->PushScalarToBranch<LArNtupleRecord::RFloat>(entry.first, entry.second, false);
                 break;
 
             case LArNtupleRecord::VALUE_TYPE::R_INT:
@@ -234,7 +656,12 @@ std::size_t LArNtuple::SetScalarBranchAddresses()
                 break;
 
             case LArNtupleRecord::VALUE_TYPE::R_FLOAT_VECTOR:
-                this->PushScalarToBranch<LArNtupleRecord::RFloatVector>(entry.first, entry.second, false);
+                if (entry.second.GetPrecision())
+                    this->PushPrecisionArrayToBranch(
+                        entry.first, entry.second, LArNtupleRecord::RFloatVector(spRecord->Value<LArNtupleRecord::RFloatVector>()));
+
+                else
+                    this->PushScalarToBranch<LArNtupleRecord::RFloatVector>(entry.first, entry.second, false);
                 break;
 
             case LArNtupleRecord::VALUE_TYPE::R_INT_VECTOR:
@@ -242,11 +669,16 @@ std::size_t LArNtuple::SetScalarBranchAddresses()
                 break;
 
             case LArNtupleRecord::VALUE_TYPE::R_FLOAT_MATRIX:
-                this->PushScalarToBranch<LArNtupleRecord::RFloatMatrix>(entry.first, entry.second, false);
+                this->PushScalarMatrixToBranch<LArNtupleRecord::RFloat>(entry.first, entry.second);
                 break;
 
             case LArNtupleRecord::VALUE_TYPE::R_INT_MATRIX:
-                this->PushScalarToBranch<LArNtupleRecord::RIntMatrix>(entry.first, entry.second, false);
+                this->PushScalarMatrixToBranch<LArNtupleRecord::RInt>(entry.first, entry.second);
+                break;
+
+            case LArNtupleRecord::VALUE_TYPE::R_CATEGORY:
+                this->PushToBranch<LArNtupleRecord::RInt>(
+                    entry.first, entry.second, this->GetCategoryCode(entry.first, spRecord->Value<LArNtupleRecord::RCategory>()), false);
                 break;
 
             default:
@@ -275,7 +707,12 @@ std::size_t LArNtuple::SetVectorBranchAddresses()
             switch (branchPlaceholder.ValueType())
             {
                 case LArNtupleRecord::VALUE_TYPE::R_FLOAT:
-                    this->PushVectorToBranch<LArNtupleRecord::RFloat>(entry.first, branchPlaceholder, false);
+                    if (branchPlaceholder.GetPrecision())
+                        this->PushPrecisionArrayToBranch(entry.first, branchPlaceholder,
+                            this->CreateVector<LArNtupleRecord::RFloat>(branchPlaceholder.GetNtupleVectorRecord()));
+
+                    else
+                        this->PushVectorToBranch<LArNtupleRecord::RFloat>(entry.first, branchPlaceholder, false);
                     break;
 
                 case LArNtupleRecord::VALUE_TYPE::R_INT:
@@ -299,6 +736,13 @@ std::size_t LArNtuple::SetVectorBranchAddresses()
                     break;
 
                 case LArNtupleRecord::VALUE_TYPE::R_FLOAT_VECTOR:
+                    if (branchPlaceholder.GetPrecision())
+                    {
+                        std::cerr << "LArNtuple: Declared precisions are not supported for per-particle float vectors, as in branch '"
+                                  << entry.first << "'" << std::endl;
+                        throw StatusCodeException(STATUS_CODE_NOT_ALLOWED);
+                    }
+
                     this->PushVectorToBranch<LArNtupleRecord::RFloatVector>(entry.first, branchPlaceholder, false);
                     break;
 
@@ -307,11 +751,16 @@ std::size_t LArNtuple::SetVectorBranchAddresses()
                     break;
 
                 case LArNtupleRecord::VALUE_TYPE::R_FLOAT_MATRIX:
-                    this->PushVectorToBranch<LArNtupleRecord::RFloatMatrix>(entry.first, branchPlaceholder, false);
+                    this->PushVectorMatrixToBranch<LArNtupleRecord::RFloat>(entry.first, branchPlaceholder);
                     break;
 
                 case LArNtupleRecord::VALUE_TYPE::R_INT_MATRIX:
-                    this->PushVectorToBranch<LArNtupleRecord::RIntMatrix>(entry.first, branchPlaceholder, false);
+                    this->PushVectorMatrixToBranch<LArNtupleRecord::RInt>(entry.first, branchPlaceholder);
+                    break;
+
+                case LArNtupleRecord::VALUE_TYPE::R_CATEGORY:
+                    this->PushToBranch<std::vector<LArNtupleRecord::RInt>>(entry.first, branchPlaceholder,
+                        this->CreateCategoryCodeVector(entry.first, branchPlaceholder.GetNtupleVectorRecord()), false);
                     break;
 
                 default:
@@ -328,6 +777,307 @@ std::size_t LArNtuple::SetVectorBranchAddresses()
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+void LArNtuple::PushPrecisionScalarToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder) const
+{
+    const LArNtupleRecord::RFloat value = branchPlaceholder.GetNtupleScalarRecord()->Value<LArNtupleRecord::RFloat>();
+
+    if (m_addressesSet)
+    {
+        std::any *const pCacheElement = branchPlaceholder.CacheElement();
+
+        if (!pCacheElement)
+        {
+            std::cerr << "LArNtuple: Cache element address has not been set" << std::endl;
+            throw StatusCodeException(STATUS_CODE_FAILURE);
+        }
+
+        std::any_cast<LArNtupleRecord::RFloat &>(*pCacheElement) = value;
+    }
+
+    else
+    {
+        LArNtupleRecord::RFloat &cachedValue = this->CacheObject(value);
+        branchPlaceholder.CacheElement(&m_cache.back());
+        this->AddLeafListBranch(branchName, &cachedValue, branchName + branchPlaceholder.GetPrecision()->LeafTypeSuffix());
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::PushPrecisionArrayToBranch(
+    const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, LArNtupleRecord::RFloatVector &&values) const
+{
+    PrecisionArray *pArray(nullptr);
+
+    if (m_addressesSet)
+    {
+        std::any *const pCacheElement = branchPlaceholder.CacheElement();
+
+        if (!pCacheElement)
+        {
+            std::cerr << "LArNtuple: Cache element address has not been set" << std::endl;
+            throw StatusCodeException(STATUS_CODE_FAILURE);
+        }
+
+        pArray           = &std::any_cast<PrecisionArray &>(*pCacheElement);
+        pArray->m_values = std::move(values);
+    }
+
+    else
+    {
+        pArray = &this->CacheObject(PrecisionArray{0U, std::move(values), nullptr});
+        branchPlaceholder.CacheElement(&m_cache.back());
+    }
+
+    // The array storage may move between fills, so always point the branch at the current storage (which must not be null)
+    pArray->m_size = static_cast<LArNtupleRecord::RUInt>(pArray->m_values.size());
+
+    if (pArray->m_values.capacity() == 0UL)
+        pArray->m_values.reserve(1UL);
+
+    if (!pArray->m_pBranch)
+    {
+        const std::string sizeBranchName(branchName + "_size");
+        const std::string leafList(branchName + "[" + sizeBranchName + "]" + branchPlaceholder.GetPrecision()->LeafTypeSuffix());
+
+        this->AddLeafListBranch(sizeBranchName, &pArray->m_size, sizeBranchName + "/i");
+        pArray->m_pBranch = this->AddLeafListBranch(branchName, pArray->m_values.data(), leafList);
+    }
+
+    else
+        pArray->m_pBranch->SetAddress(pArray->m_values.data());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtupleRecord::RInt LArNtuple::GetCategoryCode(const std::string &branchName, const LArNtupleRecord::RCategory &category) const
+{
+    const LArNtupleRecord::RCategory::VocabularySPtr &spVocabulary = category.GetVocabulary();
+
+    if (!spVocabulary)
+    {
+        std::cerr << "LArNtuple: Categorical record " << branchName << " has no vocabulary" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    auto codeMapIter = m_categoryCodes.find(branchName);
+
+    if (codeMapIter == m_categoryCodes.end())
+    {
+        // The dictionary is the vocabulary itself, so every job writes the same codes and merged TTrees decode correctly. A TTree being
+        // appended to must therefore have been written with the same vocabulary
+        TList *const pDictionary = this->GetCategoryDictionary(branchName);
+
+        if (pDictionary->IsEmpty())
+        {
+            for (const std::string &name : *spVocabulary)
+                pDictionary->Add(new TObjString(name.c_str()));
+        }
+
+        bool isSameVocabulary(pDictionary->GetSize() == static_cast<Int_t>(spVocabulary->size()));
+
+        for (Int_t code = 0, numCategories = pDictionary->GetSize(); isSameVocabulary && code < numCategories; ++code)
+            isSameVocabulary = (spVocabulary->at(code) == pDictionary->At(code)->GetName());
+
+        if (!isSameVocabulary)
+        {
+            std::cerr << "LArNtuple: The existing category dictionary for " << branchName << " differs from its vocabulary" << std::endl;
+            throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+        }
+
+        CategoryCodeMap codeMap;
+
+        for (std::size_t code = 0UL; code < spVocabulary->size(); ++code)
+            codeMap.emplace(spVocabulary->at(code), static_cast<LArNtupleRecord::RInt>(code));
+
+        m_categoryVocabularies.emplace(branchName, spVocabulary);
+        codeMapIter = m_categoryCodes.emplace(branchName, std::move(codeMap)).first;
+    }
+
+    // Tools normally share one vocabulary between their records, so only compare the names if the records hold different copies
+    const LArNtupleRecord::RCategory::VocabularySPtr &spBranchVocabulary = m_categoryVocabularies.at(branchName);
+
+    if (spVocabulary != spBranchVocabulary && *spVocabulary != *spBranchVocabulary)
+    {
+        std::cerr << "LArNtuple: Categorical records for " << branchName << " have different vocabularies" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    const CategoryCodeMap &codeMap  = codeMapIter->second;
+    const auto             findIter = codeMap.find(category.Name());
+
+    if (findIter == codeMap.end())
+    {
+        std::cerr << "LArNtuple: Category '" << category.Name() << "' is not in the vocabulary for " << branchName << std::endl;
+        throw StatusCodeException(STATUS_CODE_NOT_FOUND);
+    }
+
+    return findIter->second;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<LArNtupleRecord::RInt> LArNtuple::CreateCategoryCodeVector(
+    const std::string &branchName, const std::vector<LArBranchPlaceholder::NtupleRecordSPtr> &records) const
+{
+    std::vector<LArNtupleRecord::RInt> codes;
+
+    for (const LArBranchPlaceholder::NtupleRecordSPtr &spRecord : records)
+        codes.push_back(this->GetCategoryCode(branchName, spRecord->Value<LArNtupleRecord::RCategory>()));
+
+    return codes;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TList *LArNtuple::GetCategoryDictionary(const std::string &branchName) const
+{
+    // The dictionaries live in the TTree's user info list, so they are written once with the TTree rather than on every entry
+    const std::string dictionaryName(branchName + "_categories");
+    TList *const      pUserInfo = m_pOutputTree->GetUserInfo();
+
+    if (TList *const pDictionary = dynamic_cast<TList *>(pUserInfo->FindObject(dictionaryName.c_str())))
+        return pDictionary;
+
+    TList *const pDictionary = new TList();
+    pDictionary->SetName(dictionaryName.c_str());
+    pDictionary->SetOwner(true);
+    pUserInfo->Add(pDictionary);
+
+    return pDictionary;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtuple::StatisticVector &LArNtuple::GetBranchStatistics(const std::string &branchName)
+{
+    const auto findIter = m_branchStatistics.find(branchName);
+
+    if (findIter != m_branchStatistics.end())
+        return findIter->second;
+
+    // Like the category dictionaries, the statistics are written once with the TTree and carry on from any existing ones when appending
+    const std::string statisticsName(branchName + "_statistics");
+    TList *const      pUserInfo = m_pOutputTree->GetUserInfo();
+    TList            *pList     = dynamic_cast<TList *>(pUserInfo->FindObject(statisticsName.c_str()));
+
+    if (!pList)
+    {
+        pList = new TList();
+        pList->SetName(statisticsName.c_str());
+        pList->SetOwner(true);
+        pUserInfo->Add(pList);
+    }
+
+    StatisticVector statistics;
+
+    for (const char *const statisticName : STATISTIC_NAMES)
+    {
+        TParameter<Double_t> *pStatistic = dynamic_cast<TParameter<Double_t> *>(pList->FindObject(statisticName));
+
+        if (!pStatistic)
+        {
+            pStatistic = new TParameter<Double_t>(statisticName, 0.);
+            pList->Add(pStatistic);
+        }
+
+        statistics.push_back(pStatistic);
+    }
+
+    return m_branchStatistics.emplace(branchName, std::move(statistics)).first->second;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtuple::BuildEventIndex() const
+{
+    // A moved-from ntuple owns neither a registry nor a TTree, so there is nothing to index
+    if (!m_spRegistry || !m_pOutputTree)
+    {
+        std::cerr << "LArNtuple: Could not build the event index as the ntuple has no TTree" << std::endl;
+        throw StatusCodeException(STATUS_CODE_NOT_INITIALIZED);
+    }
+
+    if (m_pOutputTree->GetEntries() == 0LL)
+        return;
+
+    if (!m_pOutputTree->GetBranch("fileId") || !m_pOutputTree->GetBranch("eventNum") || !m_pOutputTree->GetBranch("hypothesisId"))
+    {
+        std::cerr << "LArNtuple: Could not build the event index as the TTree lacks the reserved per-event branches" << std::endl;
+        throw StatusCodeException(STATUS_CODE_NOT_FOUND);
+    }
+
+    // The running statistics cover every entry, including those appended to, so they bound the hypothesis IDs without a scan
+    const TList *const   pStatistics = dynamic_cast<TList *>(m_pOutputTree->GetUserInfo()->FindObject("hypothesisId_statistics"));
+    const TObject *const pMaxObject  = pStatistics ? pStatistics->FindObject(STATISTIC_NAMES[STATISTIC_MAX]) : nullptr;
+    const TParameter<Double_t> *const pMax = dynamic_cast<const TParameter<Double_t> *>(pMaxObject);
+
+    if (pMax && pMax->GetVal() > MAX_INDEXED_HYPOTHESIS_ID)
+    {
+        std::cerr << "LArNtuple: Could not build the event index as hypothesis IDs exceed " << MAX_INDEXED_HYPOTHESIS_ID << std::endl;
+        throw StatusCodeException(STATUS_CODE_OUT_OF_RANGE);
+    }
+
+    // Rebuilding replaces any index read in append mode, and TTree merging carries the index of each shard into the merged TTree
+    bool isIndexed(false);
+    m_spRegistry->DoAsRegistry([&]() { isIndexed = (m_pOutputTree->BuildIndex(EVENT_INDEX_MAJOR, EVENT_INDEX_MINOR) > 0); });
+
+    if (!isIndexed)
+    {
+        std::cerr << "LArNtuple: Failed to build the event index" << std::endl;
+        throw StatusCodeException(STATUS_CODE_FAILURE);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TList *LArNtuple::GetZoneMap(const std::string &branchName)
+{
+    const auto findIter = m_zoneMaps.find(branchName);
+
+    if (findIter != m_zoneMaps.end())
+        return findIter->second;
+
+    // When appending, the new zones follow on from the existing ones in the TTree metadata
+    const std::string zoneMapName(branchName + "_zones");
+    TList *const      pUserInfo = m_pOutputTree->GetUserInfo();
+    TList            *pZoneMap  = dynamic_cast<TList *>(pUserInfo->FindObject(zoneMapName.c_str()));
+
+    if (!pZoneMap)
+    {
+        pZoneMap = new TList();
+        pZoneMap->SetName(zoneMapName.c_str());
+        pZoneMap->SetOwner(true);
+        pUserInfo->Add(pZoneMap);
+    }
+
+    m_zoneMaps.emplace(branchName, pZoneMap);
+
+    return pZoneMap;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+TBranch *LArNtuple::AddLeafListBranch(const std::string &branchName, void *const pAddress, const std::string &leafList) const
+{
+    if (m_ntupleEmpty)
+        return m_pOutputTree->Branch(branchName.c_str(), pAddress, leafList.c_str());
+
+    // We have loaded this non-empty TTree from a file and now need to tie up the branch with the new address
+    TBranch *const pBranch = m_pOutputTree->GetBranch(branchName.c_str());
+
+    if (!pBranch)
+    {
+        std::cerr << "LArNtuple: Could not append to existing TTree because no existing branch matched '" << branchName << "'" << std::endl;
+        throw StatusCodeException(STATUS_CODE_NOT_FOUND);
+    }
+
+    pBranch->SetAddress(pAddress);
+    return pBranch;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 void LArNtuple::ValidateAndAddRecord(BranchMap &branchMap, const LArNtupleRecord &record)
 {
     const auto findIter = branchMap.find(record.BranchName());
@@ -441,6 +1191,9 @@ const CaloHitList &LArNtuple::GetAllDownstreamHitsImpl(const ParticleFlowObject
 
 LArBranchPlaceholder::NtupleRecordSPtr LArNtuple::GetScalarRecord(const std::string &branchName) const
 {
+    if (const LArBranchPlaceholder::NtupleRecordSPtr spLazyRecord = this->GetLazyRecord<ParticleFlowObject>(m_lazyPfoRecords, branchName, nullptr))
+        return spLazyRecord;
+
     const LArBranchPlaceholder &                 branchPlaceholder = this->GetBranchPlaceholder(m_scalarBranchMap, branchName);
     const LArBranchPlaceholder::NtupleRecordSPtr spRecord          = branchPlaceholder.GetNtupleScalarRecord();
 
@@ -498,7 +1251,7 @@ const LArBranchPlaceholder &LArNtuple::GetBranchPlaceholder(const BranchMap &bra
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 LArNtupleHelper::TrackFitSharedPtr LArNtuple::CalculateTrackFit(
-    const Pandora &pandoraInstance, const ParticleFlowObject *const pPfo, const unsigned int slidingFitWindow) const
+    const LArGeometryContext &geometryContext, const ParticleFlowObject *const pPfo, const unsigned int slidingFitWindow) const
 {
     // Get the 3D clusters and make sure there's at least one
     ClusterList threeDClusterList;
@@ -522,7 +1275,7 @@ LArNtupleHelper::TrackFitSharedPtr LArNtuple::CalculateTrackFit(
     if (coordinateVector.size() < 3UL)
         return nullptr;
 
-    const float layerPitch(LArGeometryHelper::GetWireZPitch(pandoraInstance));
+    const float layerPitch(geometryContext.GetWireZPitch());
 
     // If the fit fails, just return a nullptr
     try
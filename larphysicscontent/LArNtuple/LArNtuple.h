@@ -11,6 +11,7 @@
 #include "larphysicscontent/LArNtuple/LArBranchPlaceholder.h"
 #include "larphysicscontent/LArNtuple/LArNtupleRecord.h"
 #include "larphysicscontent/LArNtuple/NtupleVariableBaseTool.h"
+#include "larphysicscontent/LArObjects/LArGeometryContext.h"
 #include "larphysicscontent/LArObjects/LArRootRegistry.h"
 
 #include "larpandoracontent/LArHelpers/LArMCParticleHelper.h"
@@ -19,10 +20,14 @@
 #include "Objects/ParticleFlowObject.h"
 #include "Pandora/Algorithm.h"
 
+#include "TList.h"
+#include "TParameter.h"
 #include "TTree.h"
+#include "TVectorD.h"
 
 #include <any>
 #include <deque>
+#include <map>
 
 namespace lar_physics_content
 {
@@ -84,11 +89,59 @@ private:
     using Cache     = std::deque<std::any>; ///< Alias for a generic cache (deque to preserve pointers to elements)
     using VectorBranchTypeMap =
         std::unordered_map<LArNtupleHelper::VECTOR_BRANCH_TYPE, BranchMap>; ///< Alias for a map from vector branch types to their branch map
+    using CategoryCodeMap    = std::unordered_map<std::string, LArNtupleRecord::RInt>; ///< Alias for a map from category names to codes
+    using BranchCategoryMap  = std::unordered_map<std::string, CategoryCodeMap>;       ///< Alias for a map from branch names to category codes
+    using BranchVocabularyMap =
+        std::unordered_map<std::string, LArNtupleRecord::RCategory::VocabularySPtr>; ///< Alias for a map from branch names to vocabularies
+    using BranchSelectionMap = std::unordered_map<std::string, bool>; ///< Alias for a map from branch names to whether they are selected
+    using StatisticVector    = LArBranchPlaceholder::StatisticVector; ///< Alias for the running statistics of a branch
+    using StatisticsMap      = std::unordered_map<std::string, StatisticVector>; ///< Alias for a map from branch names to their statistics
+    using ZoneMapListMap     = std::unordered_map<std::string, TList *>; ///< Alias for a map from branch names to their zone maps
+    using HitPairIndexMap    = std::unordered_map<const pandora::CaloHit *, std::size_t>; ///< Alias for a map from hits to hit pair indices
+    using VectorElementCountMap =
+        std::unordered_map<LArNtupleHelper::VECTOR_BRANCH_TYPE, std::size_t>; ///< Alias for a map from vector branch types to counts
 
     template <typename T>
     using PfoCache =
         std::unordered_map<const pandora::ParticleFlowObject *, std::decay_t<T>>; ///< Alias for a cache from PFO addresses to other objects
 
+    /**
+     *  @brief  Flattened storage for a matrix branch: a flat value column plus offset columns in place of a nested collection
+     */
+    template <typename T>
+    struct FlatMatrix
+    {
+        std::vector<std::decay_t<T>>        m_values;         ///< The matrix values, concatenated row by row
+        std::vector<LArNtupleRecord::RUInt> m_offsets;        ///< The offset of each row into the values, plus a trailing end offset
+        std::vector<LArNtupleRecord::RUInt> m_elementOffsets; ///< For vector branches, the offset of each element into the rows, plus a trailing end offset
+    };
+
+    /**
+     *  @brief  Storage for a float array branch with a declared precision, written as a counted ROOT array rather than a std::vector
+     */
+    struct PrecisionArray
+    {
+        LArNtupleRecord::RUInt        m_size;    ///< The number of values, written to the counter branch
+        LArNtupleRecord::RFloatVector m_values;  ///< The values
+        TBranch *                     m_pBranch; ///< Address of the array branch, whose address follows the value storage
+    };
+
+    /**
+     *  @brief  A group of records sharing one producer, evaluated at most once per event on first request
+     */
+    struct LazyRecordGroup
+    {
+        LArNtupleHelper::RecordProducer                                         m_producer;    ///< The record producer
+        std::unordered_map<std::string, LArBranchPlaceholder::NtupleRecordSPtr> m_records;     ///< The produced records, by branch name
+        bool                                                                    m_isEvaluated; ///< Whether the producer has been run
+    };
+
+    using LazyRecordGroupSPtr = std::shared_ptr<LazyRecordGroup>; ///< Alias for a shared pointer to a lazy record group
+
+    template <typename T>
+    using LazyRecordMap = std::map<std::pair<std::string, const std::decay_t<T> *>,
+        LazyRecordGroupSPtr>; ///< Alias for a map from branch names and particle addresses to lazy record groups
+
     template <typename T>
     using RecordMapGetter = std::function<LArBranchPlaceholder::NtupleRecordMap<const std::decay_t<T> *>(const LArBranchPlaceholder &)>; ///< Alias for a record map getter function
 
@@ -99,6 +152,7 @@ private:
     bool                                                 m_addressesSet;     ///< Whether the addresses have been set
     bool                                                 m_ntupleEmpty;      ///< Whether the ntuple is empty
     bool                                                 m_areVectorElementsLocked;   ///< Whether scalar entries are locked
+    VectorElementCountMap                                m_numVectorElements;         ///< The number of elements filled per vector type
     unsigned int                                         m_trackSlidingFitWindow;     ///< The track sliding fit window size
     mutable Cache                                        m_cache;                     ///< The cache
     mutable PfoCache<const pandora::MCParticle *>        m_cacheMCParticles;          ///< The cached mappings from PFOs to MC particles
@@ -111,7 +165,21 @@ private:
     mutable PfoCache<pandora::CaloHitList>               m_cacheDownstreamWHits;      ///< The pfo cache of downstream W hits
     mutable PfoCache<pandora::PfoList>                   m_cacheDownstreamPfos;       ///< The pfo cache of downstream pfos
     mutable PfoCache<LArNtupleHelper::TrackFitSharedPtr> m_cacheTrackFits;            ///< The pfo cache of track fits
+    mutable BranchCategoryMap                            m_categoryCodes;             ///< The category codes for each categorical branch
+    mutable BranchVocabularyMap                          m_categoryVocabularies;      ///< The vocabulary of each categorical branch
+    StatisticsMap                                        m_branchStatistics;          ///< The running statistics for each numeric branch
+    pandora::StringVector                                m_branchSelection;           ///< The selected branch names, empty to select all
+    mutable BranchSelectionMap                           m_branchSelectionCache;      ///< The cached branch selection decisions
+    pandora::StringVector                                m_zoneMapBranches;           ///< The per-event branches with per-cluster zone maps
+    unsigned int                                         m_zoneMapClusterSize;        ///< The number of entries per cluster with zone maps
+    ZoneMapListMap                                       m_zoneMaps;                  ///< The zone maps of each zone-mapped branch
+    unsigned int                                         m_numZoneEntries;            ///< The number of entries in the open zone, if any
+    LazyRecordMap<pandora::ParticleFlowObject>           m_lazyPfoRecords;            ///< The lazy records by branch name and PFO
+    LazyRecordMap<pandora::MCParticle>                   m_lazyMCParticleRecords;     ///< The lazy records by branch name and MC particle
     std::shared_ptr<LArRootRegistry>                     m_spRegistry;                ///< The ROOT registry
+    HitPairIndexMap                                      m_hitPairIndices;            ///< The hit pair index of each indexed 3D and 2D hit
+    pandora::CaloHitVector                               m_indexedThreeDHits;         ///< The 3D hit of each indexed hit pair
+    pandora::CaloHitVector                               m_indexedTwoDHits;           ///< The parent 2D hit of each indexed hit pair
 
     /**
      *  @brief  Add a scalar record to the cache
@@ -128,6 +196,44 @@ private:
      */
     void AddVectorRecordElement(const LArNtupleRecord &record, const LArNtupleHelper::VECTOR_BRANCH_TYPE type);
 
+    /**
+     *  @brief  Add a group of lazily-evaluated records, whose producer is run only when one of the records is requested
+     *
+     *  @param  branchNames the names of the branches the producer populates
+     *  @param  pPfo optional address of the associated PFO
+     *  @param  pMCParticle optional address of the associated MC particle
+     *  @param  producer the record producer
+     *
+     *  @return the records selected for output, which are produced immediately
+     */
+    std::vector<LArNtupleRecord> AddLazyRecords(const pandora::StringVector &branchNames, const pandora::ParticleFlowObject *const pPfo,
+        const pandora::MCParticle *const pMCParticle, LArNtupleHelper::RecordProducer producer);
+
+    /**
+     *  @brief  Set the branch selection
+     *
+     *  @param  branchSelection the branch names to write, each optionally ending in a '*' wildcard; empty to write all branches
+     */
+    void SetBranchSelection(pandora::StringVector branchSelection);
+
+    /**
+     *  @brief  Whether a branch is selected for output
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return whether the branch is selected
+     */
+    bool IsBranchSelected(const std::string &branchName) const;
+
+    /**
+     *  @brief  Set the per-event branches for which to record the range of values in each TTree cluster, so that readers can skip the
+     *          clusters that cannot pass their cuts
+     *
+     *  @param  zoneMapBranches the names of the numeric per-event branches; empty to record no zone maps
+     *  @param  clusterSize the number of entries in each TTree cluster
+     */
+    void SetZoneMapBranches(pandora::StringVector zoneMapBranches, const unsigned int clusterSize);
+
     /**
      *  @brief  Fill the vectors using the cached elements
      *
@@ -152,6 +258,71 @@ private:
      */
     void Reset();
 
+    /**
+     *  @brief  Finalise the ntuple at the end of the job, indexing the TTree by event before the registry writes it
+     */
+    void Finalise() const;
+
+    /**
+     *  @brief  Accumulate the values of the entry just filled into the running statistics of each numeric branch
+     */
+    void UpdateBranchStatistics();
+
+    /**
+     *  @brief  Accumulate the value of a record into the running statistics of its branch, flattening vectors and matrices
+     *
+     *  @param  branchName the branch name
+     *  @param  branchPlaceholder the branch placeholder, which keeps the statistics once they have been resolved
+     *  @param  record the record
+     */
+    void AccumulateBranchStatistics(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, const LArNtupleRecord &record);
+
+    /**
+     *  @brief  Extend the zone maps with the entry just filled, starting a new zone at each cluster boundary
+     */
+    void UpdateZoneMaps();
+
+    /**
+     *  @brief  Build the per-event index between 3D hits and their parent 2D hits
+     *
+     *  @param  pfoList the list of all PFOs in the event
+     */
+    void PrepareEvent(const pandora::PfoList &pfoList);
+
+    /**
+     *  @brief  Get the parent 2D hit of a 3D hit from the per-event index
+     *
+     *  @param  pThreeDHit address of the 3D hit
+     *
+     *  @return address of the parent 2D hit, or nullptr if the 3D hit is not indexed
+     */
+    const pandora::CaloHit *GetParentTwoDHit(const pandora::CaloHit *const pThreeDHit) const;
+
+    /**
+     *  @brief  Get the 3D hit created from a 2D hit from the per-event index
+     *
+     *  @param  pTwoDHit address of the 2D hit
+     *
+     *  @return address of the 3D hit, or nullptr if the 2D hit is not indexed
+     */
+    const pandora::CaloHit *GetDaughterThreeDHit(const pandora::CaloHit *const pTwoDHit) const;
+
+    /**
+     *  @brief  Get the entry number at which the current event will be filled, for side outputs to refer back to it
+     *
+     *  @return the entry number
+     */
+    Long64_t GetCurrentEntry() const;
+
+    /**
+     *  @brief  Get the index in its vector branches of the particle being processed, which is the number of elements filled so far
+     *
+     *  @param  type the vector branch type
+     *
+     *  @return the vector element index
+     */
+    std::size_t GetCurrentVectorElementIndex(const LArNtupleHelper::VECTOR_BRANCH_TYPE type) const;
+
     /**
      *  @brief  Get all 3D hits downstream of a PFO, including from the PFO itself
      *
@@ -265,6 +436,130 @@ private:
     template <typename T>
     void PushVectorToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, const bool splitMode) const;
 
+    /**
+     *  @brief  Push a scalar matrix to a pair of flat value and row offset branches
+     *
+     *  @param  branchName the branch name
+     *  @param  branchPlaceholder the branch placeholder
+     */
+    template <typename T>
+    void PushScalarMatrixToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder) const;
+
+    /**
+     *  @brief  Push a vector of matrices to flat value, row offset and element offset branches
+     *
+     *  @param  branchName the branch name
+     *  @param  branchPlaceholder the branch placeholder
+     */
+    template <typename T>
+    void PushVectorMatrixToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder) const;
+
+    /**
+     *  @brief  Get the cached flat matrix for a branch, emptied ready for filling (i.e. cache it and add the branches if required)
+     *
+     *  @param  branchName the branch name
+     *  @param  branchPlaceholder the branch placeholder
+     *  @param  isVectorBranch whether the branch holds one matrix per vector element
+     *
+     *  @return the flat matrix
+     */
+    template <typename T>
+    FlatMatrix<T> &GetFlatMatrix(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, const bool isVectorBranch) const;
+
+    /**
+     *  @brief  Append the rows of a matrix to a flat matrix
+     *
+     *  @param  matrix the matrix
+     *  @param  flatMatrix the flat matrix to append to
+     */
+    template <typename T>
+    static void AppendMatrixRows(const std::vector<std::vector<std::decay_t<T>>> &matrix, FlatMatrix<T> &flatMatrix);
+
+    /**
+     *  @brief  Push a scalar float with a declared precision to a truncated Float16_t branch
+     *
+     *  @param  branchName the branch name
+     *  @param  branchPlaceholder the branch placeholder
+     */
+    void PushPrecisionScalarToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder) const;
+
+    /**
+     *  @brief  Push floats with a declared precision to a counted, truncated Float16_t array branch
+     *
+     *  @param  branchName the branch name
+     *  @param  branchPlaceholder the branch placeholder
+     *  @param  values the values to push
+     */
+    void PushPrecisionArrayToBranch(
+        const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, LArNtupleRecord::RFloatVector &&values) const;
+
+    /**
+     *  @brief  Get the code for a category, its index into the vocabulary of its branch, which is written as the branch's category
+     *          dictionary the first time the branch is seen
+     *
+     *  @param  branchName the branch name
+     *  @param  category the category
+     *
+     *  @return the category code
+     */
+    LArNtupleRecord::RInt GetCategoryCode(const std::string &branchName, const LArNtupleRecord::RCategory &category) const;
+
+    /**
+     *  @brief  Create a vector of category codes from a vector of shared pointers to categorical records
+     *
+     *  @param  branchName the branch name
+     *  @param  records the record shared pointers
+     *
+     *  @return the vector of category codes
+     */
+    std::vector<LArNtupleRecord::RInt> CreateCategoryCodeVector(
+        const std::string &branchName, const std::vector<LArBranchPlaceholder::NtupleRecordSPtr> &records) const;
+
+    /**
+     *  @brief  Get the category dictionary for a branch from the TTree metadata, creating it if required
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return address of the dictionary, a list of category names indexed by code
+     */
+    TList *GetCategoryDictionary(const std::string &branchName) const;
+
+    /**
+     *  @brief  Get the running statistics for a branch from the TTree metadata, creating them if required
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return the statistics: the count, minimum, maximum, sum and sum of squares of the finite values written to the branch
+     */
+    StatisticVector &GetBranchStatistics(const std::string &branchName);
+
+    /**
+     *  @brief  Index the whole TTree, including any entries it was appended to, by fileId and by eventNum and hypothesisId combined, so
+     *          that readers can find an event without a scan
+     */
+    void BuildEventIndex() const;
+
+    /**
+     *  @brief  Get the zone map for a branch from the TTree metadata, creating it if required
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return address of the zone map, a list of zones in entry order, each a vector of its first entry, end entry, and the minimum
+     *          and maximum of the finite values in it
+     */
+    TList *GetZoneMap(const std::string &branchName);
+
+    /**
+     *  @brief  Add a leaf-list branch or set its address in advance of the first fill
+     *
+     *  @param  branchName the branch name
+     *  @param  pAddress the address of the data
+     *  @param  leafList the ROOT leaf list
+     *
+     *  @return address of the branch
+     */
+    TBranch *AddLeafListBranch(const std::string &branchName, void *const pAddress, const std::string &leafList) const;
+
     /**
      *  @brief  Push an object to a branch (i.e. cache it in the right place and add the branch if required)
      *
@@ -342,6 +637,19 @@ private:
     const std::decay_t<T> &CacheWrapper(const pandora::ParticleFlowObject *const pPfo, PfoCache<std::decay_t<T>> &cache,
         const std::function<std::decay_t<T>()> &getter) const;
 
+    /**
+     *  @brief  Retrieve a lazy record, running its producer if this is the first request
+     *
+     *  @param  lazyRecordMap the lazy record map
+     *  @param  branchName the branch name
+     *  @param  pParticle optional address of the associated particle
+     *
+     *  @return the record shared pointer, or nullptr if there is no such lazy record
+     */
+    template <typename TPARTICLE>
+    LArBranchPlaceholder::NtupleRecordSPtr GetLazyRecord(
+        const LazyRecordMap<TPARTICLE> &lazyRecordMap, const std::string &branchName, const std::decay_t<TPARTICLE> *const pParticle) const;
+
     /**
      *  @brief  Retrieve a scalar record
      *
@@ -412,24 +720,25 @@ private:
     /**
      *  @brief  Get a track fit, first trying to use the cache
      *
-     *  @param  pandoraInstance the instance of Pandora
+     *  @param  geometryContext the geometry context
      *  @param  pPfo address of the PFO
      *
      *  @return shared pointer to the track fit, or nullptr if fit fails
      */
-    const LArNtupleHelper::TrackFitSharedPtr &GetTrackFit(const pandora::Pandora &pandoraInstance, const pandora::ParticleFlowObject *const pPfo) const;
+    const LArNtupleHelper::TrackFitSharedPtr &GetTrackFit(
+        const LArGeometryContext &geometryContext, const pandora::ParticleFlowObject *const pPfo) const;
 
     /**
      *  @brief  Calculate a track fit
      *
-     *  @param  pandoraInstance the instance of Pandora
+     *  @param  geometryContext the geometry context
      *  @param  pPfo address of the PFO
      *  @param  slidingFitWindow the sliding fit window
      *
      *  @return shared pointer to the track fit, or nullptr if fit fails
      */
-    LArNtupleHelper::TrackFitSharedPtr CalculateTrackFit(
-        const pandora::Pandora &pandoraInstance, const pandora::ParticleFlowObject *const pPfo, const unsigned int slidingFitWindow) const;
+    LArNtupleHelper::TrackFitSharedPtr CalculateTrackFit(const LArGeometryContext &geometryContext,
+        const pandora::ParticleFlowObject *const pPfo, const unsigned int slidingFitWindow) const;
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -442,6 +751,46 @@ inline const pandora::CaloHitList &LArNtuple::GetAllDownstreamThreeDHits(const p
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+inline const pandora::CaloHit *LArNtuple::GetParentTwoDHit(const pandora::CaloHit *const pThreeDHit) const
+{
+    const auto iter = m_hitPairIndices.find(pThreeDHit);
+
+    if (iter == m_hitPairIndices.end() || m_indexedThreeDHits[iter->second] != pThreeDHit)
+        return nullptr;
+
+    return m_indexedTwoDHits[iter->second];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const pandora::CaloHit *LArNtuple::GetDaughterThreeDHit(const pandora::CaloHit *const pTwoDHit) const
+{
+    const auto iter = m_hitPairIndices.find(pTwoDHit);
+
+    if (iter == m_hitPairIndices.end() || m_indexedTwoDHits[iter->second] != pTwoDHit)
+        return nullptr;
+
+    return m_indexedThreeDHits[iter->second];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline Long64_t LArNtuple::GetCurrentEntry() const
+{
+    return m_pOutputTree->GetEntries();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::size_t LArNtuple::GetCurrentVectorElementIndex(const LArNtupleHelper::VECTOR_BRANCH_TYPE type) const
+{
+    const auto findIter = m_numVectorElements.find(type);
+
+    return (findIter == m_numVectorElements.end()) ? 0UL : findIter->second;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 inline const pandora::CaloHitList &LArNtuple::GetAllDownstreamUHits(const pandora::ParticleFlowObject *const pPfo) const
 {
     return this->GetAllDownstreamHitsImpl(pPfo, pandora::TPC_VIEW_U, m_cacheDownstreamUHits);
@@ -545,6 +894,85 @@ inline void LArNtuple::PushVectorToBranch(const std::string &branchName, LArBran
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+template <typename T>
+inline void LArNtuple::PushScalarMatrixToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder) const
+{
+    using T_D = std::decay_t<T>;
+    FlatMatrix<T_D> &flatMatrix = this->GetFlatMatrix<T_D>(branchName, branchPlaceholder, false);
+    LArNtuple::AppendMatrixRows<T_D>(branchPlaceholder.GetNtupleScalarRecord()->Value<std::vector<std::vector<T_D>>>(), flatMatrix);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline void LArNtuple::PushVectorMatrixToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder) const
+{
+    using T_D = std::decay_t<T>;
+    FlatMatrix<T_D> &flatMatrix = this->GetFlatMatrix<T_D>(branchName, branchPlaceholder, true);
+
+    for (const LArBranchPlaceholder::NtupleRecordSPtr &spRecord : branchPlaceholder.GetNtupleVectorRecord())
+    {
+        LArNtuple::AppendMatrixRows<T_D>(spRecord->Value<std::vector<std::vector<T_D>>>(), flatMatrix);
+        flatMatrix.m_elementOffsets.push_back(static_cast<LArNtupleRecord::RUInt>(flatMatrix.m_offsets.size() - 1UL));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+LArNtuple::FlatMatrix<T> &LArNtuple::GetFlatMatrix(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, const bool isVectorBranch) const
+{
+    using T_D = std::decay_t<T>;
+
+    if (m_addressesSet)
+    {
+        std::any *const pCacheElement = branchPlaceholder.CacheElement();
+
+        if (!pCacheElement)
+        {
+            std::cerr << "LArNtuple: Cache element address has not been set" << std::endl;
+            throw pandora::STATUS_CODE_FAILURE;
+        }
+
+        // Reuse the cached object in place, so the branch addresses and the vector capacities carry over between fills
+        FlatMatrix<T_D> &flatMatrix = std::any_cast<FlatMatrix<T_D> &>(*pCacheElement);
+        flatMatrix.m_values.clear();
+        flatMatrix.m_offsets.assign(1UL, 0U);
+        flatMatrix.m_elementOffsets.assign(isVectorBranch ? 1UL : 0UL, 0U);
+
+        return flatMatrix;
+    }
+
+    FlatMatrix<T_D> flatMatrix;
+    flatMatrix.m_offsets.assign(1UL, 0U);
+    flatMatrix.m_elementOffsets.assign(isVectorBranch ? 1UL : 0UL, 0U);
+
+    FlatMatrix<T_D> &cachedFlatMatrix = this->CacheObject(std::move(flatMatrix));
+    branchPlaceholder.CacheElement(&m_cache.back());
+
+    this->AddBranch<std::vector<T_D>>(branchName + "_values", cachedFlatMatrix.m_values, false);
+    this->AddBranch<std::vector<LArNtupleRecord::RUInt>>(branchName + "_offsets", cachedFlatMatrix.m_offsets, false);
+
+    if (isVectorBranch)
+        this->AddBranch<std::vector<LArNtupleRecord::RUInt>>(branchName + "_elementOffsets", cachedFlatMatrix.m_elementOffsets, false);
+
+    return cachedFlatMatrix;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline void LArNtuple::AppendMatrixRows(const std::vector<std::vector<std::decay_t<T>>> &matrix, FlatMatrix<T> &flatMatrix)
+{
+    for (const std::vector<std::decay_t<T>> &row : matrix)
+    {
+        flatMatrix.m_values.insert(flatMatrix.m_values.end(), row.begin(), row.end());
+        flatMatrix.m_offsets.push_back(static_cast<LArNtupleRecord::RUInt>(flatMatrix.m_values.size()));
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 template <typename TOBJ, typename T>
 void LArNtuple::PushToBranch(const std::string &branchName, LArBranchPlaceholder &branchPlaceholder, T &&object, const bool splitMode) const
 {
@@ -592,6 +1020,10 @@ const std::decay_t<T> &LArNtuple::CacheWrapper(
 inline LArBranchPlaceholder::NtupleRecordSPtr LArNtuple::GetVectorRecordElement(
     const LArNtupleHelper::VECTOR_BRANCH_TYPE type, const std::string &branchName, const pandora::ParticleFlowObject *const pPfo) const
 {
+    if (const LArBranchPlaceholder::NtupleRecordSPtr spLazyRecord =
+            this->GetLazyRecord<pandora::ParticleFlowObject>(m_lazyPfoRecords, branchName, pPfo))
+        return spLazyRecord;
+
     return this->GetVectorRecordElementImpl<pandora::ParticleFlowObject>(
         type, branchName, pPfo, [](const LArBranchPlaceholder &branchPlaceholder) { return branchPlaceholder.GetPfoRecordMap(); });
 }
@@ -601,12 +1033,52 @@ inline LArBranchPlaceholder::NtupleRecordSPtr LArNtuple::GetVectorRecordElement(
 inline LArBranchPlaceholder::NtupleRecordSPtr LArNtuple::GetVectorRecordElement(
     const LArNtupleHelper::VECTOR_BRANCH_TYPE type, const std::string &branchName, const pandora::MCParticle *const pMCParticle) const
 {
+    if (const LArBranchPlaceholder::NtupleRecordSPtr spLazyRecord =
+            this->GetLazyRecord<pandora::MCParticle>(m_lazyMCParticleRecords, branchName, pMCParticle))
+        return spLazyRecord;
+
     return this->GetVectorRecordElementImpl<pandora::MCParticle>(type, branchName, pMCParticle,
         [](const LArBranchPlaceholder &branchPlaceholder) { return branchPlaceholder.GetMCParticleRecordMap(); });
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+template <typename TPARTICLE>
+LArBranchPlaceholder::NtupleRecordSPtr LArNtuple::GetLazyRecord(
+    const LazyRecordMap<TPARTICLE> &lazyRecordMap, const std::string &branchName, const std::decay_t<TPARTICLE> *const pParticle) const
+{
+    const auto findIter = lazyRecordMap.find({branchName, pParticle});
+
+    if (findIter == lazyRecordMap.end())
+        return nullptr;
+
+    LazyRecordGroup &lazyRecordGroup = *findIter->second;
+
+    if (!lazyRecordGroup.m_isEvaluated)
+    {
+        // Mark as evaluated first, so a producer that requests its own records fails below rather than recursing
+        lazyRecordGroup.m_isEvaluated = true;
+
+        for (LArNtupleRecord &record : lazyRecordGroup.m_producer())
+        {
+            const std::string recordBranchName(record.BranchName());
+            lazyRecordGroup.m_records.emplace(recordBranchName, std::make_shared<LArNtupleRecord>(std::move(record)));
+        }
+    }
+
+    const auto recordFindIter = lazyRecordGroup.m_records.find(branchName);
+
+    if (recordFindIter == lazyRecordGroup.m_records.end())
+    {
+        std::cerr << "LArNtuple: Lazy record producer did not produce a record for branch '" << branchName << "'" << std::endl;
+        throw pandora::StatusCodeException(pandora::STATUS_CODE_FAILURE);
+    }
+
+    return recordFindIter->second;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 template <typename TPARTICLE>
 LArBranchPlaceholder::NtupleRecordSPtr LArNtuple::GetVectorRecordElementImpl(const LArNtupleHelper::VECTOR_BRANCH_TYPE type,
     const std::string &branchName, const std::decay_t<TPARTICLE> *const pParticle, const RecordMapGetter<std::decay_t<TPARTICLE>> &recordMapGetter) const
@@ -635,10 +1107,10 @@ LArBranchPlaceholder::NtupleRecordSPtr LArNtuple::GetVectorRecordElementImpl(con
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 inline const LArNtupleHelper::TrackFitSharedPtr &LArNtuple::GetTrackFit(
-    const pandora::Pandora &pandoraInstance, const pandora::ParticleFlowObject *const pPfo) const
+    const LArGeometryContext &geometryContext, const pandora::ParticleFlowObject *const pPfo) const
 {
     return this->CacheWrapper<LArNtupleHelper::TrackFitSharedPtr>(
-        pPfo, m_cacheTrackFits, [&]() { return this->CalculateTrackFit(pandoraInstance, pPfo, m_trackSlidingFitWindow); });
+        pPfo, m_cacheTrackFits, [&]() { return this->CalculateTrackFit(geometryContext, pPfo, m_trackSlidingFitWindow); });
 }
 
 } // namespace lar_physics_content
@@ -14,6 +14,10 @@
 #include "TString.h"
 
 #include <cassert>
+#include <iomanip>
+#include <memory>
+#include <optional>
+#include <sstream>
 #include <variant>
 
 namespace lar_physics_content
@@ -52,9 +56,10 @@ public:
         R_ULONG64      = 4U, ///< The ROOT ulong64 type
         R_TSTRING      = 5U, ///< The ROOT TString type
         R_FLOAT_VECTOR = 6U, ///< A vector of ROOT float types
-        R_INT_VECTOR   = 7U  ///< A vector of ROOT int types
-        R_FLOAT_MATRIX = 8U, ///< A 2D matrix of ROOT float types
-        R_INT_MATRIX   = 9U  ///< A 2D matrix of ROOT int types
+        R_INT_VECTOR   = 7U, ///< A vector of ROOT int types
+        R_FLOAT_MATRIX = 8U, ///< A 2D matrix of ROOT float types (written as flat values and row offsets)
+        R_INT_MATRIX   = 9U, ///< A 2D matrix of ROOT int types (written as flat values and row offsets)
+        R_CATEGORY     = 10U ///< A categorical string (written as an integer code into a per-branch dictionary)
     };
 
     using RFloat       = Float_t;              ///< Alias for a ROOT float type
@@ -68,6 +73,89 @@ public:
     using RFloatMatrix = std::vector<std::vector<Float_t>>; ///< Alias for a 2D matrix of ROOT float types
     using RIntMatrix   = std::vector<std::vector<Int_t>>;   ///< Alias for a 2D matrix of ROOT int types
 
+    /**
+     *  @brief  A categorical string, drawn from a fixed vocabulary declared by the producing tool, that is written as its integer index
+     *          into the vocabulary rather than as a string. Every job therefore writes the same codes, so merged ntuples decode correctly
+     */
+    class RCategory
+    {
+    public:
+        using Vocabulary     = std::vector<std::string>;         ///< Alias for a vocabulary of category names, indexed by code
+        using VocabularySPtr = std::shared_ptr<const Vocabulary>; ///< Alias for a shared pointer to a vocabulary
+
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  category the category name
+         *  @param  spVocabulary the vocabulary, which must contain the category name
+         */
+        RCategory(std::string category, VocabularySPtr spVocabulary) noexcept;
+
+        /**
+         *  @brief  Get the category name
+         *
+         *  @return the category name
+         */
+        const std::string &Name() const noexcept;
+
+        /**
+         *  @brief  Get the vocabulary
+         *
+         *  @return the vocabulary
+         */
+        const VocabularySPtr &GetVocabulary() const noexcept;
+
+    private:
+        std::string    m_name;         ///< The category name
+        VocabularySPtr m_spVocabulary; ///< The vocabulary
+    };
+
+    /**
+     *  @brief  A storage precision declaration for float records, written using ROOT's truncated Float16_t storage
+     */
+    class Precision
+    {
+    public:
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  min the lower bound of the stored range (values below are clamped)
+         *  @param  max the upper bound of the stored range (values above are clamped)
+         *  @param  numBits the number of bits used to store each value, in the range [2, 32]
+         */
+        Precision(const RFloat min, const RFloat max, const unsigned int numBits);
+
+        /**
+         *  @brief  Get the ROOT leaf type suffix, e.g. "/f[0,1,16]"
+         *
+         *  @return the leaf type suffix
+         */
+        std::string LeafTypeSuffix() const;
+
+        /**
+         *  @brief  Equality operator
+         *
+         *  @param  other the other precision
+         *
+         *  @return whether the precisions are the same
+         */
+        bool operator==(const Precision &other) const noexcept;
+
+        /**
+         *  @brief  Inequality operator
+         *
+         *  @param  other the other precision
+         *
+         *  @return whether the precisions differ
+         */
+        bool operator!=(const Precision &other) const noexcept;
+
+    private:
+        RFloat       m_min;     ///< The lower bound of the stored range
+        RFloat       m_max;     ///< The upper bound of the stored range
+        unsigned int m_numBits; ///< The number of bits used to store each value
+    };
+
     /**
      *  @brief  Constructor
      *
@@ -79,9 +167,22 @@ public:
                                                            std::is_same_v<std::decay_t<TVALUE>, RBool> || std::is_same_v<std::decay_t<TVALUE>, RUInt> ||
                                                            std::is_same_v<std::decay_t<TVALUE>, RULong64> || std::is_same_v<std::decay_t<TVALUE>, RTString> ||
                                                            std::is_same_v<std::decay_t<TVALUE>, RFloatVector> || std::is_same_v<std::decay_t<TVALUE>, RIntVector> ||
-                                                           std::is_same_v<std::decay_t<TVALUE>, RFloatMatrix> || std::is_same_v<std::decay_t<TVALUE>, RIntMatrix>>>
+                                                           std::is_same_v<std::decay_t<TVALUE>, RFloatMatrix> || std::is_same_v<std::decay_t<TVALUE>, RIntMatrix> ||
+                                                           std::is_same_v<std::decay_t<TVALUE>, RCategory>>>
     LArNtupleRecord(std::string branchName, TVALUE &&value, const bool writeToNtuple = true) noexcept;
 
+    /**
+     *  @brief  Constructor for float records with a declared storage precision
+     *
+     *  @param  branchName the branch name
+     *  @param  value the value
+     *  @param  precision the storage precision
+     *  @param  writeToNtuple whether to write this record to the ntuple
+     */
+    template <typename TVALUE,
+        typename = std::enable_if_t<std::is_same_v<std::decay_t<TVALUE>, RFloat> || std::is_same_v<std::decay_t<TVALUE>, RFloatVector>>>
+    LArNtupleRecord(std::string branchName, TVALUE &&value, const Precision &precision, const bool writeToNtuple = true) noexcept;
+
     /**
      * @brief  Default copy constructor
      */
@@ -172,12 +273,20 @@ protected:
      */
     bool WriteToNtuple() const noexcept;
 
+    /**
+     *  @brief  Get the declared storage precision
+     *
+     *  @return the precision, if one has been declared
+     */
+    const std::optional<Precision> &GetPrecision() const noexcept;
+
     friend class LArNtuple;
     friend class LArBranchPlaceholder;
     friend class NtupleVariableBaseTool;
 
 private:
-    using VariantType = std::variant<RFloat, RInt, RBool, RUInt, RULong64, RTString, RFloatVector, RIntVector, RFloatMatrix, RIntMatrix>; ///< Alias for the variant type
+    using VariantType = std::variant<RFloat, RInt, RBool, RUInt, RULong64, RTString, RFloatVector, RIntVector, RFloatMatrix, RIntMatrix,
+        RCategory>; ///< Alias for the variant type
 
     VALUE_TYPE                         m_valueType;     ///< The value type
     std::string                        m_branchName;    ///< The branch name
@@ -185,6 +294,7 @@ private:
     const pandora::ParticleFlowObject *m_pPfo;          ///< Address of the associated PFO
     const pandora::MCParticle *        m_pMCParticle;   ///< Address of the associated MC particle
     bool                               m_writeToNtuple; ///< Whether to write this record to the ntuple
+    std::optional<Precision>           m_precision;     ///< The declared storage precision, if any
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -197,7 +307,8 @@ LArNtupleRecord::LArNtupleRecord(std::string branchName, TVALUE &&value, const b
     m_value(value),
     m_pPfo(nullptr),
     m_pMCParticle(nullptr),
-    m_writeToNtuple(writeToNtuple)
+    m_writeToNtuple(writeToNtuple),
+    m_precision()
 {
     using TVALUE_D = std::decay_t<TVALUE>;
 
@@ -231,12 +342,24 @@ LArNtupleRecord::LArNtupleRecord(std::string branchName, TVALUE &&value, const b
     else if (std::is_same_v<TVALUE_D, RIntMatrix>)
         m_valueType = VALUE_TYPE::R_INT_MATRIX;
 
+    else if (std::is_same_v<TVALUE_D, RCategory>)
+        m_valueType = VALUE_TYPE::R_CATEGORY;
+
     else // unreachable
         assert(false && "LArNtupleRecord: Unknown value type");
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+template <typename TVALUE, typename>
+LArNtupleRecord::LArNtupleRecord(std::string branchName, TVALUE &&value, const Precision &precision, const bool writeToNtuple) noexcept :
+    LArNtupleRecord(std::move_if_noexcept(branchName), std::forward<TVALUE>(value), writeToNtuple)
+{
+    m_precision = precision;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 inline const std::string &LArNtupleRecord::BranchName() const noexcept
 {
     return m_branchName;
@@ -320,6 +443,72 @@ inline bool LArNtupleRecord::WriteToNtuple() const noexcept
     return m_writeToNtuple;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::optional<LArNtupleRecord::Precision> &LArNtupleRecord::GetPrecision() const noexcept
+{
+    return m_precision;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArNtupleRecord::RCategory::RCategory(std::string category, VocabularySPtr spVocabulary) noexcept :
+    m_name(std::move(category)),
+    m_spVocabulary(std::move(spVocabulary))
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const std::string &LArNtupleRecord::RCategory::Name() const noexcept
+{
+    return m_name;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const LArNtupleRecord::RCategory::VocabularySPtr &LArNtupleRecord::RCategory::GetVocabulary() const noexcept
+{
+    return m_spVocabulary;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArNtupleRecord::Precision::Precision(const RFloat min, const RFloat max, const unsigned int numBits) :
+    m_min(min),
+    m_max(max),
+    m_numBits(numBits)
+{
+    if (!(m_min < m_max) || m_numBits < 2U || m_numBits > 32U)
+    {
+        std::cerr << "LArNtupleRecord: Invalid precision [" << m_min << ", " << m_max << ", " << m_numBits << "]" << std::endl;
+        throw pandora::StatusCodeException(pandora::STATUS_CODE_INVALID_PARAMETER);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::string LArNtupleRecord::Precision::LeafTypeSuffix() const
+{
+    std::ostringstream suffix;
+    suffix << std::setprecision(9) << "/f[" << m_min << "," << m_max << "," << m_numBits << "]";
+    return suffix.str();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArNtupleRecord::Precision::operator==(const Precision &other) const noexcept
+{
+    return (m_min == other.m_min) && (m_max == other.m_max) && (m_numBits == other.m_numBits);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool LArNtupleRecord::Precision::operator!=(const Precision &other) const noexcept
+{
+    return !(*this == other);
+}
+
 } // namespace lar_physics_content
 
 #endif // #ifndef LAR_NTUPLE_RECORD_H
\ No newline at end of file
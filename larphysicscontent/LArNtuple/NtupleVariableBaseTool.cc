@@ -36,12 +36,67 @@ NtupleVariableBaseTool::NtupleVariableBaseTool() noexcept :
     m_pAlgorithm(nullptr),
     m_spPlotsRegistry(nullptr),
     m_spTmpRegistry(nullptr),
-    m_isSetup(false)
+    m_spGeometryContext(nullptr),
+    m_isSetup(false),
+    m_processEvents(true),
+    m_processNeutrinos(true),
+    m_processPrimaries(true),
+    m_processCosmicRays(true),
+    m_lazyRecordProducers()
 {
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+StatusCode NtupleVariableBaseTool::ReadSettings(const TiXmlHandle xmlHandle)
+{
+    // Optionally restrict the categories the tool is run for; its branches are then absent for the other categories
+    StringVector categories;
+    PANDORA_RETURN_RESULT_IF_AND_IF(
+        STATUS_CODE_SUCCESS, STATUS_CODE_NOT_FOUND, !=, XmlHelper::ReadVectorOfValues(xmlHandle, "Categories", categories));
+
+    if (categories.empty())
+        return STATUS_CODE_SUCCESS;
+
+    m_processEvents     = false;
+    m_processNeutrinos  = false;
+    m_processPrimaries  = false;
+    m_processCosmicRays = false;
+
+    for (const std::string &category : categories)
+    {
+        if (category == "event")
+            m_processEvents = true;
+
+        else if (category == "neutrino")
+            m_processNeutrinos = true;
+
+        else if (category == "primary")
+            m_processPrimaries = true;
+
+        else if (category == "cosmic")
+            m_processCosmicRays = true;
+
+        else
+        {
+            std::cerr << "NtupleVariableBaseTool: Unknown category '" << category << "', expected event, neutrino, primary or cosmic"
+                      << std::endl;
+            return STATUS_CODE_INVALID_PARAMETER;
+        }
+    }
+
+    return STATUS_CODE_SUCCESS;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void NtupleVariableBaseTool::AddLazyRecords(const StringVector &branchNames, LArNtupleHelper::RecordProducer producer)
+{
+    m_lazyRecordProducers.emplace_back(branchNames, std::move(producer));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 const CaloHitList &NtupleVariableBaseTool::GetAllDownstreamThreeDHits(const ParticleFlowObject *const pPfo) const
 {
     if (!m_spNtuple)
@@ -128,7 +183,82 @@ const LArNtupleHelper::TrackFitSharedPtr &NtupleVariableBaseTool::GetTrackFit(co
         throw StatusCodeException(STATUS_CODE_FAILURE);
     }
 
-    return m_spNtuple->GetTrackFit(this->GetPandora(), pPfo);
+    return m_spNtuple->GetTrackFit(this->GetGeometryContext(), pPfo);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const CaloHit *NtupleVariableBaseTool::GetParentTwoDHit(const CaloHit *const pThreeDHit) const
+{
+    if (!m_spNtuple)
+    {
+        std::cerr << "NtupleVariableBaseTool: Could not call ntuple method because no ntuple was set" << std::endl;
+        throw StatusCodeException(STATUS_CODE_FAILURE);
+    }
+
+    return m_spNtuple->GetParentTwoDHit(pThreeDHit);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const CaloHit *NtupleVariableBaseTool::GetDaughterThreeDHit(const CaloHit *const pTwoDHit) const
+{
+    if (!m_spNtuple)
+    {
+        std::cerr << "NtupleVariableBaseTool: Could not call ntuple method because no ntuple was set" << std::endl;
+        throw StatusCodeException(STATUS_CODE_FAILURE);
+    }
+
+    return m_spNtuple->GetDaughterThreeDHit(pTwoDHit);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+Long64_t NtupleVariableBaseTool::GetNtupleEntry() const
+{
+    if (!m_spNtuple)
+    {
+        std::cerr << "NtupleVariableBaseTool: Could not call ntuple method because no ntuple was set" << std::endl;
+        throw StatusCodeException(STATUS_CODE_FAILURE);
+    }
+
+    return m_spNtuple->GetCurrentEntry();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::size_t NtupleVariableBaseTool::GetVectorElementIndex(const LArNtupleHelper::VECTOR_BRANCH_TYPE type) const
+{
+    if (!m_spNtuple)
+    {
+        std::cerr << "NtupleVariableBaseTool: Could not call ntuple method because no ntuple was set" << std::endl;
+        throw StatusCodeException(STATUS_CODE_FAILURE);
+    }
+
+    return m_spNtuple->GetCurrentVectorElementIndex(type);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool NtupleVariableBaseTool::IsEnabledFor(const LArNtupleHelper::VECTOR_BRANCH_TYPE type) const
+{
+    switch (type)
+    {
+        case LArNtupleHelper::VECTOR_BRANCH_TYPE::NEUTRINO:
+            return m_processNeutrinos;
+
+        case LArNtupleHelper::VECTOR_BRANCH_TYPE::PRIMARY:
+            return m_processPrimaries;
+
+        case LArNtupleHelper::VECTOR_BRANCH_TYPE::COSMIC_RAY:
+            return m_processCosmicRays;
+
+        default:
+            break;
+    }
+
+    std::cerr << "NtupleVariableBaseTool: Tools are not run for vector branch type " << static_cast<unsigned>(type) << std::endl;
+    throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -156,11 +286,15 @@ std::vector<LArNtupleRecord> NtupleVariableBaseTool::ProcessEventWrapper(const A
     if (PandoraContentApi::GetSettings(*pAlgorithm)->ShouldDisplayAlgorithmInfo())
         std::cout << "----> Running Algorithm Tool: " << this->GetInstanceName() << ", " << this->GetType() << std::endl;
 
+    m_lazyRecordProducers.clear();
     std::vector<LArNtupleRecord> records = this->ProcessEvent(pfoList, eventValidationInfo);
 
     for (LArNtupleRecord &record : records)
         record.AddBranchNamePrefix(m_eventPrefix);
 
+    std::vector<LArNtupleRecord> lazyRecords = this->RegisterLazyRecords(m_eventPrefix, nullptr, nullptr);
+    records.insert(records.end(), std::make_move_iterator(lazyRecords.begin()), std::make_move_iterator(lazyRecords.end()));
+
     return records;
 }
 
@@ -203,6 +337,7 @@ std::vector<LArNtupleRecord> NtupleVariableBaseTool::ProcessImpl(const AnalysisN
         std::cout << "----> Running Algorithm Tool: " << this->GetInstanceName() << ", " << this->GetType() << std::endl;
 
     // Add the prefix and particles to the records
+    m_lazyRecordProducers.clear();
     std::vector<LArNtupleRecord> records = processor();
 
     for (LArNtupleRecord &record : records)
@@ -216,11 +351,55 @@ std::vector<LArNtupleRecord> NtupleVariableBaseTool::ProcessImpl(const AnalysisN
             record.SetMCParticle(pMcParticle);
     }
 
+    std::vector<LArNtupleRecord> lazyRecords = this->RegisterLazyRecords(prefix, pPfo, pMcParticle);
+    records.insert(records.end(), std::make_move_iterator(lazyRecords.begin()), std::make_move_iterator(lazyRecords.end()));
+
     return records;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+std::vector<LArNtupleRecord> NtupleVariableBaseTool::RegisterLazyRecords(
+    const std::string &prefix, const ParticleFlowObject *const pPfo, const MCParticle *const pMcParticle)
+{
+    std::vector<LArNtupleRecord> selectedRecords;
+
+    for (auto &[branchNames, producer] : m_lazyRecordProducers)
+    {
+        StringVector prefixedBranchNames;
+
+        for (const std::string &branchName : branchNames)
+            prefixedBranchNames.push_back(prefix + branchName);
+
+        // Wrap the producer so its records look the same as those returned directly from the process methods
+        LArNtupleHelper::RecordProducer prefixedProducer = [prefix, pPfo, pMcParticle, producer = std::move(producer)]() {
+            std::vector<LArNtupleRecord> records = producer();
+
+            for (LArNtupleRecord &record : records)
+            {
+                record.AddBranchNamePrefix(prefix);
+
+                if (pPfo)
+                    record.SetPfo(pPfo);
+
+                if (pMcParticle)
+                    record.SetMCParticle(pMcParticle);
+            }
+
+            return records;
+        };
+
+        std::vector<LArNtupleRecord> records =
+            m_spNtuple->AddLazyRecords(prefixedBranchNames, pPfo, pMcParticle, std::move(prefixedProducer));
+        selectedRecords.insert(selectedRecords.end(), std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
+    }
+
+    m_lazyRecordProducers.clear();
+    return selectedRecords;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 void NtupleVariableBaseTool::Setup(std::shared_ptr<LArNtuple> spNtuple, const pandora::Algorithm *const pAlgorithm,
     pandora::CartesianVector fiducialRegion1MinCoords, pandora::CartesianVector fiducialRegion1MaxCoords,
     pandora::CartesianVector fiducialRegion2MinCoords, pandora::CartesianVector fiducialRegion2MaxCoords,
@@ -245,6 +424,19 @@ void NtupleVariableBaseTool::Setup(std::shared_ptr<LArNtuple> spNtuple, const pa
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+void NtupleVariableBaseTool::SetGeometryContext(std::shared_ptr<const LArGeometryContext> spGeometryContext)
+{
+    if (!spGeometryContext)
+    {
+        std::cerr << "NtupleVariableBaseTool: Cannot set a null geometry context" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    m_spGeometryContext = std::move(spGeometryContext);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 LArBranchPlaceholder::NtupleRecordSPtr NtupleVariableBaseTool::GetScalarRecord(const std::string &branchName) const
 {
     if (!m_spNtuple)
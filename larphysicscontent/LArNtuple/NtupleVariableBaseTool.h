@@ -13,6 +13,7 @@
 #include "larphysicscontent/LArHelpers/LArAnalysisHelper.h"
 #include "larphysicscontent/LArHelpers/LArNtupleHelper.h"
 #include "larphysicscontent/LArNtuple/LArBranchPlaceholder.h"
+#include "larphysicscontent/LArObjects/LArGeometryContext.h"
 #include "larphysicscontent/LArObjects/LArInteractionValidationInfo.h"
 #include "larphysicscontent/LArObjects/LArRootRegistry.h"
 
@@ -74,7 +75,14 @@ public:
     virtual ~NtupleVariableBaseTool() = default;
 
 protected:
-    pandora::StatusCode ReadSettings(const pandora::TiXmlHandle);
+    /**
+     *  @brief  Read the settings common to all ntuple tools - to be called by derived tools
+     *
+     *  @param  xmlHandle the XML handle
+     *
+     *  @return status code
+     */
+    pandora::StatusCode ReadSettings(const pandora::TiXmlHandle xmlHandle);
 
     /**
      *  @brief  Prepare an event - to be overriden
@@ -133,6 +141,15 @@ protected:
     virtual std::vector<LArNtupleRecord> ProcessCosmicRay(const pandora::ParticleFlowObject *const pPfo, const pandora::PfoList &pfoList,
         const std::shared_ptr<LArMCTargetValidationInfo> &spMcTarget);
 
+    /**
+     *  @brief  Add a group of lazily-evaluated records for the event or particle being processed. The producer is run at most once, and
+     *          only if one of the branches is selected for output or one of the records is requested by a tool
+     *
+     *  @param  branchNames the unprefixed names of the branches the producer populates
+     *  @param  producer the record producer, which must only capture objects that live until the end of the event
+     */
+    void AddLazyRecords(const pandora::StringVector &branchNames, LArNtupleHelper::RecordProducer producer);
+
     /**
      *  @brief  Get all the downstream 3D hits of a PFO, including from the PFO itself (from the cache if possible)
      *
@@ -196,6 +213,40 @@ protected:
      */
     const LArNtupleHelper::TrackFitSharedPtr &GetTrackFit(const pandora::ParticleFlowObject *const pPfo) const;
 
+    /**
+     *  @brief  Get the parent 2D hit of a 3D hit (from the per-event hit index)
+     *
+     *  @param  pThreeDHit address of the 3D hit
+     *
+     *  @return address of the parent 2D hit, or nullptr if there is none
+     */
+    const pandora::CaloHit *GetParentTwoDHit(const pandora::CaloHit *const pThreeDHit) const;
+
+    /**
+     *  @brief  Get the 3D hit created from a 2D hit (from the per-event hit index)
+     *
+     *  @param  pTwoDHit address of the 2D hit
+     *
+     *  @return address of the 3D hit, or nullptr if there is none
+     */
+    const pandora::CaloHit *GetDaughterThreeDHit(const pandora::CaloHit *const pTwoDHit) const;
+
+    /**
+     *  @brief  Get the ntuple entry number at which the current event will be filled
+     *
+     *  @return the entry number
+     */
+    Long64_t GetNtupleEntry() const;
+
+    /**
+     *  @brief  Get the index that the particle being processed will have in the vector branches of its type
+     *
+     *  @param  type the vector branch type
+     *
+     *  @return the vector element index
+     */
+    std::size_t GetVectorElementIndex(const LArNtupleHelper::VECTOR_BRANCH_TYPE type) const;
+
     /**
      *  @brief  Retrieve an event record
      *
@@ -324,25 +375,63 @@ protected:
      */
     const std::shared_ptr<LArRootRegistry> &GetTmpRegistry() const noexcept;
 
+    /**
+     *  @brief  Get the per-run geometry context, to use in place of the Pandora geometry API
+     *
+     *  @return the geometry context
+     */
+    const LArGeometryContext &GetGeometryContext() const;
+
+    /**
+     *  @brief  Whether the tool is run for a category of particle
+     *
+     *  @param  type the vector branch type of the category
+     *
+     *  @return whether the tool is run for the category
+     */
+    bool IsEnabledFor(const LArNtupleHelper::VECTOR_BRANCH_TYPE type) const;
+
     friend class AnalysisNtupleAlgorithm;
 
 private:
     using Processor = std::function<std::vector<LArNtupleRecord>()>; ///< Alias for a function to process a PFO
+    using LazyRecordProducers =
+        std::vector<std::pair<pandora::StringVector, LArNtupleHelper::RecordProducer>>; ///< Alias for a vector of lazy record producers
+
+    std::shared_ptr<LArNtuple>                m_spNtuple;                 ///< Shared pointer to the ntuple
+    std::string                               m_eventPrefix;              ///< The event prefix
+    std::string                               m_neutrinoPrefix;           ///< The neutrino prefix
+    std::string                               m_primaryPrefix;            ///< The primary prefix
+    std::string                               m_particlePrefix;           ///< The particle prefix
+    std::string                               m_cosmicPrefix;             ///< The cosmic prefix
+    pandora::CartesianVector                  m_fiducialRegion1MinCoords; ///< The minimum fiducial coordinates of region 1
+    pandora::CartesianVector                  m_fiducialRegion1MaxCoords; ///< The maximum fiducial coordinates of region 1
+    pandora::CartesianVector                  m_fiducialRegion2MinCoords; ///< The minimum fiducial coordinates of region 2
+    pandora::CartesianVector                  m_fiducialRegion2MaxCoords; ///< The maximum fiducial coordinates of region 2
+    const pandora::Algorithm *                m_pAlgorithm;               ///< The address of the calling algorithm
+    std::shared_ptr<LArRootRegistry>          m_spPlotsRegistry;          ///< The plots ROOT registry
+    std::shared_ptr<LArRootRegistry>          m_spTmpRegistry;            ///< The tmp ROOT registry
+    std::shared_ptr<const LArGeometryContext> m_spGeometryContext;        ///< The per-run geometry context
+    bool                                      m_isSetup;                  ///< Whether the tool has been set up.
+    bool                                      m_processEvents;            ///< Whether the tool is run for events
+    bool                                      m_processNeutrinos;         ///< Whether the tool is run for neutrinos
+    bool                                      m_processPrimaries;         ///< Whether the tool is run for primaries
+    bool                                      m_processCosmicRays;        ///< Whether the tool is run for cosmic rays
+    LazyRecordProducers                       m_lazyRecordProducers;      ///< The lazy record producers added by the current process call
 
-    std::shared_ptr<LArNtuple>       m_spNtuple;                 ///< Shared pointer to the ntuple
-    std::string                      m_eventPrefix;              ///< The event prefix
-    std::string                      m_neutrinoPrefix;           ///< The neutrino prefix
-    std::string                      m_primaryPrefix;            ///< The primary prefix
-    std::string                      m_particlePrefix;           ///< The particle prefix
-    std::string                      m_cosmicPrefix;             ///< The cosmic prefix
-    pandora::CartesianVector         m_fiducialRegion1MinCoords; ///< The minimum fiducial coordinates of region 1
-    pandora::CartesianVector         m_fiducialRegion1MaxCoords; ///< The maximum fiducial coordinates of region 1
-    pandora::CartesianVector         m_fiducialRegion2MinCoords; ///< The minimum fiducial coordinates of region 2
-    pandora::CartesianVector         m_fiducialRegion2MaxCoords; ///< The maximum fiducial coordinates of region 2
-    const pandora::Algorithm *       m_pAlgorithm;               ///< The address of the calling algorithm
-    std::shared_ptr<LArRootRegistry> m_spPlotsRegistry;          ///< The plots ROOT registry
-    std::shared_ptr<LArRootRegistry> m_spTmpRegistry;            ///< The tmp ROOT registry
-    bool                             m_isSetup;                  ///< Whether the tool has been set up.
+    /**
+     *  @brief  Whether the tool is run for events
+     *
+     *  @return whether the tool is run for events
+     */
+    bool IsEnabledForEvents() const noexcept;
+
+    /**
+     *  @brief  Whether the tool is run for any category
+     *
+     *  @return whether the tool is run for any category
+     */
+    bool IsEnabledForAny() const noexcept;
 
     /**
      *  @brief  Prepare an event (wrapper method)
@@ -419,6 +508,18 @@ private:
     std::vector<LArNtupleRecord> ProcessImpl(const AnalysisNtupleAlgorithm *const pAlgorithm, const std::string &prefix,
         const pandora::ParticleFlowObject *const pPfo, const pandora::MCParticle *const pMcParticle, const Processor &processor);
 
+    /**
+     *  @brief  Hand the lazy record producers added by the last process call to the ntuple
+     *
+     *  @param  prefix the prefix to apply to branch names
+     *  @param  pPfo optional address of the PFO
+     *  @param  pMcParticle optional address of the MC particle
+     *
+     *  @return the lazy records selected for output
+     */
+    std::vector<LArNtupleRecord> RegisterLazyRecords(
+        const std::string &prefix, const pandora::ParticleFlowObject *const pPfo, const pandora::MCParticle *const pMcParticle);
+
     /**
      *  @brief  Set the ntuple shared pointer
      *
@@ -436,6 +537,13 @@ private:
         pandora::CartesianVector fiducialRegion2MinCoords, pandora::CartesianVector fiducialRegion2MaxCoords,
         std::shared_ptr<LArRootRegistry> spPlotsRegistry, std::shared_ptr<LArRootRegistry> spTmpRegistry);
 
+    /**
+     *  @brief  Set the per-run geometry context
+     *
+     *  @param  spGeometryContext shared pointer to the geometry context
+     */
+    void SetGeometryContext(std::shared_ptr<const LArGeometryContext> spGeometryContext);
+
     /**
      *  @brief  Get a scalar record
      *
@@ -473,13 +581,6 @@ private:
 //------------------------------------------------------------------------------------------------------------------------------------------
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-inline pandora::StatusCode NtupleVariableBaseTool::ReadSettings(const pandora::TiXmlHandle)
-{
-    return pandora::STATUS_CODE_SUCCESS;
-}
-
-//------------------------------------------------------------------------------------------------------------------------------------------
-
 inline void NtupleVariableBaseTool::PrepareEvent(const pandora::PfoList &, const std::vector<std::shared_ptr<LArInteractionValidationInfo>> &)
 {
 }
@@ -644,6 +745,20 @@ const std::decay_t<T> &NtupleVariableBaseTool::GetNeutrinoRecord(const std::stri
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+inline bool NtupleVariableBaseTool::IsEnabledForEvents() const noexcept
+{
+    return m_processEvents;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline bool NtupleVariableBaseTool::IsEnabledForAny() const noexcept
+{
+    return m_processEvents || m_processNeutrinos || m_processPrimaries || m_processCosmicRays;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 inline bool NtupleVariableBaseTool::IsPointFiducial(const pandora::CartesianVector &point) const
 {
     return LArAnalysisHelper::IsPointFiducial(point, m_fiducialRegion1MinCoords, m_fiducialRegion1MaxCoords) ||
@@ -671,6 +786,19 @@ inline const std::shared_ptr<LArRootRegistry> &NtupleVariableBaseTool::GetTmpReg
     return m_spTmpRegistry;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const LArGeometryContext &NtupleVariableBaseTool::GetGeometryContext() const
+{
+    if (!m_spGeometryContext)
+    {
+        std::cerr << "NtupleVariableBaseTool: No geometry context was set" << std::endl;
+        throw pandora::StatusCodeException(pandora::STATUS_CODE_NOT_INITIALIZED);
+    }
+
+    return *m_spGeometryContext;
+}
+
 } // namespace lar_physics_content
 
 #endif // #ifndef LAR_NTUPLE_VARIABLE_BASE_TOOL_H
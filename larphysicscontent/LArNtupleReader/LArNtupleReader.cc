@@ -0,0 +1,516 @@
+/**
+ *  @file   larphysicscontent/LArNtupleReader/LArNtupleReader.cc
+ *
+ *  @brief  Implementation of the lar ntuple reader class.
+ *
+ *  $Log: $
+ */
+
+#include "larphysicscontent/LArNtupleReader/LArNtupleReader.h"
+
+#include "RVersion.h"
+#include "TBranchElement.h"
+#include "TLeaf.h"
+#include "TList.h"
+#include "TMath.h"
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+#include "ROOT/TBulkBranchRead.hxx"
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+
+/**
+ *  @brief  Report a reader error and throw it. The reader only needs ROOT, so it throws standard exceptions rather than Pandora status
+ *          codes
+ *
+ *  @param  message the error message
+ */
+[[noreturn]] void ThrowReaderError(const std::string &message)
+{
+    std::cerr << "LArNtupleReader: " << message << std::endl;
+    throw std::runtime_error("LArNtupleReader: " + message);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  Convert a value read through a leaf to the type of its column
+ *
+ *  @param  pLeaf address of the leaf
+ *  @param  index the index of the value in the leaf
+ *
+ *  @return the value
+ */
+template <typename T>
+T GetLeafValue(TLeaf *const pLeaf, const Int_t index)
+{
+    return static_cast<T>(pLeaf->GetValueLong64(index));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+Float_t GetLeafValue<Float_t>(TLeaf *const pLeaf, const Int_t index)
+{
+    return static_cast<Float_t>(pLeaf->GetValue(index));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+Bool_t GetLeafValue<Bool_t>(TLeaf *const pLeaf, const Int_t index)
+{
+    return pLeaf->GetValueLong64(index) != 0LL;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+namespace lar_physics_content
+{
+
+template <typename T>
+void LArNtupleReader::BindVectorBranch(Column &column)
+{
+    const std::shared_ptr<std::vector<T>> spVector(std::make_shared<std::vector<T>>());
+
+    column.m_spObject = spVector;
+    column.m_pObject  = spVector.get();
+    column.m_pBranch->SetAddress(&column.m_pObject);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+void LArNtupleReader::AppendBoundVector(Column &column)
+{
+    const std::vector<T> &values = *static_cast<const std::vector<T> *>(column.m_pObject);
+
+    LArNtupleReader::AppendValues(column, values.data(), values.size());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+void LArNtupleReader::AppendBoundVector<bool>(Column &column)
+{
+    // The bits of a vector<bool> are not addressable, so they are widened to Bool_t one at a time
+    const std::vector<bool> &values = *static_cast<const std::vector<bool> *>(column.m_pObject);
+
+    for (const bool value : values)
+    {
+        const Bool_t widenedValue(value);
+        LArNtupleReader::AppendValues(column, &widenedValue, 1UL);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtupleReader::Schema LArNtupleReader::ReadSchema(TTree *const pTree)
+{
+    if (!pTree)
+        ThrowReaderError("Cannot read the schema of a null tree");
+
+    Schema schema;
+
+    for (TObject *const pObject : *pTree->GetListOfBranches())
+        schema.push_back(LArNtupleReader::DescribeBranch(pTree, static_cast<TBranch *>(pObject)));
+
+    return schema;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtupleReader::LArNtupleReader(TTree *const pTree, const std::vector<std::string> &branchNames, const Long64_t cacheSize) :
+    m_pTree{pTree},
+    m_columns{},
+    m_firstEntry{0LL},
+    m_endEntry{0LL},
+    m_bulkBuffer{TBuffer::kWrite, 10000}
+{
+    if (!m_pTree)
+        ThrowReaderError("Cannot read a null tree");
+
+    if (m_pTree->InheritsFrom("TChain"))
+        ThrowReaderError("Chains are not supported, so read each tree of " + std::string(m_pTree->GetName()) + " with its own reader");
+
+    // Only the columns being read go into the cache, so it is filled from the start rather than after a learning phase
+    m_pTree->SetCacheSize(cacheSize);
+
+    for (const std::string &branchName : branchNames)
+    {
+        TBranch *const pBranch = m_pTree->GetBranch(branchName.c_str());
+
+        if (!pBranch)
+            ThrowReaderError("Tree " + std::string(m_pTree->GetName()) + " has no branch " + branchName);
+
+        const ColumnSchema schema(LArNtupleReader::DescribeBranch(m_pTree, pBranch));
+
+        if (schema.m_elementType == ELEMENT_TYPE::UNSUPPORTED || schema.m_shape == COLUMN_SHAPE::UNSUPPORTED)
+            ThrowReaderError("Branch " + branchName + " does not have a supported type");
+
+        bool useBulkRead(false);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+        useBulkRead = (schema.m_shape == COLUMN_SHAPE::SCALAR) && pBranch->SupportsBulkRead();
+#endif
+        m_columns.push_back(Column{schema, pBranch, useBulkRead, nullptr, nullptr, {}, {}});
+        m_pTree->AddBranchToCache(pBranch, kFALSE);
+
+        if (TLeaf *const pLeafCount = static_cast<TLeaf *>(pBranch->GetListOfLeaves()->First())->GetLeafCount())
+            m_pTree->AddBranchToCache(pLeafCount->GetBranch(), kFALSE);
+    }
+
+    m_pTree->StopCacheLearningPhase();
+
+    // The columns are bound only now, as the branches keep the addresses of the column members
+    for (Column &column : m_columns)
+    {
+        if (!dynamic_cast<TBranchElement *>(column.m_pBranch))
+            continue;
+
+        switch (column.m_schema.m_elementType)
+        {
+            case ELEMENT_TYPE::FLOAT:
+                LArNtupleReader::BindVectorBranch<Float_t>(column);
+                break;
+            case ELEMENT_TYPE::INT:
+                LArNtupleReader::BindVectorBranch<Int_t>(column);
+                break;
+            case ELEMENT_TYPE::UINT:
+                LArNtupleReader::BindVectorBranch<UInt_t>(column);
+                break;
+            case ELEMENT_TYPE::BOOL:
+                LArNtupleReader::BindVectorBranch<bool>(column);
+                break;
+            case ELEMENT_TYPE::ULONG64:
+                LArNtupleReader::BindVectorBranch<ULong64_t>(column);
+                break;
+            case ELEMENT_TYPE::UNSUPPORTED:
+            default:
+                ThrowReaderError("Branch " + column.m_schema.m_name + " does not have a supported type");
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtupleReader::~LArNtupleReader()
+{
+    for (Column &column : m_columns)
+    {
+        if (column.m_pObject)
+            column.m_pBranch->ResetAddress();
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtupleReader::EntryRangeVector LArNtupleReader::GetClusterRanges() const
+{
+    EntryRangeVector        clusterRanges;
+    const Long64_t          numEntries(m_pTree->GetEntries());
+    TTree::TClusterIterator clusterIter(m_pTree->GetClusterIterator(0LL));
+    Long64_t                firstEntry(0LL);
+
+    while ((firstEntry = clusterIter()) < numEntries)
+        clusterRanges.emplace_back(firstEntry, std::min(clusterIter.GetNextEntry(), numEntries));
+
+    return clusterRanges;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtupleReader::ReadEntries(const Long64_t firstEntry, const Long64_t endEntry)
+{
+    if (firstEntry < 0LL || endEntry < firstEntry || endEntry > m_pTree->GetEntries())
+    {
+        ThrowReaderError("Entries " + std::to_string(firstEntry) + " to " + std::to_string(endEntry) + " are not in tree " +
+            m_pTree->GetName());
+    }
+
+    m_firstEntry = firstEntry;
+    m_endEntry   = endEntry;
+    m_pTree->SetCacheEntryRange(firstEntry, endEntry);
+
+    for (Column &column : m_columns)
+    {
+        const bool isVector(column.m_schema.m_shape == COLUMN_SHAPE::VECTOR);
+
+        column.m_values.clear();
+        column.m_offsets.clear();
+
+        if (isVector)
+            column.m_offsets.push_back(0UL);
+
+        if (column.m_useBulkRead)
+        {
+            this->ReadBulkColumn(column);
+            continue;
+        }
+
+        for (Long64_t entry = firstEntry; entry < endEntry; ++entry)
+        {
+            if (column.m_pBranch->GetEntry(entry) < 0)
+                ThrowReaderError("Failed to read entry " + std::to_string(entry) + " of branch " + column.m_schema.m_name);
+
+            switch (column.m_pObject ? column.m_schema.m_elementType : ELEMENT_TYPE::UNSUPPORTED)
+            {
+                case ELEMENT_TYPE::FLOAT:
+                    LArNtupleReader::AppendBoundVector<Float_t>(column);
+                    break;
+                case ELEMENT_TYPE::INT:
+                    LArNtupleReader::AppendBoundVector<Int_t>(column);
+                    break;
+                case ELEMENT_TYPE::UINT:
+                    LArNtupleReader::AppendBoundVector<UInt_t>(column);
+                    break;
+                case ELEMENT_TYPE::BOOL:
+                    LArNtupleReader::AppendBoundVector<bool>(column);
+                    break;
+                case ELEMENT_TYPE::ULONG64:
+                    LArNtupleReader::AppendBoundVector<ULong64_t>(column);
+                    break;
+                case ELEMENT_TYPE::UNSUPPORTED:
+                default:
+                    LArNtupleReader::AppendLeafValues(column);
+                    break;
+            }
+
+            if (isVector)
+                column.m_offsets.push_back(column.m_values.size() / LArNtupleReader::GetElementSize(column.m_schema.m_elementType));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const LArNtupleReader::ColumnSchema &LArNtupleReader::GetColumnSchema(const std::string &branchName) const
+{
+    for (const Column &column : m_columns)
+    {
+        if (column.m_schema.m_name == branchName)
+            return column.m_schema;
+    }
+
+    ThrowReaderError("Branch " + branchName + " is not being read");
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtupleReader::OffsetSpan LArNtupleReader::GetVectorOffsets(const std::string &branchName) const
+{
+    const ColumnSchema &schema = this->GetColumnSchema(branchName);
+    const Column       &column = this->GetColumn(branchName, COLUMN_SHAPE::VECTOR, schema.m_elementType);
+
+    return OffsetSpan(column.m_offsets.data(), column.m_offsets.size());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArNtupleReader::ColumnSchema LArNtupleReader::DescribeBranch(TTree *const pTree, TBranch *const pBranch)
+{
+    const std::string branchName(pBranch->GetName());
+    const bool        isCategory(pTree->GetUserInfo()->FindObject((branchName + "_categories").c_str()) != nullptr);
+    ColumnSchema      schema{branchName, ELEMENT_TYPE::UNSUPPORTED, COLUMN_SHAPE::UNSUPPORTED, isCategory};
+
+    if (const TBranchElement *const pBranchElement = dynamic_cast<const TBranchElement *>(pBranch))
+    {
+        const std::string className(pBranchElement->GetClassName());
+        schema.m_shape = COLUMN_SHAPE::VECTOR;
+
+        if (className == "vector<float>")
+            schema.m_elementType = ELEMENT_TYPE::FLOAT;
+
+        else if (className == "vector<int>")
+            schema.m_elementType = ELEMENT_TYPE::INT;
+
+        else if (className == "vector<unsigned int>")
+            schema.m_elementType = ELEMENT_TYPE::UINT;
+
+        else if (className == "vector<bool>")
+            schema.m_elementType = ELEMENT_TYPE::BOOL;
+
+        else if (className == "vector<ULong64_t>" || className == "vector<unsigned long long>")
+            schema.m_elementType = ELEMENT_TYPE::ULONG64;
+
+        else
+            schema.m_shape = COLUMN_SHAPE::UNSUPPORTED;
+
+        return schema;
+    }
+
+    // Leaf-list branches written by the ntuple hold a single leaf, with a count leaf if the branch holds a variable-length array
+    if (pBranch->GetListOfLeaves()->GetEntries() != 1)
+        return schema;
+
+    const TLeaf *const pLeaf = static_cast<const TLeaf *>(pBranch->GetListOfLeaves()->First());
+    const std::string  typeName(pLeaf->GetTypeName());
+
+    if (typeName == "Float_t" || typeName == "Float16_t")
+        schema.m_elementType = ELEMENT_TYPE::FLOAT;
+
+    else if (typeName == "Int_t")
+        schema.m_elementType = ELEMENT_TYPE::INT;
+
+    else if (typeName == "UInt_t")
+        schema.m_elementType = ELEMENT_TYPE::UINT;
+
+    else if (typeName == "Bool_t")
+        schema.m_elementType = ELEMENT_TYPE::BOOL;
+
+    else if (typeName == "ULong64_t")
+        schema.m_elementType = ELEMENT_TYPE::ULONG64;
+
+    else
+        return schema;
+
+    schema.m_shape = (pLeaf->GetLeafCount() || pLeaf->GetLenStatic() > 1) ? COLUMN_SHAPE::VECTOR : COLUMN_SHAPE::SCALAR;
+
+    return schema;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::size_t LArNtupleReader::GetElementSize(const ELEMENT_TYPE elementType)
+{
+    switch (elementType)
+    {
+        case ELEMENT_TYPE::FLOAT:
+            return sizeof(Float_t);
+        case ELEMENT_TYPE::INT:
+            return sizeof(Int_t);
+        case ELEMENT_TYPE::UINT:
+            return sizeof(UInt_t);
+        case ELEMENT_TYPE::BOOL:
+            return sizeof(Bool_t);
+        case ELEMENT_TYPE::ULONG64:
+            return sizeof(ULong64_t);
+        case ELEMENT_TYPE::UNSUPPORTED:
+        default:
+            ThrowReaderError("Unsupported columns have no element size");
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+const LArNtupleReader::Column &LArNtupleReader::GetColumn(
+    const std::string &branchName, const COLUMN_SHAPE shape, const ELEMENT_TYPE elementType) const
+{
+    for (const Column &column : m_columns)
+    {
+        if (column.m_schema.m_name != branchName)
+            continue;
+
+        if (column.m_schema.m_shape != shape || column.m_schema.m_elementType != elementType)
+            ThrowReaderError("Branch " + branchName + " was requested with the wrong shape or type");
+
+        return column;
+    }
+
+    ThrowReaderError("Branch " + branchName + " is not being read");
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtupleReader::ReadBulkColumn(Column &column)
+{
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+    const std::size_t elementSize(LArNtupleReader::GetElementSize(column.m_schema.m_elementType));
+    TBranch *const    pBranch = column.m_pBranch;
+    Long64_t          entry(m_firstEntry);
+
+    column.m_values.reserve(this->GetNumEntries() * elementSize);
+
+    while (entry < m_endEntry)
+    {
+        // A bulk read returns the whole basket holding the entry, starting from the first entry of the basket
+        const Long64_t *const basketEntries = pBranch->GetBasketEntry();
+        const Long64_t        basket(TMath::BinarySearch(static_cast<Long64_t>(pBranch->GetWriteBasket() + 1), basketEntries, entry));
+        const Int_t           numBasketEntries(pBranch->GetBulkRead().GetEntriesDeserialized(entry, m_bulkBuffer));
+
+        if (basket < 0LL || numBasketEntries <= 0 || entry < basketEntries[basket] || entry >= basketEntries[basket] + numBasketEntries)
+            ThrowReaderError("Failed to bulk read entry " + std::to_string(entry) + " of branch " + column.m_schema.m_name);
+
+        const Long64_t    endEntry(std::min(basketEntries[basket] + numBasketEntries, m_endEntry));
+        const char *const pFirstValue = m_bulkBuffer.GetCurrent() + (entry - basketEntries[basket]) * elementSize;
+
+        LArNtupleReader::AppendValues(column, pFirstValue, static_cast<std::size_t>(endEntry - entry));
+        entry = endEntry;
+    }
+#else
+    ThrowReaderError("Bulk reads need ROOT 6.20 or later, so branch " + column.m_schema.m_name + " cannot be bulk read");
+#endif
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtupleReader::AppendLeafValues(Column &column)
+{
+    TLeaf *const pLeaf = static_cast<TLeaf *>(column.m_pBranch->GetListOfLeaves()->First());
+    const Int_t  numValues(pLeaf->GetLen());
+
+    for (Int_t index = 0; index < numValues; ++index)
+    {
+        switch (column.m_schema.m_elementType)
+        {
+            case ELEMENT_TYPE::FLOAT:
+            {
+                const Float_t value(GetLeafValue<Float_t>(pLeaf, index));
+                LArNtupleReader::AppendValues(column, &value, 1UL);
+                break;
+            }
+            case ELEMENT_TYPE::INT:
+            {
+                const Int_t value(GetLeafValue<Int_t>(pLeaf, index));
+                LArNtupleReader::AppendValues(column, &value, 1UL);
+                break;
+            }
+            case ELEMENT_TYPE::UINT:
+            {
+                const UInt_t value(GetLeafValue<UInt_t>(pLeaf, index));
+                LArNtupleReader::AppendValues(column, &value, 1UL);
+                break;
+            }
+            case ELEMENT_TYPE::BOOL:
+            {
+                const Bool_t value(GetLeafValue<Bool_t>(pLeaf, index));
+                LArNtupleReader::AppendValues(column, &value, 1UL);
+                break;
+            }
+            case ELEMENT_TYPE::ULONG64:
+            {
+                const ULong64_t value(GetLeafValue<ULong64_t>(pLeaf, index));
+                LArNtupleReader::AppendValues(column, &value, 1UL);
+                break;
+            }
+            case ELEMENT_TYPE::UNSUPPORTED:
+            default:
+                ThrowReaderError("Branch " + column.m_schema.m_name + " does not have a supported type");
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void LArNtupleReader::AppendValues(Column &column, const void *const pValues, const std::size_t numValues)
+{
+    const std::size_t elementSize(LArNtupleReader::GetElementSize(column.m_schema.m_elementType));
+    const std::size_t numBytes(numValues * elementSize);
+
+    if (numBytes == 0UL)
+        return;
+
+    const std::size_t oldSize(column.m_values.size());
+    column.m_values.resize(oldSize + numBytes);
+    std::memcpy(column.m_values.data() + oldSize, pValues, numBytes);
+}
+
+} // namespace lar_physics_content
@@ -0,0 +1,480 @@
+/**
+ *  @file   larphysicscontent/LArNtupleReader/LArNtupleReader.h
+ *
+ *  @brief  Header file for the lar ntuple reader class.
+ *
+ *  $Log: $
+ */
+#ifndef LAR_NTUPLE_READER_H
+#define LAR_NTUPLE_READER_H 1
+
+#include "TBufferFile.h"
+#include "TTree.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lar_physics_content
+{
+
+/**
+ *  @brief  LArColumnSpan class, a read-only view of contiguous column values
+ */
+template <typename T>
+class LArColumnSpan
+{
+public:
+    /**
+     *  @brief  Constructor
+     *
+     *  @param  pData address of the first value
+     *  @param  size the number of values
+     */
+    LArColumnSpan(const T *const pData, const std::size_t size) noexcept;
+
+    /**
+     *  @brief  Get the address of the first value
+     *
+     *  @return address of the first value
+     */
+    const T *begin() const noexcept;
+
+    /**
+     *  @brief  Get the address one past the last value
+     *
+     *  @return address one past the last value
+     */
+    const T *end() const noexcept;
+
+    /**
+     *  @brief  Get the number of values
+     *
+     *  @return the number of values
+     */
+    std::size_t size() const noexcept;
+
+    /**
+     *  @brief  Whether there are no values
+     *
+     *  @return whether there are no values
+     */
+    bool empty() const noexcept;
+
+    /**
+     *  @brief  Get a value
+     *
+     *  @param  index the index of the value
+     *
+     *  @return the value
+     */
+    const T &operator[](const std::size_t index) const noexcept;
+
+private:
+    const T    *m_pData; ///< Address of the first value
+    std::size_t m_size;  ///< The number of values
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  LArNtupleReader class, which reads selected ntuple branches a range of entries at a time into typed, contiguous columns. Scalar
+ *          branches are read a basket at a time through ROOT's bulk I/O where it supports them, and the other branches are read entry by
+ *          entry without TTreeReader proxies. Only ROOT is needed, so macros and standalone executables can link it on its own
+ */
+class LArNtupleReader
+{
+public:
+    /**
+     *  @brief  The type of the values of a column
+     */
+    enum class ELEMENT_TYPE
+    {
+        FLOAT,      ///< Float_t, including floats stored with a declared precision
+        INT,        ///< Int_t, including category codes
+        UINT,       ///< UInt_t
+        BOOL,       ///< Bool_t
+        ULONG64,    ///< ULong64_t
+        UNSUPPORTED ///< Any other type, such as TString or nested vectors
+    };
+
+    /**
+     *  @brief  The number of values of a column in each entry
+     */
+    enum class COLUMN_SHAPE
+    {
+        SCALAR,     ///< One value per entry
+        VECTOR,     ///< A variable number of values per entry, as for per-particle records and flattened matrices
+        UNSUPPORTED ///< Any other shape
+    };
+
+    /**
+     *  @brief  The description of a branch as a column
+     */
+    struct ColumnSchema
+    {
+        std::string  m_name;        ///< The branch name
+        ELEMENT_TYPE m_elementType; ///< The type of the values
+        COLUMN_SHAPE m_shape;       ///< The number of values in each entry
+        bool         m_isCategory;  ///< Whether the values are codes into a category dictionary in the TTree's user info
+    };
+
+    using Schema           = std::vector<ColumnSchema>;         ///< Alias for the column descriptions of a TTree
+    using EntryRange       = std::pair<Long64_t, Long64_t>;     ///< Alias for a range of entries [first, end)
+    using EntryRangeVector = std::vector<EntryRange>;           ///< Alias for a vector of entry ranges
+    using OffsetSpan       = LArColumnSpan<std::size_t>;        ///< Alias for a span of value offsets
+
+    /**
+     *  @brief  Describe every branch of a TTree as a column, from the branch metadata alone
+     *
+     *  @param  pTree address of the TTree
+     *
+     *  @return the schema
+     */
+    static Schema ReadSchema(TTree *const pTree);
+
+    /**
+     *  @brief  Constructor, priming a TTreeCache with the branches to read
+     *
+     *  @param  pTree address of the TTree, which must outlive the reader
+     *  @param  branchNames the names of the branches to read, each of which must have a supported type and shape
+     *  @param  cacheSize the TTreeCache size in bytes
+     */
+    LArNtupleReader(TTree *const pTree, const std::vector<std::string> &branchNames, const Long64_t cacheSize = 64LL << 20);
+
+    /**
+     *  @brief  Deleted copy constructor
+     */
+    LArNtupleReader(const LArNtupleReader &) = delete;
+
+    /**
+     *  @brief  Deleted copy assignment operator
+     */
+    LArNtupleReader &operator=(const LArNtupleReader &) = delete;
+
+    /**
+     *  @brief  Destructor, releasing the branches bound to the reader
+     */
+    ~LArNtupleReader();
+
+    /**
+     *  @brief  Get the entry ranges of the TTree clusters, which are the cheapest ranges to read
+     *
+     *  @return the cluster entry ranges
+     */
+    EntryRangeVector GetClusterRanges() const;
+
+    /**
+     *  @brief  Read a range of entries of every column, replacing the previous range
+     *
+     *  @param  firstEntry the first entry
+     *  @param  endEntry one past the last entry
+     */
+    void ReadEntries(const Long64_t firstEntry, const Long64_t endEntry);
+
+    /**
+     *  @brief  Get the first entry of the range read
+     *
+     *  @return the first entry
+     */
+    Long64_t GetFirstEntry() const noexcept;
+
+    /**
+     *  @brief  Get the number of entries in the range read
+     *
+     *  @return the number of entries
+     */
+    std::size_t GetNumEntries() const noexcept;
+
+    /**
+     *  @brief  Get the schema of a column being read
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return the column schema
+     */
+    const ColumnSchema &GetColumnSchema(const std::string &branchName) const;
+
+    /**
+     *  @brief  Get the values of a scalar column, one for each entry in the range read
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return the values
+     */
+    template <typename T>
+    LArColumnSpan<T> GetScalarColumn(const std::string &branchName) const;
+
+    /**
+     *  @brief  Get the values of a vector column, flattened across the entries in the range read
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return the values
+     */
+    template <typename T>
+    LArColumnSpan<T> GetVectorColumn(const std::string &branchName) const;
+
+    /**
+     *  @brief  Get the offsets of the values of each entry into a flattened vector column, plus a trailing end offset
+     *
+     *  @param  branchName the branch name
+     *
+     *  @return the offsets
+     */
+    OffsetSpan GetVectorOffsets(const std::string &branchName) const;
+
+    /**
+     *  @brief  Get the values of a vector column in one entry
+     *
+     *  @param  branchName the branch name
+     *  @param  entry the entry, which must be in the range read
+     *
+     *  @return the values
+     */
+    template <typename T>
+    LArColumnSpan<T> GetVectorElements(const std::string &branchName, const Long64_t entry) const;
+
+private:
+    /**
+     *  @brief  A column being read, holding the values of the range read
+     */
+    struct Column
+    {
+        ColumnSchema             m_schema;      ///< The column schema
+        TBranch                 *m_pBranch;     ///< Address of the branch
+        bool                     m_useBulkRead; ///< Whether to read the branch a basket at a time
+        std::shared_ptr<void>    m_spObject;    ///< The object that a vector branch reads into, if bound to the reader
+        void                    *m_pObject;     ///< Address of the object, whose own address is given to the branch
+        std::vector<char>        m_values;      ///< The values of the range read, as raw bytes of the element type
+        std::vector<std::size_t> m_offsets;     ///< For a vector column, the offset of each entry's values plus a trailing end offset
+    };
+
+    using ColumnVector = std::vector<Column>; ///< Alias for a vector of columns
+
+    TTree       *m_pTree;       ///< Address of the TTree
+    ColumnVector m_columns;     ///< The columns being read
+    Long64_t     m_firstEntry;  ///< The first entry of the range read
+    Long64_t     m_endEntry;    ///< One past the last entry of the range read
+    TBufferFile  m_bulkBuffer;  ///< The buffer into which baskets are read in bulk
+
+    /**
+     *  @brief  Describe a branch as a column
+     *
+     *  @param  pTree address of the TTree
+     *  @param  pBranch address of the branch
+     *
+     *  @return the column schema
+     */
+    static ColumnSchema DescribeBranch(TTree *const pTree, TBranch *const pBranch);
+
+    /**
+     *  @brief  Get the size in bytes of a value of an element type
+     *
+     *  @param  elementType the element type
+     *
+     *  @return the size in bytes
+     */
+    static std::size_t GetElementSize(const ELEMENT_TYPE elementType);
+
+    /**
+     *  @brief  Get the element type of a value type
+     *
+     *  @return the element type
+     */
+    template <typename T>
+    static ELEMENT_TYPE GetElementType() noexcept;
+
+    /**
+     *  @brief  Find a column being read
+     *
+     *  @param  branchName the branch name
+     *  @param  shape the shape the column must have
+     *  @param  elementType the element type the column must have
+     *
+     *  @return the column
+     */
+    const Column &GetColumn(const std::string &branchName, const COLUMN_SHAPE shape, const ELEMENT_TYPE elementType) const;
+
+    /**
+     *  @brief  Give a vector branch an object of its own type to read into
+     *
+     *  @param  column the column of the branch
+     */
+    template <typename T>
+    static void BindVectorBranch(Column &column);
+
+    /**
+     *  @brief  Append the values in the object of a bound vector branch to its column
+     *
+     *  @param  column the column of the branch
+     */
+    template <typename T>
+    static void AppendBoundVector(Column &column);
+
+    /**
+     *  @brief  Read a scalar column a basket at a time
+     *
+     *  @param  column the column
+     */
+    void ReadBulkColumn(Column &column);
+
+    /**
+     *  @brief  Append the values of the current entry of a leaf-list branch to its column
+     *
+     *  @param  column the column
+     */
+    static void AppendLeafValues(Column &column);
+
+    /**
+     *  @brief  Append raw values to a column
+     *
+     *  @param  column the column
+     *  @param  pValues address of the values
+     *  @param  numValues the number of values
+     */
+    static void AppendValues(Column &column, const void *const pValues, const std::size_t numValues);
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline LArColumnSpan<T>::LArColumnSpan(const T *const pData, const std::size_t size) noexcept :
+    m_pData{pData},
+    m_size{size}
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline const T *LArColumnSpan<T>::begin() const noexcept
+{
+    return m_pData;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline const T *LArColumnSpan<T>::end() const noexcept
+{
+    return m_pData + m_size;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline std::size_t LArColumnSpan<T>::size() const noexcept
+{
+    return m_size;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline bool LArColumnSpan<T>::empty() const noexcept
+{
+    return m_size == 0UL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline const T &LArColumnSpan<T>::operator[](const std::size_t index) const noexcept
+{
+    return m_pData[index];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline Long64_t LArNtupleReader::GetFirstEntry() const noexcept
+{
+    return m_firstEntry;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::size_t LArNtupleReader::GetNumEntries() const noexcept
+{
+    return static_cast<std::size_t>(m_endEntry - m_firstEntry);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline LArColumnSpan<T> LArNtupleReader::GetScalarColumn(const std::string &branchName) const
+{
+    const Column &column = this->GetColumn(branchName, COLUMN_SHAPE::SCALAR, LArNtupleReader::GetElementType<T>());
+
+    return LArColumnSpan<T>(reinterpret_cast<const T *>(column.m_values.data()), column.m_values.size() / sizeof(T));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline LArColumnSpan<T> LArNtupleReader::GetVectorColumn(const std::string &branchName) const
+{
+    const Column &column = this->GetColumn(branchName, COLUMN_SHAPE::VECTOR, LArNtupleReader::GetElementType<T>());
+
+    return LArColumnSpan<T>(reinterpret_cast<const T *>(column.m_values.data()), column.m_values.size() / sizeof(T));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+inline LArColumnSpan<T> LArNtupleReader::GetVectorElements(const std::string &branchName, const Long64_t entry) const
+{
+    const LArColumnSpan<T> values(this->GetVectorColumn<T>(branchName));
+    const OffsetSpan       offsets(this->GetVectorOffsets(branchName));
+    const std::size_t      index(static_cast<std::size_t>(entry - m_firstEntry));
+
+    return LArColumnSpan<T>(values.begin() + offsets[index], offsets[index + 1UL] - offsets[index]);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+inline LArNtupleReader::ELEMENT_TYPE LArNtupleReader::GetElementType<Float_t>() noexcept
+{
+    return ELEMENT_TYPE::FLOAT;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+inline LArNtupleReader::ELEMENT_TYPE LArNtupleReader::GetElementType<Int_t>() noexcept
+{
+    return ELEMENT_TYPE::INT;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+inline LArNtupleReader::ELEMENT_TYPE LArNtupleReader::GetElementType<UInt_t>() noexcept
+{
+    return ELEMENT_TYPE::UINT;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+inline LArNtupleReader::ELEMENT_TYPE LArNtupleReader::GetElementType<Bool_t>() noexcept
+{
+    return ELEMENT_TYPE::BOOL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <>
+inline LArNtupleReader::ELEMENT_TYPE LArNtupleReader::GetElementType<ULong64_t>() noexcept
+{
+    return ELEMENT_TYPE::ULONG64;
+}
+
+} // namespace lar_physics_content
+
+#endif // #ifndef LAR_NTUPLE_READER_H
@@ -0,0 +1,170 @@
+/**
+ *  @file   larphysicscontent/LArObjects/LArCorrectionMap.cc
+ *
+ *  @brief  Implementation of the lar correction map class.
+ *
+ *  $Log: $
+ */
+
+#include "larphysicscontent/LArObjects/LArCorrectionMap.h"
+
+#include "TAxis.h"
+#include "TDirectory.h"
+#include "TFile.h"
+
+#include <algorithm>
+
+using namespace pandora;
+
+namespace lar_physics_content
+{
+
+LArCorrectionMap::LArCorrectionMap(const TH1 &histogram, const OUT_OF_RANGE_POLICY outOfRangePolicy, const float defaultValue) :
+    m_dimension{static_cast<std::size_t>(histogram.GetDimension())},
+    m_axes{{0.f, 0.f, 1UL, 0UL}, {0.f, 0.f, 1UL, 0UL}, {0.f, 0.f, 1UL, 0UL}},
+    m_values{},
+    m_outOfRangePolicy{outOfRangePolicy},
+    m_defaultValue{defaultValue}
+{
+    if (m_dimension < 1UL || m_dimension > 3UL)
+    {
+        std::cerr << "LArCorrectionMap: correction maps must have 1, 2 or 3 dimensions" << std::endl;
+        throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+    }
+
+    const TAxis *const rootAxes[3] = {histogram.GetXaxis(), histogram.GetYaxis(), histogram.GetZaxis()};
+    std::size_t        nValues(1UL);
+
+    for (std::size_t d = 0UL; d < m_dimension; ++d)
+    {
+        const TAxis *const pRootAxis = rootAxes[d];
+
+        // A uniform grid is what makes each lookup a fixed amount of work
+        if (pRootAxis->IsVariableBinSize() || pRootAxis->GetNbins() < 1)
+        {
+            std::cerr << "LArCorrectionMap: histogram " << histogram.GetName() << " does not have uniform binning" << std::endl;
+            throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+        }
+
+        Axis &axis = m_axes[d];
+        axis.m_firstNode      = static_cast<float>(pRootAxis->GetBinCenter(1));
+        axis.m_inverseSpacing = static_cast<float>(1. / pRootAxis->GetBinWidth(1));
+        axis.m_nNodes         = static_cast<std::size_t>(pRootAxis->GetNbins());
+        axis.m_stride         = axis.m_nNodes > 1UL ? nValues : 0UL;
+        nValues *= axis.m_nNodes;
+    }
+
+    m_values.reserve(nValues);
+
+    for (std::size_t k = 0UL; k < m_axes[2].m_nNodes; ++k)
+    {
+        for (std::size_t j = 0UL; j < m_axes[1].m_nNodes; ++j)
+        {
+            for (std::size_t i = 0UL; i < m_axes[0].m_nNodes; ++i)
+                m_values.push_back(static_cast<float>(histogram.GetBinContent(i + 1, j + 1, k + 1)));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<const LArCorrectionMap> LArCorrectionMap::Load(const std::string &filePath, const std::string &histogramName,
+    const OUT_OF_RANGE_POLICY outOfRangePolicy, const float defaultValue)
+{
+    // Opening a file changes the current directory, which the output ntuple relies on
+    const TDirectory::TContext directoryContext;
+    const std::unique_ptr<TFile> spFile(TFile::Open(filePath.c_str(), "READ"));
+
+    if (!spFile || spFile->IsZombie())
+    {
+        std::cerr << "LArCorrectionMap: Failed to open file at " << filePath << std::endl;
+        throw StatusCodeException(STATUS_CODE_NOT_FOUND);
+    }
+
+    const TH1 *const pHistogram = dynamic_cast<const TH1 *>(spFile->Get(histogramName.c_str()));
+
+    if (!pHistogram)
+    {
+        std::cerr << "LArCorrectionMap: Could not find histogram " << histogramName << " in " << filePath << std::endl;
+        throw StatusCodeException(STATUS_CODE_NOT_FOUND);
+    }
+
+    return std::make_shared<const LArCorrectionMap>(*pHistogram, outOfRangePolicy, defaultValue);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArCorrectionMap::OUT_OF_RANGE_POLICY LArCorrectionMap::GetOutOfRangePolicy(const std::string &policyName)
+{
+    if (policyName == "Clamp")
+        return OUT_OF_RANGE_POLICY::CLAMP;
+
+    if (policyName == "Default")
+        return OUT_OF_RANGE_POLICY::DEFAULT_VALUE;
+
+    if (policyName == "Throw")
+        return OUT_OF_RANGE_POLICY::THROW;
+
+    std::cerr << "LArCorrectionMap: Unknown out-of-range policy " << policyName << ", expected Clamp, Default or Throw" << std::endl;
+    throw StatusCodeException(STATUS_CODE_INVALID_PARAMETER);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+float LArCorrectionMap::Evaluate(const float u, const float v, const float w) const
+{
+    const float coordinates[3] = {u, v, w};
+    float       fractions[3]   = {0.f, 0.f, 0.f};
+    std::size_t baseIndex(0UL);
+
+    for (std::size_t d = 0UL; d < m_dimension; ++d)
+    {
+        const Axis &axis        = m_axes[d];
+        const float maxPosition = static_cast<float>(axis.m_nNodes - 1UL);
+        float       position    = (coordinates[d] - axis.m_firstNode) * axis.m_inverseSpacing;
+
+        // Written so that a NaN coordinate also counts as out of range
+        if (!(position >= 0.f && position <= maxPosition))
+        {
+            switch (m_outOfRangePolicy)
+            {
+                case OUT_OF_RANGE_POLICY::CLAMP:
+                    position = position > 0.f ? maxPosition : 0.f;
+                    break;
+                case OUT_OF_RANGE_POLICY::DEFAULT_VALUE:
+                    return m_defaultValue;
+                case OUT_OF_RANGE_POLICY::THROW:
+                default:
+                    std::cerr << "LArCorrectionMap: Coordinate " << coordinates[d] << " is outside the grid along axis " << d << std::endl;
+                    throw StatusCodeException(STATUS_CODE_OUT_OF_RANGE);
+            }
+        }
+
+        // The last node is shared with the cell below it, so that the upper edge interpolates rather than reading past the grid
+        const std::size_t node = std::min(static_cast<std::size_t>(position), axis.m_nNodes > 1UL ? axis.m_nNodes - 2UL : 0UL);
+        fractions[d] = position - static_cast<float>(node);
+        baseIndex += node * axis.m_stride;
+    }
+
+    // Linear, bilinear or trilinear interpolation over the corners of the enclosing cell
+    float value(0.f);
+
+    for (std::size_t corner = 0UL; corner < (1UL << m_dimension); ++corner)
+    {
+        float       weight(1.f);
+        std::size_t index(baseIndex);
+
+        for (std::size_t d = 0UL; d < m_dimension; ++d)
+        {
+            const bool isUpper = (corner >> d) & 1UL;
+            weight *= isUpper ? fractions[d] : 1.f - fractions[d];
+            index += isUpper ? m_axes[d].m_stride : 0UL;
+        }
+
+        value += weight * m_values[index];
+    }
+
+    return value;
+}
+
+} // namespace lar_physics_content
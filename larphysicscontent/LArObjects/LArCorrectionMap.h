@@ -0,0 +1,146 @@
+/**
+ *  @file   larphysicscontent/LArObjects/LArCorrectionMap.h
+ *
+ *  @brief  Header file for the lar correction map class.
+ *
+ *  $Log: $
+ */
+#ifndef LAR_CORRECTION_MAP_H
+#define LAR_CORRECTION_MAP_H 1
+
+#include "Pandora/StatusCodes.h"
+
+#include "TH1.h"
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lar_physics_content
+{
+
+/**
+ *  @brief  LArCorrectionMap class, an immutable lookup table of correction factors on a regular 1D, 2D or 3D grid, interpolated
+ *          linearly between the grid nodes along each axis
+ */
+class LArCorrectionMap
+{
+public:
+    /**
+     *  @brief  What to do when a coordinate lies outside the grid
+     */
+    enum class OUT_OF_RANGE_POLICY
+    {
+        CLAMP,         ///< Use the value at the nearest edge of the grid
+        DEFAULT_VALUE, ///< Use the default value
+        THROW          ///< Throw an exception
+    };
+
+    /**
+     *  @brief  Constructor, taking the grid from a histogram with uniform binning whose bin centres are the grid nodes
+     *
+     *  @param  histogram the TH1, TH2 or TH3 histogram
+     *  @param  outOfRangePolicy the out-of-range policy
+     *  @param  defaultValue the value to use out of range under the default value policy
+     */
+    LArCorrectionMap(const TH1 &histogram, const OUT_OF_RANGE_POLICY outOfRangePolicy, const float defaultValue);
+
+    /**
+     *  @brief  Default copy constructor
+     */
+    LArCorrectionMap(const LArCorrectionMap &) = default;
+
+    /**
+     *  @brief  Default move constructor
+     */
+    LArCorrectionMap(LArCorrectionMap &&) = default;
+
+    /**
+     *  @brief  Deleted copy assignment operator
+     */
+    LArCorrectionMap &operator=(const LArCorrectionMap &) = delete;
+
+    /**
+     *  @brief  Deleted move assignment operator
+     */
+    LArCorrectionMap &operator=(LArCorrectionMap &&) = delete;
+
+    /**
+     *  @brief  Default destructor
+     */
+    ~LArCorrectionMap() = default;
+
+    /**
+     *  @brief  Load a correction map from a histogram in a ROOT file
+     *
+     *  @param  filePath the ROOT file path
+     *  @param  histogramName the name of the histogram in the file
+     *  @param  outOfRangePolicy the out-of-range policy
+     *  @param  defaultValue the value to use out of range under the default value policy
+     *
+     *  @return shared pointer to the correction map
+     */
+    static std::shared_ptr<const LArCorrectionMap> Load(const std::string &filePath, const std::string &histogramName,
+        const OUT_OF_RANGE_POLICY outOfRangePolicy, const float defaultValue);
+
+    /**
+     *  @brief  Parse an out-of-range policy from its name
+     *
+     *  @param  policyName the policy name: Clamp, Default or Throw
+     *
+     *  @return the out-of-range policy
+     */
+    static OUT_OF_RANGE_POLICY GetOutOfRangePolicy(const std::string &policyName);
+
+    /**
+     *  @brief  Get the number of dimensions of the grid
+     *
+     *  @return the number of dimensions
+     */
+    std::size_t GetDimension() const noexcept;
+
+    /**
+     *  @brief  Evaluate the correction at a point, using only as many coordinates as the grid has dimensions
+     *
+     *  @param  u the coordinate along the first axis
+     *  @param  v the coordinate along the second axis
+     *  @param  w the coordinate along the third axis
+     *
+     *  @return the interpolated correction
+     */
+    float Evaluate(const float u, const float v, const float w) const;
+
+private:
+    /**
+     *  @brief  A uniform grid axis
+     */
+    struct Axis
+    {
+        float       m_firstNode;      ///< The coordinate of the first grid node
+        float       m_inverseSpacing; ///< The inverse of the spacing between grid nodes
+        std::size_t m_nNodes;         ///< The number of grid nodes
+        std::size_t m_stride;         ///< The stride between neighbouring nodes in the value array
+    };
+
+    using FloatVector = std::vector<float>; ///< Alias for a vector of floats
+
+    std::size_t         m_dimension;        ///< The number of dimensions
+    Axis                m_axes[3];          ///< The grid axes, of which the first m_dimension are used
+    FloatVector         m_values;           ///< The grid node values, with the first axis varying fastest
+    OUT_OF_RANGE_POLICY m_outOfRangePolicy; ///< The out-of-range policy
+    float               m_defaultValue;     ///< The value to use out of range under the default value policy
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline std::size_t LArCorrectionMap::GetDimension() const noexcept
+{
+    return m_dimension;
+}
+
+} // namespace lar_physics_content
+
+#endif // #ifndef LAR_CORRECTION_MAP_H
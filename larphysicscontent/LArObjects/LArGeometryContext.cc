@@ -0,0 +1,78 @@
+/**
+ *  @file   larphysicscontent/LArObjects/LArGeometryContext.cc
+ *
+ *  @brief  Implementation of the lar geometry context class.
+ *
+ *  $Log: $
+ */
+
+#include "larphysicscontent/LArObjects/LArGeometryContext.h"
+
+#include "larpandoracontent/LArHelpers/LArGeometryHelper.h"
+
+#include "Geometry/LArTPC.h"
+#include "Managers/GeometryManager.h"
+
+using namespace pandora;
+using namespace lar_content;
+
+namespace
+{
+/**
+ *  @brief  Get the single LArTPC of the detector
+ *
+ *  @param  pandoraInstance the instance of Pandora
+ *
+ *  @return the LArTPC
+ */
+const LArTPC &GetSingleLArTPC(const Pandora &pandoraInstance)
+{
+    const LArTPCMap &larTPCMap(pandoraInstance.GetGeometry()->GetLArTPCMap());
+
+    if (larTPCMap.size() != 1UL)
+    {
+        std::cerr << "LArGeometryContext: the number of LArTPCs was not equal to 1" << std::endl;
+        throw StatusCodeException(STATUS_CODE_NOT_FOUND);
+    }
+
+    return *larTPCMap.begin()->second;
+}
+} // namespace
+
+namespace lar_physics_content
+{
+
+LArGeometryContext::LArGeometryContext(const Pandora &pandoraInstance) :
+    m_wireViewGeometryU(GetSingleLArTPC(pandoraInstance).GetWirePitchU(), GetSingleLArTPC(pandoraInstance).GetWireAngleU()),
+    m_wireViewGeometryV(GetSingleLArTPC(pandoraInstance).GetWirePitchV(), GetSingleLArTPC(pandoraInstance).GetWireAngleV()),
+    m_wireViewGeometryW(GetSingleLArTPC(pandoraInstance).GetWirePitchW(), GetSingleLArTPC(pandoraInstance).GetWireAngleW()),
+    m_viewProjectionU(LArGeometryContext::CalculateViewProjection(pandoraInstance, TPC_VIEW_U)),
+    m_viewProjectionV(LArGeometryContext::CalculateViewProjection(pandoraInstance, TPC_VIEW_V)),
+    m_viewProjectionW(LArGeometryContext::CalculateViewProjection(pandoraInstance, TPC_VIEW_W)),
+    m_wireZPitch(LArGeometryHelper::GetWireZPitch(pandoraInstance)),
+    m_tpcMinCoordinates(0.f, 0.f, 0.f),
+    m_tpcMaxCoordinates(0.f, 0.f, 0.f),
+    m_detector(bf::DetectorHelper::GetMicroBooNEDetector())
+{
+    const LArTPC &larTPC(GetSingleLArTPC(pandoraInstance));
+
+    // The extremal coordinates are at the centre +- half of the widths
+    m_tpcMinCoordinates = CartesianVector(larTPC.GetCenterX() - 0.5f * larTPC.GetWidthX(), larTPC.GetCenterY() - 0.5f * larTPC.GetWidthY(),
+        larTPC.GetCenterZ() - 0.5f * larTPC.GetWidthZ());
+    m_tpcMaxCoordinates = CartesianVector(larTPC.GetCenterX() + 0.5f * larTPC.GetWidthX(), larTPC.GetCenterY() + 0.5f * larTPC.GetWidthY(),
+        larTPC.GetCenterZ() + 0.5f * larTPC.GetWidthZ());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+LArGeometryContext::ViewProjection LArGeometryContext::CalculateViewProjection(const Pandora &pandoraInstance, const HitType view)
+{
+    // The transformation plugin maps y-z to the view coordinate affinely, so probing it at three points recovers the map exactly
+    const float offset(LArGeometryHelper::ProjectPosition(pandoraInstance, CartesianVector(0.f, 0.f, 0.f), view).GetZ());
+    const float yCoefficient(LArGeometryHelper::ProjectPosition(pandoraInstance, CartesianVector(0.f, 1.f, 0.f), view).GetZ() - offset);
+    const float zCoefficient(LArGeometryHelper::ProjectPosition(pandoraInstance, CartesianVector(0.f, 0.f, 1.f), view).GetZ() - offset);
+
+    return ViewProjection(yCoefficient, zCoefficient, offset);
+}
+
+} // namespace lar_physics_content
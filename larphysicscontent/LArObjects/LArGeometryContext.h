@@ -0,0 +1,301 @@
+/**
+ *  @file   larphysicscontent/LArObjects/LArGeometryContext.h
+ *
+ *  @brief  Header file for the lar geometry context class.
+ *
+ *  $Log: $
+ */
+#ifndef LAR_GEOMETRY_CONTEXT_H
+#define LAR_GEOMETRY_CONTEXT_H 1
+
+#include "Objects/CartesianVector.h"
+#include "Pandora/Pandora.h"
+#include "Pandora/StatusCodes.h"
+
+#include "bethe-faster/BetheFaster.h"
+
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+
+namespace lar_physics_content
+{
+
+/**
+ *  @brief  LArGeometryContext class, an immutable snapshot of the detector geometry taken once per run so that per-hit code does not
+ *          need to go through the Pandora geometry and plugin managers
+ */
+class LArGeometryContext
+{
+public:
+    /**
+     *  @brief  Per-view wire geometry constants, precomputed for cell path length calculations
+     */
+    struct WireViewGeometry
+    {
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  wirePitch the wire pitch
+         *  @param  wireAngle the angle of the wires from the vertical
+         */
+        WireViewGeometry(const float wirePitch, const float wireAngle);
+
+        float m_wirePitch;    ///< The wire pitch
+        float m_cosWireAngle; ///< The cosine of the angle of the wires from the vertical
+        float m_sinWireAngle; ///< The sine of the angle of the wires from the vertical
+    };
+
+    /**
+     *  @brief  The affine map from the 3D y-z coordinates to the coordinate of a 2D view
+     */
+    struct ViewProjection
+    {
+        /**
+         *  @brief  Constructor
+         *
+         *  @param  yCoefficient the coefficient of the 3D y coordinate
+         *  @param  zCoefficient the coefficient of the 3D z coordinate
+         *  @param  offset the constant offset
+         */
+        ViewProjection(const float yCoefficient, const float zCoefficient, const float offset);
+
+        float m_yCoefficient; ///< The coefficient of the 3D y coordinate
+        float m_zCoefficient; ///< The coefficient of the 3D z coordinate
+        float m_offset;       ///< The constant offset
+    };
+
+    using DetectorDescription = std::decay_t<decltype(bf::DetectorHelper::GetMicroBooNEDetector())>; ///< Alias for the bethe-faster detector
+
+    /**
+     *  @brief  Constructor, reading everything from the Pandora geometry once
+     *
+     *  @param  pandoraInstance the instance of Pandora
+     */
+    explicit LArGeometryContext(const pandora::Pandora &pandoraInstance);
+
+    /**
+     *  @brief  Default copy constructor
+     */
+    LArGeometryContext(const LArGeometryContext &) = default;
+
+    /**
+     *  @brief  Default move constructor
+     */
+    LArGeometryContext(LArGeometryContext &&) = default;
+
+    /**
+     *  @brief  Deleted copy assignment operator
+     */
+    LArGeometryContext &operator=(const LArGeometryContext &) = delete;
+
+    /**
+     *  @brief  Deleted move assignment operator
+     */
+    LArGeometryContext &operator=(LArGeometryContext &&) = delete;
+
+    /**
+     *  @brief  Default destructor
+     */
+    ~LArGeometryContext() = default;
+
+    /**
+     *  @brief  Get the wire geometry constants for a view
+     *
+     *  @param  view the view
+     *
+     *  @return the wire geometry constants
+     */
+    const WireViewGeometry &GetWireViewGeometry(const pandora::HitType view) const;
+
+    /**
+     *  @brief  Get the projection from the 3D y-z coordinates to a view
+     *
+     *  @param  view the view
+     *
+     *  @return the view projection
+     */
+    const ViewProjection &GetViewProjection(const pandora::HitType view) const;
+
+    /**
+     *  @brief  Get the wire pitch along z, as used for the layer pitch of 3D sliding fits
+     *
+     *  @return the wire z pitch
+     */
+    float GetWireZPitch() const noexcept;
+
+    /**
+     *  @brief  Get the minimum coordinates of the TPC
+     *
+     *  @return the minimum coordinates
+     */
+    const pandora::CartesianVector &GetTPCMinCoordinates() const noexcept;
+
+    /**
+     *  @brief  Get the maximum coordinates of the TPC
+     *
+     *  @return the maximum coordinates
+     */
+    const pandora::CartesianVector &GetTPCMaxCoordinates() const noexcept;
+
+    /**
+     *  @brief  Get the bethe-faster detector description
+     *
+     *  @return the detector description
+     */
+    const DetectorDescription &GetDetector() const noexcept;
+
+    /**
+     *  @brief  Project a 3D position into a view
+     *
+     *  @param  position the 3D position
+     *  @param  view the view
+     *
+     *  @return the 2D position
+     */
+    pandora::CartesianVector ProjectPosition(const pandora::CartesianVector &position, const pandora::HitType view) const;
+
+    /**
+     *  @brief  Project a 3D direction into a view
+     *
+     *  @param  direction the 3D direction
+     *  @param  view the view
+     *
+     *  @return the unit 2D direction
+     */
+    pandora::CartesianVector ProjectDirection(const pandora::CartesianVector &direction, const pandora::HitType view) const;
+
+private:
+    WireViewGeometry         m_wireViewGeometryU; ///< The U view wire geometry constants
+    WireViewGeometry         m_wireViewGeometryV; ///< The V view wire geometry constants
+    WireViewGeometry         m_wireViewGeometryW; ///< The W view wire geometry constants
+    ViewProjection           m_viewProjectionU;   ///< The projection to the U view
+    ViewProjection           m_viewProjectionV;   ///< The projection to the V view
+    ViewProjection           m_viewProjectionW;   ///< The projection to the W view
+    float                    m_wireZPitch;        ///< The wire pitch along z
+    pandora::CartesianVector m_tpcMinCoordinates; ///< The minimum coordinates of the TPC
+    pandora::CartesianVector m_tpcMaxCoordinates; ///< The maximum coordinates of the TPC
+    DetectorDescription      m_detector;          ///< The bethe-faster detector description
+
+    /**
+     *  @brief  Derive the projection to a view from the Pandora transformation plugin
+     *
+     *  @param  pandoraInstance the instance of Pandora
+     *  @param  view the view
+     *
+     *  @return the view projection
+     */
+    static ViewProjection CalculateViewProjection(const pandora::Pandora &pandoraInstance, const pandora::HitType view);
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArGeometryContext::WireViewGeometry::WireViewGeometry(const float wirePitch, const float wireAngle) :
+    m_wirePitch{wirePitch},
+    m_cosWireAngle{std::cos(wireAngle)},
+    m_sinWireAngle{std::sin(wireAngle)}
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline LArGeometryContext::ViewProjection::ViewProjection(const float yCoefficient, const float zCoefficient, const float offset) :
+    m_yCoefficient{yCoefficient},
+    m_zCoefficient{zCoefficient},
+    m_offset{offset}
+{
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const LArGeometryContext::WireViewGeometry &LArGeometryContext::GetWireViewGeometry(const pandora::HitType view) const
+{
+    switch (view)
+    {
+        case pandora::TPC_VIEW_U:
+            return m_wireViewGeometryU;
+        case pandora::TPC_VIEW_V:
+            return m_wireViewGeometryV;
+        case pandora::TPC_VIEW_W:
+            return m_wireViewGeometryW;
+        default:
+            break;
+    }
+
+    std::cerr << "LArGeometryContext: wire geometry is only defined for the U, V and W views" << std::endl;
+    throw pandora::StatusCodeException(pandora::STATUS_CODE_INVALID_PARAMETER);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const LArGeometryContext::ViewProjection &LArGeometryContext::GetViewProjection(const pandora::HitType view) const
+{
+    switch (view)
+    {
+        case pandora::TPC_VIEW_U:
+            return m_viewProjectionU;
+        case pandora::TPC_VIEW_V:
+            return m_viewProjectionV;
+        case pandora::TPC_VIEW_W:
+            return m_viewProjectionW;
+        default:
+            break;
+    }
+
+    std::cerr << "LArGeometryContext: projections are only defined for the U, V and W views" << std::endl;
+    throw pandora::StatusCodeException(pandora::STATUS_CODE_INVALID_PARAMETER);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline float LArGeometryContext::GetWireZPitch() const noexcept
+{
+    return m_wireZPitch;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const pandora::CartesianVector &LArGeometryContext::GetTPCMinCoordinates() const noexcept
+{
+    return m_tpcMinCoordinates;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const pandora::CartesianVector &LArGeometryContext::GetTPCMaxCoordinates() const noexcept
+{
+    return m_tpcMaxCoordinates;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline const LArGeometryContext::DetectorDescription &LArGeometryContext::GetDetector() const noexcept
+{
+    return m_detector;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline pandora::CartesianVector LArGeometryContext::ProjectPosition(const pandora::CartesianVector &position, const pandora::HitType view) const
+{
+    const ViewProjection &projection(this->GetViewProjection(view));
+
+    return pandora::CartesianVector(position.GetX(), 0.f,
+        projection.m_yCoefficient * position.GetY() + projection.m_zCoefficient * position.GetZ() + projection.m_offset);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline pandora::CartesianVector LArGeometryContext::ProjectDirection(const pandora::CartesianVector &direction, const pandora::HitType view) const
+{
+    const ViewProjection &projection(this->GetViewProjection(view));
+
+    return pandora::CartesianVector(direction.GetX(), 0.f,
+        projection.m_yCoefficient * direction.GetY() + projection.m_zCoefficient * direction.GetZ())
+        .GetUnitVector();
+}
+
+} // namespace lar_physics_content
+
+#endif // #ifndef LAR_GEOMETRY_CONTEXT_H
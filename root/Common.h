@@ -1,13 +1,32 @@
 #ifndef LAR_ANALYSIS_ROOT_COMMON
 #define LAR_ANALYSIS_ROOT_COMMON 1
 
+#include "RConfigure.h"
 #include "TCanvas.h"
 #include "TFile.h"
 #include "TGraph.h"
 #include "TH2F.h"
+#include "TList.h"
 #include "TNtuple.h"
-
+#include "TParameter.h"
+#include "TROOT.h"
+#include "TTreeReader.h"
+#include "TTreeReaderArray.h"
+#include "TTreeReaderValue.h"
+
+// Parallel filling needs a ROOT built with implicit multithreading
+#ifdef R__USE_IMT
+#include "ROOT/TTreeProcessorMT.hxx"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #define TEXT_NORMAL "\033[0m"
 #define TEXT_BOLD "\033[1m"
@@ -73,6 +92,94 @@ inline TTree *LoadTreeFromFile(const char *const dataFilePath, const char *const
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+// Categorical records are written as integer codes, with the category names for each branch stored once in the tree's user info as a list
+// named <branch>_categories, indexed by code. The names are a fixed vocabulary declared by the producing tool, so every job writes the same
+// codes and the dictionary that hadd keeps from the first file also decodes the others. Filter on a category with e.g.
+// tree->Draw("x", "nu_mc_InteractionType == 3").
+inline std::vector<std::string> LoadCategoryDictionary(TTree *const pTree, const char *const branchName)
+{
+    std::vector<std::string> categoryNames;
+    const std::string        dictionaryName(std::string(branchName) + "_categories");
+    const TList *const       pDictionary = dynamic_cast<TList *>(pTree->GetUserInfo()->FindObject(dictionaryName.c_str()));
+
+    if (!pDictionary)
+    {
+        CERR("Tree did not contain a category dictionary for branch '" << branchName << "'");
+        return categoryNames;
+    }
+
+    for (const TObject *const pCategory : *pDictionary)
+        categoryNames.emplace_back(pCategory->GetName());
+
+    return categoryNames;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Returns the code of a category in a categorical branch, or -1 if the category is not in the branch's vocabulary
+inline int GetCategoryCode(TTree *const pTree, const char *const branchName, const char *const categoryName)
+{
+    const std::vector<std::string> categoryNames(LoadCategoryDictionary(pTree, branchName));
+
+    for (std::size_t code = 0UL; code < categoryNames.size(); ++code)
+    {
+        if (categoryNames.at(code) == categoryName)
+            return static_cast<int>(code);
+    }
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Summary statistics of the finite values written to a numeric branch, with vectors and matrices flattened
+struct BranchStatistics
+{
+    double count;
+    double min;
+    double max;
+    double mean;
+    double stdDev;
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The ntuple keeps running statistics for each numeric branch while it fills, stored in the tree's user info as a list of parameters
+// named <branch>_statistics. Returns whether the tree has statistics for the branch, so value ranges can be had without reading entries.
+// hadd does not merge user info, so a merged tree keeps the statistics of its first file alone; they describe the whole tree only if
+// their count matches the number of values in it
+inline bool LoadBranchStatistics(TTree *const pTree, const char *const branchName, BranchStatistics &statistics)
+{
+    const std::string  statisticsName(std::string(branchName) + "_statistics");
+    const TList *const pList = dynamic_cast<TList *>(pTree->GetUserInfo()->FindObject(statisticsName.c_str()));
+
+    if (!pList)
+        return false;
+
+    const char *const           statisticNames[5] = {"count", "min", "max", "sum", "sumSquares"};
+    const TParameter<Double_t> *pStatistics[5];
+
+    for (std::size_t i = 0UL; i < 5UL; ++i)
+    {
+        if (!(pStatistics[i] = dynamic_cast<TParameter<Double_t> *>(pList->FindObject(statisticNames[i]))))
+            return false;
+    }
+
+    const double count(pStatistics[0]->GetVal());
+    const double mean(count > 0. ? pStatistics[3]->GetVal() / count : 0.);
+    const double variance(count > 0. ? pStatistics[4]->GetVal() / count - mean * mean : 0.);
+
+    statistics.count  = count;
+    statistics.min    = pStatistics[1]->GetVal();
+    statistics.max    = pStatistics[2]->GetVal();
+    statistics.mean   = mean;
+    statistics.stdDev = std::sqrt(std::max(0., variance));
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 enum PLOT_TYPE
 {
     HISTOGRAM,
@@ -120,56 +227,198 @@ struct PlotSettings1D
 const struct PlotSettings2D g_defaultPlotSettings2D = {"", "", "", 0.f, 0.f, 80, 0.f, 0.f, 80, HISTOGRAM, true, true, kBlack, kBlack, true};
 const struct PlotSettings1D g_defaultPlotSettings1D = {"", "", 0.f, 0.f, 80, HISTOGRAM, false, true, kBlack, kBlack, true};
 
+// The most entries held in memory while a histogram range is found from the plotted values, after which the range is fixed
+const std::size_t g_maxBufferedPlotEntries = 1UL << 22;
+
+// The size of the TTreeCache that prefetches the plotted branches
+const Long64_t g_plotCacheSize = 64LL << 20;
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-inline TCanvas *PlotNtuple1D(TNtuple *const pNtuple, const char *const xName, const char *const identifier, const PlotSettings1D &plotSettings)
+// A histogram axis range, either given by the plot settings or still to be found from the plotted values
+struct PlotRange
 {
-    float     x          = 0.f;
-    const int numEntries = pNtuple->GetEntries();
+    float min;
+    float max;
+    bool  isKnown;
+};
 
-    if (numEntries == 0)
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Reads the plotted float branches of the current TTreeReader entry, without touching any other branch
+class PlotValueReader
+{
+public:
+    PlotValueReader(TTreeReader &treeReader, const std::vector<const char *> &branchNames)
     {
-        CERR("Number of ntuple entries was 0 so not drawing plot");
-        return NULL;
+        for (const char *const branchName : branchNames)
+            m_values.emplace_back(new TTreeReaderValue<Float_t>(treeReader, branchName));
+    }
+
+    void Read(float *const pValues)
+    {
+        for (std::size_t i = 0UL; i < m_values.size(); ++i)
+            pValues[i] = **m_values[i];
     }
 
-    pNtuple->SetBranchAddress(xName, &x);
+private:
+    std::vector<std::unique_ptr<TTreeReaderValue<Float_t>>> m_values;
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-    float xMax = plotSettings.xMax;
-    float xMin = plotSettings.xMin;
+inline void FillPlotHistogram(TH1F *const pHistogram, const float *const pValues)
+{
+    pHistogram->Fill(pValues[0]);
+}
 
-    if (xMax == 0.f && xMin == 0.f && plotSettings.useMaximumRange)
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+inline void FillPlotHistogram(TH2F *const pHistogram, const float *const pValues)
+{
+    pHistogram->Fill(pValues[0], pValues[1]);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Fills a histogram of some ntuple branches in a single pass, reading only those branches through a TTreeCache that is told about them
+// up front. Unknown ranges are found from the values, which are buffered until the histogram can be made. Should there be more than
+// g_maxBufferedPlotEntries entries, the range is fixed from those, and any later values outside it go to the under and overflow bins.
+// Ranges are taken from stored branch statistics whose count shows they cover every entry. With known ranges, a tree read from a file and
+// ROOT::EnableImplicitMT(), the clusters of the tree are filled in parallel on ROOT builds with implicit multithreading
+template <typename HistogramType>
+inline HistogramType *FillNtupleHistogram(TNtuple *const pNtuple, const std::vector<const char *> &branchNames,
+    std::vector<PlotRange> ranges, const std::function<HistogramType *(const std::vector<PlotRange> &)> &makeHistogram)
+{
+    for (std::size_t d = 0UL; d < branchNames.size(); ++d)
     {
-        bool firstEntry = true;
+        BranchStatistics statistics;
 
-        for (int i = 0; i < numEntries; ++i)
-        {
-            pNtuple->GetEntry(i);
+        // The plotted branches are scalar, so statistics from a single file of a merged tree, or that skipped non-finite values, count
+        // fewer values than there are entries. Their range may then miss values, which are instead found by the buffered scan
+        if (!ranges[d].isKnown && LoadBranchStatistics(pNtuple, branchNames[d], statistics) && statistics.count > 0. &&
+            statistics.count == static_cast<double>(pNtuple->GetEntries()))
+            ranges[d] = PlotRange{static_cast<float>(statistics.min), static_cast<float>(statistics.max), true};
+    }
+
+    const std::size_t numDimensions  = branchNames.size();
+    TFile *const      pFile          = pNtuple->GetCurrentFile();
+    const bool        isReadFromFile = pFile && !pFile->IsWritable();
+    const bool        isRangeKnown   = std::all_of(ranges.begin(), ranges.end(), [](const PlotRange &range) { return range.isKnown; });
+
+    // A tree still being written has its baskets in memory, so only a tree read from a file benefits from prefetching
+    if (isReadFromFile)
+    {
+        pNtuple->SetCacheSize(g_plotCacheSize);
+
+        for (const char *const branchName : branchNames)
+            pNtuple->AddBranchToCache(branchName, kTRUE);
+
+        pNtuple->StopCacheLearningPhase();
+    }
+
+#ifdef R__USE_IMT
+    if (isRangeKnown && isReadFromFile && ROOT::IsImplicitMTEnabled())
+    {
+        HistogramType *const   pHistogram = makeHistogram(ranges);
+        std::mutex             histogramMutex;
+        ROOT::TTreeProcessorMT treeProcessor(*pNtuple);
+
+        treeProcessor.Process([&](TTreeReader &treeReader) {
+            std::unique_ptr<HistogramType> spClusterHistogram;
 
-            if (firstEntry)
             {
-                xMax = x;
-                xMin = x;
+                const std::lock_guard<std::mutex> lock(histogramMutex);
+                spClusterHistogram.reset(static_cast<HistogramType *>(pHistogram->Clone()));
+                spClusterHistogram->SetDirectory(nullptr);
+                spClusterHistogram->Reset();
+            }
 
-                firstEntry = false;
-                continue;
+            PlotValueReader    valueReader(treeReader, branchNames);
+            std::vector<float> values(numDimensions, 0.f);
+
+            while (treeReader.Next())
+            {
+                valueReader.Read(values.data());
+                FillPlotHistogram(spClusterHistogram.get(), values.data());
             }
 
-            if (x > xMax)
-                xMax = x;
-            if (x < xMin)
-                xMin = x;
+            const std::lock_guard<std::mutex> lock(histogramMutex);
+            pHistogram->Add(spClusterHistogram.get());
+        });
+
+        return pHistogram;
+    }
+#endif
+
+    TTreeReader        treeReader(pNtuple);
+    PlotValueReader    valueReader(treeReader, branchNames);
+    HistogramType *    pHistogram = isRangeKnown ? makeHistogram(ranges) : NULL;
+    std::vector<float> values(numDimensions, 0.f), bufferedValues;
+    std::size_t        numBufferedEntries(0UL);
+
+    const auto fixRanges = [&]() {
+        pHistogram = makeHistogram(ranges);
+
+        for (std::size_t i = 0UL; i < numBufferedEntries; ++i)
+            FillPlotHistogram(pHistogram, &bufferedValues[i * numDimensions]);
+
+        std::vector<float>().swap(bufferedValues);
+    };
+
+    while (treeReader.Next())
+    {
+        valueReader.Read(values.data());
+
+        if (pHistogram)
+        {
+            FillPlotHistogram(pHistogram, values.data());
+            continue;
+        }
+
+        for (std::size_t d = 0UL; d < numDimensions; ++d)
+        {
+            if (ranges[d].isKnown)
+                continue;
+
+            ranges[d].min = (numBufferedEntries == 0UL) ? values[d] : std::min(ranges[d].min, values[d]);
+            ranges[d].max = (numBufferedEntries == 0UL) ? values[d] : std::max(ranges[d].max, values[d]);
+        }
+
+        bufferedValues.insert(bufferedValues.end(), values.begin(), values.end());
+
+        if (++numBufferedEntries == g_maxBufferedPlotEntries)
+        {
+            CERR("Histogram range taken from the first " << numBufferedEntries << " entries, later entries outside it will be in the under "
+                                                         << "and overflow bins");
+            fixRanges();
         }
     }
 
-    TH1F *pHistogram = new TH1F(identifier, identifier, plotSettings.xNumBins, xMin, xMax);
+    if (!pHistogram)
+        fixRanges();
+
+    return pHistogram;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-    for (int i = 0; i < numEntries; ++i)
+inline TCanvas *PlotNtuple1D(TNtuple *const pNtuple, const char *const xName, const char *const identifier, const PlotSettings1D &plotSettings)
+{
+    const int numEntries = pNtuple->GetEntries();
+
+    if (numEntries == 0)
     {
-        pNtuple->GetEntry(i);
-        pHistogram->Fill(x);
+        CERR("Number of ntuple entries was 0 so not drawing plot");
+        return NULL;
     }
 
+    const bool  findRange = plotSettings.xMax == 0.f && plotSettings.xMin == 0.f && plotSettings.useMaximumRange;
+    TH1F *const pHistogram = FillNtupleHistogram<TH1F>(pNtuple, {xName}, {PlotRange{plotSettings.xMin, plotSettings.xMax, !findRange}},
+        [&](const std::vector<PlotRange> &ranges) {
+            return new TH1F(identifier, identifier, plotSettings.xNumBins, ranges[0].min, ranges[0].max);
+        });
+
     TCanvas *pCanvas = NULL;
 
     if (plotSettings.newCanvas)
@@ -203,7 +452,6 @@ inline TCanvas *PlotNtuple1D(TNtuple *const pNtuple, const char *const xName, co
         }
     }
 
-    pNtuple->ResetBranchAddresses();
     return pCanvas;
 }
 
@@ -212,7 +460,6 @@ inline TCanvas *PlotNtuple1D(TNtuple *const pNtuple, const char *const xName, co
 inline TCanvas *PlotNtuple2D(TNtuple *const pNtuple, const char *const xName, const char *const yName, const char *const identifier,
     const PlotSettings2D &plotSettings)
 {
-    float     x = 0.f, y = 0.f;
     const int numEntries = pNtuple->GetEntries();
 
     if (numEntries == 0)
@@ -221,50 +468,14 @@ inline TCanvas *PlotNtuple2D(TNtuple *const pNtuple, const char *const xName, co
         return NULL;
     }
 
-    pNtuple->SetBranchAddress(xName, &x);
-    pNtuple->SetBranchAddress(yName, &y);
-
-    float xMax = plotSettings.xMax, yMax = plotSettings.yMax;
-    float xMin = plotSettings.xMin, yMin = plotSettings.yMin;
-
-    if (xMax == 0.f && yMax == 0.f && xMin == 0.f && yMin == 0.f && plotSettings.useMaximumRange)
-    {
-        bool firstEntry = true;
-
-        for (int i = 0; i < numEntries; ++i)
-        {
-            pNtuple->GetEntry(i);
-
-            if (firstEntry)
-            {
-                xMax = x;
-                yMax = y;
-
-                xMin = x;
-                yMax = y;
-
-                firstEntry = false;
-                continue;
-            }
-
-            if (x > xMax)
-                xMax = x;
-            if (y > yMax)
-                yMax = y;
-            if (x < xMin)
-                xMin = x;
-            if (y < yMin)
-                yMin = y;
-        }
-    }
-
-    TH2F *pHistogram = new TH2F(identifier, identifier, plotSettings.xNumBins, xMin, xMax, plotSettings.yNumBins, yMin, yMax);
-
-    for (int i = 0; i < numEntries; ++i)
-    {
-        pNtuple->GetEntry(i);
-        pHistogram->Fill(x, y);
-    }
+    const bool findRange = plotSettings.xMax == 0.f && plotSettings.yMax == 0.f && plotSettings.xMin == 0.f && plotSettings.yMin == 0.f &&
+                           plotSettings.useMaximumRange;
+    TH2F *const pHistogram = FillNtupleHistogram<TH2F>(pNtuple, {xName, yName},
+        {PlotRange{plotSettings.xMin, plotSettings.xMax, !findRange}, PlotRange{plotSettings.yMin, plotSettings.yMax, !findRange}},
+        [&](const std::vector<PlotRange> &ranges) {
+            return new TH2F(identifier, identifier, plotSettings.xNumBins, ranges[0].min, ranges[0].max, plotSettings.yNumBins,
+                ranges[1].min, ranges[1].max);
+        });
 
     TCanvas *pCanvas = NULL;
 
@@ -300,7 +511,6 @@ inline TCanvas *PlotNtuple2D(TNtuple *const pNtuple, const char *const xName, co
         }
     }
 
-    pNtuple->ResetBranchAddresses();
     return pCanvas;
 }
 
@@ -494,4 +704,90 @@ inline TCanvas *PlotFunction2D(float (*pFunction)(float, va_list), const float x
     return pCanvas;
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Read-only view of a contiguous run of values in a flattened matrix branch
+template <typename T>
+struct MatrixRowView
+{
+    const T *   pFirst;
+    std::size_t numValues;
+
+    const T *begin() const { return pFirst; }
+    const T *end() const { return pFirst + numValues; }
+    std::size_t size() const { return numValues; }
+    bool empty() const { return numValues == 0UL; }
+    const T &operator[](const std::size_t i) const { return pFirst[i]; }
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Reader giving a 2D view of a matrix record. LArNtuple writes these as a flat <name>_values column and a <name>_offsets column holding
+// the start of each row plus a trailing end offset. Per-particle matrix records also have a <name>_elementOffsets column holding the
+// first row of each particle plus a trailing end row, so all values belonging to one particle are contiguous.
+template <typename T>
+class MatrixBranchReader
+{
+public:
+    MatrixBranchReader(TTreeReader &treeReader, const char *const branchName, const bool isVectorBranch) :
+        m_values(treeReader, (std::string(branchName) + "_values").c_str()),
+        m_offsets(treeReader, (std::string(branchName) + "_offsets").c_str()),
+        m_pElementOffsets(isVectorBranch ? new TTreeReaderValue<std::vector<UInt_t>>(treeReader, (std::string(branchName) + "_elementOffsets").c_str())
+                                         : nullptr)
+    {
+    }
+
+    std::size_t GetNumElements()
+    {
+        return m_pElementOffsets ? (*m_pElementOffsets)->size() - 1UL : 1UL;
+    }
+
+    std::size_t GetNumRows(const std::size_t element = 0UL)
+    {
+        return this->GetFirstRow(element + 1UL) - this->GetFirstRow(element);
+    }
+
+    MatrixRowView<T> GetRow(const std::size_t row, const std::size_t element = 0UL)
+    {
+        const std::size_t flatRow = this->GetFirstRow(element) + row;
+        return this->GetValues((*m_offsets)[flatRow], (*m_offsets)[flatRow + 1UL]);
+    }
+
+    MatrixRowView<T> GetElementValues(const std::size_t element = 0UL)
+    {
+        return this->GetValues((*m_offsets)[this->GetFirstRow(element)], (*m_offsets)[this->GetFirstRow(element + 1UL)]);
+    }
+
+    std::vector<std::vector<T>> GetMatrix(const std::size_t element = 0UL)
+    {
+        std::vector<std::vector<T>> matrix;
+
+        for (std::size_t row = 0UL, numRows = this->GetNumRows(element); row < numRows; ++row)
+        {
+            const MatrixRowView<T> rowView = this->GetRow(row, element);
+            matrix.emplace_back(rowView.begin(), rowView.end());
+        }
+
+        return matrix;
+    }
+
+private:
+    std::size_t GetFirstRow(const std::size_t element)
+    {
+        if (m_pElementOffsets)
+            return (**m_pElementOffsets)[element];
+
+        return (element == 0UL) ? 0UL : m_offsets->size() - 1UL;
+    }
+
+    MatrixRowView<T> GetValues(const std::size_t first, const std::size_t last)
+    {
+        return MatrixRowView<T>{m_values->data() + first, last - first};
+    }
+
+    TTreeReaderValue<std::vector<T>>                       m_values;
+    TTreeReaderValue<std::vector<UInt_t>>                  m_offsets;
+    std::unique_ptr<TTreeReaderValue<std::vector<UInt_t>>> m_pElementOffsets;
+};
+
 #endif // #ifndef LAR_ANALYSIS_ROOT_COMMON
@@ -1,66 +1,498 @@
 #include "Common.h"
 
+#include "../larphysicscontent/LArNtupleReader/LArNtupleReader.h"
+
+#include "Math/IFunction.h"
+#include "Minuit2/Minuit2Minimizer.h"
+#include "RConfigure.h"
 #include "TFile.h"
-#include "TFitter.h"
-#include "TMinuit.h"
 #include "TNtuple.h"
-
+#include "TTree.h"
+
+// Parallel fits need a ROOT built with implicit multithreading, and are otherwise run serially
+#ifdef R__USE_IMT
+#include "ROOT/TSeq.hxx"
+#include "ROOT/TThreadExecutor.hxx"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
-std::vector<float>              g_trueEnergy;
-std::vector<float>              g_showerChargeVector;
-std::vector<std::vector<float>> g_dQdXVector;
-std::vector<std::vector<float>> g_dXVector;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The ntuple is read through the compiled ntuple reader library, built and installed alongside LArPhysicsContent
+R__LOAD_LIBRARY(libLArNtupleReader)
+
+using lar_physics_content::LArColumnSpan;
+using lar_physics_content::LArNtupleReader;
+
+// A read-only view of some or all of the flattened training data, over the vectors filled from the ntuple, a memory-mapped training
+// cache or a chunk of a training cache read from disk
+struct BirksTrainingView
+{
+    std::size_t          m_firstParticle; // The index of the first particle of the view within the whole training data
+    std::size_t          m_numParticles;  // The number of particles
+    const float *        m_pTrueEnergy;   // The true energy of each particle
+    const float *        m_pShowerCharge; // The shower charge of each particle
+    const std::uint64_t *m_pHitOffsets;   // The offset of each particle's hits into the hit arrays, plus a trailing end offset
+    const float *        m_pdQdX;         // The dQ/dx of each track hit
+    const float *        m_pdX;           // The dx of each track hit
+};
+
+// The training data, flattened once at load time: per-particle arrays, plus per-hit arrays indexed through the particle hit offsets
+struct BirksTrainingData
+{
+    std::vector<float>         m_trueEnergy;   // The true energy of each particle
+    std::vector<float>         m_showerCharge; // The shower charge of each particle
+    std::vector<std::uint64_t> m_hitOffsets; // The offset of each particle's hits into the hit arrays, plus a trailing end offset
+    std::vector<float>         m_dQdX;       // The dQ/dx of each track hit
+    std::vector<float>         m_dX;         // The dx of each track hit
+
+    std::size_t NumParticles() const
+    {
+        return m_trueEnergy.size();
+    }
+
+    BirksTrainingView GetView() const
+    {
+        return BirksTrainingView{
+            0UL, this->NumParticles(), m_trueEnergy.data(), m_showerCharge.data(), m_hitOffsets.data(), m_dQdX.data(), m_dX.data()};
+    }
+
+    void AddParticle(
+        const float trueEnergy, const float showerCharge, const MatrixRowView<Float_t> &dQdXValues, const MatrixRowView<Float_t> &dXValues)
+    {
+        if (m_hitOffsets.empty())
+            m_hitOffsets.push_back(0UL);
+
+        // Both matrices come from the same hits, so only a corrupt input could have rows of different lengths
+        const std::size_t numHits = std::min(dQdXValues.size(), dXValues.size());
+
+        m_trueEnergy.push_back(trueEnergy);
+        m_showerCharge.push_back(showerCharge);
+        m_dQdX.insert(m_dQdX.end(), dQdXValues.begin(), dQdXValues.begin() + numHits);
+        m_dX.insert(m_dX.end(), dXValues.begin(), dXValues.begin() + numHits);
+        m_hitOffsets.push_back(m_dQdX.size());
+    }
+};
+
+// The selection cuts applied to the primaries and cosmic rays before they are used for training
+struct BirksSelection
+{
+    float       m_minEnergyWeightedContainedPfoFraction; // The minimum energy-weighted fraction of the PFO contained in the detector
+    float       m_minMcMatchCompleteness;                // The minimum completeness of the MC match
+    float       m_minMcMatchPurity;                      // The minimum purity of the MC match
+    float       m_maxHitFracLostByFit;                   // The maximum fraction of hits lost to fitting errors
+    std::size_t m_minNumCollectionPlaneHits;             // The minimum number of collection plane hits
+};
+
+// The training cache file starts with this header, followed by the hit offsets (one more than the number of particles), the true
+// energies and shower charges (one per particle), then the dQ/dx and dx values (one per hit). The 64-bit offsets come first so that
+// every array in the mapped file is aligned
+struct BirksCacheHeader
+{
+    char          m_magic[8];      // The file type tag
+    std::uint32_t m_version;       // The layout version
+    std::uint32_t m_padding;       // Unused, keeps the counts aligned
+    std::uint64_t m_selectionHash; // The hash of the selection and input file that produced the cached data
+    std::uint64_t m_numParticles;  // The number of particles
+    std::uint64_t m_numHits;       // The number of hits
+    std::uint64_t m_numPrimaries;  // The number of particles that are primaries
+    std::uint64_t m_numCosmicRays; // The number of particles that are cosmic rays
+};
+
+// A training cache file mapped read-only into memory, so that the fit reads the selected data straight from the page cache
+class MappedTrainingCache
+{
+public:
+    MappedTrainingCache() :
+        m_pData(nullptr),
+        m_size(0UL)
+    {
+    }
+
+    MappedTrainingCache(const MappedTrainingCache &) = delete;
+    MappedTrainingCache &operator=(const MappedTrainingCache &) = delete;
+
+    ~MappedTrainingCache()
+    {
+        this->Unmap();
+    }
+
+    bool Map(const char *const filePath, const std::uint64_t selectionHash);
+    void Unmap();
+
+    const BirksCacheHeader &GetHeader() const
+    {
+        return *static_cast<const BirksCacheHeader *>(m_pData);
+    }
+
+    BirksTrainingView GetView() const;
+
+private:
+    void *      m_pData; // The start of the mapping, or null if no file is mapped
+    std::size_t m_size;  // The size of the mapping
+};
+
+// A training cache file read from disk one chunk of particles at a time, so that fits over samples too large for memory only ever
+// hold one chunk, of at most a given size
+class StreamingTrainingCache
+{
+public:
+    StreamingTrainingCache() :
+        m_fileDescriptor(-1),
+        m_header(),
+        m_chunkBoundaries(),
+        m_chunk(),
+        m_loadedChunk(0UL),
+        m_hasLoadedChunk(false)
+    {
+    }
+
+    StreamingTrainingCache(const StreamingTrainingCache &) = delete;
+    StreamingTrainingCache &operator=(const StreamingTrainingCache &) = delete;
+
+    ~StreamingTrainingCache()
+    {
+        this->Close();
+    }
+
+    bool Open(const char *const filePath, const std::uint64_t selectionHash, const std::size_t maxChunkBytes);
+    void Close();
+
+    const BirksCacheHeader &GetHeader() const
+    {
+        return m_header;
+    }
+
+    std::size_t NumChunks() const
+    {
+        return m_chunkBoundaries.empty() ? 0UL : m_chunkBoundaries.size() - 1UL;
+    }
+
+    BirksTrainingView LoadChunk(const std::size_t chunk);
+    void              VisitChunks(const std::function<void(const BirksTrainingView &)> &visitor);
+
+private:
+    void ReadSection(void *const pBuffer, const std::size_t numBytes, const std::size_t fileOffset) const;
+
+    int                      m_fileDescriptor;  // The cache file descriptor, or -1 if no file is open
+    BirksCacheHeader         m_header;          // The cache file header
+    std::vector<std::size_t> m_chunkBoundaries; // The index of the first particle of each chunk, plus a trailing end index
+    BirksTrainingData        m_chunk;           // The loaded chunk, with its hit offsets relative to its first hit
+    std::size_t              m_loadedChunk;     // The index of the loaded chunk
+    bool                     m_hasLoadedChunk;  // Whether a chunk has been loaded
+};
+
+// The cache layout version, to be increased whenever the layout or the selection logic in LoadTrainingData changes
+const char *const  g_cacheMagic       = "BIRKSFIT";
+const unsigned int g_cacheVersion     = 1U;
+const unsigned int g_numCacheSections = 5U;
+
+// The objective is summed over a fixed partition of the particles, independent of the number of threads, and the chunk sums are then
+// added in chunk order, so that every fit is reproducible whatever the thread count
+const unsigned int g_numObjectiveChunks = 256U;
+
+BirksTrainingData                      g_trainingData;
+MappedTrainingCache                    g_trainingCache;
+BirksTrainingView                      g_trainingView{0UL, 0UL, nullptr, nullptr, nullptr, nullptr, nullptr};
+std::unique_ptr<StreamingTrainingCache> g_pTrainingStream;
+#ifdef R__USE_IMT
+std::unique_ptr<ROOT::TThreadExecutor> g_pThreadExecutor;
+#endif
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The estimated energy of a particle, with its partial derivatives with respect to alpha and beta
+struct EnergyEstimate
+{
+    float m_energy;   // The estimated energy
+    float m_dEdAlpha; // The derivative of the estimated energy with respect to alpha
+    float m_dEdBeta;  // The derivative of the estimated energy with respect to beta
+};
+
+// The terms of the objective over some particles: the weighted squared errors and their derivatives with respect to alpha and beta
+struct ObjectiveTerms
+{
+    double m_squaredError;      // The weighted sum of the squared errors
+    double m_squaredErrorAlpha; // The weighted sum of the derivatives of the squared errors with respect to alpha
+    double m_squaredErrorBeta;  // The weighted sum of the derivatives of the squared errors with respect to beta
+    double m_sumWeights;        // The sum of the particle weights
+};
+
+// The result of one bootstrap refit
+struct BootstrapReplica
+{
+    unsigned int m_replica; // The replica index
+    int          m_status;  // The MIGRAD status
+    double       m_alpha;   // The fitted alpha'
+    double       m_beta;    // The fitted beta'
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void VisitTrainingData(const std::function<void(const BirksTrainingView &)> &visitor)
+{
+    // Streamed training data is visited one chunk at a time, and training data in memory all at once
+    if (g_pTrainingStream)
+        g_pTrainingStream->VisitChunks(visitor);
+
+    else
+        visitor(g_trainingView);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+BirksTrainingView GetSubView(const BirksTrainingView &view, const std::size_t beginIndex, const std::size_t endIndex)
+{
+    // The hit offsets index the whole hit arrays of the view, so only the per-particle pointers move
+    return BirksTrainingView{view.m_firstParticle + beginIndex, endIndex - beginIndex, view.m_pTrueEnergy + beginIndex,
+        view.m_pShowerCharge + beginIndex, view.m_pHitOffsets + beginIndex, view.m_pdQdX, view.m_pdX};
+}
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-float GetEstimatedEnergy(const float alpha, const float beta, const int index)
+EnergyEstimate GetEnergyEstimate(const BirksTrainingView &view, const float alpha, const float beta, const std::size_t index)
 {
+    const float *const dQdX = view.m_pdQdX;
+    const float *const dX   = view.m_pdX;
+
     // Scale up the charge induced by showers by alpha
-    float estimatedEnergy = alpha * g_showerChargeVector.at(index);
+    EnergyEstimate estimate{alpha * view.m_pShowerCharge[index], view.m_pShowerCharge[index], 0.f};
 
-    // Apply Birks' correction to get to dE = dx * dE/dx
-    for (int i = 0, numBirksHits = g_dQdXVector.at(index).size(); i < numBirksHits; ++i)
+    // Apply Birks' correction to get to dE = dx * dE/dx, differentiating whichever branch each hit takes
+    for (std::size_t i = view.m_pHitOffsets[index], end = view.m_pHitOffsets[index + 1UL]; i < end; ++i)
     {
-        const float dEdX_noBirks = alpha * g_dQdXVector.at(index).at(i);
-        const float dEdX_Birks   = dEdX_noBirks / (1.f - beta * g_dQdXVector.at(index).at(i));
+        const float dEdX_noBirks = alpha * dQdX[i];
+        const float birksFactor  = 1.f / (1.f - beta * dQdX[i]);
+        const float dEdX_Birks   = dEdX_noBirks * birksFactor;
 
         if (dEdX_Birks > 0.f && dEdX_Birks < 1000.f)
-            estimatedEnergy += dEdX_Birks * g_dXVector.at(index).at(i);
+        {
+            estimate.m_energy += dEdX_Birks * dX[i];
+            estimate.m_dEdAlpha += dQdX[i] * birksFactor * dX[i];
+            estimate.m_dEdBeta += dEdX_Birks * dQdX[i] * birksFactor * dX[i];
+        }
 
         else
-            estimatedEnergy += dEdX_noBirks * g_dXVector.at(index).at(i);
+        {
+            estimate.m_energy += dEdX_noBirks * dX[i];
+            estimate.m_dEdAlpha += dQdX[i] * dX[i];
+        }
     }
 
-    return estimatedEnergy;
+    return estimate;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-double CalculateMeanSquaredError(const double alpha, const double beta)
+float GetEstimatedEnergy(const BirksTrainingView &view, const float alpha, const float beta, const std::size_t index)
+{
+    return GetEnergyEstimate(view, alpha, beta, index).m_energy;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+ObjectiveTerms CalculateObjectiveTerms(const BirksTrainingView &view, const double alpha, const double beta, const float *const pWeights,
+    const std::size_t beginIndex, const std::size_t endIndex)
+{
+    ObjectiveTerms terms{0., 0., 0., 0.};
+
+    for (std::size_t i = beginIndex; i < endIndex; ++i)
+    {
+        // Without weights every particle counts once, and a bootstrap replica skips the particles it did not draw
+        const double weight = pWeights ? pWeights[view.m_firstParticle + i] : 1.;
+
+        if (weight <= 0.)
+            continue;
+
+        const EnergyEstimate estimate = GetEnergyEstimate(view, alpha, beta, i);
+        const double         residual = view.m_pTrueEnergy[i] - estimate.m_energy;
+
+        terms.m_squaredError += weight * residual * residual;
+        terms.m_squaredErrorAlpha -= 2. * weight * residual * estimate.m_dEdAlpha;
+        terms.m_squaredErrorBeta -= 2. * weight * residual * estimate.m_dEdBeta;
+        terms.m_sumWeights += weight;
+    }
+
+    return terms;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void AddObjectiveTerms(const ObjectiveTerms &terms, ObjectiveTerms &sum)
+{
+    sum.m_squaredError += terms.m_squaredError;
+    sum.m_squaredErrorAlpha += terms.m_squaredErrorAlpha;
+    sum.m_squaredErrorBeta += terms.m_squaredErrorBeta;
+    sum.m_sumWeights += terms.m_sumWeights;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void NormaliseObjectiveTerms(ObjectiveTerms &terms)
+{
+    if (terms.m_sumWeights > 0.)
+    {
+        terms.m_squaredError /= terms.m_sumWeights;
+        terms.m_squaredErrorAlpha /= terms.m_sumWeights;
+        terms.m_squaredErrorBeta /= terms.m_sumWeights;
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+ObjectiveTerms SumObjectiveTerms(
+    const BirksTrainingView &view, const double alpha, const double beta, const float *const pWeights, const bool isParallel)
 {
-    float     meanSquareError = 0.f;
-    const int numDataPoints   = g_trueEnergy.size();
+    const std::size_t numDataPoints = view.m_numParticles;
+
+    if (numDataPoints == 0UL)
+        return ObjectiveTerms{0., 0., 0., 0.};
+
+    const auto chunkTerms = [&](const unsigned int chunk) {
+        const std::size_t beginIndex = chunk * numDataPoints / g_numObjectiveChunks;
+        const std::size_t endIndex   = (chunk + 1U) * numDataPoints / g_numObjectiveChunks;
+        return CalculateObjectiveTerms(view, alpha, beta, pWeights, beginIndex, endIndex);
+    };
 
-    for (int i = 0; i < numDataPoints; i++)
+    // Map returns the chunk terms in chunk order, whichever threads computed them
+    std::vector<ObjectiveTerms> allChunkTerms;
+
+#ifdef R__USE_IMT
+    if (isParallel && g_pThreadExecutor)
+        allChunkTerms = g_pThreadExecutor->Map(chunkTerms, ROOT::TSeqU(g_numObjectiveChunks));
+#else
+    (void)isParallel;
+#endif
+
+    if (allChunkTerms.empty())
     {
-        const float trueEnergy      = g_trueEnergy.at(i);
-        const float estimatedEnergy = GetEstimatedEnergy(alpha, beta, i);
-        meanSquareError += (trueEnergy - estimatedEnergy) * (trueEnergy - estimatedEnergy);
+        for (unsigned int chunk = 0U; chunk < g_numObjectiveChunks; ++chunk)
+            allChunkTerms.push_back(chunkTerms(chunk));
     }
 
-    return meanSquareError / numDataPoints;
+    ObjectiveTerms sum{0., 0., 0., 0.};
+
+    for (const ObjectiveTerms &terms : allChunkTerms)
+        AddObjectiveTerms(terms, sum);
+
+    return sum;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void MinuitFunction(Int_t &npar, Double_t *gin, Double_t &result, Double_t par[], Int_t iflag)
+ObjectiveTerms CalculateObjective(const double alpha, const double beta, const float *const pWeights, const bool isParallel)
 {
-    result = CalculateMeanSquaredError(par[0], par[1]);
+    ObjectiveTerms objective{0., 0., 0., 0.};
+
+    // Streamed chunks are summed in file order, so the objective only depends on the chunk size, not on the thread count
+    VisitTrainingData([&](const BirksTrainingView &view) {
+        AddObjectiveTerms(SumObjectiveTerms(view, alpha, beta, pWeights, isParallel), objective);
+    });
+
+    NormaliseObjectiveTerms(objective);
+
+    return objective;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+double CalculateMeanSquaredError(const double alpha, const double beta)
+{
+    return CalculateObjective(alpha, beta, nullptr, true).m_squaredError;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The (optionally weighted) mean squared error as a Minuit2 objective with analytic derivatives. The value and the gradient come from
+// the same pass over the data, and the last point is cached because the minimizer asks for the value and the gradient at each point
+// separately. Objectives evaluated serially can be minimized concurrently, one per thread
+class BirksObjectiveFunction : public ROOT::Math::IMultiGradFunction
+{
+public:
+    BirksObjectiveFunction(const float *const pWeights, const bool isParallel) :
+        m_pWeights(pWeights),
+        m_isParallel(isParallel),
+        m_hasCache(false),
+        m_cacheAlpha(0.),
+        m_cacheBeta(0.),
+        m_cacheTerms{0., 0., 0., 0.}
+    {
+    }
+
+    unsigned int NDim() const override
+    {
+        return 2U;
+    }
+
+    ROOT::Math::IMultiGradFunction *Clone() const override
+    {
+        return new BirksObjectiveFunction(*this);
+    }
+
+    void Gradient(const double *x, double *gradient) const override
+    {
+        const ObjectiveTerms &terms = this->GetTerms(x);
+        gradient[0]                 = terms.m_squaredErrorAlpha;
+        gradient[1]                 = terms.m_squaredErrorBeta;
+    }
+
+    void FdF(const double *x, double &value, double *gradient) const override
+    {
+        this->Gradient(x, gradient);
+        value = this->GetTerms(x).m_squaredError;
+    }
+
+private:
+    double DoEval(const double *x) const override
+    {
+        return this->GetTerms(x).m_squaredError;
+    }
+
+    double DoDerivative(const double *x, unsigned int icoord) const override
+    {
+        return (icoord == 0U) ? this->GetTerms(x).m_squaredErrorAlpha : this->GetTerms(x).m_squaredErrorBeta;
+    }
+
+    const ObjectiveTerms &GetTerms(const double *x) const
+    {
+        if (!m_hasCache || x[0] != m_cacheAlpha || x[1] != m_cacheBeta)
+        {
+            m_cacheTerms = CalculateObjective(x[0], x[1], m_pWeights, m_isParallel);
+            m_cacheAlpha = x[0];
+            m_cacheBeta  = x[1];
+            m_hasCache   = true;
+        }
+
+        return m_cacheTerms;
+    }
+
+    const float *          m_pWeights;   // The particle weights, or null to weight every particle equally
+    bool                   m_isParallel; // Whether to evaluate the objective on the thread pool
+    mutable bool           m_hasCache;   // Whether the cache holds a point
+    mutable double         m_cacheAlpha; // The alpha value of the cached point
+    mutable double         m_cacheBeta;  // The beta value of the cached point
+    mutable ObjectiveTerms m_cacheTerms; // The objective terms at the cached point
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 const char *MinuitStatusToString(const int status)
 {
     switch (status)
@@ -86,67 +518,198 @@ const char *MinuitStatusToString(const int status)
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void RunMinuitFit(double &alpha, double &beta, const double alpha_initial, const double beta_initial, const double stepSizeFraction)
+int RunMinuitFit(const BirksObjectiveFunction &objectiveFunction, double &alpha, double &beta, const double alpha_initial,
+    const double beta_initial, const double stepSizeFraction, const bool useSimplex, const bool isVerbose)
 {
-    TFitter *pTFitter = new TFitter(2);
+    const unsigned int maxIterations = 500000000U;
+
+    double migradAlpha(alpha), migradBeta(beta);
+
+    // Simplex does not use derivatives, but brings MIGRAD close to the minimum from a rough starting point
+    if (useSimplex)
+    {
+        ROOT::Minuit2::Minuit2Minimizer simplex(ROOT::Minuit2::kSimplex);
+        simplex.SetPrintLevel(0);
+        simplex.SetMaxFunctionCalls(maxIterations);
+        simplex.SetMaxIterations(maxIterations);
+        simplex.SetFunction(objectiveFunction);
+        simplex.SetVariable(0, "alpha", alpha, alpha_initial * stepSizeFraction);
+        simplex.SetVariable(1, "beta", beta, beta_initial * stepSizeFraction);
+        simplex.Minimize();
+
+        if (isVerbose && simplex.Status() != 0)
+            CERR("Simplex fit returned an error: " << MinuitStatusToString(simplex.Status()));
+
+        migradAlpha = simplex.X()[0];
+        migradBeta  = simplex.X()[1];
+    }
+
+    // MIGRAD takes the analytic gradient from the objective, rather than differencing it numerically
+    ROOT::Minuit2::Minuit2Minimizer migrad(ROOT::Minuit2::kMigrad);
+    migrad.SetPrintLevel(0);
+    migrad.SetMaxFunctionCalls(maxIterations);
+    migrad.SetMaxIterations(maxIterations);
+    migrad.SetFunction(objectiveFunction);
+    migrad.SetVariable(0, "alpha", migradAlpha, alpha_initial * stepSizeFraction);
+    migrad.SetVariable(1, "beta", migradBeta, beta_initial * stepSizeFraction);
+    migrad.Minimize();
+
+    alpha = migrad.X()[0];
+    beta  = migrad.X()[1];
 
+    if (isVerbose)
     {
-        double arg = -1.;
-        pTFitter->ExecuteCommand("SET PRINTOUT", &arg, 1);
+        if (migrad.Status() != 0)
+            CERR("Migrad fit returned an error: " << MinuitStatusToString(migrad.Status()));
+
+        COUT("Chi squared value at best parameters is " << objectiveFunction(migrad.X()) << " (" << migrad.NCalls() << " MIGRAD calls)");
     }
 
-    pTFitter->SetFCN(MinuitFunction);
+    return migrad.Status();
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+BootstrapReplica RunBootstrapReplica(const unsigned int replica, const unsigned int seed, const double alphaBest, const double betaBest,
+    const double alphaInitial, const double betaInitial, const double stepSizeFraction)
+{
+    const std::size_t numDataPoints = g_trainingView.m_numParticles;
 
-    pTFitter->SetParameter(0, "alpha", alpha_initial, alpha_initial * stepSizeFraction, 0, 0);
-    pTFitter->SetParameter(1, "beta", beta_initial, beta_initial * stepSizeFraction, 0, 0);
+    // Drawing the particles with replacement only changes how often each one counts, so the replica is a set of weights over the
+    // shared data. The generator is seeded from the replica index, so each replica is reproducible whichever thread runs it
+    std::seed_seq                              seedSequence{seed, replica};
+    std::mt19937_64                            generator(seedSequence);
+    std::uniform_int_distribution<std::size_t> distribution(0UL, numDataPoints - 1UL);
+    std::vector<float>                         weights(numDataPoints, 0.f);
 
-    double maxIterations[] = {500000000.};
+    for (std::size_t i = 0UL; i < numDataPoints; ++i)
+        weights[distribution(generator)] += 1.f;
 
-    int status = pTFitter->ExecuteCommand("SIMPLEX", maxIterations, 1);
+    // The replicas themselves run concurrently, so each objective is evaluated serially and starts from the nominal best fit
+    const BirksObjectiveFunction objectiveFunction(weights.data(), false);
+    BootstrapReplica             result{replica, 0, alphaBest, betaBest};
+    result.m_status =
+        RunMinuitFit(objectiveFunction, result.m_alpha, result.m_beta, alphaInitial, betaInitial, stepSizeFraction, true, false);
 
-    if (status != 0)
-        CERR("Simplex fit returned an error: " << MinuitStatusToString(status));
+    return result;
+}
 
-    TMinuit *const pMinuit = pTFitter->GetMinuit();
-    int            errFlag = 0;
-    pMinuit->mnexcm("MIGRAD", maxIterations, 1, errFlag);
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-    if (status != 0)
-        CERR("Migrad fit returned an error: " << MinuitStatusToString(status));
+std::vector<BootstrapReplica> RunBootstrap(const unsigned int numReplicas, const unsigned int seed, const double alphaBest,
+    const double betaBest, const double alphaInitial, const double betaInitial, const double stepSizeFraction)
+{
+    const auto runReplica = [&](const unsigned int replica) {
+        return RunBootstrapReplica(replica, seed, alphaBest, betaBest, alphaInitial, betaInitial, stepSizeFraction);
+    };
 
-    alpha = pTFitter->GetParameter(0);
-    beta  = pTFitter->GetParameter(1);
+#ifdef R__USE_IMT
+    if (g_pThreadExecutor)
+        return g_pThreadExecutor->Map(runReplica, ROOT::TSeqU(numReplicas));
+#endif
 
-    double minFunctionError = CalculateMeanSquaredError(alpha, beta);
+    std::vector<BootstrapReplica> replicas;
 
-    COUT("Chi squared value at best parameters is " << minFunctionError);
+    for (unsigned int replica = 0U; replica < numReplicas; ++replica)
+        replicas.push_back(runReplica(replica));
 
-    delete pTFitter;
+    return replicas;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void MakeDebugPlots(const double alpha, const double beta, const char *const outputDir)
+void RunMinibatchWarmUp(double &alpha, double &beta, const double alphaInitial, const double betaInitial, const unsigned int numEpochs,
+    const std::size_t minibatchSize, const double learningRate, const unsigned int seed)
 {
-    TFile *        pFile    = new TFile(TString(outputDir) + "/Tmp.root", "RECREATE");
-    TNtuple *const pNtuple1 = new TNtuple("BirksFit", "BirksFit", "EstimatedEnergy:TrueEnergy");
-    TNtuple *const pNtuple2 = new TNtuple("BirksFit", "BirksFit", "Discrepancy:TrueEnergy");
+    const double firstMomentDecay  = 0.9;
+    const double secondMomentDecay = 0.999;
+    const double epsilon           = 1.e-8;
+
+    // Adam steps, in units of the initial values so that alpha and beta are both of order one despite being orders of magnitude apart
+    const double scales[2] = {alphaInitial, betaInitial};
+    double       position[2]{alpha / alphaInitial, beta / betaInitial};
+    double       firstMoment[2]{0., 0.}, secondMoment[2]{0., 0.};
+    unsigned int numSteps(0U);
 
-    const int numDataPoints = g_trueEnergy.size();
+    std::mt19937_64          generator(seed);
+    std::vector<std::size_t> chunkOrder(g_pTrainingStream->NumChunks()), minibatchOrder;
+    std::iota(chunkOrder.begin(), chunkOrder.end(), 0UL);
 
-    for (int i = 0; i < numDataPoints; i++)
+    for (unsigned int epoch = 0U; epoch < numEpochs; ++epoch)
     {
-        const float trueEnergy      = g_trueEnergy.at(i);
-        const float estimatedEnergy = GetEstimatedEnergy(alpha, beta, i);
+        double      sumSquaredError(0.);
+        std::size_t numMinibatches(0UL);
 
-        if (estimatedEnergy > 0.f)
+        // Shuffling the chunks, then the minibatches within each chunk, reads each chunk from disk once per epoch
+        std::shuffle(chunkOrder.begin(), chunkOrder.end(), generator);
+
+        for (const std::size_t chunk : chunkOrder)
         {
-            const float fractionalDiscrepancy = (estimatedEnergy - trueEnergy) / trueEnergy;
-            pNtuple1->Fill(estimatedEnergy, trueEnergy);
-            pNtuple2->Fill(fractionalDiscrepancy, trueEnergy);
+            const BirksTrainingView chunkView = g_pTrainingStream->LoadChunk(chunk);
+
+            minibatchOrder.resize((chunkView.m_numParticles + minibatchSize - 1UL) / minibatchSize);
+            std::iota(minibatchOrder.begin(), minibatchOrder.end(), 0UL);
+            std::shuffle(minibatchOrder.begin(), minibatchOrder.end(), generator);
+
+            for (const std::size_t minibatch : minibatchOrder)
+            {
+                const std::size_t       beginIndex = minibatch * minibatchSize;
+                const std::size_t       endIndex   = std::min(beginIndex + minibatchSize, chunkView.m_numParticles);
+                const BirksTrainingView minibatchView(GetSubView(chunkView, beginIndex, endIndex));
+
+                // Minibatches are small, so the thread pool would cost more than it saves
+                ObjectiveTerms terms = SumObjectiveTerms(minibatchView, position[0] * scales[0], position[1] * scales[1], nullptr, false);
+                NormaliseObjectiveTerms(terms);
+
+                const double gradient[2] = {terms.m_squaredErrorAlpha * scales[0], terms.m_squaredErrorBeta * scales[1]};
+                ++numSteps;
+
+                for (unsigned int d = 0U; d < 2U; ++d)
+                {
+                    firstMoment[d]  = firstMomentDecay * firstMoment[d] + (1. - firstMomentDecay) * gradient[d];
+                    secondMoment[d] = secondMomentDecay * secondMoment[d] + (1. - secondMomentDecay) * gradient[d] * gradient[d];
+
+                    const double firstMomentEstimate  = firstMoment[d] / (1. - std::pow(firstMomentDecay, numSteps));
+                    const double secondMomentEstimate = secondMoment[d] / (1. - std::pow(secondMomentDecay, numSteps));
+                    position[d] -= learningRate * firstMomentEstimate / (std::sqrt(secondMomentEstimate) + epsilon);
+                }
+
+                sumSquaredError += terms.m_squaredError;
+                ++numMinibatches;
+            }
         }
+
+        COUT("Warm-up epoch " << epoch << ": mean minibatch squared error " << sumSquaredError / std::max(numMinibatches, 1UL)
+                              << " at alpha' = " << position[0] * scales[0] << ", beta' = " << position[1] * scales[1]);
     }
 
+    alpha = position[0] * scales[0];
+    beta  = position[1] * scales[1];
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void MakeDebugPlots(const double alpha, const double beta, const char *const outputDir)
+{
+    TFile *        pFile    = new TFile(TString(outputDir) + "/Tmp.root", "RECREATE");
+    TNtuple *const pNtuple1 = new TNtuple("BirksFit", "BirksFit", "EstimatedEnergy:TrueEnergy");
+    TNtuple *const pNtuple2 = new TNtuple("BirksFit", "BirksFit", "Discrepancy:TrueEnergy");
+
+    VisitTrainingData([&](const BirksTrainingView &view) {
+        for (std::size_t i = 0UL; i < view.m_numParticles; ++i)
+        {
+            const float trueEnergy      = view.m_pTrueEnergy[i];
+            const float estimatedEnergy = GetEstimatedEnergy(view, alpha, beta, i);
+
+            if (estimatedEnergy > 0.f)
+            {
+                const float fractionalDiscrepancy = (estimatedEnergy - trueEnergy) / trueEnergy;
+                pNtuple1->Fill(estimatedEnergy, trueEnergy);
+                pNtuple2->Fill(fractionalDiscrepancy, trueEnergy);
+            }
+        }
+    });
+
     {
         struct PlotSettings2D plotSettings    = g_defaultPlotSettings2D;
         plotSettings.xMax                     = 1;
@@ -179,7 +742,8 @@ void MakeDebugPlots(const double alpha, const double beta, const char *const out
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void OutputToNTuple(const TString &outputFilePath, const double alphaOut, const double betaOut, const double dQdxPole)
+void OutputToNTuple(const TString &outputFilePath, const double alphaOut, const double betaOut, const double dQdxPole,
+    const std::vector<BootstrapReplica> &bootstrapReplicas, const unsigned int bootstrapSeed)
 {
     TFile *pFile = new TFile(outputFilePath, "RECREATE");
 
@@ -187,127 +751,822 @@ void OutputToNTuple(const TString &outputFilePath, const double alphaOut, const
     pNtuple->Fill(alphaOut, betaOut, dQdxPole);
     pNtuple->Write();
 
+    if (!bootstrapReplicas.empty())
+    {
+        UInt_t   replica(0U), seed(bootstrapSeed);
+        Int_t    status(0);
+        Double_t alpha(0.), beta(0.), alphaPrime(0.), betaPrime(0.), pole(0.);
+
+        TTree *const pTree = new TTree("BirksBootstrap", "BirksBootstrap");
+        pTree->Branch("Replica", &replica, "Replica/i");
+        pTree->Branch("Seed", &seed, "Seed/i");
+        pTree->Branch("Status", &status, "Status/I");
+        pTree->Branch("AlphaPrime", &alphaPrime, "AlphaPrime/D");
+        pTree->Branch("BetaPrime", &betaPrime, "BetaPrime/D");
+        pTree->Branch("Alpha", &alpha, "Alpha/D");
+        pTree->Branch("Beta", &beta, "Beta/D");
+        pTree->Branch("dQdXPole", &pole, "dQdXPole/D");
+
+        for (const BootstrapReplica &result : bootstrapReplicas)
+        {
+            replica    = result.m_replica;
+            status     = result.m_status;
+            alphaPrime = result.m_alpha;
+            betaPrime  = result.m_beta;
+            alpha      = 1. / result.m_alpha;
+            beta       = result.m_alpha / result.m_beta;
+            pole       = 1. / result.m_beta;
+            pTree->Fill();
+        }
+
+        pTree->Write();
+    }
+
     pFile->Close();
     delete pFile;
 }
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-void FitBirksData(const char *const inputFilePath, const char *const ntupleName, const char *const outputDir, const char *const outputName)
+std::uint64_t HashBytes(const void *const pBytes, const std::size_t numBytes, std::uint64_t hash)
 {
-    const float       minEnergyWeightedContainedPfoFraction = 0.9f;
-    const float       minMcMatchCompleteness                = 0.9f;
-    const float       minMcMatchPurity                      = 0.9f;
-    const float       maxHitFracLostByFit                   = 0.1f;
-    const std::size_t minNumCollectionPlaneHits             = 3UL;
+    const unsigned char *const pChars = static_cast<const unsigned char *>(pBytes);
 
-    // Load the ntuple
-    TFile       ntupleFile(inputFilePath);
-    TTreeReader treeReader(ntupleName, &ntupleFile);
-
-    // Primary fit data
-    TTreeReaderValue<UInt_t>                            numPrimaryEntries(treeReader, "numPrimaryEntries");
-    TTreeReaderValue<std::vector<std::vector<Float_t>>> primary_dQdX(treeReader, "primary_dQdX");
-    TTreeReaderValue<std::vector<std::vector<Float_t>>> primary_dX(treeReader, "primary_dX");
-    TTreeReaderValue<std::vector<Float_t>>              primary_ShowerCharge(treeReader, "primary_ShowerCharge");
-    TTreeReaderValue<std::vector<Float_t>>              primary_mc_KineticEnergy(treeReader, "primary_mc_KineticEnergy");
-
-    // Primary quality cut data
-    TTreeReaderValue<std::vector<UInt_t>>  primary_NumVectorEntries(treeReader, "primary_NumVectorEntries");
-    TTreeReaderValue<std::vector<UInt_t>>  primary_NumHitsLostToFittingErrors(treeReader, "primary_NumHitsLostToFittingErrors");
-    TTreeReaderValue<std::vector<Bool_t>>  primary_WasReconstructedWithVertex(treeReader, "primary_WasReconstructedWithVertex");
-    TTreeReaderValue<std::vector<Bool_t>>  primary_HasMCInfo(treeReader, "primary_HasMCInfo");
-    TTreeReaderValue<std::vector<Bool_t>>  primary_IsVertexFiducial(treeReader, "primary_IsVertexFiducial");
-    TTreeReaderValue<std::vector<Float_t>> primary_mc_EnergyWeightedContainedPfoFraction(
-        treeReader, "primary_mc_EnergyWeightedContainedPfoFraction");
-    TTreeReaderValue<std::vector<Bool_t>>  primary_mc_IsGoodMatch(treeReader, "primary_mc_IsGoodMatch");
-    TTreeReaderValue<std::vector<Float_t>> primary_mc_MatchPurity(treeReader, "primary_mc_MatchPurity");
-    TTreeReaderValue<std::vector<Float_t>> primary_mc_MatchCompleteness(treeReader, "primary_mc_MatchCompleteness");
-
-    // Cosmic fit data
-    TTreeReaderValue<UInt_t>                            numCosmicRayEntries(treeReader, "numCosmicRayEntries");
-    TTreeReaderValue<std::vector<std::vector<Float_t>>> cr_dQdX(treeReader, "cr_dQdX");
-    TTreeReaderValue<std::vector<std::vector<Float_t>>> cr_dX(treeReader, "cr_dX");
-    TTreeReaderValue<std::vector<Float_t>>              cr_ShowerCharge(treeReader, "cr_ShowerCharge");
-    TTreeReaderValue<std::vector<Float_t>>              cr_mc_KineticEnergy(treeReader, "cr_mc_KineticEnergy");
-
-    // Cosmic quality cut data
-    TTreeReaderValue<std::vector<UInt_t>>  cr_NumVectorEntries(treeReader, "cr_NumVectorEntries");
-    TTreeReaderValue<std::vector<UInt_t>>  cr_NumHitsLostToFittingErrors(treeReader, "cr_NumHitsLostToFittingErrors");
-    TTreeReaderValue<std::vector<Bool_t>>  cr_WasReconstructedWithVertex(treeReader, "cr_WasReconstructedWithVertex");
-    TTreeReaderValue<std::vector<Bool_t>>  cr_HasMCInfo(treeReader, "cr_HasMCInfo");
-    TTreeReaderValue<std::vector<Bool_t>>  cr_IsVertexFiducial(treeReader, "cr_IsVertexFiducial");
-    TTreeReaderValue<std::vector<Float_t>> cr_mc_EnergyWeightedContainedPfoFraction(treeReader, "cr_mc_EnergyWeightedContainedPfoFraction");
-    TTreeReaderValue<std::vector<Bool_t>>  cr_mc_IsGoodMatch(treeReader, "cr_mc_IsGoodMatch");
-    TTreeReaderValue<std::vector<Float_t>> cr_mc_MatchPurity(treeReader, "cr_mc_MatchPurity");
-    TTreeReaderValue<std::vector<Float_t>> cr_mc_MatchCompleteness(treeReader, "cr_mc_MatchCompleteness");
-
-    std::size_t numCosmicRayDatapoints(0UL), numPrimaryDatapoints(0UL);
-
-    while (treeReader.Next())
-    {
-        for (std::size_t i = 0U; i < *numPrimaryEntries; ++i)
+    // 64-bit FNV-1a
+    for (std::size_t i = 0UL; i < numBytes; ++i)
+    {
+        hash ^= pChars[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+std::uint64_t HashValue(const T &value, const std::uint64_t hash)
+{
+    return HashBytes(&value, sizeof(T), hash);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::uint64_t HashString(const char *const pString, const std::uint64_t hash)
+{
+    const std::size_t length = std::strlen(pString);
+    return HashBytes(pString, length, HashValue(length, hash));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::uint64_t GetSelectionHash(const BirksSelection &selection, const char *const inputFilePath, const char *const ntupleName)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+
+    // The cuts are hashed one at a time, so that the struct padding never enters the hash
+    hash = HashValue(selection.m_minEnergyWeightedContainedPfoFraction, hash);
+    hash = HashValue(selection.m_minMcMatchCompleteness, hash);
+    hash = HashValue(selection.m_minMcMatchPurity, hash);
+    hash = HashValue(selection.m_maxHitFracLostByFit, hash);
+    hash = HashValue(static_cast<std::uint64_t>(selection.m_minNumCollectionPlaneHits), hash);
+    hash = HashString(inputFilePath, hash);
+    hash = HashString(ntupleName, hash);
+
+    // A rewritten input file changes its size or modification time. Files that cannot be stat'ed, such as remote ones, are only
+    // identified by their path
+    struct stat  fileStatus;
+    std::int64_t fileSize(0), modificationTime(0);
+
+    if (stat(inputFilePath, &fileStatus) == 0)
+    {
+        fileSize         = static_cast<std::int64_t>(fileStatus.st_size);
+        modificationTime = static_cast<std::int64_t>(fileStatus.st_mtime);
+    }
+
+    hash = HashValue(fileSize, hash);
+    hash = HashValue(modificationTime, hash);
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::size_t GetCacheFileSize(const std::uint64_t numParticles, const std::uint64_t numHits)
+{
+    return sizeof(BirksCacheHeader) + (numParticles + 1UL) * sizeof(std::uint64_t) + 2UL * numParticles * sizeof(float) +
+           2UL * numHits * sizeof(float);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool IsCacheHeaderValid(const BirksCacheHeader &header, const std::size_t fileSize, const std::uint64_t selectionHash,
+    const char *const filePath)
+{
+    if (std::memcmp(header.m_magic, g_cacheMagic, sizeof(header.m_magic)) != 0 || header.m_version != g_cacheVersion)
+    {
+        COUT("Training cache at " << filePath << " has an unknown format or version, rebuilding it");
+        return false;
+    }
+
+    if (header.m_selectionHash != selectionHash)
+    {
+        COUT("Training cache at " << filePath << " was made with a different selection or input file, rebuilding it");
+        return false;
+    }
+
+    if (fileSize != GetCacheFileSize(header.m_numParticles, header.m_numHits))
+    {
+        CERR("Training cache at " << filePath << " does not match the size in its header, rebuilding it");
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool MappedTrainingCache::Map(const char *const filePath, const std::uint64_t selectionHash)
+{
+    this->Unmap();
+
+    const int fileDescriptor = open(filePath, O_RDONLY);
+
+    if (fileDescriptor < 0)
+    {
+        COUT("No training cache at " << filePath);
+        return false;
+    }
+
+    struct stat fileStatus;
+
+    if (fstat(fileDescriptor, &fileStatus) != 0 || static_cast<std::size_t>(fileStatus.st_size) < sizeof(BirksCacheHeader))
+    {
+        CERR("Training cache at " << filePath << " is truncated");
+        close(fileDescriptor);
+        return false;
+    }
+
+    // The mapping keeps the file open, so the descriptor is not needed once it exists
+    m_size  = static_cast<std::size_t>(fileStatus.st_size);
+    m_pData = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+
+    if (m_pData == MAP_FAILED)
+    {
+        CERR("Failed to map the training cache at " << filePath);
+        m_pData = nullptr;
+        m_size  = 0UL;
+        return false;
+    }
+
+    if (!IsCacheHeaderValid(this->GetHeader(), m_size, selectionHash, filePath))
+    {
+        this->Unmap();
+        return false;
+    }
+
+    // Every fit iteration sweeps the whole file in order
+    madvise(m_pData, m_size, MADV_SEQUENTIAL);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void MappedTrainingCache::Unmap()
+{
+    if (m_pData)
+        munmap(m_pData, m_size);
+
+    m_pData = nullptr;
+    m_size  = 0UL;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+BirksTrainingView MappedTrainingCache::GetView() const
+{
+    const BirksCacheHeader &header       = this->GetHeader();
+    const std::size_t       numParticles = header.m_numParticles;
+    const char *const       pHeaderEnd   = static_cast<const char *>(m_pData) + sizeof(BirksCacheHeader);
+
+    const std::uint64_t *const pHitOffsets   = reinterpret_cast<const std::uint64_t *>(pHeaderEnd);
+    const float *const         pTrueEnergy   = reinterpret_cast<const float *>(pHitOffsets + numParticles + 1UL);
+    const float *const         pShowerCharge = pTrueEnergy + numParticles;
+    const float *const         pdQdX         = pShowerCharge + numParticles;
+    const float *const         pdX           = pdQdX + header.m_numHits;
+
+    return BirksTrainingView{0UL, numParticles, pTrueEnergy, pShowerCharge, pHitOffsets, pdQdX, pdX};
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool StreamingTrainingCache::Open(const char *const filePath, const std::uint64_t selectionHash, const std::size_t maxChunkBytes)
+{
+    this->Close();
+
+    m_fileDescriptor = open(filePath, O_RDONLY);
+
+    if (m_fileDescriptor < 0)
+    {
+        COUT("No training cache at " << filePath);
+        return false;
+    }
+
+    struct stat fileStatus;
+
+    if (fstat(m_fileDescriptor, &fileStatus) != 0 || static_cast<std::size_t>(fileStatus.st_size) < sizeof(BirksCacheHeader))
+    {
+        CERR("Training cache at " << filePath << " is truncated");
+        this->Close();
+        return false;
+    }
+
+    this->ReadSection(&m_header, sizeof(m_header), 0UL);
+
+    if (!IsCacheHeaderValid(m_header, static_cast<std::size_t>(fileStatus.st_size), selectionHash, filePath))
+    {
+        this->Close();
+        return false;
+    }
+
+    posix_fadvise(m_fileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Greedily pack whole particles into chunks, each holding its hit offsets, true energies, shower charges, dQ/dx and dx. Only a single
+    // particle with more hits than fit in the budget makes a larger chunk. The offsets are read in blocks, to stay within the budget here
+    const std::size_t bytesPerParticle = sizeof(std::uint64_t) + 2UL * sizeof(float);
+    const std::size_t bytesPerHit      = 2UL * sizeof(float);
+    const std::size_t numParticles     = m_header.m_numParticles;
+    const std::size_t blockSize        = std::max(1UL, std::min(numParticles + 1UL, maxChunkBytes / sizeof(std::uint64_t)));
+
+    std::vector<std::uint64_t> offsetBlock;
+    std::uint64_t              previousOffset(0UL);
+    std::size_t                chunkBytes(0UL);
+
+    m_chunkBoundaries.push_back(0UL);
+
+    for (std::size_t blockBegin = 0UL; blockBegin <= numParticles; blockBegin += blockSize)
+    {
+        offsetBlock.resize(std::min(blockSize, numParticles + 1UL - blockBegin));
+        this->ReadSection(offsetBlock.data(), offsetBlock.size() * sizeof(std::uint64_t),
+            sizeof(BirksCacheHeader) + blockBegin * sizeof(std::uint64_t));
+
+        for (std::size_t i = 0UL; i < offsetBlock.size(); ++i)
         {
-            // Require reconstruction and good MC info
-            if (!(*primary_WasReconstructedWithVertex)[i] || !(*primary_HasMCInfo)[i] || !(*primary_mc_IsGoodMatch)[i])
+            // The first offset of the file starts the first particle rather than ending one
+            if (blockBegin + i == 0UL)
+            {
+                previousOffset = offsetBlock[i];
                 continue;
+            }
 
-            // Require a minimum purity and completeness of the MC match
-            if ((*primary_mc_MatchPurity)[i] < minMcMatchPurity || (*primary_mc_MatchCompleteness)[i] < minMcMatchCompleteness)
-                continue;
+            const std::size_t particleBytes = bytesPerParticle + bytesPerHit * (offsetBlock[i] - previousOffset);
+            previousOffset                  = offsetBlock[i];
 
-            // Require fiducial vertex and enough energy contained
-            if (!(*primary_IsVertexFiducial)[i] || (*primary_mc_EnergyWeightedContainedPfoFraction)[i] < minEnergyWeightedContainedPfoFraction)
-                continue;
+            if (chunkBytes > 0UL && chunkBytes + particleBytes > maxChunkBytes)
+            {
+                m_chunkBoundaries.push_back(blockBegin + i - 1UL);
+                chunkBytes = 0UL;
+            }
 
-            // Require at least n (and at least 1) collection plane hits
-            if (minNumCollectionPlaneHits < 1UL || (*primary_NumVectorEntries)[i] < minNumCollectionPlaneHits)
-                continue;
+            chunkBytes += particleBytes;
+        }
+    }
 
-            // No more than a given fraction of hits may be lost due to fitting issues
-            if ((*primary_NumHitsLostToFittingErrors)[i] / (*primary_NumVectorEntries)[i] > maxHitFracLostByFit)
-                continue;
+    m_chunkBoundaries.push_back(numParticles);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void StreamingTrainingCache::Close()
+{
+    if (m_fileDescriptor >= 0)
+        close(m_fileDescriptor);
+
+    m_fileDescriptor = -1;
+    m_chunkBoundaries.clear();
+    m_chunk          = BirksTrainingData();
+    m_hasLoadedChunk = false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+BirksTrainingView StreamingTrainingCache::LoadChunk(const std::size_t chunk)
+{
+    const std::size_t beginIndex = m_chunkBoundaries[chunk];
+    const std::size_t endIndex   = m_chunkBoundaries[chunk + 1UL];
 
-            g_trueEnergy.push_back((*primary_mc_KineticEnergy)[i]);
-            g_showerChargeVector.push_back((*primary_ShowerCharge)[i]);
-            g_dQdXVector.push_back((*primary_dQdX)[i]);
-            g_dXVector.push_back((*primary_dX)[i]);
+    // Training data that fits in a single chunk is only ever read once
+    if (!m_hasLoadedChunk || m_loadedChunk != chunk)
+    {
+        const std::size_t numParticles      = m_header.m_numParticles;
+        const std::size_t offsetsPosition   = sizeof(BirksCacheHeader);
+        const std::size_t energyPosition    = offsetsPosition + (numParticles + 1UL) * sizeof(std::uint64_t);
+        const std::size_t chargePosition    = energyPosition + numParticles * sizeof(float);
+        const std::size_t dQdXPosition      = chargePosition + numParticles * sizeof(float);
+        const std::size_t dXPosition        = dQdXPosition + m_header.m_numHits * sizeof(float);
+        const std::size_t numChunkParticles = endIndex - beginIndex;
+
+        // Reading into the same buffers every time means that, after the largest chunk, no chunk allocates
+        m_chunk.m_hitOffsets.resize(numChunkParticles + 1UL);
+        this->ReadSection(m_chunk.m_hitOffsets.data(), (numChunkParticles + 1UL) * sizeof(std::uint64_t),
+            offsetsPosition + beginIndex * sizeof(std::uint64_t));
+
+        const std::uint64_t firstHit = m_chunk.m_hitOffsets.front();
+        const std::size_t   numHits  = m_chunk.m_hitOffsets.back() - firstHit;
+
+        for (std::uint64_t &hitOffset : m_chunk.m_hitOffsets)
+            hitOffset -= firstHit;
+
+        m_chunk.m_trueEnergy.resize(numChunkParticles);
+        m_chunk.m_showerCharge.resize(numChunkParticles);
+        m_chunk.m_dQdX.resize(numHits);
+        m_chunk.m_dX.resize(numHits);
+        this->ReadSection(m_chunk.m_trueEnergy.data(), numChunkParticles * sizeof(float), energyPosition + beginIndex * sizeof(float));
+        this->ReadSection(m_chunk.m_showerCharge.data(), numChunkParticles * sizeof(float), chargePosition + beginIndex * sizeof(float));
+        this->ReadSection(m_chunk.m_dQdX.data(), numHits * sizeof(float), dQdXPosition + firstHit * sizeof(float));
+        this->ReadSection(m_chunk.m_dX.data(), numHits * sizeof(float), dXPosition + firstHit * sizeof(float));
+
+        m_loadedChunk    = chunk;
+        m_hasLoadedChunk = true;
+    }
+
+    BirksTrainingView view = m_chunk.GetView();
+    view.m_firstParticle   = beginIndex;
+
+    return view;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void StreamingTrainingCache::VisitChunks(const std::function<void(const BirksTrainingView &)> &visitor)
+{
+    for (std::size_t chunk = 0UL, numChunks = this->NumChunks(); chunk < numChunks; ++chunk)
+        visitor(this->LoadChunk(chunk));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void StreamingTrainingCache::ReadSection(void *const pBuffer, const std::size_t numBytes, const std::size_t fileOffset) const
+{
+    char *const pBytes = static_cast<char *>(pBuffer);
+    std::size_t numBytesRead(0UL);
+
+    while (numBytesRead < numBytes)
+    {
+        const ssize_t result = pread(m_fileDescriptor, pBytes + numBytesRead, numBytes - numBytesRead, fileOffset + numBytesRead);
 
-            ++numPrimaryDatapoints;
+        // The file size was checked against the header, so a failed read means the cache changed or broke under the fit
+        if (result <= 0)
+        {
+            CERR("Failed to read the training cache at offset " << fileOffset + numBytesRead);
+            throw std::runtime_error("Failed to read the training cache");
         }
 
-        for (std::size_t i = 0U; i < *numCosmicRayEntries; ++i)
+        numBytesRead += static_cast<std::size_t>(result);
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+BirksCacheHeader MakeCacheHeader(const std::uint64_t selectionHash, const std::size_t numParticles, const std::size_t numHits,
+    const std::size_t numPrimaries, const std::size_t numCosmicRays)
+{
+    BirksCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.m_magic, g_cacheMagic, sizeof(header.m_magic));
+    header.m_version       = g_cacheVersion;
+    header.m_selectionHash = selectionHash;
+    header.m_numParticles  = numParticles;
+    header.m_numHits       = numHits;
+    header.m_numPrimaries  = numPrimaries;
+    header.m_numCosmicRays = numCosmicRays;
+
+    return header;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+bool MoveCacheIntoPlace(const std::string &temporaryPath, const char *const filePath)
+{
+    if (std::rename(temporaryPath.c_str(), filePath) != 0)
+    {
+        CERR("Failed to move the training cache into place at " << filePath);
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    COUT("Wrote the training cache to " << filePath);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void WriteTrainingCache(const char *const filePath, const std::uint64_t selectionHash, const BirksTrainingData &trainingData,
+    const std::size_t numPrimaries, const std::size_t numCosmicRays)
+{
+    if (trainingData.m_hitOffsets.empty())
+        return;
+
+    const BirksCacheHeader header =
+        MakeCacheHeader(selectionHash, trainingData.NumParticles(), trainingData.m_dQdX.size(), numPrimaries, numCosmicRays);
+
+    // Write to a temporary file and rename it into place, so that an interrupted write never leaves a cache that looks valid
+    const std::string temporaryPath = std::string(filePath) + ".tmp";
+
+    {
+        std::ofstream cacheFile(temporaryPath, std::ios::binary | std::ios::trunc);
+
+        const auto writeVector = [&](const auto &values) {
+            cacheFile.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(values.front()));
+        };
+
+        cacheFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writeVector(trainingData.m_hitOffsets);
+        writeVector(trainingData.m_trueEnergy);
+        writeVector(trainingData.m_showerCharge);
+        writeVector(trainingData.m_dQdX);
+        writeVector(trainingData.m_dX);
+        cacheFile.close();
+
+        if (!cacheFile)
         {
-            // Require reconstruction and good MC info
-            if (!(*cr_WasReconstructedWithVertex)[i] || !(*cr_HasMCInfo)[i] || !(*cr_mc_IsGoodMatch)[i])
-                continue;
+            CERR("Failed to write the training cache to " << temporaryPath);
+            std::remove(temporaryPath.c_str());
+            return;
+        }
+    }
 
-            // Require a minimum purity and completeness of the MC match
-            if ((*cr_mc_MatchPurity)[i] < minMcMatchPurity || (*cr_mc_MatchCompleteness)[i] < minMcMatchCompleteness)
-                continue;
+    MoveCacheIntoPlace(temporaryPath, filePath);
+}
 
-            // Require fiducial vertex and enough energy contained
-            if (!(*cr_IsVertexFiducial)[i] || (*cr_mc_EnergyWeightedContainedPfoFraction)[i] < minEnergyWeightedContainedPfoFraction)
-                continue;
+//------------------------------------------------------------------------------------------------------------------------------------------
 
-            // Require at least n (and at least 1) collection plane hits
-            if (minNumCollectionPlaneHits < 1UL || (*cr_NumVectorEntries)[i] < minNumCollectionPlaneHits)
-                continue;
+// Writes a training cache one particle at a time, for training data too large to hold in memory. Each array goes to its own temporary
+// file as the particles arrive, and the arrays are joined behind the header once the counts are known
+class BirksCacheWriter
+{
+public:
+    explicit BirksCacheWriter(const char *const filePath) :
+        m_filePath(filePath),
+        m_numParticles(0UL),
+        m_numHits(0UL)
+    {
+        for (unsigned int section = 0U; section < g_numCacheSections; ++section)
+            m_sections[section].open(this->GetSectionPath(section), std::ios::binary | std::ios::trunc);
 
-            // No more than a given fraction of hits may be lost due to fitting issues
-            if ((*cr_NumHitsLostToFittingErrors)[i] / ((*cr_NumVectorEntries)[i] + (*cr_NumHitsLostToFittingErrors)[i]) > maxHitFracLostByFit)
-                continue;
+        const std::uint64_t firstOffset(0UL);
+        m_sections[0].write(reinterpret_cast<const char *>(&firstOffset), sizeof(firstOffset));
+    }
 
-            g_trueEnergy.push_back((*cr_mc_KineticEnergy)[i]);
-            g_showerChargeVector.push_back((*cr_ShowerCharge)[i]);
-            g_dQdXVector.push_back((*cr_dQdX)[i]);
-            g_dXVector.push_back((*cr_dX)[i]);
+    BirksCacheWriter(const BirksCacheWriter &) = delete;
+    BirksCacheWriter &operator=(const BirksCacheWriter &) = delete;
 
-            ++numCosmicRayDatapoints;
+    ~BirksCacheWriter()
+    {
+        for (unsigned int section = 0U; section < g_numCacheSections; ++section)
+        {
+            m_sections[section].close();
+            std::remove(this->GetSectionPath(section).c_str());
         }
     }
 
-    const std::size_t numDatapoints = g_trueEnergy.size();
+    void AddParticle(
+        const float trueEnergy, const float showerCharge, const MatrixRowView<Float_t> &dQdXValues, const MatrixRowView<Float_t> &dXValues)
+    {
+        // Both matrices come from the same hits, so only a corrupt input could have rows of different lengths
+        const std::size_t numHits = std::min(dQdXValues.size(), dXValues.size());
+
+        m_numParticles += 1UL;
+        m_numHits += numHits;
+
+        const std::uint64_t endOffset(m_numHits);
+        m_sections[0].write(reinterpret_cast<const char *>(&endOffset), sizeof(endOffset));
+        m_sections[1].write(reinterpret_cast<const char *>(&trueEnergy), sizeof(trueEnergy));
+        m_sections[2].write(reinterpret_cast<const char *>(&showerCharge), sizeof(showerCharge));
+        m_sections[3].write(reinterpret_cast<const char *>(dQdXValues.begin()), numHits * sizeof(Float_t));
+        m_sections[4].write(reinterpret_cast<const char *>(dXValues.begin()), numHits * sizeof(Float_t));
+    }
+
+    bool Finish(const std::uint64_t selectionHash, const std::size_t numPrimaries, const std::size_t numCosmicRays)
+    {
+        const BirksCacheHeader header = MakeCacheHeader(selectionHash, m_numParticles, m_numHits, numPrimaries, numCosmicRays);
+        const std::string      temporaryPath(m_filePath + ".tmp");
+
+        {
+            std::ofstream cacheFile(temporaryPath, std::ios::binary | std::ios::trunc);
+            cacheFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+            for (unsigned int section = 0U; section < g_numCacheSections; ++section)
+            {
+                m_sections[section].close();
+
+                if (!m_sections[section])
+                    cacheFile.setstate(std::ios::failbit);
+
+                std::ifstream sectionFile(this->GetSectionPath(section), std::ios::binary);
+
+                // Streaming the file buffer across copies the section without holding it in memory
+                if (cacheFile && sectionFile.peek() != std::ifstream::traits_type::eof())
+                    cacheFile << sectionFile.rdbuf();
+            }
+
+            cacheFile.close();
+
+            if (!cacheFile)
+            {
+                CERR("Failed to write the training cache to " << temporaryPath);
+                std::remove(temporaryPath.c_str());
+                return false;
+            }
+        }
+
+        return MoveCacheIntoPlace(temporaryPath, m_filePath.c_str());
+    }
+
+private:
+    std::string GetSectionPath(const unsigned int section) const
+    {
+        return m_filePath + ".tmp" + std::to_string(section);
+    }
+
+    std::string   m_filePath;                     // The path of the cache file
+    std::ofstream m_sections[g_numCacheSections]; // The hit offsets, true energies, shower charges, dQ/dx and dx, in file order
+    std::size_t   m_numParticles;                 // The number of particles written
+    std::size_t   m_numHits;                      // The number of hits written
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The values of a vector column in each entry of the range read by an ntuple reader
+template <typename T>
+struct BirksColumnView
+{
+    BirksColumnView(const LArNtupleReader &ntupleReader, const std::string &branchName) :
+        m_values(ntupleReader.GetVectorColumn<T>(branchName)),
+        m_offsets(ntupleReader.GetVectorOffsets(branchName))
+    {
+    }
+
+    // The first value of an entry, given its index within the range read
+    const T *GetEntryValues(const std::size_t entryIndex) const
+    {
+        return m_values.begin() + m_offsets[entryIndex];
+    }
+
+    LArColumnSpan<T>            m_values;  // The values of every entry in the range
+    LArNtupleReader::OffsetSpan m_offsets; // The offset of each entry's values, plus a trailing end offset
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The columns of the primary_ or cr_ particles in the range read by an ntuple reader
+struct BirksParticleColumns
+{
+    BirksParticleColumns(const LArNtupleReader &ntupleReader, const std::string &prefix) :
+        m_numEntries(ntupleReader.GetScalarColumn<UInt_t>(GetNumEntriesBranchName(prefix))),
+        m_dQdXValues(ntupleReader, prefix + "dQdXMatrix_values"),
+        m_dQdXOffsets(ntupleReader, prefix + "dQdXMatrix_offsets"),
+        m_dQdXElementOffsets(ntupleReader, prefix + "dQdXMatrix_elementOffsets"),
+        m_dXValues(ntupleReader, prefix + "dXMatrix_values"),
+        m_dXOffsets(ntupleReader, prefix + "dXMatrix_offsets"),
+        m_dXElementOffsets(ntupleReader, prefix + "dXMatrix_elementOffsets"),
+        m_showerCharge(ntupleReader, prefix + "ShowerCharge"),
+        m_mcKineticEnergy(ntupleReader, prefix + "mc_KineticEnergy"),
+        m_numVectorEntries(ntupleReader, prefix + "NumVectorEntries"),
+        m_numHitsLostToFittingErrors(ntupleReader, prefix + "NumHitsLostToFittingErrors"),
+        m_wasReconstructedWithVertex(ntupleReader, prefix + "WasReconstructedWithVertex"),
+        m_hasMCInfo(ntupleReader, prefix + "HasMCInfo"),
+        m_isVertexFiducial(ntupleReader, prefix + "IsVertexFiducial"),
+        m_mcEnergyWeightedContainedPfoFraction(ntupleReader, prefix + "mc_EnergyWeightedContainedPfoFraction"),
+        m_mcIsGoodMatch(ntupleReader, prefix + "mc_IsGoodMatch"),
+        m_mcMatchPurity(ntupleReader, prefix + "mc_MatchPurity"),
+        m_mcMatchCompleteness(ntupleReader, prefix + "mc_MatchCompleteness")
+    {
+    }
+
+    // The branch holding the number of particles in each entry
+    static std::string GetNumEntriesBranchName(const std::string &prefix)
+    {
+        return (prefix == "primary_") ? "numPrimaryEntries" : "numCosmicRayEntries";
+    }
+
+    // The branches holding the columns
+    static std::vector<std::string> GetBranchNames(const std::string &prefix)
+    {
+        std::vector<std::string> branchNames{GetNumEntriesBranchName(prefix)};
+
+        for (const char *const column : {"dQdXMatrix_values", "dQdXMatrix_offsets", "dQdXMatrix_elementOffsets", "dXMatrix_values",
+                 "dXMatrix_offsets", "dXMatrix_elementOffsets", "ShowerCharge", "mc_KineticEnergy", "NumVectorEntries",
+                 "NumHitsLostToFittingErrors", "WasReconstructedWithVertex", "HasMCInfo", "IsVertexFiducial",
+                 "mc_EnergyWeightedContainedPfoFraction", "mc_IsGoodMatch", "mc_MatchPurity", "mc_MatchCompleteness"})
+        {
+            branchNames.push_back(prefix + column);
+        }
+
+        return branchNames;
+    }
+
+    // The dQ/dx or dx values of one particle. The track hits of all downstream PFOs are contiguous in the flattened matrices
+    static MatrixRowView<Float_t> GetParticleValues(const BirksColumnView<Float_t> &values, const BirksColumnView<UInt_t> &offsets,
+        const BirksColumnView<UInt_t> &elementOffsets, const std::size_t entryIndex, const std::size_t particle)
+    {
+        const UInt_t *const pOffsets = offsets.GetEntryValues(entryIndex);
+        const UInt_t        firstRow(elementOffsets.GetEntryValues(entryIndex)[particle]);
+        const UInt_t        endRow(elementOffsets.GetEntryValues(entryIndex)[particle + 1UL]);
+
+        return MatrixRowView<Float_t>{values.GetEntryValues(entryIndex) + pOffsets[firstRow], pOffsets[endRow] - pOffsets[firstRow]};
+    }
+
+    LArColumnSpan<UInt_t>    m_numEntries;
+    BirksColumnView<Float_t> m_dQdXValues;
+    BirksColumnView<UInt_t>  m_dQdXOffsets;
+    BirksColumnView<UInt_t>  m_dQdXElementOffsets;
+    BirksColumnView<Float_t> m_dXValues;
+    BirksColumnView<UInt_t>  m_dXOffsets;
+    BirksColumnView<UInt_t>  m_dXElementOffsets;
+    BirksColumnView<Float_t> m_showerCharge;
+    BirksColumnView<Float_t> m_mcKineticEnergy;
+    BirksColumnView<UInt_t>  m_numVectorEntries;
+    BirksColumnView<UInt_t>  m_numHitsLostToFittingErrors;
+    BirksColumnView<Bool_t>  m_wasReconstructedWithVertex;
+    BirksColumnView<Bool_t>  m_hasMCInfo;
+    BirksColumnView<Bool_t>  m_isVertexFiducial;
+    BirksColumnView<Float_t> m_mcEnergyWeightedContainedPfoFraction;
+    BirksColumnView<Bool_t>  m_mcIsGoodMatch;
+    BirksColumnView<Float_t> m_mcMatchPurity;
+    BirksColumnView<Float_t> m_mcMatchCompleteness;
+};
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Passes the selected particles of one entry to a training sink, returning how many were selected. Cosmic rays count the hits lost to
+// fitting errors against all of their hits, primaries against the hits kept
+template <typename TrainingSink>
+std::size_t SelectParticles(const BirksParticleColumns &columns, const std::size_t entryIndex, const bool isCosmicRay,
+    const BirksSelection &selection, TrainingSink &trainingSink)
+{
+    const Bool_t *const  wasReconstructedWithVertex = columns.m_wasReconstructedWithVertex.GetEntryValues(entryIndex);
+    const Bool_t *const  hasMCInfo                  = columns.m_hasMCInfo.GetEntryValues(entryIndex);
+    const Bool_t *const  mcIsGoodMatch              = columns.m_mcIsGoodMatch.GetEntryValues(entryIndex);
+    const Float_t *const mcMatchPurity              = columns.m_mcMatchPurity.GetEntryValues(entryIndex);
+    const Float_t *const mcMatchCompleteness        = columns.m_mcMatchCompleteness.GetEntryValues(entryIndex);
+    const Bool_t *const  isVertexFiducial           = columns.m_isVertexFiducial.GetEntryValues(entryIndex);
+    const Float_t *const containedFraction          = columns.m_mcEnergyWeightedContainedPfoFraction.GetEntryValues(entryIndex);
+    const UInt_t *const  numVectorEntries           = columns.m_numVectorEntries.GetEntryValues(entryIndex);
+    const UInt_t *const  numHitsLost                = columns.m_numHitsLostToFittingErrors.GetEntryValues(entryIndex);
+    const Float_t *const mcKineticEnergy            = columns.m_mcKineticEnergy.GetEntryValues(entryIndex);
+    const Float_t *const showerCharge               = columns.m_showerCharge.GetEntryValues(entryIndex);
+
+    std::size_t numSelected(0UL);
+
+    for (std::size_t i = 0U; i < columns.m_numEntries[entryIndex]; ++i)
+    {
+        // Require reconstruction and good MC info
+        if (!wasReconstructedWithVertex[i] || !hasMCInfo[i] || !mcIsGoodMatch[i])
+            continue;
+
+        // Require a minimum purity and completeness of the MC match
+        if (mcMatchPurity[i] < selection.m_minMcMatchPurity || mcMatchCompleteness[i] < selection.m_minMcMatchCompleteness)
+            continue;
+
+        // Require fiducial vertex and enough energy contained
+        if (!isVertexFiducial[i] || containedFraction[i] < selection.m_minEnergyWeightedContainedPfoFraction)
+            continue;
+
+        // Require at least n (and at least 1) collection plane hits
+        if (selection.m_minNumCollectionPlaneHits < 1UL || numVectorEntries[i] < selection.m_minNumCollectionPlaneHits)
+            continue;
+
+        // No more than a given fraction of hits may be lost due to fitting issues
+        if (numHitsLost[i] / (numVectorEntries[i] + (isCosmicRay ? numHitsLost[i] : 0U)) > selection.m_maxHitFracLostByFit)
+            continue;
+
+        trainingSink.AddParticle(mcKineticEnergy[i], showerCharge[i],
+            BirksParticleColumns::GetParticleValues(
+                columns.m_dQdXValues, columns.m_dQdXOffsets, columns.m_dQdXElementOffsets, entryIndex, i),
+            BirksParticleColumns::GetParticleValues(columns.m_dXValues, columns.m_dXOffsets, columns.m_dXElementOffsets, entryIndex, i));
+
+        ++numSelected;
+    }
+
+    return numSelected;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The selected particles go to a training sink, either BirksTrainingData to hold them in memory or BirksCacheWriter to stream them to
+// a training cache file. The ntuple is read a cluster at a time into typed columns by the compiled ntuple reader
+template <typename TrainingSink>
+void LoadTrainingData(const char *const inputFilePath, const char *const ntupleName, const BirksSelection &selection,
+    TrainingSink &trainingSink, std::size_t &numPrimaries, std::size_t &numCosmicRays)
+{
+    // Load the ntuple
+    TFile        ntupleFile(inputFilePath);
+    TTree *const pNtuple = dynamic_cast<TTree *>(ntupleFile.Get(ntupleName));
+
+    if (!pNtuple)
+        throw std::runtime_error("Could not find ntuple " + std::string(ntupleName) + " in " + inputFilePath);
+
+    std::vector<std::string>       branchNames(BirksParticleColumns::GetBranchNames("primary_"));
+    const std::vector<std::string> cosmicRayBranchNames(BirksParticleColumns::GetBranchNames("cr_"));
+    branchNames.insert(branchNames.end(), cosmicRayBranchNames.begin(), cosmicRayBranchNames.end());
+
+    LArNtupleReader ntupleReader(pNtuple, branchNames);
+
+    numPrimaries  = 0UL;
+    numCosmicRays = 0UL;
+
+    for (const LArNtupleReader::EntryRange &clusterRange : ntupleReader.GetClusterRanges())
+    {
+        ntupleReader.ReadEntries(clusterRange.first, clusterRange.second);
+
+        const BirksParticleColumns primaryColumns(ntupleReader, "primary_");
+        const BirksParticleColumns cosmicRayColumns(ntupleReader, "cr_");
+
+        for (std::size_t entryIndex = 0UL; entryIndex < ntupleReader.GetNumEntries(); ++entryIndex)
+        {
+            numPrimaries += SelectParticles(primaryColumns, entryIndex, false, selection, trainingSink);
+            numCosmicRays += SelectParticles(cosmicRayColumns, entryIndex, true, selection, trainingSink);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+void FitBirksData(const char *const inputFilePath, const char *const ntupleName, const char *const outputDir, const char *const outputName,
+    const unsigned int numThreads = 0U, const unsigned int numBootstrapReplicas = 0U, const unsigned int bootstrapSeed = 12345U,
+    const char *const cacheFilePath = "", const unsigned int maxMemoryMB = 0U)
+{
+    const BirksSelection selection{0.9f, 0.9f, 0.9f, 0.1f, 3UL};
+    const bool           useCache = cacheFilePath && std::strlen(cacheFilePath) > 0UL;
+
+    std::size_t numPrimaryDatapoints(0UL), numCosmicRayDatapoints(0UL);
+
+    // Start afresh, in case the macro has already been run in this session
+    g_trainingData = BirksTrainingData();
+    g_trainingView = g_trainingData.GetView();
+    g_trainingCache.Unmap();
+    g_pTrainingStream.reset();
+
+    // A valid cache saves rereading the ntuple and reapplying the selection. Otherwise the data is selected afresh, and the cache
+    // (re)built for next time
+    const std::uint64_t selectionHash = GetSelectionHash(selection, inputFilePath, ntupleName);
+
+    // With a memory limit, the training data is streamed from the cache file in chunks that fit within the limit, and is never held in
+    // memory all at once, not even while the cache is built
+    if (maxMemoryMB > 0U)
+    {
+        if (!useCache)
+        {
+            CERR("Fits with a memory limit stream the training data from a cache file, so need a cache file path");
+            return;
+        }
+
+        const std::size_t maxChunkBytes = static_cast<std::size_t>(maxMemoryMB) << 20;
+        g_pTrainingStream.reset(new StreamingTrainingCache);
+
+        if (!g_pTrainingStream->Open(cacheFilePath, selectionHash, maxChunkBytes))
+        {
+            BirksCacheWriter cacheWriter(cacheFilePath);
+            LoadTrainingData(inputFilePath, ntupleName, selection, cacheWriter, numPrimaryDatapoints, numCosmicRayDatapoints);
+
+            if (!cacheWriter.Finish(selectionHash, numPrimaryDatapoints, numCosmicRayDatapoints) ||
+                !g_pTrainingStream->Open(cacheFilePath, selectionHash, maxChunkBytes))
+            {
+                CERR("Failed to build the training cache at " << cacheFilePath);
+                g_pTrainingStream.reset();
+                return;
+            }
+        }
+
+        COUT("Streaming the training cache at " << cacheFilePath << " in " << g_pTrainingStream->NumChunks() << " chunks of up to "
+                                                << maxMemoryMB << " MB");
+        numPrimaryDatapoints   = g_pTrainingStream->GetHeader().m_numPrimaries;
+        numCosmicRayDatapoints = g_pTrainingStream->GetHeader().m_numCosmicRays;
+    }
+
+    else if (useCache && g_trainingCache.Map(cacheFilePath, selectionHash))
+    {
+        COUT("Using the training cache at " << cacheFilePath);
+        g_trainingView         = g_trainingCache.GetView();
+        numPrimaryDatapoints   = g_trainingCache.GetHeader().m_numPrimaries;
+        numCosmicRayDatapoints = g_trainingCache.GetHeader().m_numCosmicRays;
+    }
+
+    else
+    {
+        LoadTrainingData(inputFilePath, ntupleName, selection, g_trainingData, numPrimaryDatapoints, numCosmicRayDatapoints);
+        g_trainingView = g_trainingData.GetView();
+
+        if (useCache)
+            WriteTrainingCache(cacheFilePath, selectionHash, g_trainingData, numPrimaryDatapoints, numCosmicRayDatapoints);
+    }
+
+    const std::size_t numDatapoints = g_pTrainingStream ? g_pTrainingStream->GetHeader().m_numParticles : g_trainingView.m_numParticles;
 
     if (numDatapoints == 0UL)
     {
@@ -319,10 +1578,33 @@ void FitBirksData(const char *const inputFilePath, const char *const ntupleName,
     const double betaInitial      = 0.000714286;
     const double stepSizeFraction = 0.1;
 
+    // The minibatch warm-up used in place of Simplex when the training data is streamed
+    const unsigned int numWarmupEpochs    = 2U;
+    const std::size_t  minibatchSize      = 4096UL;
+    const double       warmupLearningRate = 0.01;
+    const unsigned int warmupSeed         = 12345U;
+
     double alpha = alphaInitial, beta = betaInitial;
 
+    // A thread count of 0 uses the ROOT default, and 1 evaluates the objective serially
+#ifdef R__USE_IMT
+    if (numThreads != 1U)
+        g_pThreadExecutor.reset(new ROOT::TThreadExecutor(numThreads));
+#else
+    if (numThreads != 1U)
+        CERR("ROOT was built without implicit multithreading, so the fit will run serially");
+#endif
+
+    // Each Simplex step over streamed data would be a pass over the whole cache file, so cheap minibatch steps bring the parameters
+    // close to the minimum instead. MIGRAD then converges on the exact objective, one pass over the file per evaluation
+    if (g_pTrainingStream)
+    {
+        COUT("Running minibatch warm-up...");
+        RunMinibatchWarmUp(alpha, beta, alphaInitial, betaInitial, numWarmupEpochs, minibatchSize, warmupLearningRate, warmupSeed);
+    }
+
     COUT("Running Minuit fit...");
-    RunMinuitFit(alpha, beta, alphaInitial, betaInitial, stepSizeFraction);
+    RunMinuitFit(BirksObjectiveFunction(nullptr, true), alpha, beta, alphaInitial, betaInitial, stepSizeFraction, !g_pTrainingStream, true);
 
     const double alphaOut = 1. / alpha;
     const double betaOut  = alpha / beta;
@@ -336,6 +1618,46 @@ void FitBirksData(const char *const inputFilePath, const char *const ntupleName,
          << "  - beta          = " << betaOut << " GeV/cm\n"
          << "  - Pole at dQ/dx = " << dQdxPole << " ADC/cm");
 
+    std::vector<BootstrapReplica> bootstrapReplicas;
+
+    if (numBootstrapReplicas > 0U && g_pTrainingStream)
+        CERR("Bootstrap refits need the training data in memory, so are skipped when it is streamed");
+
+    else if (numBootstrapReplicas > 0U)
+    {
+        COUT("\nRunning " << numBootstrapReplicas << " bootstrap refits with seed " << bootstrapSeed << "...");
+        bootstrapReplicas = RunBootstrap(numBootstrapReplicas, bootstrapSeed, alpha, beta, alphaInitial, betaInitial, stepSizeFraction);
+
+        double      sumAlpha(0.), sumSquaredAlpha(0.), sumBeta(0.), sumSquaredBeta(0.);
+        std::size_t numConverged(0UL);
+
+        for (const BootstrapReplica &result : bootstrapReplicas)
+        {
+            if (result.m_status != 0)
+                continue;
+
+            sumAlpha += 1. / result.m_alpha;
+            sumSquaredAlpha += 1. / (result.m_alpha * result.m_alpha);
+            sumBeta += result.m_alpha / result.m_beta;
+            sumSquaredBeta += (result.m_alpha / result.m_beta) * (result.m_alpha / result.m_beta);
+            ++numConverged;
+        }
+
+        if (numConverged > 0UL)
+        {
+            const double meanAlpha = sumAlpha / numConverged, meanBeta = sumBeta / numConverged;
+            const double rmsAlpha  = std::sqrt(std::max(0., sumSquaredAlpha / numConverged - meanAlpha * meanAlpha));
+            const double rmsBeta   = std::sqrt(std::max(0., sumSquaredBeta / numConverged - meanBeta * meanBeta));
+
+            COUT("Bootstrap spread over " << numConverged << " converged refits:\n"
+                 << "  - alpha         = " << meanAlpha << " +- " << rmsAlpha << " ADC/GeV\n"
+                 << "  - beta          = " << meanBeta << " +- " << rmsBeta << " GeV/cm");
+        }
+
+        else
+            CERR("None of the bootstrap refits converged");
+    }
+
     MakeDebugPlots(alpha, beta, outputDir);
-    OutputToNTuple(TString(outputDir) + "/" + TString(outputName), alphaOut, betaOut, dQdxPole);
+    OutputToNTuple(TString(outputDir) + "/" + TString(outputName), alphaOut, betaOut, dQdxPole, bootstrapReplicas, bootstrapSeed);
 }
@@ -0,0 +1,77 @@
+#ifndef LAR_ANALYSIS_ROOT_NTUPLE_EVENT_INDEX
+#define LAR_ANALYSIS_ROOT_NTUPLE_EVENT_INDEX 1
+
+#include "Common.h"
+
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TVirtualIndex.h"
+
+#include <cstring>
+
+// The ntuple is written with a TTree index on fileId and on eventNum and hypothesisId combined, so a single event can be found by a binary
+// search rather than a scan. The index is rebuilt over the whole tree when appending, is carried through by hadd, and a TChain of ntuple
+// shards builds its own index from those of its trees, e.g.
+//
+//     TTreeReader treeReader(pTree);
+//     ...
+//     if (LoadEvent(treeReader, fileId, eventNum, hypothesisId))
+//         ...
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The minor key of the event index, which must match the one used by the ntuple
+const char *const g_eventIndexMinor    = "eventNum * 65536 + hypothesisId";
+const Long64_t    g_hypothesesPerEvent = 65536LL;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Makes sure that a tree or chain has the event index, building it with a scan if not. Returns whether the index is available
+inline bool PrepareEventIndex(TTree *const pTree)
+{
+    const TVirtualIndex *const pIndex = pTree->GetTreeIndex();
+
+    if (pIndex && !std::strcmp(pIndex->GetMajorName(), "fileId") && !std::strcmp(pIndex->GetMinorName(), g_eventIndexMinor))
+        return true;
+
+    COUT("Tree has no event index, so building one");
+
+    if (pTree->BuildIndex("fileId", g_eventIndexMinor) <= 0)
+    {
+        CERR("Failed to build the event index");
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Returns the entry number of an event hypothesis, or -1 if the tree does not contain it
+inline Long64_t FindEventEntry(TTree *const pTree, const int fileId, const int eventNum, const int hypothesisId)
+{
+    if (hypothesisId < 0 || hypothesisId >= g_hypothesesPerEvent || !PrepareEventIndex(pTree))
+        return -1;
+
+    const Long64_t minorKey(static_cast<Long64_t>(eventNum) * g_hypothesesPerEvent + hypothesisId);
+
+    return pTree->GetEntryNumberWithIndex(static_cast<Long64_t>(fileId), minorKey);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Moves a tree reader to an event hypothesis, returning whether it was found
+inline bool LoadEvent(TTreeReader &treeReader, const int fileId, const int eventNum, const int hypothesisId)
+{
+    const Long64_t entry(FindEventEntry(treeReader.GetTree(), fileId, eventNum, hypothesisId));
+
+    if (entry < 0)
+    {
+        CERR("Could not find hypothesis " << hypothesisId << " of event " << eventNum << " in file " << fileId);
+        return false;
+    }
+
+    return treeReader.SetEntry(entry) == TTreeReader::kEntryValid;
+}
+
+#endif // #ifndef LAR_ANALYSIS_ROOT_NTUPLE_EVENT_INDEX
@@ -0,0 +1,222 @@
+#ifndef LAR_ANALYSIS_ROOT_NTUPLE_ZONE_MAPS
+#define LAR_ANALYSIS_ROOT_NTUPLE_ZONE_MAPS 1
+
+#include "Common.h"
+
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TVectorD.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Zone maps let a macro skip the clusters of ntuple entries that cannot pass its cuts, so that their baskets are never read. For each
+// branch in the ZoneMapBranches setting, the ntuple stores the range of the branch in each cluster as a list named <branch>_zones in the
+// tree's user info. A ZoneMapSelection checks predicates against those ranges and runs a TTreeReader over the clusters that survive.
+// A cluster that may pass can still contain entries that fail, so the cuts must also be applied to each entry as usual, e.g.
+//
+//     ZoneMapSelection selection(pTree);
+//     selection.AddRangeCut("recoEnergy", 0.2, 0.8);
+//
+//     TTreeReader               treeReader(pTree);
+//     TTreeReaderValue<Float_t> recoEnergy(treeReader, "recoEnergy");
+//
+//     selection.Process(treeReader, [&]() {
+//         if (*recoEnergy >= 0.2f && *recoEnergy <= 0.8f)
+//             ...
+//     });
+//
+//     selection.PrintSummary();
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// The range of the finite values of a branch in one zone, empty (min > max) if there are none
+struct ZoneRange
+{
+    double min;
+    double max;
+};
+
+// Whether any entry with a value in a zone range might pass a cut
+using ZonePredicate = std::function<bool(const ZoneRange &)>;
+
+// An entry range [first, end)
+using EntryRange = std::pair<Long64_t, Long64_t>;
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+// Selects the clusters of a tree that might pass predicates on its zone-mapped branches
+class ZoneMapSelection
+{
+public:
+    explicit ZoneMapSelection(TTree *const pTree) : m_pTree(pTree), m_predicates(), m_numClusters(0UL), m_numSkippedClusters(0UL)
+    {
+    }
+
+    // Adds a predicate on a branch, returning false and skipping nothing on its account if the tree has no zone map for the branch
+    bool AddPredicate(const char *const branchName, const ZonePredicate &predicate)
+    {
+        const std::string  zoneMapName(std::string(branchName) + "_zones");
+        const TList *const pZoneMap = dynamic_cast<TList *>(m_pTree->GetUserInfo()->FindObject(zoneMapName.c_str()));
+
+        if (!pZoneMap)
+        {
+            CERR("Tree did not contain a zone map for branch '" << branchName << "', so no clusters will be skipped on it");
+            return false;
+        }
+
+        BranchPredicate branchPredicate{branchName, {}, predicate};
+
+        for (const TObject *const pObject : *pZoneMap)
+        {
+            const TVectorD *const pZone = dynamic_cast<const TVectorD *>(pObject);
+
+            if (pZone && pZone->GetNrows() == 4)
+            {
+                branchPredicate.zones.push_back(
+                    Zone{static_cast<Long64_t>((*pZone)[0]), static_cast<Long64_t>((*pZone)[1]), ZoneRange{(*pZone)[2], (*pZone)[3]}});
+            }
+        }
+
+        // Appending keeps the zones in entry order, but sorting costs little and guards the lookup
+        std::sort(branchPredicate.zones.begin(), branchPredicate.zones.end(),
+            [](const Zone &lhs, const Zone &rhs) { return lhs.firstEntry < rhs.firstEntry; });
+
+        m_predicates.push_back(std::move(branchPredicate));
+        return true;
+    }
+
+    // Adds a cut requiring the value of a branch to lie within [min, max]
+    bool AddRangeCut(const char *const branchName, const double min, const double max)
+    {
+        return this->AddPredicate(branchName, [=](const ZoneRange &range) { return range.max >= min && range.min <= max; });
+    }
+
+    // Finds the entry ranges of the clusters that might pass every predicate, merging neighbouring clusters
+    std::vector<EntryRange> GetSelectedRanges()
+    {
+        std::vector<EntryRange> selectedRanges;
+        const Long64_t          numEntries(m_pTree->GetEntries());
+        TTree::TClusterIterator clusterIter(m_pTree->GetClusterIterator(0));
+        Long64_t                firstEntry(0);
+
+        m_numClusters        = 0UL;
+        m_numSkippedClusters = 0UL;
+
+        while ((firstEntry = clusterIter()) < numEntries)
+        {
+            const Long64_t endEntry(std::min(clusterIter.GetNextEntry(), numEntries));
+            ++m_numClusters;
+
+            const bool mightPass(std::all_of(m_predicates.begin(), m_predicates.end(),
+                [&](const BranchPredicate &branchPredicate) { return MightPass(branchPredicate, firstEntry, endEntry); }));
+
+            if (!mightPass)
+                ++m_numSkippedClusters;
+
+            else if (!selectedRanges.empty() && selectedRanges.back().second == firstEntry)
+                selectedRanges.back().second = endEntry;
+
+            else
+                selectedRanges.emplace_back(firstEntry, endEntry);
+        }
+
+        return selectedRanges;
+    }
+
+    // Runs a tree reader over the selected clusters, calling processEntry for each entry read, and returns the number of entries read.
+    // The reader is left restricted to the last selected cluster
+    template <typename Function>
+    Long64_t Process(TTreeReader &treeReader, Function processEntry)
+    {
+        Long64_t numEntriesRead(0);
+
+        for (const EntryRange &entryRange : this->GetSelectedRanges())
+        {
+            if (treeReader.SetEntriesRange(entryRange.first, entryRange.second) != TTreeReader::kEntryValid)
+            {
+                CERR("Could not move the tree reader to entries " << entryRange.first << " to " << entryRange.second);
+                break;
+            }
+
+            while (treeReader.Next())
+            {
+                processEntry();
+                ++numEntriesRead;
+            }
+        }
+
+        return numEntriesRead;
+    }
+
+    // The number of clusters considered by the last selection
+    std::size_t GetNumClusters() const
+    {
+        return m_numClusters;
+    }
+
+    // The number of clusters skipped by the last selection
+    std::size_t GetNumSkippedClusters() const
+    {
+        return m_numSkippedClusters;
+    }
+
+    // Prints how many clusters the last selection skipped
+    void PrintSummary() const
+    {
+        COUT("Zone maps skipped " << TEXT_BOLD << m_numSkippedClusters << " of " << m_numClusters << TEXT_NORMAL << " clusters");
+    }
+
+private:
+    struct Zone
+    {
+        Long64_t  firstEntry;
+        Long64_t  endEntry;
+        ZoneRange range;
+    };
+
+    struct BranchPredicate
+    {
+        std::string       branchName;
+        std::vector<Zone> zones;
+        ZonePredicate     predicate;
+    };
+
+    // A cluster might pass unless every entry in it lies in a zone that fails the predicate
+    static bool MightPass(const BranchPredicate &branchPredicate, const Long64_t firstEntry, const Long64_t endEntry)
+    {
+        const std::vector<Zone> &zones = branchPredicate.zones;
+        auto zoneIter = std::upper_bound(zones.begin(), zones.end(), firstEntry, [](const Long64_t entry, const Zone &zone) {
+            return entry < zone.firstEntry;
+        });
+
+        if (zoneIter != zones.begin())
+            --zoneIter;
+
+        Long64_t coveredEntry(firstEntry);
+
+        for (; zoneIter != zones.end() && zoneIter->firstEntry < endEntry; ++zoneIter)
+        {
+            if (zoneIter->endEntry <= coveredEntry)
+                continue;
+
+            // Entries written without a zone map could hold anything
+            if (zoneIter->firstEntry > coveredEntry || branchPredicate.predicate(zoneIter->range))
+                return true;
+
+            coveredEntry = zoneIter->endEntry;
+        }
+
+        return coveredEntry < endEntry;
+    }
+
+    TTree *                      m_pTree;
+    std::vector<BranchPredicate> m_predicates;
+    std::size_t                  m_numClusters;
+    std::size_t                  m_numSkippedClusters;
+};
+
+#endif // #ifndef LAR_ANALYSIS_ROOT_NTUPLE_ZONE_MAPS
@@ -18,7 +18,9 @@ TestNtupleTool::TestNtupleTool() :
     m_eventCounter(0),
     m_neutrinoCounter(0),
     m_cosmicCounter(0),
-    m_primaryCounter(0)
+    m_primaryCounter(0),
+    m_spCategories(std::make_shared<const LArNtupleRecord::RCategory::Vocabulary>(
+        LArNtupleRecord::RCategory::Vocabulary{"Category 0", "Category 1", "Category 2"}))
 {
 }
 
@@ -78,11 +80,13 @@ std::vector<LArNtupleRecord> TestNtupleTool::ProcessCosmicRay(
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
-std::vector<LArNtupleRecord> TestNtupleTool::GetTestRecords(const int counter) const
+std::vector<LArNtupleRecord> TestNtupleTool::GetTestRecords(const int counter)
 {
     std::vector<LArNtupleRecord> records;
 
     records.emplace_back("RFloat", static_cast<LArNtupleRecord::RFloat>(-1.234) + static_cast<LArNtupleRecord::RFloat>(counter));
+    records.emplace_back("RPreciseFloat", static_cast<LArNtupleRecord::RFloat>(-1.234) + static_cast<LArNtupleRecord::RFloat>(counter),
+        LArNtupleRecord::Precision(-100.f, 100.f, 16U));
     records.emplace_back("RInt", static_cast<LArNtupleRecord::RInt>(-1234) + static_cast<LArNtupleRecord::RInt>(counter));
 
     records.emplace_back("RBool", static_cast<LArNtupleRecord::RBool>(counter % 2));
@@ -91,12 +95,27 @@ std::vector<LArNtupleRecord> TestNtupleTool::GetTestRecords(const int counter) c
     records.emplace_back("RULong64", static_cast<LArNtupleRecord::RULong64>(1234UL) + static_cast<LArNtupleRecord::RULong64>(counter));
 
     records.emplace_back("RTString", LArNtupleRecord::RTString("1 2 3 4 " + std::to_string(counter)));
+    records.emplace_back("RCategory", LArNtupleRecord::RCategory("Category " + std::to_string(counter % 3), m_spCategories));
 
     records.emplace_back("RFloatVector", LArNtupleRecord::RFloatVector{1.2f + static_cast<LArNtupleRecord::RFloat>(counter),
                                              -3.4f + static_cast<LArNtupleRecord::RFloat>(counter)});
     records.emplace_back("RIntVector",
         LArNtupleRecord::RIntVector{12 + static_cast<LArNtupleRecord::RInt>(counter), -34 + static_cast<LArNtupleRecord::RInt>(counter)});
 
+    records.emplace_back("RFloatMatrix", LArNtupleRecord::RFloatMatrix{{1.2f + static_cast<LArNtupleRecord::RFloat>(counter)}, {},
+                                             {-3.4f + static_cast<LArNtupleRecord::RFloat>(counter), 5.6f + static_cast<LArNtupleRecord::RFloat>(counter)}});
+
+    // One lazy record inside the branch selection, and one outside it whose producer must never run
+    this->AddLazyRecords({"RLazyInt"}, [counter]() {
+        return std::vector<LArNtupleRecord>{
+            LArNtupleRecord("RLazyInt", static_cast<LArNtupleRecord::RInt>(5678) + static_cast<LArNtupleRecord::RInt>(counter))};
+    });
+
+    this->AddLazyRecords({"UnselectedInt"}, []() -> std::vector<LArNtupleRecord> {
+        std::cerr << "TestNtupleTool: Produced a lazy record outside the branch selection" << std::endl;
+        throw StatusCodeException(STATUS_CODE_FAILURE);
+    });
+
     return records;
 }
 
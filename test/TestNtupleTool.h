@@ -56,6 +56,8 @@ private:
     int m_cosmicCounter;   ///< The cosmic counter
     int m_primaryCounter;  ///< The primary counter
 
+    LArNtupleRecord::RCategory::VocabularySPtr m_spCategories; ///< The vocabulary of test categories
+
     std::vector<LArNtupleRecord> ProcessEvent(
         const pandora::PfoList &pfoList, const std::vector<std::shared_ptr<LArInteractionValidationInfo>> &eventValidationInfo) override;
 
@@ -69,13 +71,13 @@ private:
         const std::shared_ptr<LArMCTargetValidationInfo> &spMcTarget) override;
 
     /**
-     *  @brief  Get the set of test records for a given counter
+     *  @brief  Get the set of test records for a given counter, and add the lazy test records
      *
      *  @param  counter the counter value
      *
      *  @return the test records
      */
-    std::vector<LArNtupleRecord> GetTestRecords(const int counter) const;
+    std::vector<LArNtupleRecord> GetTestRecords(const int counter);
 };
 
 } // namespace lar_physics_content
@@ -6,11 +6,23 @@
  *  $Log: $
  */
 
+#include "../larphysicscontent/LArNtupleReader/LArNtupleReader.h"
+
 #include "Rtypes.h"
+#include "TList.h"
+#include "TParameter.h"
 #include "TString.h"
+#include "TVectorD.h"
 
+#include <stdexcept>
+#include <string>
 #include <vector>
 
+R__LOAD_LIBRARY(libLArNtupleReader)
+
+using lar_physics_content::LArColumnSpan;
+using lar_physics_content::LArNtupleReader;
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 #define TEXT_RED "\033[0;31m"
@@ -80,9 +92,14 @@ Bool_t               GetRBoolValue(const int counter);
 UInt_t               GetRUIntValue(const int counter);
 ULong64_t            GetRULong64Value(const int counter);
 TString              GetRTStringValue(const int counter);
+TString              GetRCategoryValue(const int counter);
+Int_t                GetRCategoryCode(const int counter);
+Int_t                GetRLazyIntValue(const int counter);
 std::vector<Float_t> GetRFloatVectorValue(const int counter);
 std::vector<Int_t>   GetRIntVectorValue(const int counter);
 
+std::vector<std::vector<Float_t>> GetRFloatMatrixValue(const int counter);
+
 //------------------------------------------------------------------------------------------------------------------------------------------
 
 /**
@@ -110,6 +127,115 @@ std::ostream &operator<<(std::ostream &os, const std::vector<T> &vec)
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+/**
+ *  @brief  Rebuild a range of matrix rows from its flat ntuple representation
+ *
+ *  @param  values the flat values
+ *  @param  offsets the offset of each row into the values, plus a trailing end offset
+ *  @param  firstRow the first row
+ *  @param  lastRow one past the last row
+ *
+ *  @return the matrix
+ */
+template <typename T>
+std::vector<std::vector<T>> UnflattenMatrix(const std::vector<T> &values, const std::vector<UInt_t> &offsets, const std::size_t firstRow, const std::size_t lastRow)
+{
+    std::vector<std::vector<T>> matrix;
+
+    for (std::size_t row = firstRow; row < lastRow && row + 1UL < offsets.size(); ++row)
+        matrix.emplace_back(values.begin() + offsets.at(row), values.begin() + offsets.at(row + 1UL));
+
+    return matrix;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  Decode a categorical record using the category dictionary stored in the tree's user info
+ *
+ *  @param  pTree address of the tree
+ *  @param  branchName the branch name
+ *  @param  code the category code
+ *
+ *  @return the category name
+ */
+TString DecodeCategory(TTree *const pTree, const TString &branchName, const Int_t code)
+{
+    const TList *const pDictionary = dynamic_cast<TList *>(pTree->GetUserInfo()->FindObject(branchName + "_categories"));
+
+    if (!pDictionary || code < 0 || code >= pDictionary->GetSize())
+        return TString("<unknown category>");
+
+    return TString(pDictionary->At(code)->GetName());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  Get one of the running statistics of a branch stored in the tree's user info
+ *
+ *  @param  pTree address of the tree
+ *  @param  branchName the branch name
+ *  @param  statisticName the statistic name
+ *
+ *  @return the statistic, or -1 if it is missing
+ */
+Double_t GetBranchStatistic(TTree *const pTree, const TString &branchName, const TString &statisticName)
+{
+    const TList *const pStatistics = dynamic_cast<TList *>(pTree->GetUserInfo()->FindObject(branchName + "_statistics"));
+
+    if (!pStatistics)
+        return -1.;
+
+    const TParameter<Double_t> *const pStatistic = dynamic_cast<TParameter<Double_t> *>(pStatistics->FindObject(statisticName));
+
+    return pStatistic ? pStatistic->GetVal() : -1.;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  Append the values of a column read by the ntuple reader to a vector
+ *
+ *  @param  column the column values
+ *  @param  values the vector to append to
+ */
+template <typename T>
+void AppendColumn(const LArColumnSpan<T> &column, std::vector<T> &values)
+{
+    values.insert(values.end(), column.begin(), column.end());
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+/**
+ *  @brief  Test that the values of a branch read by the ntuple reader match those read by the tree reader
+ *
+ *  @param  branchName the branch name
+ *  @param  readerValues the values read by the ntuple reader
+ *  @param  treeReaderValues the values read by the tree reader
+ *
+ *  @return whether the values match
+ */
+template <typename T>
+bool TestReaderColumn(const TString &branchName, const std::vector<T> &readerValues, const std::vector<T> &treeReaderValues)
+{
+    if (readerValues == treeReaderValues)
+    {
+        std::cout << "[ " << TEXT_GREEN_BOLD << "SUCCESS" << TEXT_NORMAL << " ] Ntuple reader values of " << branchName << " match"
+                  << std::endl;
+        return true;
+    }
+
+    std::cerr << "[ " << TEXT_RED_BOLD << "FAILURE" << TEXT_NORMAL << " ] Ntuple reader values of " << branchName << " do not match"
+              << std::endl;
+    std::cerr << "    - Got values     " << readerValues << std::endl;
+    std::cerr << "    - Correct values " << treeReaderValues << std::endl;
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 /**
  *  @brief  Validate the ntuple produced by the Pandora test ntuple tools
  *
@@ -133,23 +259,34 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
 
     // Prepare the per-event values
     TTreeReaderValue<Float_t>              evt_RFloat(treeReader, "evt_RFloat");
+    TTreeReaderValue<Float_t>              evt_RPreciseFloat(treeReader, "evt_RPreciseFloat");
     TTreeReaderValue<Int_t>                evt_RInt(treeReader, "evt_RInt");
     TTreeReaderValue<Bool_t>               evt_RBool(treeReader, "evt_RBool");
     TTreeReaderValue<UInt_t>               evt_RUInt(treeReader, "evt_RUInt");
     TTreeReaderValue<ULong64_t>            evt_RULong64(treeReader, "evt_RULong64");
     TTreeReaderValue<TString>              evt_RTString(treeReader, "evt_RTString");
+    TTreeReaderValue<Int_t>                evt_RCategory(treeReader, "evt_RCategory");
+    TTreeReaderValue<Int_t>                evt_RLazyInt(treeReader, "evt_RLazyInt");
     TTreeReaderValue<std::vector<Float_t>> evt_RFloatVector(treeReader, "evt_RFloatVector");
     TTreeReaderValue<std::vector<Int_t>>   evt_RIntVector(treeReader, "evt_RIntVector");
+    TTreeReaderValue<std::vector<Float_t>> evt_RFloatMatrix_values(treeReader, "evt_RFloatMatrix_values");
+    TTreeReaderValue<std::vector<UInt_t>>  evt_RFloatMatrix_offsets(treeReader, "evt_RFloatMatrix_offsets");
 
     // Prepare the per-neutrino values
     TTreeReaderValue<std::vector<Float_t>>              nu_RFloat(treeReader, "nu_RFloat");
+    TTreeReaderArray<Float_t>                           nu_RPreciseFloat(treeReader, "nu_RPreciseFloat");
     TTreeReaderValue<std::vector<Int_t>>                nu_RInt(treeReader, "nu_RInt");
     TTreeReaderValue<std::vector<Bool_t>>               nu_RBool(treeReader, "nu_RBool");
     TTreeReaderValue<std::vector<UInt_t>>               nu_RUInt(treeReader, "nu_RUInt");
     TTreeReaderValue<std::vector<ULong64_t>>            nu_RULong64(treeReader, "nu_RULong64");
     TTreeReaderValue<std::vector<TString>>              nu_RTString(treeReader, "nu_RTString");
+    TTreeReaderValue<std::vector<Int_t>>                nu_RCategory(treeReader, "nu_RCategory");
+    TTreeReaderValue<std::vector<Int_t>>                nu_RLazyInt(treeReader, "nu_RLazyInt");
     TTreeReaderValue<std::vector<std::vector<Float_t>>> nu_RFloatVector(treeReader, "nu_RFloatVector");
     TTreeReaderValue<std::vector<std::vector<Int_t>>>   nu_RIntVector(treeReader, "nu_RIntVector");
+    TTreeReaderValue<std::vector<Float_t>>              nu_RFloatMatrix_values(treeReader, "nu_RFloatMatrix_values");
+    TTreeReaderValue<std::vector<UInt_t>>               nu_RFloatMatrix_offsets(treeReader, "nu_RFloatMatrix_offsets");
+    TTreeReaderValue<std::vector<UInt_t>>               nu_RFloatMatrix_elementOffsets(treeReader, "nu_RFloatMatrix_elementOffsets");
 
     // Prepare the per-primary values
     TTreeReaderValue<std::vector<Float_t>>              primary_RFloat(treeReader, "primary_RFloat");
@@ -158,8 +295,13 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
     TTreeReaderValue<std::vector<UInt_t>>               primary_RUInt(treeReader, "primary_RUInt");
     TTreeReaderValue<std::vector<ULong64_t>>            primary_RULong64(treeReader, "primary_RULong64");
     TTreeReaderValue<std::vector<TString>>              primary_RTString(treeReader, "primary_RTString");
+    TTreeReaderValue<std::vector<Int_t>>                primary_RCategory(treeReader, "primary_RCategory");
+    TTreeReaderValue<std::vector<Int_t>>                primary_RLazyInt(treeReader, "primary_RLazyInt");
     TTreeReaderValue<std::vector<std::vector<Float_t>>> primary_RFloatVector(treeReader, "primary_RFloatVector");
     TTreeReaderValue<std::vector<std::vector<Int_t>>>   primary_RIntVector(treeReader, "primary_RIntVector");
+    TTreeReaderValue<std::vector<Float_t>>              primary_RFloatMatrix_values(treeReader, "primary_RFloatMatrix_values");
+    TTreeReaderValue<std::vector<UInt_t>>               primary_RFloatMatrix_offsets(treeReader, "primary_RFloatMatrix_offsets");
+    TTreeReaderValue<std::vector<UInt_t>>               primary_RFloatMatrix_elementOffsets(treeReader, "primary_RFloatMatrix_elementOffsets");
 
     // Prepare the per-cosmic values
     TTreeReaderValue<std::vector<Float_t>>              cr_RFloat(treeReader, "cr_RFloat");
@@ -168,13 +310,47 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
     TTreeReaderValue<std::vector<UInt_t>>               cr_RUInt(treeReader, "cr_RUInt");
     TTreeReaderValue<std::vector<ULong64_t>>            cr_RULong64(treeReader, "cr_RULong64");
     TTreeReaderValue<std::vector<TString>>              cr_RTString(treeReader, "cr_RTString");
+    TTreeReaderValue<std::vector<Int_t>>                cr_RCategory(treeReader, "cr_RCategory");
+    TTreeReaderValue<std::vector<Int_t>>                cr_RLazyInt(treeReader, "cr_RLazyInt");
     TTreeReaderValue<std::vector<std::vector<Float_t>>> cr_RFloatVector(treeReader, "cr_RFloatVector");
     TTreeReaderValue<std::vector<std::vector<Int_t>>>   cr_RIntVector(treeReader, "cr_RIntVector");
+    TTreeReaderValue<std::vector<Float_t>>              cr_RFloatMatrix_values(treeReader, "cr_RFloatMatrix_values");
+    TTreeReaderValue<std::vector<UInt_t>>               cr_RFloatMatrix_offsets(treeReader, "cr_RFloatMatrix_offsets");
+    TTreeReaderValue<std::vector<UInt_t>>               cr_RFloatMatrix_elementOffsets(treeReader, "cr_RFloatMatrix_elementOffsets");
 
     std::cout << "Beginning ntuple validation" << std::endl;
 
-    int successfulTests(0), failedTests(0), warnings(0);
-    int evtCounter(0);
+    int   successfulTests(0), failedTests(0), warnings(0);
+    int   evtCounter(0);
+    Int_t evtRIntMin(0), evtRIntMax(0);
+
+    std::size_t evtMatrixCount(0UL);
+    Float_t     evtMatrixMin(0.f), evtMatrixMax(0.f);
+
+    std::vector<Int_t> fileIds, eventNums, hypothesisIds;
+
+    // The values read by the tree reader, flattened across entries, for comparison with the ntuple reader
+    std::vector<Float_t> evtPreciseFloats, nuPreciseFloats, evtMatrixValues;
+    std::vector<UInt_t>  evtMatrixOffsets;
+    std::vector<Bool_t>  nuBools;
+
+    // Branches outside the branch selection should not have been written
+    for (const TString branchName : {"evt_UnselectedInt", "nu_UnselectedInt", "primary_UnselectedInt", "cr_UnselectedInt"})
+    {
+        if (!treeReader.GetTree()->GetBranch(branchName))
+        {
+            ++successfulTests;
+            std::cout << "[ " << TEXT_GREEN_BOLD << "SUCCESS" << TEXT_NORMAL << " ] Unselected branch " << branchName << " is absent"
+                      << std::endl;
+        }
+
+        else
+        {
+            ++failedTests;
+            std::cerr << "[ " << TEXT_RED_BOLD << "FAILURE" << TEXT_NORMAL << " ] Unselected branch " << branchName << " is present"
+                      << std::endl;
+        }
+    }
 
     while (treeReader.Next())
     {
@@ -204,24 +380,51 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
 
         TEST(GetRFloatValue, *evt_RFloat, *eventNum);
         TEST(GetRIntValue, *evt_RInt, *eventNum);
+        evtRIntMin = (evtCounter == 0) ? *evt_RInt : std::min(evtRIntMin, *evt_RInt);
+        evtRIntMax = (evtCounter == 0) ? *evt_RInt : std::max(evtRIntMax, *evt_RInt);
+        fileIds.push_back(*fileId);
+        eventNums.push_back(*eventNum);
+        hypothesisIds.push_back(*hypothesisId);
         TEST(GetRBoolValue, *evt_RBool, *eventNum);
         TEST(GetRUIntValue, *evt_RUInt, *eventNum);
         TEST(GetRULong64Value, *evt_RULong64, *eventNum);
         TEST(GetRTStringValue, *evt_RTString, *eventNum);
+        TEST(GetRCategoryValue, DecodeCategory(treeReader.GetTree(), "evt_RCategory", *evt_RCategory), *eventNum);
+        TEST(GetRCategoryCode, *evt_RCategory, *eventNum);
+        TEST(GetRLazyIntValue, *evt_RLazyInt, *eventNum);
         TEST(GetRFloatVectorValue, *evt_RFloatVector, *eventNum);
         TEST(GetRIntVectorValue, *evt_RIntVector, *eventNum);
+        TEST(GetRFloatMatrixValue,
+            UnflattenMatrix(*evt_RFloatMatrix_values, *evt_RFloatMatrix_offsets, 0UL, (*evt_RFloatMatrix_offsets).size() - 1UL), *eventNum);
+
+        for (const Float_t value : *evt_RFloatMatrix_values)
+        {
+            evtMatrixMin = (evtMatrixCount == 0UL) ? value : std::min(evtMatrixMin, value);
+            evtMatrixMax = (evtMatrixCount == 0UL) ? value : std::max(evtMatrixMax, value);
+            ++evtMatrixCount;
+        }
+
+        evtPreciseFloats.push_back(*evt_RPreciseFloat);
+        nuPreciseFloats.insert(nuPreciseFloats.end(), nu_RPreciseFloat.begin(), nu_RPreciseFloat.end());
+        evtMatrixValues.insert(evtMatrixValues.end(), (*evt_RFloatMatrix_values).begin(), (*evt_RFloatMatrix_values).end());
+        evtMatrixOffsets.insert(evtMatrixOffsets.end(), (*evt_RFloatMatrix_offsets).begin(), (*evt_RFloatMatrix_offsets).end());
+        nuBools.insert(nuBools.end(), (*nu_RBool).begin(), (*nu_RBool).end());
 
         // Per-neutrino tests
         std::cout << std::endl << "Testing per-neutrino parameters" << std::endl;
 
         TEST_SIZE(*nu_RFloat, *numNeutrinos);
+        TEST_SIZE(nu_RPreciseFloat, *numNeutrinos);
         TEST_SIZE(*nu_RInt, *numNeutrinos);
         TEST_SIZE(*nu_RBool, *numNeutrinos);
         TEST_SIZE(*nu_RUInt, *numNeutrinos);
         TEST_SIZE(*nu_RULong64, *numNeutrinos);
         TEST_SIZE(*nu_RTString, *numNeutrinos);
+        TEST_SIZE(*nu_RCategory, *numNeutrinos);
+        TEST_SIZE(*nu_RLazyInt, *numNeutrinos);
         TEST_SIZE(*nu_RFloatVector, *numNeutrinos);
         TEST_SIZE(*nu_RIntVector, *numNeutrinos);
+        TEST_SIZE(*nu_RFloatMatrix_elementOffsets, *numNeutrinos + 1UL);
 
         for (std::size_t i = 0; i < *numNeutrinos; ++i)
         {
@@ -243,12 +446,24 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
             if (i < (*nu_RTString).size())
                 TEST(GetRTStringValue, (*nu_RTString).at(i), nuCounter);
 
+            if (i < (*nu_RCategory).size())
+                TEST(GetRCategoryValue, DecodeCategory(treeReader.GetTree(), "nu_RCategory", (*nu_RCategory).at(i)), nuCounter);
+
+            if (i < (*nu_RLazyInt).size())
+                TEST(GetRLazyIntValue, (*nu_RLazyInt).at(i), nuCounter);
+
             if (i < (*nu_RFloatVector).size())
                 TEST(GetRFloatVectorValue, (*nu_RFloatVector).at(i), nuCounter);
 
             if (i < (*nu_RIntVector).size())
                 TEST(GetRIntVectorValue, (*nu_RIntVector).at(i), nuCounter);
 
+            if (i + 1UL < (*nu_RFloatMatrix_elementOffsets).size())
+                TEST(GetRFloatMatrixValue,
+                    UnflattenMatrix(*nu_RFloatMatrix_values, *nu_RFloatMatrix_offsets, (*nu_RFloatMatrix_elementOffsets).at(i),
+                        (*nu_RFloatMatrix_elementOffsets).at(i + 1UL)),
+                    nuCounter);
+
             ++nuCounter;
         }
 
@@ -261,8 +476,11 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
         TEST_SIZE(*primary_RUInt, *numPrimaries);
         TEST_SIZE(*primary_RULong64, *numPrimaries);
         TEST_SIZE(*primary_RTString, *numPrimaries);
+        TEST_SIZE(*primary_RCategory, *numPrimaries);
+        TEST_SIZE(*primary_RLazyInt, *numPrimaries);
         TEST_SIZE(*primary_RFloatVector, *numPrimaries);
         TEST_SIZE(*primary_RIntVector, *numPrimaries);
+        TEST_SIZE(*primary_RFloatMatrix_elementOffsets, *numPrimaries + 1UL);
 
         for (std::size_t i = 0; i < *numPrimaries; ++i)
         {
@@ -284,12 +502,24 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
             if (i < (*primary_RTString).size())
                 TEST(GetRTStringValue, (*primary_RTString).at(i), primaryCounter);
 
+            if (i < (*primary_RCategory).size())
+                TEST(GetRCategoryValue, DecodeCategory(treeReader.GetTree(), "primary_RCategory", (*primary_RCategory).at(i)), primaryCounter);
+
+            if (i < (*primary_RLazyInt).size())
+                TEST(GetRLazyIntValue, (*primary_RLazyInt).at(i), primaryCounter);
+
             if (i < (*primary_RFloatVector).size())
                 TEST(GetRFloatVectorValue, (*primary_RFloatVector).at(i), primaryCounter);
 
             if (i < (*primary_RIntVector).size())
                 TEST(GetRIntVectorValue, (*primary_RIntVector).at(i), primaryCounter);
 
+            if (i + 1UL < (*primary_RFloatMatrix_elementOffsets).size())
+                TEST(GetRFloatMatrixValue,
+                    UnflattenMatrix(*primary_RFloatMatrix_values, *primary_RFloatMatrix_offsets, (*primary_RFloatMatrix_elementOffsets).at(i),
+                        (*primary_RFloatMatrix_elementOffsets).at(i + 1UL)),
+                    primaryCounter);
+
             ++primaryCounter;
         }
 
@@ -302,8 +532,11 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
         TEST_SIZE(*cr_RUInt, *numCosmicRays);
         TEST_SIZE(*cr_RULong64, *numCosmicRays);
         TEST_SIZE(*cr_RTString, *numCosmicRays);
+        TEST_SIZE(*cr_RCategory, *numCosmicRays);
+        TEST_SIZE(*cr_RLazyInt, *numCosmicRays);
         TEST_SIZE(*cr_RFloatVector, *numCosmicRays);
         TEST_SIZE(*cr_RIntVector, *numCosmicRays);
+        TEST_SIZE(*cr_RFloatMatrix_elementOffsets, *numCosmicRays + 1UL);
 
         for (std::size_t i = 0; i < *numCosmicRays; ++i)
         {
@@ -325,18 +558,168 @@ void ValidateNtuple(const TString &filePath, const TString &ntupleName = "Pandor
             if (i < (*cr_RTString).size())
                 TEST(GetRTStringValue, (*cr_RTString).at(i), cosmicCounter);
 
+            if (i < (*cr_RCategory).size())
+                TEST(GetRCategoryValue, DecodeCategory(treeReader.GetTree(), "cr_RCategory", (*cr_RCategory).at(i)), cosmicCounter);
+
+            if (i < (*cr_RLazyInt).size())
+                TEST(GetRLazyIntValue, (*cr_RLazyInt).at(i), cosmicCounter);
+
             if (i < (*cr_RFloatVector).size())
                 TEST(GetRFloatVectorValue, (*cr_RFloatVector).at(i), cosmicCounter);
 
             if (i < (*cr_RIntVector).size())
                 TEST(GetRIntVectorValue, (*cr_RIntVector).at(i), cosmicCounter);
 
+            if (i + 1UL < (*cr_RFloatMatrix_elementOffsets).size())
+                TEST(GetRFloatMatrixValue,
+                    UnflattenMatrix(*cr_RFloatMatrix_values, *cr_RFloatMatrix_offsets, (*cr_RFloatMatrix_elementOffsets).at(i),
+                        (*cr_RFloatMatrix_elementOffsets).at(i + 1UL)),
+                    cosmicCounter);
+
             ++cosmicCounter;
         }
 
         ++evtCounter;
     }
 
+    // The running statistics written with the tree should agree with the values read back
+    TTree *const   pTree = treeReader.GetTree();
+    const Double_t count(GetBranchStatistic(pTree, "evt_RInt", "count")), min(GetBranchStatistic(pTree, "evt_RInt", "min")),
+        max(GetBranchStatistic(pTree, "evt_RInt", "max"));
+
+    if (count == evtCounter && min == evtRIntMin && max == evtRIntMax)
+    {
+        ++successfulTests;
+        std::cout << "[ " << TEXT_GREEN_BOLD << "SUCCESS" << TEXT_NORMAL << " ] Statistics of evt_RInt match its values" << std::endl;
+    }
+
+    else
+    {
+        ++failedTests;
+        std::cerr << "[ " << TEXT_RED_BOLD << "FAILURE" << TEXT_NORMAL << " ] Statistics of evt_RInt do not match its values" << std::endl;
+        std::cerr << "    - Got count, min, max     " << count << ", " << min << ", " << max << std::endl;
+        std::cerr << "    - Correct count, min, max " << evtCounter << ", " << evtRIntMin << ", " << evtRIntMax << std::endl;
+    }
+
+    // Matrix statistics are kept under the flattened values branch, which is the one readers look up
+    const Double_t matrixCount(GetBranchStatistic(pTree, "evt_RFloatMatrix_values", "count")),
+        matrixMin(GetBranchStatistic(pTree, "evt_RFloatMatrix_values", "min")),
+        matrixMax(GetBranchStatistic(pTree, "evt_RFloatMatrix_values", "max"));
+
+    if (matrixCount == evtMatrixCount && static_cast<Float_t>(matrixMin) == evtMatrixMin && static_cast<Float_t>(matrixMax) == evtMatrixMax)
+    {
+        ++successfulTests;
+        std::cout << "[ " << TEXT_GREEN_BOLD << "SUCCESS" << TEXT_NORMAL << " ] Statistics of evt_RFloatMatrix_values match its values"
+                  << std::endl;
+    }
+
+    else
+    {
+        ++failedTests;
+        std::cerr << "[ " << TEXT_RED_BOLD << "FAILURE" << TEXT_NORMAL << " ] Statistics of evt_RFloatMatrix_values do not match its values"
+                  << std::endl;
+        std::cerr << "    - Got count, min, max     " << matrixCount << ", " << matrixMin << ", " << matrixMax << std::endl;
+        std::cerr << "    - Correct count, min, max " << evtMatrixCount << ", " << evtMatrixMin << ", " << evtMatrixMax << std::endl;
+    }
+
+    // The eventNum zone map should cover the entries in order, each zone bounding the values in it
+    const TList *const pZoneMap = dynamic_cast<TList *>(pTree->GetUserInfo()->FindObject("eventNum_zones"));
+    Long64_t           coveredEntry(0);
+    bool               areZonesValid(pZoneMap != nullptr);
+
+    for (TIter zoneIter(pZoneMap); areZonesValid && zoneIter.Next();)
+    {
+        const TVectorD *const pZone = dynamic_cast<const TVectorD *>(*zoneIter);
+
+        if (!pZone || pZone->GetNrows() != 4 || static_cast<Long64_t>((*pZone)[0]) != coveredEntry || (*pZone)[1] > eventNums.size())
+        {
+            areZonesValid = false;
+            break;
+        }
+
+        for (; coveredEntry < static_cast<Long64_t>((*pZone)[1]); ++coveredEntry)
+            areZonesValid &= (eventNums.at(coveredEntry) >= (*pZone)[2] && eventNums.at(coveredEntry) <= (*pZone)[3]);
+    }
+
+    if (areZonesValid && coveredEntry == static_cast<Long64_t>(eventNums.size()))
+    {
+        ++successfulTests;
+        std::cout << "[ " << TEXT_GREEN_BOLD << "SUCCESS" << TEXT_NORMAL << " ] Zone map of eventNum bounds its values" << std::endl;
+    }
+
+    else
+    {
+        ++failedTests;
+        std::cerr << "[ " << TEXT_RED_BOLD << "FAILURE" << TEXT_NORMAL << " ] Zone map of eventNum does not bound its values" << std::endl;
+    }
+
+    // The event index written with the tree should find an entry with the key of each entry
+    bool isIndexValid(pTree->GetTreeIndex() != nullptr);
+
+    for (std::size_t entry = 0UL; isIndexValid && entry < eventNums.size(); ++entry)
+    {
+        const Long64_t minorKey(eventNums.at(entry) * 65536LL + hypothesisIds.at(entry));
+        const Long64_t foundEntry(pTree->GetEntryNumberWithIndex(fileIds.at(entry), minorKey));
+
+        isIndexValid = foundEntry >= 0 && foundEntry < static_cast<Long64_t>(eventNums.size()) &&
+            fileIds.at(foundEntry) == fileIds.at(entry) && eventNums.at(foundEntry) == eventNums.at(entry) &&
+            hypothesisIds.at(foundEntry) == hypothesisIds.at(entry);
+    }
+
+    if (isIndexValid)
+    {
+        ++successfulTests;
+        std::cout << "[ " << TEXT_GREEN_BOLD << "SUCCESS" << TEXT_NORMAL << " ] Event index finds every event" << std::endl;
+    }
+
+    else
+    {
+        ++failedTests;
+        std::cerr << "[ " << TEXT_RED_BOLD << "FAILURE" << TEXT_NORMAL << " ] Event index does not find every event" << std::endl;
+    }
+
+    // The ntuple reader should read the matrix, Float16_t and vector<bool> columns as the tree reader does, using its own copy of the tree
+    TFile                readerFile(filePath);
+    TTree *const         pReaderTree = dynamic_cast<TTree *>(readerFile.Get(ntupleName));
+    std::vector<Float_t> readerEvtPreciseFloats, readerNuPreciseFloats, readerEvtMatrixValues;
+    std::vector<UInt_t>  readerEvtMatrixOffsets;
+    std::vector<Bool_t>  readerNuBools;
+
+    try
+    {
+        LArNtupleReader reader(pReaderTree,
+            {"evt_RPreciseFloat", "nu_RPreciseFloat", "evt_RFloatMatrix_values", "evt_RFloatMatrix_offsets", "nu_RBool"});
+
+        for (const LArNtupleReader::EntryRange &entryRange : reader.GetClusterRanges())
+        {
+            reader.ReadEntries(entryRange.first, entryRange.second);
+            AppendColumn(reader.GetScalarColumn<Float_t>("evt_RPreciseFloat"), readerEvtPreciseFloats);
+            AppendColumn(reader.GetVectorColumn<Float_t>("nu_RPreciseFloat"), readerNuPreciseFloats);
+            AppendColumn(reader.GetVectorColumn<Float_t>("evt_RFloatMatrix_values"), readerEvtMatrixValues);
+            AppendColumn(reader.GetVectorColumn<UInt_t>("evt_RFloatMatrix_offsets"), readerEvtMatrixOffsets);
+            AppendColumn(reader.GetVectorColumn<Bool_t>("nu_RBool"), readerNuBools);
+        }
+
+        for (const bool isMatch : {TestReaderColumn("evt_RPreciseFloat", readerEvtPreciseFloats, evtPreciseFloats),
+                 TestReaderColumn("nu_RPreciseFloat", readerNuPreciseFloats, nuPreciseFloats),
+                 TestReaderColumn("evt_RFloatMatrix_values", readerEvtMatrixValues, evtMatrixValues),
+                 TestReaderColumn("evt_RFloatMatrix_offsets", readerEvtMatrixOffsets, evtMatrixOffsets),
+                 TestReaderColumn("nu_RBool", readerNuBools, nuBools)})
+        {
+            if (isMatch)
+                ++successfulTests;
+
+            else
+                ++failedTests;
+        }
+    }
+
+    catch (const std::runtime_error &error)
+    {
+        ++failedTests;
+        std::cerr << "[ " << TEXT_RED_BOLD << "FAILURE" << TEXT_NORMAL << " ] Ntuple reader failed: " << error.what() << std::endl;
+    }
+
     // Print summary
     std::cout << "--------------------------------------------------------------------------------------------" << std::endl;
     std::cout << "Processed " << TEXT_WHITE_BOLD << evtCounter << " event(s) " << TEXT_NORMAL << "with " << TEXT_GREEN_BOLD
@@ -388,6 +771,28 @@ TString GetRTStringValue(const int counter)
 
 //------------------------------------------------------------------------------------------------------------------------------------------
 
+TString GetRCategoryValue(const int counter)
+{
+    return TString("Category " + std::to_string(counter % 3));
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+Int_t GetRCategoryCode(const int counter)
+{
+    // The test categories are declared in order, so the code of each is fixed by its vocabulary rather than by the order they are seen
+    return static_cast<Int_t>(counter % 3);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+Int_t GetRLazyIntValue(const int counter)
+{
+    return static_cast<Int_t>(5678) + static_cast<Int_t>(counter);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
 std::vector<Float_t> GetRFloatVectorValue(const int counter)
 {
     return std::vector<Float_t>{1.2f + static_cast<Float_t>(counter), -3.4f + static_cast<Float_t>(counter)};
@@ -398,4 +803,12 @@ std::vector<Float_t> GetRFloatVectorValue(const int counter)
 std::vector<Int_t> GetRIntVectorValue(const int counter)
 {
     return std::vector<Int_t>{12 + static_cast<Int_t>(counter), -34 + static_cast<Int_t>(counter)};
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::vector<Float_t>> GetRFloatMatrixValue(const int counter)
+{
+    return std::vector<std::vector<Float_t>>{
+        {1.2f + static_cast<Float_t>(counter)}, {}, {-3.4f + static_cast<Float_t>(counter), 5.6f + static_cast<Float_t>(counter)}};
+}